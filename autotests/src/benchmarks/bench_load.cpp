@@ -0,0 +1,139 @@
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QTextStream>
+
+#include <kateglobal.h>
+#include <katetextbuffer.h>
+
+static constexpr int lines = 1000000;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for file loading and saving"));
+    p.addHelpOption();
+    p.addPositionalArgument(QStringLiteral("file"), QStringLiteral("File to load, a generated one is used if not given"));
+    // number of lines of generated file
+    QCommandLineOption linesOpt(QStringLiteral("l"),
+                                QStringLiteral("Number of lines of the generated file"),
+                                QStringLiteral("lines"),
+                                QString::number(lines));
+    p.addOption(linesOpt);
+    // number of iterations
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of times the file is loaded"), QStringLiteral("iters"), QStringLiteral("5"));
+    p.addOption(iterOpt);
+    // codec to load with
+    QCommandLineOption codecOpt(QStringLiteral("c"), QStringLiteral("Codec to load the file with"), QStringLiteral("codec"), QStringLiteral("UTF-8"));
+    p.addOption(codecOpt);
+    // disable parallel loading, to compare against it
+    QCommandLineOption serialOpt(QStringLiteral("s"), QStringLiteral("Load the file with one thread only"));
+    p.addOption(serialOpt);
+    // measure saving the loaded text instead
+    QCommandLineOption saveOpt(QStringLiteral("w"), QStringLiteral("Measure saving the loaded text to a temporary file instead of loading"));
+    p.addOption(saveOpt);
+
+    p.process(app);
+
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    // either use the given file or generate some log like content
+    QString fileName;
+    QTemporaryFile generated;
+    if (!p.positionalArguments().isEmpty()) {
+        fileName = p.positionalArguments().constFirst();
+    } else {
+        bool ok = false;
+        int linesInFile = p.value(linesOpt).toInt(&ok);
+        if (!ok || linesInFile <= 0) {
+            linesInFile = lines;
+        }
+
+        if (!generated.open()) {
+            qWarning("failed to create temporary file");
+            return 1;
+        }
+
+        QTextStream stream(&generated);
+        stream.setCodec("UTF-8");
+        for (int i = 0; i < linesInFile; ++i) {
+            stream << QStringLiteral("2021-01-01 12:00:%1 [worker-%2] INFO request handled; status=200 bytes=%3 path=/api/v1/items/%4\n")
+                          .arg(i % 60, 2, 10, QLatin1Char('0'))
+                          .arg(i % 16)
+                          .arg(i * 7)
+                          .arg(i);
+        }
+        stream.flush();
+        generated.close();
+        fileName = generated.fileName();
+    }
+
+    bool ok = false;
+    int iters = p.value(iterOpt).toInt(&ok);
+    if (!ok || iters <= 0) {
+        iters = 5;
+    }
+
+    const double megaBytes = QFileInfo(fileName).size() / (1024.0 * 1024.0);
+    QTextCodec *codec = QTextCodec::codecForName(p.value(codecOpt).toLatin1());
+    if (!codec) {
+        codec = QTextCodec::codecForName("UTF-8");
+    }
+
+    QTemporaryFile saved;
+    if (p.isSet(saveOpt)) {
+        if (!saved.open()) {
+            qWarning("failed to create temporary file");
+            return 1;
+        }
+        saved.close();
+    }
+
+    qint64 bestTime = -1;
+    qint64 totalTime = 0;
+    int linesLoaded = 0;
+    for (int i = 0; i < iters; ++i) {
+        Kate::TextBuffer buffer(nullptr);
+        buffer.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+        buffer.setTextCodec(codec);
+        buffer.setParallelLoadThreshold(p.isSet(serialOpt) ? 0 : 1);
+
+        bool encodingErrors = false;
+        bool tooLongLines = false;
+        int longestLineLoaded = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!buffer.load(fileName, encodingErrors, tooLongLines, longestLineLoaded, false)) {
+            qWarning("failed to load %s", qPrintable(fileName));
+            return 1;
+        }
+        qint64 elapsed = qMax(qint64(1), timer.elapsed());
+
+        if (p.isSet(saveOpt)) {
+            timer.restart();
+            if (!buffer.save(saved.fileName())) {
+                qWarning("failed to save %s", qPrintable(saved.fileName()));
+                return 1;
+            }
+            elapsed = qMax(qint64(1), timer.elapsed());
+        }
+
+        totalTime += elapsed;
+        if (bestTime < 0 || elapsed < bestTime) {
+            bestTime = elapsed;
+        }
+        linesLoaded = buffer.lines();
+    }
+
+    printf("file: %s (%.1f MB, %d lines)\n", qPrintable(fileName), megaBytes, linesLoaded);
+    printf("best: %lld ms, %.1f MB/s\n", bestTime, megaBytes * 1000.0 / bestTime);
+    printf("average: %lld ms, %.1f MB/s\n", totalTime / iters, megaBytes * 1000.0 * iters / totalTime);
+
+    return 0;
+}
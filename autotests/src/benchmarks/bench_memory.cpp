@@ -0,0 +1,115 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+
+#include <katebuffer.h>
+#include <katedocument.h>
+#include <kateglobal.h>
+#include <kateundomanager.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static constexpr int lines = 1000000;
+
+/**
+ * Bytes currently allocated on the heap, -1 if not available on this platform.
+ */
+static qint64 heapUsage()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return qint64(mallinfo2().uordblks);
+#elif defined(__GLIBC__)
+    return qint64(uint(mallinfo().uordblks));
+#else
+    return -1;
+#endif
+}
+
+static void report(const char *what, qint64 before, qint64 after, int linesInText)
+{
+    if (before < 0 || after < 0) {
+        printf("%s: heap usage not available on this platform\n", what);
+        return;
+    }
+    printf("%s: %.1f MB, %.1f bytes per line\n", what, (after - before) / (1024.0 * 1024.0), double(after - before) / linesInText);
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Memory benchmark for the text buffer"));
+    p.addHelpOption();
+    // number of lines
+    QCommandLineOption linesOpt(QStringLiteral("l"), QStringLiteral("Number of lines of the text"), QStringLiteral("lines"), QString::number(lines));
+    p.addOption(linesOpt);
+    // highlighting to use
+    QCommandLineOption modeOpt(QStringLiteral("m"), QStringLiteral("Highlighting mode to use"), QStringLiteral("mode"), QStringLiteral("C++"));
+    p.addOption(modeOpt);
+
+    p.process(app);
+
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    bool ok = false;
+    int linesInText = p.value(linesOpt).toInt(&ok);
+    if (!ok || linesInText <= 0) {
+        linesInText = lines;
+    }
+
+    printf("lines: %d, sizeof(TextLineData): %d bytes\n", linesInText, int(sizeof(Kate::TextLineData)));
+
+    KTextEditor::DocumentPrivate doc;
+
+    // text only, the generated text and the undo history are gone before the heap usage is measured again
+    const qint64 before = heapUsage();
+    {
+        // source code like content, with some empty lines
+        QString text;
+        for (int i = 0; i < linesInText; ++i) {
+            switch (i % 8) {
+            case 0:
+                text += QStringLiteral("void function%1(int argument)\n").arg(i);
+                break;
+            case 1:
+                text += QStringLiteral("{\n");
+                break;
+            case 2:
+                text += QStringLiteral("    // compute the value for %1\n").arg(i);
+                break;
+            case 3:
+                text += QStringLiteral("    const int value = argument * %1;\n").arg(i);
+                break;
+            case 4:
+                text += QStringLiteral("\n");
+                break;
+            case 5:
+                text += QStringLiteral("    return value;\n");
+                break;
+            case 6:
+                text += QStringLiteral("}\n");
+                break;
+            default:
+                text += QStringLiteral("\n");
+                break;
+            }
+        }
+        doc.setText(text);
+    }
+    doc.undoManager()->clearUndo();
+    doc.undoManager()->clearRedo();
+    const qint64 afterText = heapUsage();
+    report("text", before, afterText, linesInText);
+
+    // highlighting, on top of the text
+    doc.setHighlightingMode(p.value(modeOpt));
+    doc.buffer().ensureHighlighted(doc.lines() - 1);
+    const qint64 afterHighlighting = heapUsage();
+    report("highlighting", afterText, afterHighlighting, linesInText);
+    report("text + highlighting", before, afterHighlighting, linesInText);
+
+    return 0;
+}
@@ -1,31 +1,340 @@
 #include <QApplication>
 #include <QCommandLineOption>
 #include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
 
 #include <KMainWindow>
+#include <KTextEditor/Command>
+#include <KTextEditor/Editor>
 #include <katedocument.h>
+#include <kateglobal.h>
+#include <kateplaintextsearch.h>
+#include <kateregexpsearch.h>
 #include <katesearchbar.h>
 #include <kateview.h>
 
-static constexpr int lines = 100000;
+#include <functional>
+
+static constexpr int lines = 10000;
+static constexpr int iterations = 3;
+
+/**
+ * Generated text to search in, with the patterns the benchmarks search for in it.
+ */
+struct Corpus {
+    QString name;
+    QStringList lines;
+    // literal that occurs in many lines
+    QString plain;
+    // literal searched as whole word, it also occurs as part of other words
+    QString word;
+    // literal that spans two lines
+    QString multiLine;
+    // regular expression with two captures, swapped by the replacement
+    QString regex;
+    QString replacement;
+    // regular expression that spans two lines
+    QString multiLineRegex;
+};
+
+/**
+ * Source code like text, functions of 10 lines.
+ */
+static Corpus sourceCorpus(int lineCount)
+{
+    Corpus corpus;
+    corpus.name = QStringLiteral("source");
+    corpus.lines.reserve(lineCount);
+    for (int i = 0; i < lineCount; ++i) {
+        const int function = i / 10;
+        switch (i % 10) {
+        case 0:
+            corpus.lines.append(QStringLiteral("// compute the values of item %1").arg(function));
+            break;
+        case 1:
+            corpus.lines.append(QStringLiteral("int computeValue%1(const Item &item)").arg(function));
+            break;
+        case 2:
+            corpus.lines.append(QStringLiteral("{"));
+            break;
+        case 3:
+            corpus.lines.append(QStringLiteral("    const int value = item.value() * %1;").arg(function % 97));
+            break;
+        case 4:
+            corpus.lines.append(QStringLiteral("    if (value > limit) {"));
+            break;
+        case 5:
+            corpus.lines.append(QStringLiteral("        return value - limit;"));
+            break;
+        case 6:
+            corpus.lines.append(QStringLiteral("    }"));
+            break;
+        case 7:
+            corpus.lines.append(QStringLiteral("    return value;"));
+            break;
+        case 8:
+            corpus.lines.append(QStringLiteral("}"));
+            break;
+        default:
+            corpus.lines.append(QString());
+            break;
+        }
+    }
+    corpus.plain = QStringLiteral("value");
+    corpus.word = QStringLiteral("value");
+    corpus.multiLine = QStringLiteral("    }\n    return");
+    corpus.regex = QStringLiteral("(\\w+)\\.value\\(\\) \\* (\\d+)");
+    corpus.replacement = QStringLiteral("\\2 * \\1.value()");
+    corpus.multiLineRegex = QStringLiteral("(\\w+)\\(const Item &item\\)\\n\\{");
+    return corpus;
+}
+
+/**
+ * Minified JavaScript, one statement after the other without line breaks.
+ */
+static QString minifiedStatement(int i)
+{
+    return QStringLiteral("function a%1(b,c){var d=b.value*%2;if(d>c){return d-c}return d}var e%1=a%1(x,%3);").arg(i).arg(i % 97).arg(i % 13);
+}
+
+/**
+ * Minified JavaScript, with the given number of statements per line.
+ */
+static Corpus minifiedCorpus(const QString &name, int lineCount, int statementsPerLine)
+{
+    Corpus corpus;
+    corpus.name = name;
+    corpus.lines.reserve(lineCount);
+    for (int i = 0; i < lineCount; ++i) {
+        QString line;
+        for (int j = 0; j < statementsPerLine; ++j) {
+            line += minifiedStatement(i * statementsPerLine + j);
+        }
+        corpus.lines.append(line);
+    }
+    corpus.plain = QStringLiteral("return");
+    corpus.word = QStringLiteral("d");
+    corpus.multiLine = QStringLiteral(");\nfunction a");
+    corpus.regex = QStringLiteral("var (\\w+)=(\\w+)\\(");
+    corpus.replacement = QStringLiteral("let \\2=\\1(");
+    corpus.multiLineRegex = QStringLiteral("(\\d+)\\);\\nfunction");
+    return corpus;
+}
+
+/**
+ * Log file, like the one of bench_load.
+ */
+static Corpus logCorpus(int lineCount)
+{
+    Corpus corpus;
+    corpus.name = QStringLiteral("log");
+    corpus.lines.reserve(lineCount);
+    for (int i = 0; i < lineCount; ++i) {
+        const int status = (i % 101 == 0) ? 500 : ((i % 7 == 0) ? 404 : 200);
+        corpus.lines.append(QStringLiteral("2021-01-01 12:00:%1 [worker-%2] INFO request handled; status=%3 bytes=%4 path=/api/v1/items/%5 time=%6 ms")
+                                .arg(i % 60, 2, 10, QLatin1Char('0'))
+                                .arg(i % 16)
+                                .arg(status)
+                                .arg(i * 7)
+                                .arg(i)
+                                .arg(i % 250));
+    }
+    corpus.plain = QStringLiteral("status=500");
+    corpus.word = QStringLiteral("item");
+    corpus.multiLine = QStringLiteral(" ms\n2021-01-01");
+    corpus.regex = QStringLiteral("status=(\\d+) bytes=(\\d+)");
+    corpus.replacement = QStringLiteral("bytes=\\2 status=\\1");
+    corpus.multiLineRegex = QStringLiteral("(\\d+) ms\\n2021");
+    return corpus;
+}
+
+static Corpus generateCorpus(const QString &name, int lineCount)
+{
+    if (name == QLatin1String("source")) {
+        return sourceCorpus(lineCount);
+    } else if (name == QLatin1String("js")) {
+        return minifiedCorpus(name, lineCount, 8);
+    } else if (name == QLatin1String("log")) {
+        return logCorpus(lineCount);
+    } else if (name == QLatin1String("long")) {
+        // the text of 1000 lines of the js corpus in each line
+        return minifiedCorpus(name, qMax(1, lineCount / 1000), 8 * 1000);
+    }
+    return Corpus();
+}
+
+/**
+ * Measures one pass over the document, made of steps, each one like one user action.
+ * The pass ends with the last step.
+ */
+class Measurement
+{
+public:
+    void start()
+    {
+        m_timer.start();
+        m_stepTimer.start();
+    }
+
+    void step()
+    {
+        m_slowestStep = qMax(m_slowestStep, m_stepTimer.nsecsElapsed());
+        m_elapsed = m_timer.nsecsElapsed();
+        m_stepTimer.start();
+    }
+
+    qint64 elapsed() const
+    {
+        return qMax(qint64(1), m_elapsed);
+    }
+
+    qint64 slowestStep() const
+    {
+        return m_slowestStep;
+    }
+
+    int matches = 0;
+
+private:
+    QElapsedTimer m_timer;
+    QElapsedTimer m_stepTimer;
+    qint64 m_elapsed = 0;
+    qint64 m_slowestStep = 0;
+};
+
+/**
+ * Find next over the whole document with the plain text search, forwards or backwards.
+ */
+static void findPlainText(KTextEditor::DocumentPrivate &doc, const QString &pattern, Qt::CaseSensitivity caseSensitivity, bool wholeWords, bool backwards, Measurement &m)
+{
+    KatePlainTextSearch search(&doc, caseSensitivity, wholeWords);
+    KTextEditor::Range range = doc.documentRange();
+    m.start();
+    for (;;) {
+        const KTextEditor::Range match = search.search(pattern, range, backwards);
+        m.step();
+        if (!match.isValid()) {
+            break;
+        }
+        ++m.matches;
+        if (backwards) {
+            range.setEnd(match.start());
+        } else {
+            range.setStart(match.end());
+        }
+    }
+}
+
+/**
+ * Find next over the whole document with the prepared regular expression search, forwards or backwards.
+ */
+static void findRegExp(KTextEditor::DocumentPrivate &doc, const QString &pattern, QRegularExpression::PatternOptions options, bool backwards, Measurement &m)
+{
+    m.start();
+    KateRegExpSearch search(&doc, pattern, options);
+    KTextEditor::Range range = doc.documentRange();
+    for (;;) {
+        const KTextEditor::Range match = search.search(range, backwards).at(0);
+        m.step();
+        if (!match.isValid()) {
+            break;
+        }
+        ++m.matches;
+        if (backwards) {
+            range.setEnd(match.start());
+        } else {
+            range.setStart(match.end());
+        }
+    }
+}
+
+/**
+ * Find all or replace all of the search bar, until it is finished.
+ */
+static void searchBar(KateSearchBar &bar, KateSearchBar::SearchMode mode, const QString &pattern, const QString &replacement, Measurement &m)
+{
+    bar.setSearchMode(mode);
+    bar.setMatchCase(true);
+    bar.setSearchPattern(pattern);
+    bar.setReplacementPattern(replacement);
+
+    bool finished = false;
+    QEventLoop loop;
+    const auto connection = QObject::connect(&bar, &KateSearchBar::findOrReplaceAllFinished, &loop, [&finished, &loop]() {
+        finished = true;
+        loop.quit();
+    });
+
+    m.start();
+    if (replacement.isNull()) {
+        bar.findAll();
+    } else {
+        bar.replaceAll();
+    }
+    if (!finished) {
+        loop.exec();
+    }
+    m.step();
+    QObject::disconnect(connection);
+}
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
     QCommandLineParser p;
-    p.setApplicationDescription(QStringLiteral("Performance benchmark for search"));
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for search and replace"));
     p.addHelpOption();
+    // number of lines of the generated texts
+    QCommandLineOption linesOpt(QStringLiteral("l"),
+                                QStringLiteral("Comma separated numbers of lines of the generated texts, e.g. 10000,1000000,10000000"),
+                                QStringLiteral("lines"),
+                                QString::number(lines));
+    p.addOption(linesOpt);
     // number of iterations
     QCommandLineOption iterOpt(QStringLiteral("i"),
-                               QStringLiteral("Number of lines of text in which search will happen"),
+                               QStringLiteral("Number of times each benchmark is run, the best run is reported"),
                                QStringLiteral("iters"),
-                               QStringLiteral("0"));
+                               QString::number(iterations));
     p.addOption(iterOpt);
+    // which texts
+    QCommandLineOption corpusOpt(QStringLiteral("c"),
+                                 QStringLiteral("Comma separated generated texts to search in: source, js (minified), log, long (lines of 1000 js lines)"),
+                                 QStringLiteral("corpora"),
+                                 QStringLiteral("source,js,log,long"));
+    p.addOption(corpusOpt);
+    // which benchmarks
+    QCommandLineOption modeOpt(QStringLiteral("m"),
+                               QStringLiteral("Comma separated benchmarks to run, all if not given: plain, plain-backward, case-insensitive, whole-words, multi-line, "
+                                              "regex, regex-backward, regex-case-insensitive, regex-multi-line, find-all, replace-all, vi-substitute"),
+                               QStringLiteral("modes"));
+    p.addOption(modeOpt);
 
     p.process(app);
+
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
     bool ok = false;
     int iters = p.value(iterOpt).toInt(&ok);
+    if (!ok || iters <= 0) {
+        iters = iterations;
+    }
+
+    QVector<int> lineCounts;
+    const QStringList lineCountValues = p.value(linesOpt).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &value : lineCountValues) {
+        const int lineCount = value.toInt(&ok);
+        if (ok && lineCount > 0) {
+            lineCounts.append(lineCount);
+        }
+    }
+    if (lineCounts.isEmpty()) {
+        lineCounts.append(lines);
+    }
+
+    const QStringList corpora = p.value(corpusOpt).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    const QStringList modes = p.value(modeOpt).split(QLatin1Char(','), Qt::SkipEmptyParts);
 
     KMainWindow *w = new KMainWindow;
     app.setActiveWindow(w);
@@ -34,24 +343,117 @@ int main(int argc, char *argv[])
     KTextEditor::ViewPrivate view(&doc, nullptr);
     KateViewConfig config(&view);
     KateSearchBar bar(true, &view, &config);
+    KTextEditor::Command *substitute = KTextEditor::Editor::instance()->queryCommand(QStringLiteral("s"));
 
-    int linesInText = ok ? (iters > 0 ? iters : lines) : lines;
+    // all benchmarks, they search in the document with the text of the corpus
+    using Benchmark = std::function<void(const Corpus &, Measurement &)>;
+    const QVector<QPair<QString, Benchmark>> benchmarks = {
+        {QStringLiteral("plain"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findPlainText(doc, c.plain, Qt::CaseSensitive, false, false, m);
+         }},
+        {QStringLiteral("plain-backward"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findPlainText(doc, c.plain, Qt::CaseSensitive, false, true, m);
+         }},
+        {QStringLiteral("case-insensitive"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findPlainText(doc, c.plain.toUpper(), Qt::CaseInsensitive, false, false, m);
+         }},
+        {QStringLiteral("whole-words"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findPlainText(doc, c.word, Qt::CaseSensitive, true, false, m);
+         }},
+        {QStringLiteral("multi-line"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findPlainText(doc, c.multiLine, Qt::CaseSensitive, false, false, m);
+         }},
+        {QStringLiteral("regex"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findRegExp(doc, c.regex, QRegularExpression::NoPatternOption, false, m);
+         }},
+        {QStringLiteral("regex-backward"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findRegExp(doc, c.regex, QRegularExpression::NoPatternOption, true, m);
+         }},
+        {QStringLiteral("regex-case-insensitive"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findRegExp(doc, c.regex, QRegularExpression::CaseInsensitiveOption, false, m);
+         }},
+        {QStringLiteral("regex-multi-line"),
+         [&doc](const Corpus &c, Measurement &m) {
+             findRegExp(doc, c.multiLineRegex, QRegularExpression::NoPatternOption, false, m);
+         }},
+        {QStringLiteral("find-all"),
+         [&bar](const Corpus &c, Measurement &m) {
+             searchBar(bar, KateSearchBar::MODE_PLAIN_TEXT, c.plain, QString(), m);
+         }},
+        {QStringLiteral("replace-all"),
+         [&bar, &doc](const Corpus &c, Measurement &m) {
+             m.matches = KateRegExpSearch(&doc, c.regex).searchAll(doc.documentRange()).size();
+             searchBar(bar, KateSearchBar::MODE_REGEX, c.regex, c.replacement, m);
+             doc.undo();
+         }},
+        // :%s of the vi mode runs the sed like command of the command line
+        {QStringLiteral("vi-substitute"),
+         [&doc, &view, substitute](const Corpus &c, Measurement &m) {
+             m.matches = KateRegExpSearch(&doc, c.regex).searchAll(doc.documentRange()).size();
+             QString message;
+             m.start();
+             substitute->exec(&view, QStringLiteral("s/%1/%2/g").arg(c.regex, c.replacement), message, doc.documentRange());
+             m.step();
+             doc.undo();
+         }},
+    };
 
-    QStringList l;
-    l.reserve(linesInText);
-    for (int i = 0; i < linesInText; ++i) {
-        l.append(QStringLiteral("This is a long long long sentence."));
-    }
-    doc.setText(l);
+    printf("%-8s %10s %10s  %-22s %10s %12s %12s %16s\n", "corpus", "lines", "MB", "benchmark", "matches", "best ms", "MB/s", "slowest step ms");
+    for (const int lineCount : qAsConst(lineCounts)) {
+        for (const QString &corpusName : corpora) {
+            const Corpus corpus = generateCorpus(corpusName, lineCount);
+            if (corpus.name.isEmpty()) {
+                qWarning("unknown corpus %s", qPrintable(corpusName));
+                return 1;
+            }
+            doc.setText(corpus.lines);
 
-    QObject::connect(&bar, &KateSearchBar::findOrReplaceAllFinished, [&w]() {
-        w->close();
-    });
+            qint64 characters = 0;
+            for (const QString &line : corpus.lines) {
+                characters += line.size() + 1;
+            }
+            const double megaBytes = characters / (1024.0 * 1024.0);
+
+            for (const auto &benchmark : benchmarks) {
+                if (!modes.isEmpty() && !modes.contains(benchmark.first)) {
+                    continue;
+                }
 
-    bar.setSearchMode(KateSearchBar::SearchMode::MODE_PLAIN_TEXT);
-    bar.setSearchPattern(QStringLiteral("long"));
+                qint64 best = -1;
+                qint64 slowestStep = 0;
+                int matches = 0;
+                for (int i = 0; i < iters; ++i) {
+                    Measurement m;
+                    benchmark.second(corpus, m);
+                    const qint64 elapsed = m.elapsed();
+                    if (best < 0 || elapsed < best) {
+                        best = elapsed;
+                        slowestStep = m.slowestStep();
+                        matches = m.matches;
+                    }
+                }
 
-    bar.findAll();
+                printf("%-8s %10d %10.1f  %-22s %10d %12.2f %12.1f %16.3f\n",
+                       qPrintable(corpus.name),
+                       doc.lines(),
+                       megaBytes,
+                       qPrintable(benchmark.first),
+                       matches,
+                       best / 1000000.0,
+                       megaBytes * 1000000000.0 / best,
+                       slowestStep / 1000000.0);
+                fflush(stdout);
+            }
+        }
+    }
 
-    return app.exec();
+    return 0;
 }
@@ -0,0 +1,63 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <katedocument.h>
+#include <kateglobal.h>
+
+static constexpr int lines = 5000000;
+static constexpr int edits = 10000;
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Benchmark for typing Enter and Backspace at the start of a huge document"));
+    p.addHelpOption();
+    // number of lines
+    QCommandLineOption linesOpt(QStringLiteral("l"), QStringLiteral("Number of lines of the text"), QStringLiteral("lines"), QString::number(lines));
+    p.addOption(linesOpt);
+    // number of edits
+    QCommandLineOption editsOpt(QStringLiteral("e"), QStringLiteral("Number of Enter and Backspace pairs"), QStringLiteral("edits"), QString::number(edits));
+    p.addOption(editsOpt);
+    // line to edit
+    QCommandLineOption lineOpt(QStringLiteral("a"), QStringLiteral("Line to type at"), QStringLiteral("line"), QStringLiteral("0"));
+    p.addOption(lineOpt);
+
+    p.process(app);
+
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    const int linesInText = qMax(1, p.value(linesOpt).toInt());
+    const int editsToDo = qMax(1, p.value(editsOpt).toInt());
+
+    QString text;
+    for (int i = 0; i < linesInText; ++i) {
+        text += QStringLiteral("line %1 of the document\n").arg(i);
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(text);
+    text.clear();
+
+    const int line = qBound(0, p.value(lineOpt).toInt(), doc.lines() - 1);
+
+    // each round: Enter, then Backspace, the line count of the first block changes twice
+    QElapsedTimer t;
+    t.start();
+    for (int i = 0; i < editsToDo; ++i) {
+        doc.editStart();
+        doc.editWrapLine(line, 0);
+        doc.editEnd();
+        doc.editStart();
+        doc.editUnWrapLine(line);
+        doc.editEnd();
+    }
+    const qint64 elapsed = t.nsecsElapsed();
+
+    printf("lines: %d, edits: %d, time: %lld ms, %.2f us per edit\n", doc.lines(), 2 * editsToDo, elapsed / 1000000, elapsed / (2000.0 * editsToDo));
+
+    return 0;
+}
@@ -8,9 +8,11 @@
 #include "katedocument_test.h"
 #include "moc_katedocument_test.cpp"
 
+#include <katebuffer.h>
 #include <kateconfig.h>
 #include <katedocument.h>
 #include <kateglobal.h>
+#include <katesearchjob.h>
 #include <kateview.h>
 #include <ktexteditor/movingcursor.h>
 
@@ -517,6 +519,117 @@ void KateDocumentTest::testInsertAfterEOF()
     QCOMPARE(doc.text(), expected);
 }
 
+void KateDocumentTest::testInsertManyLines()
+{
+    KTextEditor::DocumentPrivate doc;
+
+    const QString text = QStringLiteral(
+        "line0\n"
+        "line1\n"
+        "line2");
+    doc.setText(text);
+    doc.addMark(1, KTextEditor::MarkInterface::markType01);
+
+    // large paste, inserted at once
+    QString input;
+    for (int i = 0; i < 1000; ++i) {
+        input += QStringLiteral("pasted %1\n").arg(i);
+    }
+    input += QStringLiteral("end");
+
+    QString expected = text;
+    expected.insert(2, input);
+
+    QVector<KTextEditor::Range> insertedRanges;
+    connect(&doc, &KTextEditor::DocumentPrivate::textInserted, this, [&insertedRanges](KTextEditor::Document *, const KTextEditor::Range &range) {
+        insertedRanges.push_back(range);
+    });
+    QSignalSpy wrappedSpy(&doc, &KTextEditor::Document::lineWrapped);
+    doc.insertText(KTextEditor::Cursor(0, 2), input);
+    QCOMPARE(doc.text(), expected);
+    QCOMPARE(doc.lines(), 1003);
+
+    // one change for the document, the primitive signals are still reported one by one
+    QCOMPARE(insertedRanges.size(), 1);
+    QCOMPARE(insertedRanges.front(), KTextEditor::Range(0, 2, 1000, 3));
+    QCOMPARE(wrappedSpy.count(), 1000);
+
+    // the mark moved with its line
+    QCOMPARE(doc.mark(1001), uint(KTextEditor::MarkInterface::markType01));
+
+    // one undo step, everything back, removed at once
+    QVector<KTextEditor::Range> removedRanges;
+    connect(&doc, &KTextEditor::DocumentPrivate::textRemoved, this, [&removedRanges](KTextEditor::Document *, const KTextEditor::Range &range) {
+        removedRanges.push_back(range);
+    });
+    QSignalSpy unwrappedSpy(&doc, &KTextEditor::Document::lineUnwrapped);
+    const qint64 revision = doc.revision();
+    doc.undo();
+    QCOMPARE(doc.text(), text);
+    QCOMPARE(doc.mark(1), uint(KTextEditor::MarkInterface::markType01));
+    QCOMPARE(doc.revision(), revision + 1);
+    QCOMPARE(removedRanges.size(), 1);
+    QCOMPARE(removedRanges.front(), KTextEditor::Range(0, 2, 1000, 3));
+    QCOMPARE(unwrappedSpy.count(), 1000);
+
+    doc.redo();
+    QCOMPARE(doc.text(), expected);
+    QCOMPARE(doc.mark(1001), uint(KTextEditor::MarkInterface::markType01));
+
+    // many whole lines in front of a line and behind the last one
+    doc.setText(text);
+    const QStringList lines = input.split(QLatin1Char('\n'));
+    doc.insertLines(1, lines);
+    QCOMPARE(doc.text(), QStringLiteral("line0\n") + input + QStringLiteral("\nline1\nline2"));
+    doc.insertLines(doc.lines(), lines);
+    QCOMPARE(doc.text(), QStringLiteral("line0\n") + input + QStringLiteral("\nline1\nline2\n") + input);
+}
+
+void KateDocumentTest::testInsertManyLinesLikeSingleLines()
+{
+    QStringList lines;
+    for (int i = 0; i < 100; ++i) {
+        lines << QStringLiteral("inserted %1").arg(i);
+    }
+
+    // in front of the first line, in the middle, behind an empty line and behind the last line
+    for (const int target : {0, 2, 3, 4}) {
+        // the document with all lines inserted at once and the one with one line after the other
+        KTextEditor::DocumentPrivate bulkDoc;
+        KTextEditor::DocumentPrivate singleDoc;
+        KTextEditor::DocumentPrivate *docs[] = {&bulkDoc, &singleDoc};
+        QVector<KTextEditor::MovingCursor *> cursors;
+        for (KTextEditor::DocumentPrivate *doc : docs) {
+            doc->setText(QStringLiteral("line0\nline1\n\nline3"));
+            doc->insertText(KTextEditor::Cursor(1, 0), QStringLiteral("modified "));
+            if (target < doc->lines()) {
+                doc->addMark(target, KTextEditor::MarkInterface::markType01);
+            }
+            if (target > 0) {
+                doc->addMark(target - 1, KTextEditor::MarkInterface::markType02);
+            }
+            const KTextEditor::Cursor position(qMin(target, doc->lastLine()), 0);
+            cursors << doc->newMovingCursor(position, KTextEditor::MovingCursor::MoveOnInsert);
+            cursors << doc->newMovingCursor(position, KTextEditor::MovingCursor::StayOnInsert);
+        }
+
+        QVERIFY(bulkDoc.insertLines(target, lines));
+        for (int i = 0; i < lines.size(); ++i) {
+            QVERIFY(singleDoc.insertLine(target + i, lines.at(i)));
+        }
+
+        QCOMPARE(bulkDoc.text(), singleDoc.text());
+        for (int line = 0; line < singleDoc.lines(); ++line) {
+            QCOMPARE(bulkDoc.mark(line), singleDoc.mark(line));
+            QCOMPARE(bulkDoc.plainKateTextLine(line)->markedAsModified(), singleDoc.plainKateTextLine(line)->markedAsModified());
+            QCOMPARE(bulkDoc.plainKateTextLine(line)->markedAsSavedOnDisk(), singleDoc.plainKateTextLine(line)->markedAsSavedOnDisk());
+        }
+        QCOMPARE(cursors[0]->toCursor(), cursors[2]->toCursor());
+        QCOMPARE(cursors[1]->toCursor(), cursors[3]->toCursor());
+        qDeleteAll(cursors);
+    }
+}
+
 // we have two different ways of creating the checksum:
 // in KateFileLoader and KTextEditor::DocumentPrivate::createDigest. Make
 // sure, these two implementations result in the same checksum.
@@ -730,6 +843,99 @@ void KateDocumentTest::testSearch()
     }
 }
 
+void KateDocumentTest::testSearchTextAsync()
+{
+    // more lines than searched at once by the job
+    KTextEditor::DocumentPrivate doc;
+    QStringList lines;
+    for (int i = 0; i < 10000; ++i) {
+        lines.append(QStringLiteral("line %1").arg(i));
+    }
+    lines[5] = QStringLiteral("a needle");
+    lines[9000] = QStringLiteral("needle");
+    doc.setText(lines);
+
+    // all matches, forwards
+    std::unique_ptr<KateSearchJob> job(doc.searchTextAsync(doc.documentRange(), QStringLiteral("needle"), KTextEditor::Default, -1));
+    QSignalSpy progressSpy(job.get(), &KateSearchJob::progress);
+    QSignalSpy finishedSpy(job.get(), &KateSearchJob::finished);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(job->isFinished());
+    QVERIFY(!job->isCanceled());
+    QVERIFY(progressSpy.count() >= 1);
+    QCOMPARE(progressSpy.last().at(0).toInt(), 10000);
+    QCOMPARE(job->results().size(), 2);
+    QCOMPARE(job->results().at(0).first(), KTextEditor::Range(5, 2, 5, 8));
+    QCOMPARE(job->results().at(1).first(), KTextEditor::Range(9000, 0, 9000, 6));
+
+    // the matches are at the revision the search started at, they are transformed to the current one
+    doc.insertLine(0, QStringLiteral("first"));
+    QCOMPARE(job->results().at(0).first(), KTextEditor::Range(5, 2, 5, 8));
+    QCOMPARE(job->transformedRanges(), QVector<KTextEditor::Range>({KTextEditor::Range(6, 2, 6, 8), KTextEditor::Range(9001, 0, 9001, 6)}));
+
+    // first match backwards, with capture groups
+    job.reset(doc.searchTextAsync(doc.documentRange(), QStringLiteral("ne(e)dle"), KTextEditor::Regex | KTextEditor::Backwards));
+    QSignalSpy backwardsSpy(job.get(), &KateSearchJob::finished);
+    QTRY_COMPARE(backwardsSpy.count(), 1);
+    QCOMPARE(job->results().size(), 1);
+    QCOMPARE(job->results().first(), QVector<KTextEditor::Range>({KTextEditor::Range(9001, 0, 9001, 6), KTextEditor::Range(9001, 2, 9001, 3)}));
+
+    // no matches once the document is cleared
+    job.reset(doc.searchTextAsync(doc.documentRange(), QStringLiteral("needle"), KTextEditor::Default, -1));
+    QSignalSpy clearedSpy(job.get(), &KateSearchJob::finished);
+    doc.clear();
+    QVERIFY(job->isCanceled());
+    QTRY_COMPARE(clearedSpy.count(), 1);
+    QVERIFY(job->transformedRanges().isEmpty());
+
+    // deleting a running job cancels it
+    doc.setText(lines);
+    job.reset(doc.searchTextAsync(doc.documentRange(), QStringLiteral("nothing"), KTextEditor::Default));
+    job.reset();
+}
+
+void KateDocumentTest::testSearchTextAsyncLargeFile()
+{
+    // many more blocks than one chunk of the job spans
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    for (int i = 0; i < 20000; ++i) {
+        file.write("line " + QByteArray::number(i) + '\n');
+    }
+    file.write("needle\n");
+    file.close();
+
+    KTextEditor::DocumentPrivate doc;
+    doc.buffer().setLargeFileModeThreshold(1);
+    QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+    QVERIFY(doc.buffer().largeFileModeActive());
+    const KTextEditor::Range range(KTextEditor::Cursor(100, 0), doc.documentEnd());
+    const int blocksLoaded = doc.buffer().lazyBlocksLoaded();
+
+    // incremental search from the cursor on, the first match ends it
+    std::unique_ptr<KateSearchJob> job(doc.searchTextAsync(range, QStringLiteral("line 200")));
+    QSignalSpy finishedSpy(job.get(), &KateSearchJob::finished);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QVERIFY(!job->isCanceled());
+    QCOMPARE(job->transformedRanges(), QVector<KTextEditor::Range>({KTextEditor::Range(200, 0, 200, 8)}));
+
+    // only the blocks of the first chunk got decoded
+    QVERIFY(doc.buffer().lazyBlocksLoaded() - blocksLoaded <= 4096 / 64 + 1);
+
+    // the last chunk is reached if there is no match before it
+    job.reset(doc.searchTextAsync(range, QStringLiteral("needle")));
+    QSignalSpy needleSpy(job.get(), &KateSearchJob::finished);
+    QTRY_COMPARE(needleSpy.count(), 1);
+    QCOMPARE(job->transformedRanges(), QVector<KTextEditor::Range>({KTextEditor::Range(20000, 0, 20000, 6)}));
+
+    // changing the document before the search is done cancels it
+    job.reset(doc.searchTextAsync(range, QStringLiteral("nothing")));
+    QSignalSpy changedSpy(job.get(), &KateSearchJob::finished);
+    doc.insertLine(0, QStringLiteral("first"));
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QVERIFY(job->isCanceled());
+}
+
 void KateDocumentTest::testMatchingBracket_data()
 {
     QTest::addColumn<QString>("text");
@@ -765,4 +971,109 @@ void KateDocumentTest::testMatchingBracket()
     QCOMPARE(doc.findMatchingBracket(cursor, maxLines), match);
 }
 
+void KateDocumentTest::testIncrementalHighlighting()
+{
+    KTextEditor::DocumentPrivate doc;
+    QString text;
+    for (int i = 0; i < 5000; ++i) {
+        text += QStringLiteral("int value%1 = %1; // comment\n").arg(i);
+    }
+    doc.setText(text);
+    doc.setHighlightingMode("C++");
+
+    KateBuffer &buffer = doc.buffer();
+    const int lastLine = doc.lines() - 2;
+
+    // near lines are highlighted at once
+    QVERIFY(buffer.ensureHighlightedIncrementally(10));
+    QVERIFY(!buffer.plainLine(10)->attributesList().isEmpty());
+
+    // far away lines in the background
+    QVERIFY(!buffer.ensureHighlightedIncrementally(lastLine));
+    QVERIFY(buffer.plainLine(lastLine)->attributesList().isEmpty());
+    QTRY_VERIFY(!buffer.plainLine(lastLine)->attributesList().isEmpty());
+
+    // an edit before the highlighted lines restarts from there, the result is the same as for highlighting at once
+    doc.insertText(KTextEditor::Cursor(100, 0), QStringLiteral("/*"));
+    QVERIFY(!buffer.ensureHighlightedIncrementally(lastLine));
+    QTRY_VERIFY(buffer.ensureHighlightedIncrementally(lastLine));
+    const auto attributes = buffer.plainLine(lastLine)->attributesList();
+    buffer.invalidateHighlighting();
+    buffer.ensureHighlighted(lastLine);
+    const auto expectedAttributes = buffer.plainLine(lastLine)->attributesList();
+    QCOMPARE(attributes.size(), expectedAttributes.size());
+    for (int i = 0; i < attributes.size(); ++i) {
+        QCOMPARE(attributes[i].offset, expectedAttributes[i].offset);
+        QCOMPARE(attributes[i].length, expectedAttributes[i].length);
+        QCOMPARE(attributes[i].attributeValue, expectedAttributes[i].attributeValue);
+    }
+}
+
+static void compareWithFullHighlighting(KateBuffer &buffer, int from, int to)
+{
+    // remember the current highlighting, compute it again from the start
+    QVector<QVector<Kate::TextLineData::Attribute>> attributes;
+    for (int line = from; line <= to; ++line) {
+        attributes.push_back(buffer.plainLine(line)->attributesList());
+    }
+    buffer.invalidateHighlighting();
+    buffer.ensureHighlighted(to);
+
+    for (int line = from; line <= to; ++line) {
+        const auto &expectedAttributes = buffer.plainLine(line)->attributesList();
+        const auto &lineAttributes = attributes[line - from];
+        QCOMPARE(lineAttributes.size(), expectedAttributes.size());
+        for (int i = 0; i < lineAttributes.size(); ++i) {
+            QCOMPARE(lineAttributes[i].offset, expectedAttributes[i].offset);
+            QCOMPARE(lineAttributes[i].attributeValue, expectedAttributes[i].attributeValue);
+        }
+    }
+}
+
+void KateDocumentTest::testHighlightingConvergence()
+{
+    KTextEditor::DocumentPrivate doc;
+    QString text;
+    for (int i = 0; i < 500; ++i) {
+        text += (i == 150) ? QStringLiteral("int x = 1 */ 2;\n") : QStringLiteral("int value%1 = %1;\n").arg(i);
+    }
+    doc.setText(text);
+    doc.setHighlightingMode("C++");
+    KateBuffer &buffer = doc.buffer();
+    buffer.ensureHighlighted(doc.lines() - 1);
+
+    // open a comment that ends in line 150, the highlighting must be right up to there and stop afterwards
+    doc.insertText(KTextEditor::Cursor(100, 0), QStringLiteral("/*"));
+    QVERIFY(buffer.ensureHighlightedIncrementally(doc.lines() - 1));
+    QVERIFY(buffer.plainLine(120)->highlightingState() == buffer.plainLine(101)->highlightingState());
+    compareWithFullHighlighting(buffer, 95, doc.lines() - 1);
+
+    // remove it again
+    doc.removeText(KTextEditor::Range(100, 0, 100, 2));
+    compareWithFullHighlighting(buffer, 95, doc.lines() - 1);
+}
+
+void KateDocumentTest::testSpeculativeHighlighting()
+{
+    KTextEditor::DocumentPrivate doc;
+    QString text;
+    for (int i = 0; i < 20000; ++i) {
+        text += QStringLiteral("int value%1 = %1; // comment\n").arg(i);
+    }
+    doc.setText(text);
+    doc.setHighlightingMode("C++");
+    KateBuffer &buffer = doc.buffer();
+
+    // very far lines are highlighted at once, but only guessed
+    const int line = 19000;
+    QVERIFY(buffer.ensureHighlightedIncrementally(line));
+    QVERIFY(!buffer.plainLine(line)->attributesList().isEmpty());
+    QVERIFY(buffer.plainLine(line - 2000)->attributesList().isEmpty());
+
+    // the background highlighting arrives there later and leaves the right result
+    QTRY_VERIFY_WITH_TIMEOUT(!buffer.plainLine(line - 2000)->attributesList().isEmpty(), 30000);
+    QTRY_VERIFY_WITH_TIMEOUT(buffer.ensureHighlightedIncrementally(line + 64), 30000);
+    compareWithFullHighlighting(buffer, line - 300, line + 64);
+}
+
 #include "katedocument_test.moc"
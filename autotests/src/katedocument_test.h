@@ -32,6 +32,8 @@ private Q_SLOTS:
     void testRemoveMultipleLines();
     void testInsertNewline();
     void testInsertAfterEOF();
+    void testInsertManyLines();
+    void testInsertManyLinesLikeSingleLines();
     void testAutoBrackets();
     void testReplaceTabs();
     void testDigest();
@@ -41,8 +43,13 @@ private Q_SLOTS:
     void testRemoveComposedCharacters();
     void testAutoReload();
     void testSearch();
+    void testSearchTextAsync();
+    void testSearchTextAsyncLargeFile();
     void testMatchingBracket_data();
     void testMatchingBracket();
+    void testIncrementalHighlighting();
+    void testHighlightingConvergence();
+    void testSpeculativeHighlighting();
 };
 
 #endif // KATE_DOCUMENT_TEST_H
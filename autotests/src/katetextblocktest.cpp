@@ -9,6 +9,10 @@
 #include <katetextblock.h>
 #include <katetextbuffer.h>
 #include <katetextline.h>
+#include <katetextrange.h>
+
+#include <algorithm>
+#include <memory>
 
 QTEST_MAIN(KateTextBlockTest)
 
@@ -153,3 +157,56 @@ void KateTextBlockTest::testTextRanges()
 
     block.clearLines();
 }
+
+void KateTextBlockTest::testMultiLineTextRanges()
+{
+    // small blocks, the ranges span several of them
+    TextBuffer buf(nullptr, 4);
+    buf.startEditing();
+    for (int line = 0; line < 39; ++line) {
+        buf.wrapLine(KTextEditor::Cursor(line, 0));
+    }
+    buf.finishEditing();
+    QCOMPARE(buf.lines(), 40);
+
+    std::vector<std::unique_ptr<Kate::TextRange>> ranges;
+    for (int i = 0; i < 30; ++i) {
+        const int startLine = (i * 7) % 37;
+        const KTextEditor::Range range(startLine, 0, startLine + 1 + i % 5, 0);
+        ranges.emplace_back(new Kate::TextRange(buf, range, KTextEditor::MovingRange::DoNotExpand));
+    }
+
+    // the ranges of each line must be the ones containing it
+    const auto checkRanges = [&buf, &ranges]() {
+        for (int line = 0; line < buf.lines(); ++line) {
+            QVector<Kate::TextRange *> expected;
+            for (const auto &range : ranges) {
+                if (range->start().line() <= line && line <= range->end().line()) {
+                    expected.append(range.get());
+                }
+            }
+            QVector<Kate::TextRange *> found = buf.rangesForLine(line, nullptr, false);
+            std::sort(expected.begin(), expected.end());
+            std::sort(found.begin(), found.end());
+            QCOMPARE(found, expected);
+        }
+    };
+    checkRanges();
+
+    // edits move the ranges
+    buf.startEditing();
+    buf.wrapLine(KTextEditor::Cursor(10, 0));
+    buf.wrapLine(KTextEditor::Cursor(11, 0));
+    buf.unwrapLine(25);
+    buf.finishEditing();
+    checkRanges();
+
+    // and so does setting them
+    ranges[3]->setRange(KTextEditor::Range(2, 0, 30, 0));
+    ranges[4]->setRange(KTextEditor::Range(33, 0, 38, 0));
+    ranges[5]->setRange(KTextEditor::Range(5, 0, 5, 0));
+    checkRanges();
+
+    ranges.erase(ranges.begin() + 7);
+    checkRanges();
+}
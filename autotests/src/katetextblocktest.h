@@ -23,6 +23,7 @@ private Q_SLOTS:
     void testInsertRemoveText();
     void testSplitMergeBlocks();
     void testTextRanges();
+    void testMultiLineTextRanges();
 };
 
 #endif // KATETEXTBLOCKTEST_H
@@ -12,6 +12,15 @@
 #include "katetextfolding.h"
 #include <kateglobal.h>
 
+#include <KCompressionDevice>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <memory>
+
 QTEST_MAIN(KateTextBufferTest)
 
 KateTextBufferTest::KateTextBufferTest()
@@ -197,6 +206,326 @@ void KateTextBufferTest::cursorTest()
     }
 }
 
+void KateTextBufferTest::insertLinesTest()
+{
+    // the lines to insert, the empty ones are important for the modification flags
+    const QStringList lines = {QStringLiteral("first"), QString(), QStringLiteral("middle"), QStringLiteral("x"), QString(), QStringLiteral("last")};
+
+    // positions to insert at, line start, middle and end of a line
+    const QVector<KTextEditor::Cursor> positions = {KTextEditor::Cursor(0, 0), KTextEditor::Cursor(1, 3), KTextEditor::Cursor(2, 6), KTextEditor::Cursor(3, 0)};
+
+    // cursors all around the insert positions
+    const QVector<KTextEditor::Cursor> cursorPositions = {KTextEditor::Cursor(0, 0),
+                                                          KTextEditor::Cursor(1, 0),
+                                                          KTextEditor::Cursor(1, 3),
+                                                          KTextEditor::Cursor(1, 5),
+                                                          KTextEditor::Cursor(2, 6),
+                                                          KTextEditor::Cursor(3, 0),
+                                                          KTextEditor::Cursor(3, 2)};
+
+    // test with different block sizes, small ones to split the blocks a lot
+    for (int blockSize = 1; blockSize <= 4; ++blockSize) {
+        for (const KTextEditor::Cursor &position : positions) {
+            // one buffer with insertLines, one with the single primitives
+            Kate::TextBuffer bulkBuffer(nullptr, blockSize);
+            Kate::TextBuffer buffer(nullptr, blockSize);
+            for (Kate::TextBuffer *b : {&bulkBuffer, &buffer}) {
+                b->startEditing();
+                b->insertText(KTextEditor::Cursor(0, 0), QStringLiteral("line 0"));
+                b->wrapLine(KTextEditor::Cursor(0, 6));
+                b->insertText(KTextEditor::Cursor(1, 0), QStringLiteral("line 1"));
+                b->wrapLine(KTextEditor::Cursor(1, 6));
+                b->insertText(KTextEditor::Cursor(2, 0), QStringLiteral("line 2"));
+                b->wrapLine(KTextEditor::Cursor(2, 6));
+                b->insertText(KTextEditor::Cursor(3, 0), QStringLiteral("line 3"));
+                b->finishEditing();
+
+                // some lines saved, some modified
+                b->line(0)->markAsSavedOnDisk(true);
+                b->line(2)->markAsSavedOnDisk(true);
+                b->line(3)->markAsModified(false);
+            }
+
+            // cursors with both insert behaviors
+            std::vector<std::unique_ptr<Kate::TextCursor>> bulkCursors;
+            std::vector<std::unique_ptr<Kate::TextCursor>> cursors;
+            for (const KTextEditor::Cursor &cursorPosition : cursorPositions) {
+                for (auto behavior : {Kate::TextCursor::MoveOnInsert, Kate::TextCursor::StayOnInsert}) {
+                    bulkCursors.emplace_back(new Kate::TextCursor(bulkBuffer, cursorPosition, behavior));
+                    cursors.emplace_back(new Kate::TextCursor(buffer, cursorPosition, behavior));
+                }
+            }
+
+            const qint64 bulkRevision = bulkBuffer.revision();
+            const qint64 revision = buffer.revision();
+            bulkBuffer.history().lockRevision(bulkRevision);
+            buffer.history().lockRevision(revision);
+
+            // insert all lines at once
+            bulkBuffer.startEditing();
+            bulkBuffer.insertLines(position, lines);
+            bulkBuffer.finishEditing();
+            QCOMPARE(bulkBuffer.revision(), bulkRevision + 1);
+
+            // insert them like the document does for small inserts
+            buffer.startEditing();
+            KTextEditor::Cursor insertPosition = position;
+            for (int i = 0; i < lines.size(); ++i) {
+                buffer.insertText(insertPosition, lines.at(i));
+                if (i + 1 < lines.size()) {
+                    buffer.wrapLine(KTextEditor::Cursor(insertPosition.line(), insertPosition.column() + lines.at(i).size()));
+                    insertPosition = KTextEditor::Cursor(insertPosition.line() + 1, 0);
+                }
+            }
+            buffer.finishEditing();
+
+            // same text, lines and modification flags
+            QCOMPARE(bulkBuffer.text(), buffer.text());
+            QCOMPARE(bulkBuffer.lines(), buffer.lines());
+            for (int line = 0; line < buffer.lines(); ++line) {
+                QCOMPARE(bulkBuffer.line(line)->markedAsModified(), buffer.line(line)->markedAsModified());
+                QCOMPARE(bulkBuffer.line(line)->markedAsSavedOnDisk(), buffer.line(line)->markedAsSavedOnDisk());
+            }
+
+            // same cursors
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                QCOMPARE(bulkCursors[i]->toCursor(), cursors[i]->toCursor());
+            }
+
+            // same transformation of cursors by the history
+            for (const KTextEditor::Cursor &cursorPosition : cursorPositions) {
+                for (auto behavior : {KTextEditor::MovingCursor::MoveOnInsert, KTextEditor::MovingCursor::StayOnInsert}) {
+                    int bulkLine = cursorPosition.line();
+                    int bulkColumn = cursorPosition.column();
+                    bulkBuffer.history().transformCursor(bulkLine, bulkColumn, behavior, bulkRevision);
+                    int line = cursorPosition.line();
+                    int column = cursorPosition.column();
+                    buffer.history().transformCursor(line, column, behavior, revision);
+                    QCOMPARE(KTextEditor::Cursor(bulkLine, bulkColumn), KTextEditor::Cursor(line, column));
+
+                    // and back again, this only is the same outside of the inserted text
+                    bulkBuffer.history().transformCursor(bulkLine, bulkColumn, behavior, -1, bulkRevision);
+                    buffer.history().transformCursor(line, column, behavior, -1, revision);
+                    QCOMPARE(KTextEditor::Cursor(bulkLine, bulkColumn), KTextEditor::Cursor(line, column));
+                }
+            }
+
+            bulkBuffer.history().unlockRevision(bulkRevision);
+            buffer.history().unlockRevision(revision);
+        }
+    }
+
+    // many lines into small blocks, the block must be split into many
+    Kate::TextBuffer buffer(nullptr, 4);
+    QStringList manyLines;
+    for (int i = 0; i < 1000; ++i) {
+        manyLines << QString::number(i);
+    }
+    buffer.startEditing();
+    buffer.insertText(KTextEditor::Cursor(0, 0), QStringLiteral("front back"));
+    buffer.insertLines(KTextEditor::Cursor(0, 6), manyLines);
+    buffer.finishEditing();
+    QCOMPARE(buffer.lines(), 1000);
+    QCOMPARE(buffer.line(0)->text(), QStringLiteral("front 0"));
+    QCOMPARE(buffer.line(500)->text(), QStringLiteral("500"));
+    QCOMPARE(buffer.line(999)->text(), QStringLiteral("999back"));
+}
+
+void KateTextBufferTest::removeLinesTest()
+{
+    // ranges to remove, from and to line start, middle and end of lines
+    const QVector<KTextEditor::Range> ranges = {KTextEditor::Range(0, 0, 1, 0),
+                                                KTextEditor::Range(0, 3, 4, 2),
+                                                KTextEditor::Range(1, 6, 2, 0),
+                                                KTextEditor::Range(2, 0, 4, 6),
+                                                KTextEditor::Range(3, 2, 4, 0)};
+
+    // cursors all around the removed ranges
+    const QVector<KTextEditor::Cursor> cursorPositions = {KTextEditor::Cursor(0, 0),
+                                                          KTextEditor::Cursor(0, 3),
+                                                          KTextEditor::Cursor(1, 5),
+                                                          KTextEditor::Cursor(2, 0),
+                                                          KTextEditor::Cursor(3, 2),
+                                                          KTextEditor::Cursor(4, 1),
+                                                          KTextEditor::Cursor(4, 6),
+                                                          KTextEditor::Cursor(5, 0)};
+
+    // test with different block sizes, small ones to remove across many blocks
+    // the primitives only join lines of different blocks with other modification flags, compare them in one block
+    for (const int blockSize : {1, 2, 3, 4, 64}) {
+        for (const KTextEditor::Range &range : ranges) {
+            // one buffer with removeLines, one with the single primitives
+            Kate::TextBuffer bulkBuffer(nullptr, blockSize);
+            Kate::TextBuffer buffer(nullptr, blockSize);
+            for (Kate::TextBuffer *b : {&bulkBuffer, &buffer}) {
+                b->startEditing();
+                b->insertLines(KTextEditor::Cursor(0, 0),
+                               {QStringLiteral("line 0"),
+                                QStringLiteral("line 1"),
+                                QString(),
+                                QStringLiteral("line 3"),
+                                QStringLiteral("line 4"),
+                                QStringLiteral("line 5")});
+                b->finishEditing();
+
+                // some lines saved, some modified
+                b->line(0)->markAsSavedOnDisk(true);
+                b->line(2)->markAsSavedOnDisk(true);
+                b->line(3)->markAsModified(false);
+                b->line(4)->markAsSavedOnDisk(true);
+            }
+
+            // cursors with both insert behaviors
+            std::vector<std::unique_ptr<Kate::TextCursor>> bulkCursors;
+            std::vector<std::unique_ptr<Kate::TextCursor>> cursors;
+            for (const KTextEditor::Cursor &cursorPosition : cursorPositions) {
+                for (auto behavior : {Kate::TextCursor::MoveOnInsert, Kate::TextCursor::StayOnInsert}) {
+                    bulkCursors.emplace_back(new Kate::TextCursor(bulkBuffer, cursorPosition, behavior));
+                    cursors.emplace_back(new Kate::TextCursor(buffer, cursorPosition, behavior));
+                }
+            }
+
+            const qint64 bulkRevision = bulkBuffer.revision();
+            const qint64 revision = buffer.revision();
+            bulkBuffer.history().lockRevision(bulkRevision);
+            buffer.history().lockRevision(revision);
+
+            // remove all lines at once
+            QStringList removedLines;
+            connect(&bulkBuffer, &Kate::TextBuffer::linesRemoved, this, [&removedLines](const KTextEditor::Range &, const QStringList &lines) {
+                removedLines = lines;
+            });
+            QStringList expectedRemovedLines;
+            for (int line = range.start().line(); line <= range.end().line(); ++line) {
+                expectedRemovedLines << bulkBuffer.line(line)->text();
+            }
+            expectedRemovedLines.back().truncate(range.end().column());
+            expectedRemovedLines.front().remove(0, range.start().column());
+            bulkBuffer.startEditing();
+            bulkBuffer.removeLines(range);
+            bulkBuffer.finishEditing();
+            QCOMPARE(bulkBuffer.revision(), bulkRevision + 1);
+            QCOMPARE(removedLines, expectedRemovedLines);
+
+            // remove them like the document does: the text of each line, then join them
+            buffer.startEditing();
+            buffer.removeText(KTextEditor::Range(range.end().line(), 0, range.end().line(), range.end().column()));
+            for (int line = range.end().line() - 1; line > range.start().line(); --line) {
+                buffer.removeText(KTextEditor::Range(line, 0, line, buffer.line(line)->length()));
+            }
+            buffer.removeText(KTextEditor::Range(range.start(), KTextEditor::Cursor(range.start().line(), buffer.line(range.start().line())->length())));
+            for (int line = range.end().line(); line > range.start().line(); --line) {
+                buffer.unwrapLine(line);
+            }
+            buffer.finishEditing();
+
+            // same text, lines and modification flags
+            QCOMPARE(bulkBuffer.text(), buffer.text());
+            QCOMPARE(bulkBuffer.lines(), buffer.lines());
+            if (blockSize == 64) {
+                for (int line = 0; line < buffer.lines(); ++line) {
+                    QCOMPARE(bulkBuffer.line(line)->markedAsModified(), buffer.line(line)->markedAsModified());
+                    QCOMPARE(bulkBuffer.line(line)->markedAsSavedOnDisk(), buffer.line(line)->markedAsSavedOnDisk());
+                }
+            }
+
+            // same cursors
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                QCOMPARE(bulkCursors[i]->toCursor(), cursors[i]->toCursor());
+            }
+
+            // same transformation of cursors by the history
+            for (const KTextEditor::Cursor &cursorPosition : cursorPositions) {
+                for (auto behavior : {KTextEditor::MovingCursor::MoveOnInsert, KTextEditor::MovingCursor::StayOnInsert}) {
+                    int bulkLine = cursorPosition.line();
+                    int bulkColumn = cursorPosition.column();
+                    bulkBuffer.history().transformCursor(bulkLine, bulkColumn, behavior, bulkRevision);
+                    int line = cursorPosition.line();
+                    int column = cursorPosition.column();
+                    buffer.history().transformCursor(line, column, behavior, revision);
+                    QCOMPARE(KTextEditor::Cursor(bulkLine, bulkColumn), KTextEditor::Cursor(line, column));
+
+                    // and back again, this only restores the cursors outside of the removed text
+                    if (cursorPosition < range.start() || cursorPosition > range.end()) {
+                        bulkBuffer.history().transformCursor(bulkLine, bulkColumn, behavior, -1, bulkRevision);
+                        QCOMPARE(KTextEditor::Cursor(bulkLine, bulkColumn), cursorPosition);
+                    }
+                }
+            }
+
+            bulkBuffer.history().unlockRevision(bulkRevision);
+            buffer.history().unlockRevision(revision);
+        }
+    }
+}
+
+void KateTextBufferTest::searchIndexTest()
+{
+    // small blocks, most of them can be skipped
+    Kate::TextBuffer buffer(nullptr, 4);
+    QStringList lines;
+    for (int i = 0; i < 100; ++i) {
+        lines << QStringLiteral("line %1").arg(i);
+    }
+    buffer.startEditing();
+    buffer.insertLines(KTextEditor::Cursor(0, 0), lines);
+    buffer.finishEditing();
+    QCOMPARE(buffer.lines(), 100);
+
+    // case folded, distinct trigrams
+    const std::vector<quint32> needle = Kate::TextBuffer::searchIndexTrigrams(QStringLiteral("Needle"));
+    QCOMPARE(needle.size(), size_t(4));
+    QCOMPARE(Kate::TextBuffer::searchIndexTrigrams(QStringLiteral("nEEDLE")), needle);
+    QVERIFY(Kate::TextBuffer::searchIndexTrigrams(QStringLiteral("ne")).empty());
+
+    // without index, all lines might contain it
+    QVERIFY(!buffer.searchIndexEnabled());
+    QCOMPARE(buffer.searchIndexNextLine(0, needle, false), 0);
+
+    buffer.setSearchIndexEnabled(true);
+    QVERIFY(!buffer.searchIndexComplete());
+    QCOMPARE(buffer.searchIndexNextLine(0, needle, false), 0);
+    while (buffer.buildSearchIndex(1)) {
+    }
+    QVERIFY(buffer.searchIndexComplete());
+    QVERIFY(buffer.searchIndexMemory() > 0);
+    QCOMPARE(buffer.searchIndexNextLine(0, needle, false), buffer.lines());
+    QCOMPARE(buffer.searchIndexNextLine(99, needle, true), -1);
+    QCOMPARE(buffer.searchIndexNextLine(0, Kate::TextBuffer::searchIndexTrigrams(QStringLiteral("line 42")), false), 40);
+
+    // the halves of the text are on their own, joining the lines adds the trigrams across them
+    buffer.startEditing();
+    buffer.insertText(KTextEditor::Cursor(20, 7), QStringLiteral("nee"));
+    buffer.insertText(KTextEditor::Cursor(21, 0), QStringLiteral("dle"));
+    buffer.finishEditing();
+    QCOMPARE(buffer.searchIndexNextLine(0, needle, false), buffer.lines());
+    buffer.startEditing();
+    buffer.unwrapLine(21);
+    buffer.finishEditing();
+    QCOMPARE(buffer.line(20)->text(), QStringLiteral("line 20needleline 21"));
+    int line = buffer.searchIndexNextLine(0, needle, false);
+    QVERIFY(line > 16 && line <= 20);
+    QCOMPARE(buffer.searchIndexNextLine(20, needle, false), 20);
+    line = buffer.searchIndexNextLine(98, needle, true);
+    QVERIFY(line >= 20 && line < 24);
+
+    // inserted text, removed text stays in the filter until it is built again
+    buffer.startEditing();
+    buffer.insertText(KTextEditor::Cursor(50, 0), QStringLiteral("NEEDLE "));
+    buffer.removeText(KTextEditor::Range(20, 7, 20, 13));
+    buffer.finishEditing();
+    QCOMPARE(buffer.searchIndexNextLine(21, needle, false), 21);
+    line = buffer.searchIndexNextLine(23, needle, false);
+    QVERIFY(line > 45 && line <= 50);
+
+    // dropped once it needs too much memory
+    buffer.setSearchIndexMemoryLimit(1);
+    QVERIFY(!buffer.buildSearchIndex(1));
+    QVERIFY(!buffer.searchIndexEnabled());
+    QCOMPARE(buffer.searchIndexMemory(), qint64(0));
+    QCOMPARE(buffer.searchIndexNextLine(0, needle, false), 0);
+}
+
 void KateTextBufferTest::foldingTest()
 {
     // construct an empty text buffer & folding info
@@ -415,6 +744,68 @@ void KateTextBufferTest::nestedFoldingTest()
     QVERIFY(folding.unfoldRange(1));
 }
 
+void KateTextBufferTest::foldedLinesMappingTest()
+{
+    // construct an empty text buffer & folding info
+    Kate::TextBuffer buffer(nullptr, 1);
+    Kate::TextFolding folding(buffer);
+
+    // 1000 lines
+    buffer.startEditing();
+    for (int i = 0; i < 999; ++i) {
+        buffer.wrapLine(KTextEditor::Cursor(0, 0));
+    }
+    buffer.finishEditing();
+    QCOMPARE(buffer.lines(), 1000);
+
+    // fold lines 10 * i + 2 to 10 * i + 7, that hides 5 lines each
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(folding.newFoldingRange(KTextEditor::Range(KTextEditor::Cursor(10 * i + 2, 0), KTextEditor::Cursor(10 * i + 7, 0)), Kate::TextFolding::Folded), qint64(i));
+    }
+    QCOMPARE(folding.visibleLines(), 500);
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(folding.visibleLineToLine(5 * i + 2), 10 * i + 2);
+        QCOMPARE(folding.visibleLineToLine(5 * i + 3), 10 * i + 8);
+        QCOMPARE(folding.lineToVisibleLine(10 * i + 2), 5 * i + 2);
+        QCOMPARE(folding.lineToVisibleLine(10 * i + 5), 5 * i + 2);
+        QCOMPARE(folding.lineToVisibleLine(10 * i + 8), 5 * i + 3);
+    }
+
+    // the mapping follows edits: a new line in front of all folds moves them
+    buffer.startEditing();
+    buffer.wrapLine(KTextEditor::Cursor(0, 0));
+    buffer.finishEditing();
+    QCOMPARE(folding.visibleLines(), 501);
+    QCOMPARE(folding.visibleLineToLine(3), 3);
+    QCOMPARE(folding.visibleLineToLine(4), 9);
+    QCOMPARE(folding.lineToVisibleLine(998), 501 - 3);
+
+    // a new line inside of a fold hides one more line
+    buffer.startEditing();
+    buffer.wrapLine(KTextEditor::Cursor(5, 0));
+    buffer.finishEditing();
+    QCOMPARE(folding.visibleLines(), 501);
+    QCOMPARE(folding.visibleLineToLine(4), 10);
+
+    // unfolding shows the lines again
+    QVERIFY(folding.unfoldRange(0));
+    QCOMPARE(folding.visibleLines(), 507);
+    QCOMPARE(folding.visibleLineToLine(4), 4);
+    QCOMPARE(folding.visibleLineToLine(10), 10);
+    QCOMPARE(folding.visibleLineToLine(11), 11);
+
+    // bulk conversion matches the single one
+    for (int step = 1; step <= 3; ++step) {
+        const QVector<int> lines = folding.visibleLinesToLines(0, folding.visibleLines() - 1, step);
+        QCOMPARE(lines.size(), (folding.visibleLines() - 1) / step + 1);
+        for (int i = 0; i < lines.size(); ++i) {
+            QCOMPARE(lines.at(i), folding.visibleLineToLine(i * step));
+        }
+    }
+    QCOMPARE(folding.visibleLinesToLines(4, 8), QVector<int>({4, 5, 6, 7, 8}));
+    QCOMPARE(folding.visibleLinesToLines(20, 22), QVector<int>({folding.visibleLineToLine(20), folding.visibleLineToLine(21), folding.visibleLineToLine(22)}));
+}
+
 void KateTextBufferTest::saveFileInUnwritableFolder()
 {
     // create temp dir and get file name inside
@@ -486,3 +877,334 @@ void KateTextBufferTest::saveFileWithElevatedPrivileges()
     QVERIFY(f.remove());
     QVERIFY(dir.remove());
 }
+
+void KateTextBufferTest::loadCompressedFileWithFallbackCodec()
+{
+    // latin-15 content, that is no valid utf-8, the fallback codec must be picked
+    const QByteArray content = QByteArray("first line\nsecond line with \xe4\xf6\xfc\r\nthird line");
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // plain and gzip compressed variant, both are read only once from disk
+    const QString plainPath = dir.path() + QLatin1String("/plain.txt");
+    QFile plain(plainPath);
+    QVERIFY(plain.open(QIODevice::WriteOnly));
+    QCOMPARE(plain.write(content), qint64(content.size()));
+    plain.close();
+
+    const QString compressedPath = dir.path() + QLatin1String("/compressed.txt.gz");
+    KCompressionDevice compressed(compressedPath, KCompressionDevice::GZip);
+    QVERIFY(compressed.open(QIODevice::WriteOnly));
+    QCOMPARE(compressed.write(content), qint64(content.size()));
+    compressed.close();
+
+    for (const QString &path : {plainPath, compressedPath}) {
+        Kate::TextBuffer buffer(nullptr, 1);
+        buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+        buffer.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+        bool encodingErrors = false;
+        bool tooLongLinesWrapped = false;
+        int longestLineLoaded = 0;
+        QVERIFY(buffer.load(path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+        QVERIFY(!encodingErrors);
+        QCOMPARE(buffer.textCodec()->name(), QTextCodec::codecForName("ISO 8859-15")->name());
+        QCOMPARE(buffer.lines(), 3);
+        QCOMPARE(buffer.text(), QString::fromLatin1("first line\nsecond line with \xe4\xf6\xfc\nthird line"));
+        QCOMPARE(buffer.endOfLineMode(), Kate::TextBuffer::eolDos);
+    }
+}
+
+void KateTextBufferTest::loadLargeFileMode()
+{
+    // mixed line endings, a \r\n crossing block boundaries, non-ascii content, a line to wrap and a trailing empty line
+    QByteArray content("\xef\xbb\xbf"
+                       "first line\n"
+                       "second line \xc3\xa4\xc3\xb6\xc3\xbc\r\n"
+                       "third\r"
+                       "\n"
+                       "fourth \xf0\x9f\x98\x80\r\n"
+                       "\r\n"
+                       "sixth\xe2\x80\xa8seventh\n");
+    content += QByteArray(50, 'x') + ' ' + QByteArray(50, 'y') + "\r\n";
+    content += "last line\n";
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QLatin1String("/large.txt");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), qint64(content.size()));
+    file.close();
+
+    // load once normally and with different block sizes in large file mode, the result must be the same
+    Kate::TextBuffer reference(nullptr);
+    reference.setTextCodec(QTextCodec::codecForName("UTF-8"));
+    reference.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+    reference.setLineLengthLimit(60);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(reference.load(path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!reference.largeFileModeActive());
+    QVERIFY(tooLongLinesWrapped);
+    const int referenceLongestLine = longestLineLoaded;
+
+    for (int blockSize = 1; blockSize <= 4; ++blockSize) {
+        Kate::TextBuffer buffer(nullptr, blockSize);
+        buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+        buffer.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+        buffer.setLineLengthLimit(60);
+        buffer.setLargeFileModeThreshold(1);
+        encodingErrors = false;
+        tooLongLinesWrapped = false;
+        longestLineLoaded = 0;
+        QVERIFY(buffer.load(path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+        QVERIFY(buffer.largeFileModeActive());
+        QVERIFY(!encodingErrors);
+        QVERIFY(tooLongLinesWrapped);
+        QCOMPARE(longestLineLoaded, referenceLongestLine);
+        QCOMPARE(buffer.lines(), reference.lines());
+        QCOMPARE(buffer.endOfLineMode(), reference.endOfLineMode());
+        QCOMPARE(buffer.generateByteOrderMark(), reference.generateByteOrderMark());
+        QCOMPARE(buffer.digest(), reference.digest());
+
+        // access the lines backwards, the blocks get decoded out of order
+        for (int line = buffer.lines() - 1; line >= 0; --line) {
+            QCOMPARE(buffer.line(line)->string(), reference.line(line)->string());
+        }
+        QCOMPARE(buffer.text(), reference.text());
+
+        // editing works like for normally loaded files
+        buffer.startEditing();
+        buffer.insertText(KTextEditor::Cursor(2, 0), QStringLiteral("edited "));
+        buffer.wrapLine(KTextEditor::Cursor(0, 5));
+        buffer.finishEditing();
+        QCOMPARE(buffer.line(0)->string(), QStringLiteral("first"));
+        QCOMPARE(buffer.line(3)->string(), QStringLiteral("edited third"));
+        QCOMPARE(buffer.lines(), reference.lines() + 1);
+
+        // saving over the mapped file is possible
+        QVERIFY(buffer.save(path));
+        QVERIFY(!buffer.largeFileModeActive());
+        QCOMPARE(buffer.line(3)->string(), QStringLiteral("edited third"));
+
+        // restore the original content for the next round
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(content), qint64(content.size()));
+        file.close();
+    }
+
+    // others truncate the file: the lines read before stay, the other ones are empty
+    Kate::TextBuffer buffer(nullptr, 2);
+    buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+    buffer.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+    buffer.setLineLengthLimit(60);
+    buffer.setLargeFileModeThreshold(1);
+    QVERIFY(buffer.load(path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(buffer.largeFileModeActive());
+    QCOMPARE(buffer.line(0)->string(), reference.line(0)->string());
+    QVERIFY(file.resize(0));
+    for (int line = buffer.lines() - 1; line >= 2; --line) {
+        QVERIFY(buffer.line(line)->string().isEmpty());
+    }
+    QCOMPARE(buffer.line(1)->string(), reference.line(1)->string());
+    QCOMPARE(buffer.lines(), reference.lines());
+}
+
+void KateTextBufferTest::largeFileModeEviction()
+{
+    // more blocks than are kept decoded at once
+    QByteArray content;
+    for (int i = 0; i < 10000; ++i) {
+        content += "line " + QByteArray::number(i) + '\n';
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QLatin1String("/large.txt");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), qint64(content.size()));
+    file.close();
+
+    Kate::TextBuffer buffer(nullptr, 2);
+    buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+    buffer.setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+    buffer.setLargeFileModeThreshold(1);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(buffer.largeFileModeActive());
+
+    // highlight the first block
+    buffer.line(0)->addAttribute(Kate::TextLineData::Attribute(0, 4, 1));
+    buffer.line(1)->addAttribute(Kate::TextLineData::Attribute(0, 4, 1));
+
+    // access all other lines, the first block is the coldest one and gets evicted
+    QCOMPARE(buffer.lines(), 10001);
+    for (int line = 2; line < 10000; ++line) {
+        QCOMPARE(buffer.line(line)->string(), QStringLiteral("line %1").arg(line));
+    }
+
+    // the highlighting is gone and must be done again, once
+    int startLine = -1;
+    int endLine = -1;
+    QVERIFY(buffer.takeLostHighlighting(1, startLine, endLine));
+    QCOMPARE(startLine, 0);
+    QCOMPARE(endLine, 1);
+    QVERIFY(!buffer.takeLostHighlighting(0, startLine, endLine));
+    QVERIFY(!buffer.takeLostHighlighting(2, startLine, endLine));
+    QCOMPARE(buffer.line(0)->string(), QStringLiteral("line 0"));
+    QVERIFY(buffer.line(0)->attributesList().isEmpty());
+}
+
+void KateTextBufferTest::loadParallel_data()
+{
+    QTest::addColumn<QByteArray>("content");
+    QTest::addColumn<QByteArray>("codec");
+
+    // many lines with mixed line endings, \r\n at all positions relative to the chunk borders, multi byte characters and lines to wrap
+    QByteArray content("\xef\xbb\xbf");
+    const QList<QByteArray> endings = {"\n", "\r\n", "\r", "\xe2\x80\xa8", "\r\r\n", "\n\n"};
+    for (int i = 0; i < 500; ++i) {
+        content += "line " + QByteArray::number(i) + " \xc3\xa4\xf0\x9f\x98\x80";
+        if (i % 37 == 0) {
+            content += QByteArray(70 + i % 50, 'x');
+        }
+        content += endings.at(i % endings.size());
+    }
+    QTest::newRow("utf-8") << content << QByteArray("UTF-8");
+
+    // invalid utf-8, the fallback codec is used
+    QTest::newRow("fallback") << content.replace("\xc3\xa4", "\xe4") << QByteArray("UTF-8");
+
+    // unix line endings only, ending with a line break
+    QByteArray unixContent;
+    for (int i = 0; i < 500; ++i) {
+        unixContent += "unix line " + QByteArray::number(i) + '\n';
+    }
+    QTest::newRow("unix") << unixContent << QByteArray("ISO 8859-15");
+}
+
+void KateTextBufferTest::loadParallel()
+{
+    QFETCH(QByteArray, content);
+    QFETCH(QByteArray, codec);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QLatin1String("/parallel.txt");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), qint64(content.size()));
+    file.close();
+
+    // load serial and parallel, the result must be the same
+    Kate::TextBuffer reference(nullptr);
+    Kate::TextBuffer buffer(nullptr);
+    buffer.setParallelLoadThreshold(1);
+    bool encodingErrors[2] = {false, false};
+    bool tooLongLinesWrapped[2] = {false, false};
+    int longestLineLoaded[2] = {0, 0};
+    Kate::TextBuffer *buffers[2] = {&reference, &buffer};
+    for (int i = 0; i < 2; ++i) {
+        buffers[i]->setTextCodec(QTextCodec::codecForName(codec));
+        buffers[i]->setFallbackTextCodec(QTextCodec::codecForName("ISO 8859-15"));
+        buffers[i]->setLineLengthLimit(60);
+        QVERIFY(buffers[i]->load(path, encodingErrors[i], tooLongLinesWrapped[i], longestLineLoaded[i], false));
+    }
+
+    QCOMPARE(encodingErrors[1], encodingErrors[0]);
+    QCOMPARE(tooLongLinesWrapped[1], tooLongLinesWrapped[0]);
+    QCOMPARE(longestLineLoaded[1], longestLineLoaded[0]);
+    QCOMPARE(buffer.textCodec()->name(), reference.textCodec()->name());
+    QCOMPARE(buffer.lines(), reference.lines());
+    QCOMPARE(buffer.endOfLineMode(), reference.endOfLineMode());
+    QCOMPARE(buffer.generateByteOrderMark(), reference.generateByteOrderMark());
+    QCOMPARE(buffer.digest(), reference.digest());
+    QCOMPARE(buffer.text(), reference.text());
+}
+
+void KateTextBufferTest::saveEncodings_data()
+{
+    QTest::addColumn<QByteArray>("codec");
+    QTest::addColumn<int>("eol");
+    QTest::addColumn<bool>("bom");
+    QTest::addColumn<bool>("newLineAtEof");
+    QTest::addColumn<bool>("viaTemporaryFile");
+
+    QTest::newRow("utf-8") << QByteArray("UTF-8") << int(Kate::TextBuffer::eolUnix) << false << false << false;
+    QTest::newRow("utf-8 bom dos") << QByteArray("UTF-8") << int(Kate::TextBuffer::eolDos) << true << true << false;
+    QTest::newRow("utf-8 temporary file") << QByteArray("UTF-8") << int(Kate::TextBuffer::eolMac) << false << true << true;
+    QTest::newRow("latin-1") << QByteArray("ISO 8859-1") << int(Kate::TextBuffer::eolDos) << false << true << false;
+    QTest::newRow("latin-15") << QByteArray("ISO 8859-15") << int(Kate::TextBuffer::eolUnix) << false << false << false;
+    QTest::newRow("utf-16 temporary file") << QByteArray("UTF-16") << int(Kate::TextBuffer::eolDos) << true << true << true;
+}
+
+void KateTextBufferTest::saveEncodings()
+{
+    QFETCH(QByteArray, codec);
+    QFETCH(int, eol);
+    QFETCH(bool, bom);
+    QFETCH(bool, newLineAtEof);
+    QFETCH(bool, viaTemporaryFile);
+
+    // multi byte chars, chars not in latin-1, a surrogate pair and unpaired surrogates
+    QStringList lines = {QStringLiteral("first line"),
+                         QStringLiteral("äöü €"),
+                         QStringLiteral("smile \U0001F600 unpaired ") + QChar(0xd800) + QStringLiteral(" and ") + QChar(0xdc00),
+                         QString(),
+                         QStringLiteral("last line")};
+
+    Kate::TextBuffer buffer(nullptr, 2);
+    buffer.setTextCodec(QTextCodec::codecForName(codec));
+    buffer.setGenerateByteOrderMark(bom);
+    buffer.setEndOfLineMode(Kate::TextBuffer::EndOfLineMode(eol));
+    buffer.setNewLineAtEof(newLineAtEof);
+    buffer.setSaveViaTemporaryFile(viaTemporaryFile);
+    buffer.startEditing();
+    buffer.insertLines(KTextEditor::Cursor(0, 0), lines);
+    buffer.finishEditing();
+    QCOMPARE(buffer.lines(), lines.size());
+
+    // the data must be the same as written by a text stream with the codec
+    QByteArray expected;
+    {
+        QTextStream stream(&expected);
+        stream.setCodec(buffer.textCodec());
+        stream.setGenerateByteOrderMark(buffer.generateByteOrderMark());
+        QString eolString = QStringLiteral("\n");
+        if (eol == Kate::TextBuffer::eolDos) {
+            eolString = QStringLiteral("\r\n");
+        } else if (eol == Kate::TextBuffer::eolMac) {
+            eolString = QStringLiteral("\r");
+        }
+        stream << lines.join(eolString);
+        if (newLineAtEof) {
+            stream << eolString;
+        }
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QLatin1String("/saved.txt");
+    QVERIFY(buffer.save(path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray saved = file.readAll();
+    QCOMPARE(saved, expected);
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files), QStringList(QStringLiteral("saved.txt")));
+
+    // the digest is computed while writing for the codecs without encoder, it must match the git blob sha1 of the file
+    if (codec == "UTF-8" || codec == "ISO 8859-1") {
+        QCryptographicHash crypto(QCryptographicHash::Sha1);
+        crypto.addData(QByteArray("blob ") + QByteArray::number(saved.size()) + '\0');
+        crypto.addData(saved);
+        QCOMPARE(buffer.digest(), crypto.result());
+    } else {
+        QVERIFY(buffer.digest().isEmpty());
+    }
+}
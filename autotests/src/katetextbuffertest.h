@@ -25,10 +25,21 @@ private Q_SLOTS:
     void wrapLineTest();
     void insertRemoveTextTest();
     void cursorTest();
+    void insertLinesTest();
+    void removeLinesTest();
+    void searchIndexTest();
     void foldingTest();
     void nestedFoldingTest();
+    void foldedLinesMappingTest();
     void saveFileInUnwritableFolder();
     void saveFileWithElevatedPrivileges();
+    void loadCompressedFileWithFallbackCodec();
+    void loadLargeFileMode();
+    void largeFileModeEviction();
+    void loadParallel_data();
+    void loadParallel();
+    void saveEncodings_data();
+    void saveEncodings();
 };
 
 #endif // KATETEXTBUFFERTEST_H
@@ -11,6 +11,8 @@
 #include <katedocument.h>
 #include <kateglobal.h>
 #include <kateplaintextsearch.h>
+#include <kateregexpsearch.h>
+#include <katebuffer.h>
 
 #include <QtTestWidgets>
 
@@ -155,3 +157,158 @@ void PlainTextSearchTest::testMultilineSearch()
 
     QCOMPARE(m_search->search(pattern, inputRange, false), forwardResult);
 }
+
+void PlainTextSearchTest::testWholeWordsAndCase()
+{
+    m_doc->setText(QStringLiteral("foo_bar foo foobar foo-bar\n"
+                                  "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxFooBAR x\n"
+                                  "the \u212Aelvin scale"));
+    const KTextEditor::Range all = m_doc->documentRange();
+
+    KatePlainTextSearch wholeWords(m_doc, Qt::CaseSensitive, true);
+    QCOMPARE(wholeWords.search(QStringLiteral("foo"), all, false), KTextEditor::Range(0, 8, 0, 11));
+    QCOMPARE(wholeWords.search(QStringLiteral("foo"), all, true), KTextEditor::Range(0, 19, 0, 22));
+    QCOMPARE(wholeWords.search(QStringLiteral("oo"), all, false), KTextEditor::Range::invalid());
+    QCOMPARE(wholeWords.search(QStringLiteral("x"), all, false), KTextEditor::Range(1, 49, 1, 50));
+    QCOMPARE(wholeWords.search(QStringLiteral("x"), all, true), KTextEditor::Range(1, 49, 1, 50));
+
+    // no boundary is needed next to a needle character that is no word character
+    QCOMPARE(wholeWords.search(QStringLiteral("-bar"), all, false), KTextEditor::Range(0, 22, 0, 26));
+
+    // multi-line needles are bounded at their start and end
+    QCOMPARE(m_search->search(QStringLiteral("bar\nx"), all, false), KTextEditor::Range(0, 23, 1, 1));
+    QCOMPARE(wholeWords.search(QStringLiteral("bar\nx"), all, false), KTextEditor::Range::invalid());
+
+    KatePlainTextSearch caseInsensitive(m_doc, Qt::CaseInsensitive, false);
+    QCOMPARE(caseInsensitive.search(QStringLiteral("FOOBAR"), all, false), KTextEditor::Range(0, 12, 0, 18));
+    QCOMPARE(caseInsensitive.search(QStringLiteral("FOOBAR"), all, true), KTextEditor::Range(1, 42, 1, 48));
+    QCOMPARE(caseInsensitive.search(QStringLiteral("FOOBAR"), KTextEditor::Range(1, 0, 1, 47), false), KTextEditor::Range::invalid());
+
+    // case folding beyond ASCII, the Kelvin sign folds to k
+    QCOMPARE(caseInsensitive.search(QStringLiteral("KELVIN"), all, false), KTextEditor::Range(2, 4, 2, 10));
+    QCOMPARE(m_search->search(QStringLiteral("kelvin"), all, false), KTextEditor::Range::invalid());
+}
+
+void PlainTextSearchTest::testSearchAllParallel_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("wholeWords");
+    QTest::addColumn<KTextEditor::Range>("inputRange");
+
+    QTest::newRow("plain") << QStringLiteral("of") << false << KTextEditor::Range(0, 0, 19999, 1);
+    QTest::newRow("cut range") << QStringLiteral("1") << false << KTextEditor::Range(3, 4, 15000, 3);
+    QTest::newRow("whole words") << QStringLiteral("2") << true << KTextEditor::Range(100, 2, 9000, 0);
+    // multi-line texts are searched match by match
+    QTest::newRow("multi-line") << QStringLiteral("}\n\nline") << false << KTextEditor::Range(0, 0, 19999, 1);
+}
+
+void PlainTextSearchTest::testSearchAllParallel()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, wholeWords);
+    QFETCH(KTextEditor::Range, inputRange);
+
+    // more lines than one thread searches at once
+    QStringList lines;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 7 == 0) {
+            lines << QStringLiteral("}");
+        } else if (i % 7 == 1) {
+            lines << QString();
+        } else {
+            lines << QStringLiteral("line %1 of 2").arg(i);
+        }
+    }
+    m_doc->setText(lines.join(QLatin1Char('\n')));
+
+    // the same matches as one search after the other
+    KatePlainTextSearch searcher(m_doc, Qt::CaseSensitive, wholeWords);
+    QVector<KTextEditor::Range> expected;
+    KTextEditor::Range range = inputRange;
+    for (KTextEditor::Range match = searcher.search(text, range); match.isValid(); match = searcher.search(text, range)) {
+        expected.append(match);
+        range.setStart(match.end());
+    }
+    QVERIFY(!expected.isEmpty());
+
+    int matchCount = -1;
+    QCOMPARE(searcher.searchAllParallel(text, inputRange, matchCount), expected);
+    QCOMPARE(matchCount, expected.size());
+
+    // the first ranges, but all matches counted
+    matchCount = -1;
+    QCOMPARE(searcher.searchAllParallel(text, inputRange, matchCount, 5), expected.mid(0, 5));
+    QCOMPARE(matchCount, expected.size());
+}
+
+void PlainTextSearchTest::testSearchIndex()
+{
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines << QStringLiteral("line %1 text").arg(i);
+    }
+    lines[10] = QStringLiteral("a Needle in the text");
+    lines[500] = QStringLiteral("needles");
+    lines[990] = QStringLiteral("the needle");
+    m_doc->setText(lines.join(QLatin1Char('\n')));
+
+    KateBuffer &buffer = m_doc->buffer();
+    buffer.setSearchIndexEnabled(true);
+    while (buffer.buildSearchIndex(16)) {
+    }
+    QVERIFY(buffer.searchIndexComplete());
+
+    const KTextEditor::Range all = m_doc->documentRange();
+    const KTextEditor::Range middle(20, 0, 980, 0);
+
+    // same results as without index
+    QCOMPARE(m_search->search(QStringLiteral("needle"), all, false), KTextEditor::Range(500, 0, 500, 6));
+    QCOMPARE(m_search->search(QStringLiteral("needle"), all, true), KTextEditor::Range(990, 4, 990, 10));
+    QCOMPARE(m_search->search(QStringLiteral("needle"), middle, true), KTextEditor::Range(500, 0, 500, 6));
+    QCOMPARE(m_search->search(QStringLiteral("needle in"), middle, false), KTextEditor::Range::invalid());
+    QCOMPARE(m_search->search(QStringLiteral("text\nneedles"), all, false), KTextEditor::Range(499, 9, 500, 7));
+
+    KatePlainTextSearch caseInsensitive(m_doc, Qt::CaseInsensitive, false);
+    QCOMPARE(caseInsensitive.search(QStringLiteral("NEEDLE"), all, false), KTextEditor::Range(10, 2, 10, 8));
+    KatePlainTextSearch wholeWords(m_doc, Qt::CaseSensitive, true);
+    QCOMPARE(wholeWords.search(QStringLiteral("needle"), middle, false), KTextEditor::Range::invalid());
+    QCOMPARE(wholeWords.search(QStringLiteral("needle"), all, true), KTextEditor::Range(990, 4, 990, 10));
+
+    // patterns with a literal prefix, too
+    KateRegExpSearch regExpSearch(m_doc, QStringLiteral("^needle\\w*"));
+    QCOMPARE(regExpSearch.search(all).at(0), KTextEditor::Range(500, 0, 500, 7));
+    QCOMPARE(regExpSearch.search(all, true).at(0), KTextEditor::Range(500, 0, 500, 7));
+    QCOMPARE(regExpSearch.searchAll(all).size(), 1);
+    KateRegExpSearch optionalSearch(m_doc, QStringLiteral("needles?"), QRegularExpression::CaseInsensitiveOption);
+    QCOMPARE(optionalSearch.searchAll(all).size(), 3);
+
+    // edits are found right away
+    m_doc->insertText(KTextEditor::Cursor(700, 0), QStringLiteral("needle "));
+    QCOMPARE(m_search->search(QStringLiteral("needle"), middle, true), KTextEditor::Range(700, 0, 700, 6));
+}
+
+void PlainTextSearchTest::testSearchIndexRemoveText()
+{
+    QStringList lines;
+    for (int i = 0; i < 100; ++i) {
+        lines << QStringLiteral("line %1 text").arg(i);
+    }
+    lines[50] = QStringLiteral("a neeXdle here");
+    m_doc->setText(lines.join(QLatin1Char('\n')));
+
+    KateBuffer &buffer = m_doc->buffer();
+    buffer.setSearchIndexEnabled(true);
+    while (buffer.buildSearchIndex(16)) {
+    }
+    QVERIFY(buffer.searchIndexComplete());
+
+    const KTextEditor::Range all = m_doc->documentRange();
+    QCOMPARE(m_search->search(QStringLiteral("needle"), all, false), KTextEditor::Range::invalid());
+
+    // deleting the character in the middle of the word joins it
+    m_doc->removeText(KTextEditor::Range(50, 5, 50, 6));
+    QCOMPARE(m_doc->line(50), QStringLiteral("a needle here"));
+    QCOMPARE(m_search->search(QStringLiteral("needle"), all, false), KTextEditor::Range(50, 2, 50, 8));
+    QCOMPARE(m_search->search(QStringLiteral("eed"), all, false), KTextEditor::Range(50, 3, 50, 6));
+    QCOMPARE(m_search->search(QStringLiteral("edl"), all, true), KTextEditor::Range(50, 4, 50, 7));
+}
@@ -40,6 +40,14 @@ private Q_SLOTS:
     void testMultilineSearch_data();
     void testMultilineSearch();
 
+    void testWholeWordsAndCase();
+
+    void testSearchAllParallel_data();
+    void testSearchAllParallel();
+
+    void testSearchIndex();
+    void testSearchIndexRemoveText();
+
 private:
     KTextEditor::DocumentPrivate *m_doc = nullptr;
     KatePlainTextSearch *m_search = nullptr;
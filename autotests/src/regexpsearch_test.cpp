@@ -14,6 +14,8 @@
 
 #include <QRegularExpression>
 
+#include <algorithm>
+
 #include <QtTestWidgets>
 
 QTEST_MAIN(RegExpSearchTest)
@@ -244,12 +246,13 @@ void RegExpSearchTest::testAnchoredRegexp_data()
     // that end beyond the search range are rejected, see KateRegExpSearch::searchText()
     // testNewRow() << "^fe( fe)*"  << Range(0, 0, 0, 5) << false << Range(0, 0, 0, 5);
 
+    // backwards, the match that starts last is found
     testNewRow() << "^fe( fe)*$" << Range(0, 0, 0, 8) << true << Range(0, 0, 0, 8);
     testNewRow() << "^fe( fe)*" << Range(0, 0, 0, 8) << true << Range(0, 0, 0, 8);
-    testNewRow() << "fe( fe)*$" << Range(0, 0, 0, 8) << true << Range(0, 0, 0, 8);
-    testNewRow() << "fe( fe)*" << Range(0, 0, 0, 8) << true << Range(0, 0, 0, 8);
+    testNewRow() << "fe( fe)*$" << Range(0, 0, 0, 8) << true << Range(0, 6, 0, 8);
+    testNewRow() << "fe( fe)*" << Range(0, 0, 0, 8) << true << Range(0, 6, 0, 8);
     testNewRow() << "^fe( fe)*$" << Range(0, 3, 0, 8) << true << Range::invalid();
-    testNewRow() << "fe( fe)*$" << Range(0, 3, 0, 8) << true << Range(0, 3, 0, 8);
+    testNewRow() << "fe( fe)*$" << Range(0, 3, 0, 8) << true << Range(0, 6, 0, 8);
     testNewRow() << "^fe( fe)*$" << Range(0, 0, 0, 5) << true << Range::invalid();
 
     testNewRow() << "^fe|fe$" << Range(0, 0, 0, 5) << false << Range(0, 0, 0, 2);
@@ -303,6 +306,28 @@ void RegExpSearchTest::testSearchBackwardInSelection()
     QCOMPARE(result, Range(0, 7, 0, 10));
 }
 
+void RegExpSearchTest::testSearchBackwardLongLine()
+{
+    // matches far from the end of the line, before chunks of the line without matches
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QString(5000, QLatin1Char('x')) + QLatin1String("foo1") + QString(3000, QLatin1Char('x')) + QLatin1String("foo22") + QString(3000, QLatin1Char('x')));
+
+    const KateRegExpSearch searcher(&doc, QStringLiteral("foo(\\d+)"));
+    const QVector<Range> result = searcher.search(doc.documentRange(), true);
+    QCOMPARE(result.size(), 2);
+    QCOMPARE(result[0], Range(0, 8004, 0, 8009));
+    QCOMPARE(result[1], Range(0, 8007, 0, 8009));
+    QCOMPARE(searcher.search(Range(0, 0, 0, 8005), true)[0], Range(0, 5000, 0, 5004));
+
+    KateRegExpSearch::MatchIterator backwards = searcher.matches(doc.documentRange(), true);
+    QCOMPARE(backwards.next()[0], Range(0, 8004, 0, 8009));
+    QCOMPARE(backwards.next()[0], Range(0, 5000, 0, 5004));
+    QVERIFY(backwards.next().isEmpty());
+
+    const KateRegExpSearch repeated(&doc, QStringLiteral("x+"));
+    QCOMPARE(repeated.search(doc.documentRange(), true)[0], Range(0, 12008, 0, 12009));
+}
+
 void RegExpSearchTest::test()
 {
     KTextEditor::DocumentPrivate doc;
@@ -317,3 +342,177 @@ void RegExpSearchTest::test()
     QCOMPARE(doc.text(result[0]), QString("\\piReductionO"));
     QCOMPARE(doc.text(result[1]), QString("O"));
 }
+
+void RegExpSearchTest::testSearchAllMultiLine_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<Range>("inputRange");
+
+    testNewRow() << "\\n[ \\t]*\\}" << Range(0, 0, 299, 1);
+    testNewRow() << "\\}\\n\\n" << Range(0, 0, 299, 1);
+    testNewRow() << "\\n" << Range(3, 5, 250, 2);
+    testNewRow() << "^$\\n?" << Range(0, 0, 299, 1);
+    // spans more lines than the initial window
+    testNewRow() << "^a\\n(.*\\n){40}b$" << Range(0, 0, 299, 1);
+    testNewRow() << "^a\\n(.*\\n){40}b$" << Range(90, 0, 141, 1);
+    testNewRow() << "line 1\\d\\n" << Range(5, 0, 150, 0);
+}
+
+void RegExpSearchTest::testSearchAllMultiLine()
+{
+    QFETCH(QString, pattern);
+    QFETCH(Range, inputRange);
+
+    // more lines than the window of the multi-line search
+    QStringList lines;
+    for (int i = 0; i < 300; ++i) {
+        if (i == 100) {
+            lines << QStringLiteral("a");
+        } else if (i == 141) {
+            lines << QStringLiteral("b");
+        } else if (i % 7 == 0) {
+            lines << QStringLiteral("}");
+        } else if (i % 7 == 1) {
+            lines << QString();
+        } else {
+            lines << QStringLiteral("    line %1").arg(i);
+        }
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines.join(QLatin1Char('\n')));
+
+    // reference: search the whole range as one string
+    QVector<int> lineStarts;
+    int lineStart = 0;
+    for (const QString &line : qAsConst(lines)) {
+        lineStarts << lineStart;
+        lineStart += line.size() + 1;
+    }
+    auto toCursor = [&lineStarts](int offset) {
+        const int line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin() - 1;
+        return Cursor(line, offset - lineStarts.at(line));
+    };
+
+    const QString text = lines.join(QLatin1Char('\n'));
+    const QRegularExpression regexp(pattern, QRegularExpression::MultilineOption);
+    const int endOffset = lineStarts.at(inputRange.end().line()) + inputRange.end().column();
+    QVector<Range> expected;
+    int offset = lineStarts.at(inputRange.start().line()) + inputRange.start().column();
+    while (offset <= text.size()) {
+        const QRegularExpressionMatch match = regexp.match(text.left(lineStarts.at(inputRange.end().line()) + lines.at(inputRange.end().line()).size()), offset);
+        if (!match.hasMatch() || match.capturedEnd() > endOffset) {
+            break;
+        }
+        expected << Range(toCursor(match.capturedStart()), toCursor(match.capturedEnd()));
+        offset = match.capturedEnd() + (match.capturedLength() == 0 ? 1 : 0);
+    }
+    QVERIFY(!expected.isEmpty());
+
+    KateRegExpSearch searcher(&doc);
+    QCOMPARE(searcher.searchAll(pattern, inputRange), expected);
+
+    // the single searches give the same ranges
+    QCOMPARE(searcher.search(pattern, inputRange)[0], expected.first());
+    QCOMPARE(searcher.search(pattern, inputRange, true)[0], expected.last());
+    QCOMPARE(searcher.searchAll(pattern, inputRange, QRegularExpression::NoPatternOption, 2), expected.mid(0, 2));
+}
+
+void RegExpSearchTest::testMatchIterator_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<Range>("inputRange");
+    QTest::addColumn<QVector<Range>>("expected");
+
+    testNewRow() << "f(e)" << Range(0, 0, 2, 8) << QVector<Range>{Range(0, 0, 0, 2), Range(0, 3, 0, 5), Range(0, 6, 0, 8), Range(2, 6, 2, 8)};
+    testNewRow() << "f(e)" << Range(0, 1, 2, 7) << QVector<Range>{Range(0, 3, 0, 5), Range(0, 6, 0, 8)};
+    testNewRow() << "(e)\\n" << Range(0, 0, 2, 8) << QVector<Range>{Range(0, 7, 1, 0)};
+    testNewRow() << "^(x)?$" << Range(0, 0, 2, 8) << QVector<Range>{Range(1, 0, 1, 0)};
+}
+
+void RegExpSearchTest::testMatchIterator()
+{
+    QFETCH(QString, pattern);
+    QFETCH(Range, inputRange);
+    QFETCH(QVector<Range>, expected);
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText("fe fe fe\n\nxx ff fe");
+
+    const KateRegExpSearch searcher(&doc, pattern);
+    QVERIFY(searcher.isValid());
+    QCOMPARE(searcher.searchAll(inputRange), expected);
+
+    // forwards, with the capture groups
+    KateRegExpSearch::MatchIterator forwards = searcher.matches(inputRange);
+    for (const Range &range : qAsConst(expected)) {
+        const QVector<Range> match = forwards.next();
+        QCOMPARE(match.size(), 2);
+        QCOMPARE(match[0], range);
+    }
+    QVERIFY(forwards.next().isEmpty());
+
+    // backwards, the same matches in reverse order
+    KateRegExpSearch::MatchIterator backwards = searcher.matches(inputRange, true);
+    for (int i = expected.size() - 1; i >= 0; --i) {
+        QCOMPARE(backwards.next()[0], expected[i]);
+    }
+    QVERIFY(backwards.next().isEmpty());
+
+    // single searches with the prepared pattern
+    QCOMPARE(searcher.search(inputRange)[0], expected.first());
+    QCOMPARE(searcher.search(inputRange, true)[0], expected.last());
+
+    // invalid patterns give no matches
+    const KateRegExpSearch invalid(&doc, QStringLiteral("f("));
+    QVERIFY(!invalid.isValid());
+    QCOMPARE(invalid.search(inputRange)[0], Range::invalid());
+    QVERIFY(invalid.matches(inputRange).next().isEmpty());
+}
+
+void RegExpSearchTest::testSearchAllParallel_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<Range>("inputRange");
+
+    testNewRow() << "\\d+" << Range(0, 0, 19999, 1);
+    testNewRow() << "\\d+" << Range(3, 4, 15000, 3);
+    testNewRow() << "^$" << Range(0, 0, 19999, 1);
+    testNewRow() << "\\b" << Range(100, 2, 9000, 0);
+    // multi-line patterns are searched in one pass
+    testNewRow() << "\\}\\n\\n" << Range(0, 0, 19999, 1);
+}
+
+void RegExpSearchTest::testSearchAllParallel()
+{
+    QFETCH(QString, pattern);
+    QFETCH(Range, inputRange);
+
+    // more lines than one thread searches at once
+    QStringList lines;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 7 == 0) {
+            lines << QStringLiteral("}");
+        } else if (i % 7 == 1) {
+            lines << QString();
+        } else {
+            lines << QStringLiteral("line %1 of 2").arg(i);
+        }
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines.join(QLatin1Char('\n')));
+
+    const KateRegExpSearch searcher(&doc, pattern);
+    const QVector<Range> expected = searcher.searchAll(inputRange);
+    QVERIFY(!expected.isEmpty());
+
+    int matchCount = -1;
+    QCOMPARE(searcher.searchAllParallel(inputRange, matchCount), expected);
+    QCOMPARE(matchCount, expected.size());
+
+    // the first ranges, but all matches counted
+    matchCount = -1;
+    QCOMPARE(searcher.searchAllParallel(inputRange, matchCount, 5), expected.mid(0, 5));
+    QCOMPARE(matchCount, expected.size());
+}
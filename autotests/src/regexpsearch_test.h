@@ -37,8 +37,18 @@ private Q_SLOTS:
     void testSearchForward();
 
     void testSearchBackwardInSelection();
+    void testSearchBackwardLongLine();
 
     void test();
+
+    void testSearchAllMultiLine_data();
+    void testSearchAllMultiLine();
+
+    void testMatchIterator_data();
+    void testMatchIterator();
+
+    void testSearchAllParallel_data();
+    void testSearchAllParallel();
 };
 
 #endif
@@ -355,6 +355,39 @@ void SearchBarTest::testFindAll()
     QCOMPARE(bar.m_hlRanges.size(), 0);
 }
 
+void SearchBarTest::testFindAllHighlightsVisibleLines()
+{
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    QStringList lines;
+    for (int i = 0; i < 2000; ++i) {
+        lines << QStringLiteral("a b a");
+    }
+    doc.setText(lines.join(QLatin1Char('\n')));
+    KateSearchBar bar(true, &view, &config);
+
+    bar.setSearchPattern("a");
+    bar.findAll();
+
+    // all matches are counted, only the ones around the visible lines are highlighted
+    QCOMPARE(bar.m_matchCounter, 4000u);
+    QVERIFY(!bar.m_hlRanges.isEmpty());
+    QVERIFY(bar.m_hlRanges.size() < 4000);
+    QCOMPARE(bar.m_hlRanges.at(0)->toRange(), Range(0, 0, 0, 1));
+    const int highlights = bar.m_hlRanges.size();
+
+    // edits are highlighted again
+    doc.insertText(Cursor(0, 0), QStringLiteral("a "));
+    bar.updateHighlightAll();
+    QCOMPARE(bar.m_hlRanges.size(), highlights + 1);
+
+    bar.clearHighlights();
+    QVERIFY(bar.m_hlRanges.isEmpty());
+    QVERIFY(!bar.m_highlightAllRange);
+}
+
 void SearchBarTest::testReplaceAll()
 {
     KTextEditor::DocumentPrivate doc;
@@ -382,6 +415,82 @@ void SearchBarTest::testReplaceAll()
     QCOMPARE(bar.m_hlRanges.at(1)->toRange(), Range(0, 1, 0, 2));
 }
 
+void SearchBarTest::testReplaceAllUndo()
+{
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    const QString text = QStringLiteral("foo1 foo2\nbar\nfoo3");
+    doc.setText(text);
+    KateSearchBar bar(true, &view, &config);
+
+    bar.setSearchMode(KateSearchBar::MODE_REGEX);
+    bar.setSearchPattern(QStringLiteral("foo(\\d)"));
+    bar.setReplacementPattern(QStringLiteral("x\\1"));
+    bar.replaceAll();
+
+    QCOMPARE(doc.text(), QStringLiteral("x1 x2\nbar\nx3"));
+    QCOMPARE(bar.m_hlRanges.size(), 3);
+    QCOMPARE(bar.m_hlRanges.at(0)->toRange(), Range(0, 0, 0, 2));
+    QCOMPARE(bar.m_hlRanges.at(1)->toRange(), Range(0, 3, 0, 5));
+    QCOMPARE(bar.m_hlRanges.at(2)->toRange(), Range(2, 0, 2, 2));
+
+    // the whole replacement is undone and redone in one step
+    doc.undo();
+    QCOMPARE(doc.text(), text);
+    doc.redo();
+    QCOMPARE(doc.text(), QStringLiteral("x1 x2\nbar\nx3"));
+
+    // replacements with line breaks are done match by match
+    doc.setText(text);
+    bar.setReplacementPattern(QStringLiteral("\\1\\n"));
+    bar.replaceAll();
+    QCOMPARE(doc.text(), QStringLiteral("1\n 2\n\nbar\n3\n"));
+    doc.undo();
+    QCOMPARE(doc.text(), text);
+}
+
+void SearchBarTest::testReplaceAllLikeFindAll_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("numMatches");
+    QTest::addColumn<QString>("textAfter");
+
+    // '$' is a word character for the highlighting, unlike for \b of regular expressions
+    testNewRow() << QStringLiteral("a$b a a_b\nA") << int(KateSearchBar::MODE_PLAIN_TEXT) << 3 << QStringLiteral("x$b x x_b\nA");
+    testNewRow() << QStringLiteral("a$b a a_b\nA") << int(KateSearchBar::MODE_WHOLE_WORDS) << 1 << QStringLiteral("a$b x a_b\nA");
+    testNewRow() << QStringLiteral("a$b a a_b\nA") << int(KateSearchBar::MODE_ESCAPE_SEQUENCES) << 3 << QStringLiteral("x$b x x_b\nA");
+}
+
+void SearchBarTest::testReplaceAllLikeFindAll()
+{
+    QFETCH(QString, text);
+    QFETCH(int, mode);
+    QFETCH(int, numMatches);
+    QFETCH(QString, textAfter);
+
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    doc.setText(text);
+    KateSearchBar bar(true, &view, &config);
+
+    // find all and replace all agree on the matches
+    bar.setSearchMode(KateSearchBar::SearchMode(mode));
+    bar.setMatchCase(true);
+    bar.setSearchPattern(QStringLiteral("a"));
+    bar.findAll();
+    QCOMPARE(int(bar.m_matchCounter), numMatches);
+
+    bar.setReplacementPattern(QStringLiteral("x"));
+    bar.replaceAll();
+    QCOMPARE(doc.text(), textAfter);
+    QCOMPARE(bar.m_hlRanges.size(), numMatches);
+}
+
 void SearchBarTest::testFindSelectionForward_data()
 {
     QTest::addColumn<QString>("text");
@@ -43,7 +43,13 @@ private Q_SLOTS:
     void testFindAll_data();
     void testFindAll();
 
+    void testFindAllHighlightsVisibleLines();
+
     void testReplaceAll();
+    void testReplaceAllUndo();
+
+    void testReplaceAllLikeFindAll_data();
+    void testReplaceAllLikeFindAll();
 
     void testFindSelectionForward_data();
     void testFindSelectionForward();
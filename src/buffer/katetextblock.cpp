@@ -14,6 +14,7 @@ namespace Kate
 TextBlock::TextBlock(TextBuffer *buffer, int startLine)
     : m_buffer(buffer)
     , m_startLine(startLine)
+    , m_startLineRevision(buffer->m_startLinesRevision)
 {
     // reserve the block size
     m_lines.reserve(m_buffer->m_blockSize);
@@ -28,13 +29,15 @@ TextBlock::~TextBlock()
     // it only is a hint for ranges for this block, not the storage of them
 }
 
-void TextBlock::setStartLine(int startLine)
+int TextBlock::startLine() const
 {
-    // allow only valid lines
-    Q_ASSERT(startLine >= 0);
-    Q_ASSERT(startLine < m_buffer->lines());
+    // line counts of blocks in front of us changed? ask the buffer
+    if (m_startLineRevision != m_buffer->m_startLinesRevision) {
+        m_startLine = m_buffer->blockStartLine(m_index);
+        m_startLineRevision = m_buffer->m_startLinesRevision;
+    }
 
-    m_startLine = startLine;
+    return m_startLine;
 }
 
 TextLine TextBlock::line(int line) const
@@ -42,10 +45,29 @@ TextLine TextBlock::line(int line) const
     // right input
     Q_ASSERT(line >= startLine());
 
+    // large file mode: lines are decoded on first access
+    // the block still represents the same content, therefore this is fine for const access
+    if (m_lazyByteStart >= 0) {
+        const_cast<TextBlock *>(this)->loadLazyLines();
+    }
+
     // get text line, at will bail out on out-of-range
     return m_lines.at(line - startLine());
 }
 
+int TextBlock::estimatedLineLength(int line) const
+{
+    // right input
+    Q_ASSERT(line >= startLine());
+
+    // large file mode: don't decode the lines, the byte range is known
+    if (m_lazyLines > 0) {
+        return static_cast<int>((m_lazyByteEnd - m_lazyByteStart) / m_lazyLines);
+    }
+
+    return m_lines.at(line - startLine())->length();
+}
+
 void TextBlock::appendLine(const QString &textOfLine)
 {
     m_lines.push_back(TextLine::create(textOfLine));
@@ -54,10 +76,22 @@ void TextBlock::appendLine(const QString &textOfLine)
 void TextBlock::clearLines()
 {
     m_lines.clear();
+
+    // forget about any file backing
+    m_lazyByteStart = m_lazyByteEnd = -1;
+    m_lazyLines = 0;
+
+    // nothing left to filter
+    dropSearchIndex();
 }
 
 void TextBlock::text(QString &text) const
 {
+    // large file mode: lines are decoded on first access
+    if (m_lazyByteStart >= 0) {
+        const_cast<TextBlock *>(this)->loadLazyLines();
+    }
+
     // combine all lines
     for (size_t i = 0; i < m_lines.size(); ++i) {
         // not first line, insert \n
@@ -71,6 +105,9 @@ void TextBlock::text(QString &text) const
 
 void TextBlock::wrapLine(const KTextEditor::Cursor &position, int fixStartLinesStartIndex)
 {
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
     // calc internal line
     int line = position.line() - startLine();
 
@@ -82,7 +119,7 @@ void TextBlock::wrapLine(const KTextEditor::Cursor &position, int fixStartLinesS
     Q_ASSERT(position.column() <= text.size());
 
     // create new line and insert it
-    m_lines.insert(m_lines.begin() + line + 1, TextLine(new TextLineData()));
+    m_lines.insert(m_lines.begin() + line + 1, TextLine::create());
 
     // cases for modification:
     // 1. line is wrapped in the middle
@@ -173,6 +210,9 @@ void TextBlock::wrapLine(const KTextEditor::Cursor &position, int fixStartLinesS
 
 void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLinesStartIndex)
 {
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
     // calc internal line
     line = line - startLine();
 
@@ -183,6 +223,7 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
         Q_ASSERT(previousBlock->lines() > 0);
 
         // move last line of previous block to this one, might result in empty block
+        previousBlock->detachFromFile();
         TextLine oldFirst = m_lines.at(0);
         int lastLineOfPreviousBlock = previousBlock->lines() - 1;
         TextLine newFirst = previousBlock->m_lines.back();
@@ -198,10 +239,12 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
             newFirst->markAsModified(true);
         }
 
-        // patch startLine of this block
-        --m_startLine;
+        // the line comes from the previous block, its filter doesn't know it
+        if (hasSearchIndex()) {
+            addToSearchIndex(newFirst->text(), 0, newFirst->length());
+        }
 
-        // fix all start lines
+        // fix all start lines, this will patch the start line of this block, too
         // we need to do this NOW, else the range update will FAIL!
         // bug 313759
         m_buffer->fixStartLines(fixStartLinesStartIndex);
@@ -280,6 +323,11 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
         m_lines.at(line - 1)->textReadWrite().append(m_lines.at(line)->text());
     }
 
+    // only the trigrams across the joint are new
+    if (hasSearchIndex()) {
+        addToSearchIndex(m_lines.at(line - 1)->text(), oldSizeOfPreviousLine - 2, oldSizeOfPreviousLine + 2);
+    }
+
     const bool lineChanged = (oldSizeOfPreviousLine > 0 && m_lines.at(line - 1)->markedAsModified())
         || (sizeOfCurrentLine > 0 && (oldSizeOfPreviousLine > 0 || m_lines.at(line)->markedAsModified()));
     m_lines.at(line - 1)->markAsModified(lineChanged);
@@ -339,6 +387,9 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
 
 void TextBlock::insertText(const KTextEditor::Cursor &position, const QString &text)
 {
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
     // calc internal line
     int line = position.line() - startLine();
 
@@ -354,6 +405,11 @@ void TextBlock::insertText(const KTextEditor::Cursor &position, const QString &t
     // insert text
     textOfLine.insert(position.column(), text);
 
+    // the trigrams of the inserted text and the ones across its borders are new
+    if (hasSearchIndex()) {
+        addToSearchIndex(textOfLine, position.column() - 2, position.column() + text.size() + 2);
+    }
+
     // notify the text history
     m_buffer->history().insertText(position, text.size(), oldLength);
 
@@ -406,8 +462,156 @@ void TextBlock::insertText(const KTextEditor::Cursor &position, const QString &t
     }
 }
 
+void TextBlock::insertLines(const KTextEditor::Cursor &position, const QStringList &lines, int fixStartLinesStartIndex)
+{
+    Q_ASSERT(lines.size() > 1);
+
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
+    // calc internal line
+    const int line = position.line() - startLine();
+    const int newLines = lines.size() - 1;
+    const int lastLineLength = lines.back().size();
+
+    // get text
+    QString &text = m_lines.at(line)->textReadWrite();
+
+    // check if valid column
+    Q_ASSERT(position.column() >= 0);
+    Q_ASSERT(position.column() <= text.size());
+
+    // create the new lines, the rest of the line goes behind the last one
+    std::vector<TextLine> insertedLines;
+    insertedLines.reserve(newLines);
+    for (int i = 1; i <= newLines; ++i) {
+        insertedLines.push_back(TextLine::create(lines.at(i)));
+    }
+    insertedLines.back()->textReadWrite().append(text.mid(position.column()));
+
+    // compute the modification flags insertText() and wrapLine() would set line by line
+    bool modified = m_lines.at(line)->markedAsModified();
+    bool savedOnDisk = m_lines.at(line)->markedAsSavedOnDisk();
+    int lineLength = text.size();
+    int column = position.column();
+    for (int i = 0; i <= newLines; ++i) {
+        // insertText() of the part of this line
+        if (!lines.at(i).isEmpty()) {
+            modified = true;
+            savedOnDisk = false;
+        }
+        lineLength += lines.at(i).size();
+        column += lines.at(i).size();
+
+        // wrapLine() behind it, rules see there
+        bool nextModified = false;
+        bool nextSavedOnDisk = false;
+        if (i < newLines) {
+            if (column > 0 || lineLength == 0 || modified) {
+                nextModified = true;
+            } else if (savedOnDisk) {
+                nextSavedOnDisk = true;
+            }
+            if (column < lineLength) {
+                modified = true;
+                savedOnDisk = false;
+            }
+        }
+
+        // apply to the line
+        const TextLine &textLine = (i == 0) ? m_lines.at(line) : insertedLines[i - 1];
+        textLine->markAsModified(modified);
+        textLine->markAsSavedOnDisk(savedOnDisk);
+
+        // next line starts with the wrapped rest
+        modified = nextModified;
+        savedOnDisk = nextSavedOnDisk;
+        lineLength -= column;
+        column = 0;
+    }
+
+    // the first line ends with the first inserted text
+    text.truncate(position.column());
+    text.append(lines.front());
+
+    // splice in all new lines at once
+    m_lines.insert(m_lines.begin() + line + 1, std::make_move_iterator(insertedLines.begin()), std::make_move_iterator(insertedLines.end()));
+
+    // add the new text to the filter, unless the block gets split into many new ones, they are indexed later on
+    if (hasSearchIndex()) {
+        if (newLines < m_buffer->m_blockSize) {
+            addToSearchIndex(text, position.column() - 2, text.size());
+            for (int i = 1; i <= newLines; ++i) {
+                addToSearchIndex(m_lines.at(line + i)->text(), 0, m_lines.at(line + i)->length());
+            }
+        } else {
+            dropSearchIndex();
+        }
+    }
+
+    // fix all start lines
+    // we need to do this NOW, else the range update will FAIL!
+    m_buffer->fixStartLines(fixStartLinesStartIndex);
+
+    // notify the text history
+    m_buffer->history().insertLines(position, newLines, lastLineLength);
+
+    // cursor and range handling below
+
+    // no cursors in this block, no work to do..
+    if (m_cursors.empty()) {
+        return;
+    }
+
+    // move all cursors on and behind the line which has the lines inserted, in one pass
+    // remember all ranges modified, optimize for the standard case of a few ranges
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    for (TextCursor *cursor : m_cursors) {
+        // skip cursors on lines in front of the changed one!
+        if (cursor->lineInBlock() < line) {
+            continue;
+        }
+
+        // either this is simple, line behind the changed one
+        if (cursor->lineInBlock() > line) {
+            // patch line of cursor
+            cursor->m_line += newLines;
+        }
+
+        // this is the changed line
+        else {
+            // skip cursors with too small column
+            if (cursor->column() <= position.column()) {
+                if (cursor->column() < position.column() || !cursor->m_moveOnInsert) {
+                    continue;
+                }
+            }
+
+            // move cursor behind the last inserted line
+            cursor->m_line += newLines;
+            cursor->m_column = cursor->m_column - position.column() + lastLineLength;
+        }
+
+        // remember range, if any, avoid double insert
+        auto range = cursor->kateRange();
+        if (range && !range->isValidityCheckRequired()) {
+            range->setValidityCheckRequired();
+            changedRanges.push_back(range);
+        }
+    }
+
+    // we might need to invalidate ranges or notify about their changes
+    // checkValidity might trigger delete of the range!
+    for (TextRange *range : qAsConst(changedRanges)) {
+        range->checkValidity();
+    }
+}
+
 void TextBlock::removeText(const KTextEditor::Range &range, QString &removedText)
 {
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
     // calc internal line
     int line = range.start().line() - startLine();
 
@@ -428,6 +632,12 @@ void TextBlock::removeText(const KTextEditor::Range &range, QString &removedText
     textOfLine.remove(range.start().column(), range.end().column() - range.start().column());
     m_lines.at(line)->markAsModified(true);
 
+    // the removal joins the text around it, index the trigrams across the gap
+    if (hasSearchIndex()) {
+        const int start = range.start().column();
+        addToSearchIndex(textOfLine, qMax(0, start - 2), qMin(textOfLine.size(), start + 2));
+    }
+
     // notify the text history
     m_buffer->history().removeText(range, oldLength);
 
@@ -475,8 +685,139 @@ void TextBlock::removeText(const KTextEditor::Range &range, QString &removedText
     }
 }
 
+void TextBlock::removeLines(const KTextEditor::Range &range, QStringList &removedLines, int fixStartLinesStartIndex)
+{
+    Q_ASSERT(range.start().line() < range.end().line());
+
+    // edited blocks no longer depend on the file
+    detachFromFile();
+
+    // calc internal lines
+    const int line = range.start().line() - startLine();
+    const int lastLine = range.end().line() - startLine();
+    const int removedLineCount = lastLine - line;
+    const int startColumn = range.start().column();
+    const int endColumn = range.end().column();
+
+    // get text
+    QString &text = m_lines.at(line)->textReadWrite();
+    const QString &lastText = m_lines.at(lastLine)->text();
+
+    // check if valid columns
+    Q_ASSERT(startColumn >= 0);
+    Q_ASSERT(startColumn <= text.size());
+    Q_ASSERT(endColumn >= 0);
+    Q_ASSERT(endColumn <= lastText.size());
+
+    // get text which will be removed
+    removedLines.clear();
+    removedLines.reserve(removedLineCount + 1);
+    removedLines.push_back(text.mid(startColumn));
+    for (int i = line + 1; i < lastLine; ++i) {
+        removedLines.push_back(m_lines.at(i)->text());
+    }
+    removedLines.push_back(lastText.left(endColumn));
+
+    // compute the modification flags removeText() and unwrapLine() would set line by line
+    bool modified = m_lines.at(line)->markedAsModified() || startColumn < text.size();
+    bool savedOnDisk = m_lines.at(line)->markedAsSavedOnDisk() && startColumn == text.size();
+    int lineLength = startColumn;
+    for (int i = line + 1; i <= lastLine; ++i) {
+        // removeText() of the part of this line
+        const int removedLength = (i < lastLine) ? m_lines.at(i)->length() : endColumn;
+        const int restLength = (i < lastLine) ? 0 : lastText.size() - endColumn;
+        const bool nextModified = m_lines.at(i)->markedAsModified() || removedLength > 0;
+        const bool nextSavedOnDisk = m_lines.at(i)->markedAsSavedOnDisk() && removedLength == 0;
+
+        // unwrapLine() of it, rules see there
+        modified = (lineLength > 0 && modified) || (restLength > 0 && (lineLength > 0 || nextModified));
+        if (modified) {
+            savedOnDisk = false;
+        }
+        if (lineLength == 0 && nextSavedOnDisk) {
+            modified = false;
+            savedOnDisk = true;
+        }
+        lineLength += restLength;
+    }
+
+    // the first line ends with the rest of the last one
+    text.truncate(startColumn);
+    text.append(lastText.mid(endColumn));
+    m_lines.at(line)->markAsModified(modified);
+    m_lines.at(line)->markAsSavedOnDisk(savedOnDisk);
+
+    // remove all other lines at once
+    m_lines.erase(m_lines.begin() + line + 1, m_lines.begin() + lastLine + 1);
+
+    // the removal joins the text around it, index the trigrams across the gap
+    if (hasSearchIndex()) {
+        addToSearchIndex(text, qMax(0, startColumn - 2), qMin(text.size(), startColumn + 2));
+    }
+
+    // fix all start lines
+    // we need to do this NOW, else the range update will FAIL!
+    m_buffer->fixStartLines(fixStartLinesStartIndex);
+
+    // notify the text history
+    m_buffer->history().removeLines(range);
+
+    // cursor and range handling below
+
+    // no cursors in this block, no work to do..
+    if (m_cursors.empty()) {
+        return;
+    }
+
+    // move all cursors on and behind the first line of the removal, in one pass
+    // remember all ranges modified, optimize for the standard case of a few ranges
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    for (TextCursor *cursor : m_cursors) {
+        // skip cursors on lines in front of the changed one and in front of the removed text
+        if (cursor->lineInBlock() < line || (cursor->lineInBlock() == line && cursor->column() <= startColumn)) {
+            continue;
+        }
+
+        // either this is simple, line behind the removed ones
+        if (cursor->lineInBlock() > lastLine) {
+            // patch line of cursor
+            cursor->m_line -= removedLineCount;
+        }
+
+        // the rest of the last line, move it behind the front of the first one
+        else if (cursor->lineInBlock() == lastLine && cursor->column() > endColumn) {
+            cursor->m_line = line;
+            cursor->m_column = cursor->m_column - endColumn + startColumn;
+        }
+
+        // inside the removed text
+        else {
+            cursor->m_line = line;
+            cursor->m_column = startColumn;
+        }
+
+        // remember range, if any, avoid double insert
+        auto range = cursor->kateRange();
+        if (range && !range->isValidityCheckRequired()) {
+            range->setValidityCheckRequired();
+            changedRanges.push_back(range);
+        }
+    }
+
+    // we might need to invalidate ranges or notify about their changes
+    // checkValidity might trigger delete of the range!
+    for (TextRange *range : qAsConst(changedRanges)) {
+        range->checkValidity();
+    }
+}
+
 void TextBlock::debugPrint(int blockIndex) const
 {
+    // large file mode: lines are decoded on first access
+    if (m_lazyByteStart >= 0) {
+        const_cast<TextBlock *>(this)->loadLazyLines();
+    }
+
     // print all blocks
     for (size_t i = 0; i < m_lines.size(); ++i)
         printf("%4d - %4lld : %4d : '%s'\n", blockIndex, (unsigned long long)startLine() + i, m_lines.at(i)->text().size(), qPrintable(m_lines.at(i)->text()));
@@ -484,6 +825,9 @@ void TextBlock::debugPrint(int blockIndex) const
 
 TextBlock *TextBlock::splitBlock(int fromLine)
 {
+    // both parts will no longer depend on the file
+    detachFromFile();
+
     // half the block
     int linesOfNewBlock = lines() - fromLine;
 
@@ -497,6 +841,14 @@ TextBlock *TextBlock::splitBlock(int fromLine)
     }
     m_lines.resize(fromLine);
 
+    // lines that lost their highlighting by eviction still need it in both parts
+    newBlock->m_lazyHighlightingLost = m_lazyHighlightingLost;
+
+    // the filter of this block still covers the moved lines, the new block gets its own one
+    if (hasSearchIndex()) {
+        newBlock->buildSearchIndex();
+    }
+
     // move cursors
     for (auto it = m_cursors.begin(); it != m_cursors.end();) {
         auto cursor = *it;
@@ -533,6 +885,10 @@ TextBlock *TextBlock::splitBlock(int fromLine)
 
 void TextBlock::mergeBlock(TextBlock *targetBlock)
 {
+    // merged block will no longer depend on the file
+    detachFromFile();
+    targetBlock->detachFromFile();
+
     // move cursors, do this first, now still lines() count is correct for target
     for (TextCursor *cursor : m_cursors) {
         cursor->m_line = cursor->lineInBlock() + targetBlock->lines();
@@ -547,6 +903,24 @@ void TextBlock::mergeBlock(TextBlock *targetBlock)
         targetBlock->m_lines.push_back(m_lines.at(i));
     }
     m_lines.clear();
+    targetBlock->m_lazyHighlightingLost = targetBlock->m_lazyHighlightingLost || m_lazyHighlightingLost;
+
+    // unite the filters, the larger one is folded to the size of the smaller one
+    if (hasSearchIndex() && targetBlock->hasSearchIndex()) {
+        const bool targetSmaller = targetBlock->m_searchIndex.size() <= m_searchIndex.size();
+        std::vector<quint64> searchIndex = targetSmaller ? targetBlock->m_searchIndex : m_searchIndex;
+        const std::vector<quint64> &largerSearchIndex = targetSmaller ? m_searchIndex : targetBlock->m_searchIndex;
+        for (size_t i = 0; i < largerSearchIndex.size(); ++i) {
+            searchIndex[i % searchIndex.size()] |= largerSearchIndex[i];
+        }
+        targetBlock->setSearchIndex(std::move(searchIndex), targetBlock->m_searchIndexTrigrams + m_searchIndexTrigrams);
+        if (targetBlock->m_searchIndexTrigrams > static_cast<int>(targetBlock->m_searchIndex.size() * 64)) {
+            targetBlock->buildSearchIndex();
+        }
+    } else {
+        targetBlock->dropSearchIndex();
+    }
+    dropSearchIndex();
 
     // fix ALL ranges!
     // copy is necessary as update range may modify the uncached ranges
@@ -584,7 +958,7 @@ void TextBlock::deleteBlockContent()
     }
 
     // kill lines
-    m_lines.clear();
+    clearLines();
 }
 
 void TextBlock::clearBlockContent(TextBlock *targetBlock)
@@ -608,14 +982,14 @@ void TextBlock::clearBlockContent(TextBlock *targetBlock)
     }
 
     // kill lines
-    m_lines.clear();
+    clearLines();
 }
 
 QVector<TextRange *> TextBlock::rangesForLine(int line, KTextEditor::View *view, bool rangesWithAttributeOnly) const
 {
     const auto cachedRanges = cachedRangesForLine(line);
     QVector<TextRange *> ranges;
-    ranges.reserve(m_uncachedRanges.size() + cachedRanges.size());
+    ranges.reserve(cachedRanges.size());
 
     auto predicate = [line, view, rangesWithAttributeOnly](TextRange *range) {
         if (rangesWithAttributeOnly && !range->hasAttribute()) {
@@ -640,12 +1014,76 @@ QVector<TextRange *> TextBlock::rangesForLine(int line, KTextEditor::View *view,
     };
 
     std::copy_if(cachedRanges.begin(), cachedRanges.end(), std::back_inserter(ranges), predicate);
-    std::copy_if(m_uncachedRanges.begin(), m_uncachedRanges.end(), std::back_inserter(ranges), predicate);
+
+    // multi-line ranges: only the parts of the interval index that can contain the line are visited
+    updateUncachedRangesIndex();
+    QVector<TextRange *> uncachedRanges;
+    uncachedRangesForLine(0, m_uncachedRangesIndex.size(), line, uncachedRanges);
+    std::copy_if(uncachedRanges.begin(), uncachedRanges.end(), std::back_inserter(ranges), predicate);
     return ranges;
 }
 
+void TextBlock::updateUncachedRangesIndex() const
+{
+    // ranges are only moved by edits, they change the revision
+    const qint64 revision = m_buffer->revision();
+    if (m_uncachedRangesIndexRevision == revision) {
+        return;
+    }
+    m_uncachedRangesIndexRevision = revision;
+
+    m_uncachedRangesIndex.clear();
+    m_uncachedRangesIndex.reserve(m_uncachedRanges.size());
+    for (TextRange *range : m_uncachedRanges) {
+        m_uncachedRangesIndex.push_back({range->startInternal().lineInternal(), range->endInternal().lineInternal(), 0, range});
+    }
+    std::sort(m_uncachedRangesIndex.begin(), m_uncachedRangesIndex.end(), [](const UncachedRange &a, const UncachedRange &b) {
+        return a.startLine < b.startLine;
+    });
+    updateUncachedRangesMaxEndLines(0, m_uncachedRangesIndex.size());
+}
+
+int TextBlock::updateUncachedRangesMaxEndLines(int first, int last) const
+{
+    if (first >= last) {
+        return -1;
+    }
+
+    const int middle = first + (last - first) / 2;
+    UncachedRange &entry = m_uncachedRangesIndex[middle];
+    entry.maxEndLine = qMax(entry.endLine, qMax(updateUncachedRangesMaxEndLines(first, middle), updateUncachedRangesMaxEndLines(middle + 1, last)));
+    return entry.maxEndLine;
+}
+
+void TextBlock::uncachedRangesForLine(int first, int last, int line, QVector<TextRange *> &ranges) const
+{
+    if (first >= last) {
+        return;
+    }
+
+    // all ranges of this half end before the line
+    const int middle = first + (last - first) / 2;
+    const UncachedRange &entry = m_uncachedRangesIndex[middle];
+    if (entry.maxEndLine < line) {
+        return;
+    }
+
+    uncachedRangesForLine(first, middle, line, ranges);
+
+    // the ranges of the right half start at or after this one
+    if (entry.startLine > line) {
+        return;
+    }
+
+    if (line <= entry.endLine) {
+        ranges.append(entry.range);
+    }
+    uncachedRangesForLine(middle + 1, last, line, ranges);
+}
+
 void TextBlock::markModifiedLinesAsSaved()
 {
+    // not decoded lines from the file are unmodified anyway
     // mark all modified lines as saved
     for (auto &textLine : m_lines) {
         if (textLine->markedAsModified()) {
@@ -662,7 +1100,8 @@ void TextBlock::updateRange(TextRange *range)
     const bool isSingleLine = startLine == endLine;
 
     // perhaps remove range and be done
-    if ((endLine < m_startLine) || (startLine >= (m_startLine + lines()))) {
+    const int blockStartLine = this->startLine();
+    if ((endLine < blockStartLine) || (startLine >= (blockStartLine + lines()))) {
         removeRange(range);
         return;
     }
@@ -670,13 +1109,14 @@ void TextBlock::updateRange(TextRange *range)
     // The range is still a single-line range, and is still cached to the correct line.
     if (isSingleLine) {
         auto it = m_cachedLineForRanges.find(range);
-        if (it != m_cachedLineForRanges.end() && it->second == startLine - m_startLine) {
+        if (it != m_cachedLineForRanges.end() && it->second == startLine - blockStartLine) {
             return;
         }
     }
 
-    // The range is still a multi-line range, and is already in the correct set.
-    if (!isSingleLine && m_uncachedRanges.contains(range)) {
+    // The range is still a multi-line range, and is already in the correct set, its lines might have changed.
+    if (!isSingleLine && m_uncachedRanges.find(range) != m_uncachedRanges.end()) {
+        m_uncachedRangesIndexRevision = -1;
         return;
     }
 
@@ -686,12 +1126,13 @@ void TextBlock::updateRange(TextRange *range)
     // simple case: multi-line range
     if (!isSingleLine) {
         // The range cannot be cached per line, as it spans multiple lines
-        m_uncachedRanges.append(range);
+        m_uncachedRanges.insert(range);
+        m_uncachedRangesIndexRevision = -1;
         return;
     }
 
     // The range is contained by a single line, put it into the line-cache
-    const int lineOffset = startLine - m_startLine;
+    const int lineOffset = startLine - blockStartLine;
 
     // enlarge cache if needed
     if (m_cachedRangesForLine.size() <= lineOffset) {
@@ -706,9 +1147,8 @@ void TextBlock::updateRange(TextRange *range)
 void TextBlock::removeRange(TextRange *range)
 {
     // uncached range? remove it and be done
-    int pos = m_uncachedRanges.indexOf(range);
-    if (pos != -1) {
-        m_uncachedRanges.remove(pos);
+    if (m_uncachedRanges.erase(range) > 0) {
+        m_uncachedRangesIndexRevision = -1;
         // must be only uncached!
         Q_ASSERT(m_cachedLineForRanges.find(range) == m_cachedLineForRanges.end());
         return;
@@ -718,7 +1158,7 @@ void TextBlock::removeRange(TextRange *range)
     auto it = m_cachedLineForRanges.find(range);
     if (it != m_cachedLineForRanges.end()) {
         // must be only cached!
-        Q_ASSERT(!m_uncachedRanges.contains(range));
+        Q_ASSERT(m_uncachedRanges.find(range) == m_uncachedRanges.end());
 
         int line = it->second;
 
@@ -734,4 +1174,165 @@ void TextBlock::removeRange(TextRange *range)
     // else: range was not for this block, just do nothing, removeRange should be "safe" to use
 }
 
+void TextBlock::setLazyLines(qint64 byteStart, qint64 byteEnd, bool startsAfterCarriageReturn, int lines)
+{
+    // only allowed for new blocks during load
+    Q_ASSERT(m_lines.empty());
+    Q_ASSERT(lines > 0);
+
+    m_lazyByteStart = byteStart;
+    m_lazyByteEnd = byteEnd;
+    m_lazyStartsAfterCarriageReturn = startsAfterCarriageReturn;
+    m_lazyLines = lines;
+
+    // don't keep the reserved line storage around for blocks not yet decoded
+    std::vector<Kate::TextLine>().swap(m_lines);
+}
+
+void TextBlock::loadLazyLines()
+{
+    Q_ASSERT(m_lazyByteStart >= 0);
+
+    // remember access, cold blocks are evicted first
+    m_lazyLastUse = ++m_buffer->m_lazyUseCounter;
+
+    // already decoded?
+    if (m_lazyLines == 0) {
+        return;
+    }
+
+    decodeLazyLines();
+
+    // this might evict other blocks
+    m_buffer->lazyBlockLoaded(this);
+}
+
+void TextBlock::decodeLazyLines()
+{
+    // decode the lines, they must match the number of lines indexed on load
+    m_buffer->loadLazyLines(m_lazyByteStart, m_lazyByteEnd, m_lazyStartsAfterCarriageReturn, m_lazyLines, m_lines);
+    Q_ASSERT(static_cast<int>(m_lines.size()) == m_lazyLines);
+    m_lazyLines = 0;
+
+    // the highlighting of the following lines continues with the state kept on eviction
+    if (m_lazyHighlightingLost) {
+        m_lines.back()->setHighlightingState(m_lazyEndState);
+    }
+}
+
+bool TextBlock::evictLazyLines()
+{
+    Q_ASSERT(lazyLinesLoaded());
+
+    // only clean lines can be decoded again without loss
+    bool highlighted = false;
+    for (const auto &textLine : m_lines) {
+        if (textLine->markedAsModified() || textLine->markedAsSavedOnDisk()) {
+            return false;
+        }
+        highlighted = highlighted || textLine->markedAsFoldingStart() || !textLine->attributesList().isEmpty() || !textLine->foldings().empty()
+            || !(textLine->highlightingState() == KSyntaxHighlighting::State());
+    }
+
+    // highlighting data is dropped, too, but the state at the end is needed to highlight the following lines
+    if (highlighted) {
+        m_lazyHighlightingLost = true;
+        m_lazyEndState = m_lines.back()->highlightingState();
+    }
+
+    m_lazyLines = static_cast<int>(m_lines.size());
+    std::vector<Kate::TextLine>().swap(m_lines);
+    return true;
+}
+
+void TextBlock::detachFromFile()
+{
+    // not backed by the file, nothing to do
+    if (m_lazyByteStart < 0) {
+        return;
+    }
+
+    // decode the lines or, if already done, stop counting them as evictable
+    if (m_lazyLines > 0) {
+        decodeLazyLines();
+    } else {
+        --m_buffer->m_lazyBlocksLoaded;
+    }
+
+    m_lazyByteStart = m_lazyByteEnd = -1;
+}
+
+void TextBlock::buildSearchIndex()
+{
+    // large file mode: lines are decoded on first access
+    if (m_lazyByteStart >= 0) {
+        loadLazyLines();
+    }
+
+    // two bits per trigram, at least 512 bits, a power of two, that filters can be folded when blocks are merged
+    size_t trigrams = 0;
+    for (const auto &textLine : m_lines) {
+        trigrams += qMax(0, textLine->length() - 2);
+    }
+    size_t words = 8;
+    while (words * 64 < 2 * trigrams) {
+        words *= 2;
+    }
+
+    setSearchIndex(std::vector<quint64>(words, 0), 0);
+    for (const auto &textLine : m_lines) {
+        addToSearchIndex(textLine->text(), 0, textLine->length());
+    }
+}
+
+bool TextBlock::searchIndexMayContain(const std::vector<quint32> &trigrams) const
+{
+    if (m_searchIndex.empty()) {
+        return true;
+    }
+
+    const quint32 mask = static_cast<quint32>(m_searchIndex.size() * 64 - 1);
+    for (const quint32 hash : trigrams) {
+        if (!(m_searchIndex[(hash & mask) >> 6] & (quint64(1) << (hash & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextBlock::addToSearchIndex(const QString &text, int from, int to)
+{
+    from = qMax(from, 0);
+    to = qMin(to, text.size());
+    if (to - from < 3) {
+        return;
+    }
+
+    const quint32 mask = static_cast<quint32>(m_searchIndex.size() * 64 - 1);
+    const QChar *unicode = text.unicode();
+    ushort first = unicode[from].toCaseFolded().unicode();
+    ushort second = unicode[from + 1].toCaseFolded().unicode();
+    for (int i = from + 2; i < to; ++i) {
+        const ushort third = unicode[i].toCaseFolded().unicode();
+        const quint32 hash = searchIndexHash(first, second, third);
+        m_searchIndex[(hash & mask) >> 6] |= quint64(1) << (hash & 63);
+        first = second;
+        second = third;
+    }
+    m_searchIndexTrigrams += to - from - 2;
+
+    // too full, the filter would let most searches through
+    if (m_searchIndexTrigrams > static_cast<int>(m_searchIndex.size() * 64)) {
+        buildSearchIndex();
+    }
+}
+
+void TextBlock::setSearchIndex(std::vector<quint64> &&searchIndex, int trigrams)
+{
+    m_buffer->m_searchIndexMemory += static_cast<qint64>(searchIndex.size() * sizeof(quint64)) - searchIndexMemory();
+    m_buffer->m_searchIndexBlocks += (searchIndex.empty() ? 0 : 1) - (m_searchIndex.empty() ? 0 : 1);
+    m_searchIndex = std::move(searchIndex);
+    m_searchIndexTrigrams = trigrams;
+}
+
 }
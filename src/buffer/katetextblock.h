@@ -9,8 +9,10 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <QSet>
+#include <QStringList>
 #include <QVarLengthArray>
 #include <QVector>
 
@@ -51,18 +53,19 @@ public:
 
     /**
      * Start line of this block.
+     * Cached, computed again by the buffer after the line count of any block in front of this one changed.
      * @return start line of this block
      */
-    int startLine() const
-    {
-        return m_startLine;
-    }
+    int startLine() const;
 
     /**
-     * Set start line of this block.
-     * @param startLine new start line of this block
+     * Set index of this block in the buffer, done by the buffer after blocks got inserted or removed.
+     * @param index new index of this block
      */
-    void setStartLine(int startLine);
+    void setIndex(int index)
+    {
+        m_index = index;
+    }
 
     /**
      * Retrieve a text line.
@@ -71,12 +74,28 @@ public:
      */
     TextLine line(int line) const;
 
+    /**
+     * Length of a line, for lines not decoded yet the average byte length of the lines of this block.
+     * @param line wanted line number
+     * @return (estimated) length of the line
+     */
+    int estimatedLineLength(int line) const;
+
     /**
      * Append a new line with given text.
      * @param textOfLine text of the line to append
      */
     void appendLine(const QString &textOfLine);
 
+    /**
+     * Append the given line.
+     * @param textLine text line to append
+     */
+    void appendLine(TextLine &&textLine)
+    {
+        m_lines.push_back(std::move(textLine));
+    }
+
     /**
      * Clear the lines.
      */
@@ -88,7 +107,7 @@ public:
      */
     int lines() const
     {
-        return m_lines.size();
+        return (m_lazyLines > 0) ? m_lazyLines : static_cast<int>(m_lines.size());
     }
 
     /**
@@ -119,6 +138,15 @@ public:
      */
     void insertText(const KTextEditor::Cursor &position, const QString &text);
 
+    /**
+     * Insert multiple lines at given cursor position, the block might get too large, the buffer will split it.
+     * Same result as insertText() and wrapLine() for each line, but done in one go.
+     * @param position position where to insert the first line
+     * @param lines lines to insert, at least two, the rest of the line at position is appended to the last one
+     * @param fixStartLinesStartIndex start index to fix start lines, normally this is this block
+     */
+    void insertLines(const KTextEditor::Cursor &position, const QStringList &lines, int fixStartLinesStartIndex);
+
     /**
      * Remove text at given range.
      * @param range range of text to remove, must be on one line only.
@@ -126,6 +154,15 @@ public:
      */
     void removeText(const KTextEditor::Range &range, QString &removedText);
 
+    /**
+     * Remove text spanning multiple lines, all of them must be in this block.
+     * Same result as removeText() and unwrapLine() for each line, but done in one go.
+     * @param range range of text to remove, must span at least two lines
+     * @param removedLines will be filled with the removed text, one entry per line
+     * @param fixStartLinesStartIndex start index to fix start lines, normally this is this block
+     */
+    void removeLines(const KTextEditor::Range &range, QStringList &removedLines, int fixStartLinesStartIndex);
+
     /**
      * Debug output, print whole block content with line numbers and line length
      * @param blockIndex index of this block in buffer
@@ -176,7 +213,7 @@ public:
      */
     bool containsRange(TextRange *range) const
     {
-        return m_cachedLineForRanges.find(range) != m_cachedLineForRanges.end() || m_uncachedRanges.contains(range);
+        return m_cachedLineForRanges.find(range) != m_cachedLineForRanges.end() || m_uncachedRanges.find(range) != m_uncachedRanges.end();
     }
 
     /**
@@ -223,7 +260,7 @@ public:
      */
     QSet<TextRange *> cachedRangesForLine(int line) const
     {
-        line -= m_startLine;
+        line -= startLine();
         if (line >= 0 && line < m_cachedRangesForLine.size()) {
             return m_cachedRangesForLine[line];
         } else {
@@ -231,7 +268,155 @@ public:
         }
     }
 
+    /**
+     * Large file mode: let this empty block stand for the given byte range of the large file.
+     * The lines are only decoded on first access, see TextBuffer::setLargeFileModeThreshold().
+     * @param byteStart start of the byte range of the lines
+     * @param byteEnd end of the byte range of the lines
+     * @param startsAfterCarriageReturn does the range directly follow a \r? needed for \r\n detection
+     * @param lines number of lines in the byte range
+     */
+    void setLazyLines(qint64 byteStart, qint64 byteEnd, bool startsAfterCarriageReturn, int lines);
+
+    /**
+     * Large file mode: are the lines of this block decoded but still backed by the large file?
+     * Only such blocks can be evicted again.
+     * @return lines decoded and evictable?
+     */
+    bool lazyLinesLoaded() const
+    {
+        return m_lazyByteStart >= 0 && m_lazyLines == 0;
+    }
+
+    /**
+     * Large file mode: usage stamp of the last access to the lines, used to evict the coldest blocks first.
+     * @return usage stamp
+     */
+    quint64 lazyLastUse() const
+    {
+        return m_lazyLastUse;
+    }
+
+    /**
+     * Large file mode: drop the decoded lines again, they will be decoded again on next access.
+     * Only unmodified lines can be dropped without loss. Of their highlighting data only the state at
+     * the end of the block is kept, see takeLostHighlighting().
+     * @return true, if the lines got dropped
+     */
+    bool evictLazyLines();
+
+    /**
+     * Large file mode: did the lines lose their highlighting data by eviction?
+     * Resets the flag, the caller must highlight the lines again.
+     * @return lines to highlight again?
+     */
+    bool takeLostHighlighting()
+    {
+        const bool lost = m_lazyHighlightingLost;
+        m_lazyHighlightingLost = false;
+        return lost;
+    }
+
+    /**
+     * Large file mode: decode the lines, if not already done, and stop to depend on the large file.
+     * Done before any edit of the block, edited blocks are never evicted.
+     */
+    void detachFromFile();
+
+    /**
+     * Search index: has this block a filter of the trigrams of its lines? see TextBuffer::setSearchIndexEnabled()
+     * @return filter built?
+     */
+    bool hasSearchIndex() const
+    {
+        return !m_searchIndex.empty();
+    }
+
+    /**
+     * Search index: build the filter of the trigrams of the lines again, sized for their number.
+     */
+    void buildSearchIndex();
+
+    /**
+     * Search index: drop the filter, the block might contain anything again.
+     */
+    void dropSearchIndex()
+    {
+        setSearchIndex(std::vector<quint64>(), 0);
+    }
+
+    /**
+     * Search index: might a line of this block contain a text with all the given trigrams?
+     * @param trigrams hashes of the trigrams, see TextBuffer::searchIndexTrigrams()
+     * @return false, if the filter rules it out, true otherwise or if there is no filter
+     */
+    bool searchIndexMayContain(const std::vector<quint32> &trigrams) const;
+
+    /**
+     * Search index: memory used by the filter.
+     * @return size of the filter in bytes
+     */
+    qint64 searchIndexMemory() const
+    {
+        return static_cast<qint64>(m_searchIndex.size() * sizeof(quint64));
+    }
+
+    /**
+     * Search index: hash of a case folded trigram, the same for the filters and the searched texts.
+     * @param first first character, case folded
+     * @param second second character, case folded
+     * @param third third character, case folded
+     * @return hash of the trigram
+     */
+    static quint32 searchIndexHash(ushort first, ushort second, ushort third)
+    {
+        const quint32 hash = (first * 0x9E3779B1U) ^ (second * 0x85EBCA77U) ^ (third * 0xC2B2AE3DU);
+        return hash ^ (hash >> 15);
+    }
+
 private:
+    /**
+     * Search index: add the trigrams of the given part of a line to the filter, the filter is built again once it is too full.
+     * @param text text of the line
+     * @param from start of the part, trigrams reaching in front of the line are ignored
+     * @param to end of the part, trigrams reaching behind the line are ignored
+     */
+    void addToSearchIndex(const QString &text, int from, int to);
+
+    /**
+     * Search index: replace the filter and keep the memory accounting of the buffer right.
+     * @param searchIndex new filter, empty for none
+     * @param trigrams number of trigrams added to the filter
+     */
+    void setSearchIndex(std::vector<quint64> &&searchIndex, int trigrams);
+
+    /**
+     * Large file mode: decode the lines, if not already done and remember the access for eviction.
+     */
+    void loadLazyLines();
+
+    /**
+     * Large file mode: decode the lines and restore the kept highlighting state.
+     */
+    void decodeLazyLines();
+
+private:
+    /**
+     * Build the interval index of the multi-line ranges again, if outdated.
+     */
+    void updateUncachedRangesIndex() const;
+
+    /**
+     * Compute the largest end lines of the interval index entries \p first to \p last - 1 and their halves.
+     * @return largest end line of these entries
+     */
+    int updateUncachedRangesMaxEndLines(int first, int last) const;
+
+    /**
+     * Append the multi-line ranges of the interval index entries \p first to \p last - 1 that contain \p line.
+     */
+    void uncachedRangesForLine(int first, int last, int line, QVector<TextRange *> &ranges) const;
+
     /**
      * parent text buffer
      */
@@ -244,9 +429,19 @@ private:
     std::vector<Kate::TextLine> m_lines;
 
     /**
-     * Startline of this block
+     * Index of this block in the buffer
      */
-    int m_startLine;
+    int m_index = 0;
+
+    /**
+     * Startline of this block, valid for the start line revision of the buffer below
+     */
+    mutable int m_startLine;
+
+    /**
+     * Start line revision of the buffer, m_startLine was computed for
+     */
+    mutable quint64 m_startLineRevision;
 
     /**
      * Set of cursors for this block.
@@ -268,7 +463,61 @@ private:
     /**
      * This contains all the ranges that are not cached.
      */
-    QVarLengthArray<TextRange *, 1> m_uncachedRanges;
+    std::unordered_set<TextRange *> m_uncachedRanges;
+
+    /**
+     * Interval index of the uncached ranges: sorted by start line, each entry knows the largest end line
+     * of the entries of the half it is the middle of, like in a balanced binary tree.
+     * The lines are the ones of the buffer revision the index was built for, it is built again
+     * on the first query after an edit or after uncached ranges were added, moved or removed.
+     */
+    struct UncachedRange {
+        int startLine;
+        int endLine;
+        int maxEndLine;
+        TextRange *range;
+    };
+    mutable std::vector<UncachedRange> m_uncachedRangesIndex;
+    mutable qint64 m_uncachedRangesIndexRevision = -1;
+
+    /**
+     * Large file mode: byte range of the lines in the large file, -1 if not backed by the file.
+     */
+    qint64 m_lazyByteStart = -1;
+    qint64 m_lazyByteEnd = -1;
+
+    /**
+     * Large file mode: does the byte range directly follow a \r?
+     */
+    bool m_lazyStartsAfterCarriageReturn = false;
+
+    /**
+     * Large file mode: number of lines not yet decoded, 0 if m_lines is valid.
+     */
+    int m_lazyLines = 0;
+
+    /**
+     * Large file mode: usage stamp of last access to the decoded lines.
+     */
+    quint64 m_lazyLastUse = 0;
+
+    /**
+     * Large file mode: lines evicted with highlighting data, the highlighting state at the end of the block
+     * is kept for the highlighting of the following lines.
+     */
+    bool m_lazyHighlightingLost = false;
+    KSyntaxHighlighting::State m_lazyEndState;
+
+    /**
+     * Search index: Bloom filter of the case folded trigrams of the lines, one bit per trigram, empty if none.
+     * Edits only add trigrams, the filter stays valid for removed text, but is built again once too many got added.
+     */
+    std::vector<quint64> m_searchIndex;
+
+    /**
+     * Search index: number of trigrams added to the filter
+     */
+    int m_searchIndexTrigrams = 0;
 };
 
 }
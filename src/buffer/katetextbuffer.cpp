@@ -28,7 +28,15 @@
 #include <QCryptographicHash>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QTemporaryFile>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <thread>
 
 #if 0
 #define BUFFER_DEBUG qCDebug(LOG_KTE)
@@ -40,6 +48,33 @@
 
 namespace Kate
 {
+/**
+ * large file mode: maximal number of decoded blocks still backed by the file, colder ones get evicted
+ */
+static const int KATE_LARGE_FILE_MAX_LOADED_BLOCKS = 4096;
+
+/**
+ * large file mode: read the given byte range of the file, less if the file got truncated by others
+ */
+static QByteArray readFileRange(QFile &file, qint64 start, qint64 end)
+{
+    QByteArray data;
+    if (file.seek(start)) {
+        data = file.read(end - start);
+    }
+    return data;
+}
+
+/**
+ * parallel loading: maximal size of the chunks the file data is cut into, limits the temporary decoded text
+ */
+static const qint64 KATE_PARALLEL_LOAD_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+/**
+ * saving: size of the output buffer the lines get encoded into, it is written to the device once full
+ */
+static const int KATE_SAVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
 TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, int blockSize, bool alwaysUseKAuth)
     : QObject(parent)
     , m_document(parent)
@@ -47,6 +82,7 @@ TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, int blockSize, bool
     , m_blockSize(blockSize)
     , m_lines(0)
     , m_lastUsedBlock(0)
+    , m_startLinesRevision(0)
     , m_revision(0)
     , m_editingTransactions(0)
     , m_editingLastRevision(0)
@@ -61,6 +97,20 @@ TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, int blockSize, bool
     , m_newLineAtEof(false)
     , m_lineLengthLimit(4096)
     , m_alwaysUseKAuthForSave(alwaysUseKAuth)
+    , m_saveViaTemporaryFile(false)
+    , m_parallelLoadThreshold(0)
+    , m_largeFileModeThreshold(0)
+    , m_largeFile(nullptr)
+    , m_largeFileSize(0)
+    , m_largeFileUtf8(false)
+    , m_largeFileLineLengthLimit(0)
+    , m_lazyBlocksLoaded(0)
+    , m_lazyUseCounter(0)
+    , m_searchIndexEnabled(false)
+    , m_searchIndexMemoryLimit(0)
+    , m_searchIndexMemory(0)
+    , m_searchIndexBlocks(0)
+    , m_searchIndexNextBlock(0)
 {
     // minimal block size must be > 0
     Q_ASSERT(m_blockSize > 0);
@@ -92,6 +142,9 @@ TextBuffer::~TextBuffer()
     qDeleteAll(m_blocks);
     m_blocks.clear();
 
+    // close the large file, no block depends on it anymore
+    delete m_largeFile;
+
     // kill all invalid cursors, do this after block deletion, to uncover if they might be still linked in blocks
     QSet<TextCursor *> copyCursors = m_invalidCursors;
     qDeleteAll(copyCursors);
@@ -130,9 +183,16 @@ void TextBuffer::clear()
     // insert one block with one empty line
     m_blocks.push_back(newBlock);
 
+    // close the large file, no block depends on it anymore
+    delete m_largeFile;
+    m_largeFile = nullptr;
+    m_largeFileSize = 0;
+    m_lazyBlocksLoaded = 0;
+
     // reset lines and last used block
     m_lines = 1;
     m_lastUsedBlock = 0;
+    fixBlockIndices();
 
     // reset revision
     m_revision = 0;
@@ -159,6 +219,28 @@ TextLine TextBuffer::line(int line) const
     return m_blocks.at(blockIndex)->line(line);
 }
 
+int TextBuffer::estimatedLineLength(int line) const
+{
+    // get block, this will assert on invalid line
+    int blockIndex = blockForLine(line);
+
+    // get length, without decoding the block
+    return m_blocks.at(blockIndex)->estimatedLineLength(line);
+}
+
+bool TextBuffer::takeLostHighlighting(int line, int &startLine, int &endLine)
+{
+    // get block, this will assert on invalid line
+    TextBlock *block = m_blocks.at(blockForLine(line));
+    if (!block->takeLostHighlighting()) {
+        return false;
+    }
+
+    startLine = block->startLine();
+    endLine = startLine + block->lines() - 1;
+    return true;
+}
+
 QString TextBuffer::text() const
 {
     QString text;
@@ -216,6 +298,9 @@ bool TextBuffer::finishEditing()
     Q_ASSERT(!editingChangedBuffer() || (m_editingMinimalLineChanged >= 0 && m_editingMinimalLineChanged < m_lines));
     Q_ASSERT(!editingChangedBuffer() || (m_editingMaximalLineChanged >= 0 && m_editingMaximalLineChanged < m_lines));
 
+    // edits might have grown the filters of the search index
+    checkSearchIndexMemory();
+
     // transaction has finished
     Q_EMIT editingFinished();
     if (m_document)
@@ -355,6 +440,63 @@ void TextBuffer::insertText(const KTextEditor::Cursor &position, const QString &
         Q_EMIT m_document->KTextEditor::Document::textInserted(m_document, position, text);
 }
 
+void TextBuffer::insertLines(const KTextEditor::Cursor &position, const QStringList &lines)
+{
+    // debug output for REAL low-level debugging
+    BUFFER_DEBUG << "insertLines" << position << lines.size();
+
+    // only allowed if editing transaction running
+    Q_ASSERT(m_editingTransactions > 0);
+
+    // at least one line must be wrapped, else this is just insertText
+    Q_ASSERT(lines.size() > 1);
+
+    // get block, this will assert on invalid line
+    int blockIndex = blockForLine(position.line());
+
+    // let the block handle the insertLines
+    // this leads to more lines in this block, the balancing below splits it
+    // this call will trigger fixStartLines
+    const int newLines = lines.size() - 1;
+    m_lines += newLines; // first alter the line counter, as functions called will need the valid one
+    m_blocks.at(blockIndex)->insertLines(position, lines, blockIndex);
+
+    // remember changes
+    ++m_revision;
+
+    // update changed line interval
+    if (position.line() < m_editingMinimalLineChanged || m_editingMinimalLineChanged == -1) {
+        m_editingMinimalLineChanged = position.line();
+    }
+
+    if (position.line() <= m_editingMaximalLineChanged) {
+        m_editingMaximalLineChanged += newLines;
+    } else {
+        m_editingMaximalLineChanged = position.line() + newLines;
+    }
+
+    // balance the changed block if needed
+    balanceBlock(blockIndex);
+
+    // emit signal about done change
+    Q_EMIT linesInserted(position, lines);
+
+    // the document signals only know the primitives, report the same ones as if each line was inserted on its own
+    if (m_document) {
+        KTextEditor::Cursor insertPosition = position;
+        for (int i = 0; i <= newLines; ++i) {
+            const QString &text = lines.at(i);
+            if (!text.isEmpty()) {
+                Q_EMIT m_document->KTextEditor::Document::textInserted(m_document, insertPosition, text);
+            }
+            if (i < newLines) {
+                Q_EMIT m_document->KTextEditor::Document::lineWrapped(m_document, KTextEditor::Cursor(insertPosition.line(), insertPosition.column() + text.size()));
+                insertPosition = KTextEditor::Cursor(insertPosition.line() + 1, 0);
+            }
+        }
+    }
+}
+
 void TextBuffer::removeText(const KTextEditor::Range &range)
 {
     // debug output for REAL low-level debugging
@@ -400,6 +542,76 @@ void TextBuffer::removeText(const KTextEditor::Range &range)
         Q_EMIT m_document->KTextEditor::Document::textRemoved(m_document, range, text);
 }
 
+void TextBuffer::removeLines(const KTextEditor::Range &range)
+{
+    // debug output for REAL low-level debugging
+    BUFFER_DEBUG << "removeLines" << range;
+
+    // only allowed if editing transaction running
+    Q_ASSERT(m_editingTransactions > 0);
+
+    // at least one line must be unwrapped, else this is just removeText
+    Q_ASSERT(range.start().line() < range.end().line());
+
+    // get blocks, this will assert on invalid lines
+    const int blockIndex = blockForLine(range.start().line());
+    const int lastBlockIndex = blockForLine(range.end().line());
+
+    // the removal must happen inside one block, merge all blocks up to the one of the last line into the first one
+    // the balancing below splits it again if needed
+    if (lastBlockIndex > blockIndex) {
+        TextBlock *targetBlock = m_blocks.at(blockIndex);
+        for (int index = blockIndex + 1; index <= lastBlockIndex; ++index) {
+            m_blocks.at(index)->mergeBlock(targetBlock);
+            delete m_blocks.at(index);
+        }
+        m_blocks.erase(m_blocks.begin() + blockIndex + 1, m_blocks.begin() + lastBlockIndex + 1);
+        fixBlockIndices();
+    }
+
+    // let the block handle the removeLines, retrieve removed text
+    // this call will trigger fixStartLines
+    const int removedLines = range.end().line() - range.start().line();
+    QStringList lines;
+    m_lines -= removedLines; // first alter the line counter, as functions called will need the valid one
+    m_blocks.at(blockIndex)->removeLines(range, lines, blockIndex);
+
+    // remember changes
+    ++m_revision;
+
+    // update changed line interval
+    if (range.start().line() < m_editingMinimalLineChanged || m_editingMinimalLineChanged == -1) {
+        m_editingMinimalLineChanged = range.start().line();
+    }
+
+    if (range.end().line() <= m_editingMaximalLineChanged) {
+        m_editingMaximalLineChanged -= removedLines;
+    } else {
+        m_editingMaximalLineChanged = range.start().line();
+    }
+
+    // balance the changed block if needed
+    balanceBlock(blockIndex);
+
+    // emit signal about done change
+    Q_EMIT linesRemoved(range, lines);
+
+    // the document signals only know the primitives, report the same ones as if each line was removed on its own
+    if (m_document) {
+        for (int i = removedLines; i >= 0; --i) {
+            const int line = range.start().line() + i;
+            const int column = (i == 0) ? range.start().column() : 0;
+            const QString &text = lines.at(i);
+            if (!text.isEmpty()) {
+                Q_EMIT m_document->KTextEditor::Document::textRemoved(m_document, KTextEditor::Range(line, column, line, column + text.size()), text);
+            }
+            if (i > 0) {
+                Q_EMIT m_document->KTextEditor::Document::lineUnwrapped(m_document, line);
+            }
+        }
+    }
+}
+
 int TextBuffer::blockForLine(int line) const
 {
     // only allow valid lines
@@ -424,38 +636,32 @@ int TextBuffer::blockForLine(int line) const
     }
 
     // search for right block
-    // use binary search
-    // if we leave this loop not by returning the found element we have an error
-    int blockStart = 0;
-    int blockEnd = m_blocks.size() - 1;
-    while (blockEnd >= blockStart) {
-        // get middle and ensure it is OK
-        int middle = blockStart + ((blockEnd - blockStart) / 2);
-        Q_ASSERT(middle >= 0);
-        Q_ASSERT(middle < (int)m_blocks.size());
-
-        // facts bout this block
-        TextBlock *block = m_blocks[middle];
-        const int start = block->startLine();
-        const int lines = block->lines();
-
-        // right block found, remember it and return it
-        if (start <= line && line < (start + lines)) {
-            m_lastUsedBlock = middle;
-            return middle;
-        }
-
-        // half our stuff ;)
-        if (line < start) {
-            blockEnd = middle - 1;
-        } else {
-            blockStart = middle + 1;
+    // descend the tree of block line counts: find the most blocks that in sum have not more lines than the wanted line
+    // the next block contains the line, empty blocks in front of it are skipped this way
+    const int blocks = m_blocks.size();
+    int step = 1;
+    while (2 * step <= blocks) {
+        step *= 2;
+    }
+    int index = 0;
+    int remainingLines = line;
+    for (; step > 0; step /= 2) {
+        if ((index + step) <= blocks && m_blockLinesTree[index + step - 1] <= remainingLines) {
+            index += step;
+            remainingLines -= m_blockLinesTree[index - 1];
         }
     }
 
     // we should always find a block
-    qFatal("line requested in text buffer (%d out of [0, %d[), no block found", line, lines());
-    return -1;
+    if (index >= blocks) {
+        qFatal("line requested in text buffer (%d out of [0, %d[), no block found", line, lines());
+        return -1;
+    }
+
+    // remember it and return it
+    Q_ASSERT(m_blocks[index]->startLine() <= line && line < (m_blocks[index]->startLine() + m_blocks[index]->lines()));
+    m_lastUsedBlock = index;
+    return index;
 }
 
 void TextBuffer::fixStartLines(int startBlock)
@@ -464,19 +670,51 @@ void TextBuffer::fixStartLines(int startBlock)
     Q_ASSERT(startBlock >= 0);
     Q_ASSERT(startBlock < (int)m_blocks.size());
 
-    // new start line for next block
-    TextBlock *block = m_blocks.at(startBlock);
-    int newStartLine = block->startLine() + block->lines();
+    // nothing to do if the number of lines is still the same
+    const int difference = m_blocks.at(startBlock)->lines() - m_blockLines[startBlock];
+    if (difference == 0) {
+        return;
+    }
+
+    // update the tree, all following blocks compute their start line again
+    m_blockLines[startBlock] += difference;
+    for (size_t index = startBlock + 1; index <= m_blockLinesTree.size(); index += (index & (~index + 1))) {
+        m_blockLinesTree[index - 1] += difference;
+    }
+    ++m_startLinesRevision;
+}
+
+int TextBuffer::blockStartLine(int index) const
+{
+    // sum up the lines of all blocks in front of the given one
+    int startLine = 0;
+    for (size_t i = index; i > 0; i -= (i & (~i + 1))) {
+        startLine += m_blockLinesTree[i - 1];
+    }
+    return startLine;
+}
 
-    // fixup block
-    for (size_t index = startBlock + 1; index < m_blocks.size(); ++index) {
-        // set new start line
-        block = m_blocks.at(index);
-        block->setStartLine(newStartLine);
+void TextBuffer::fixBlockIndices()
+{
+    // remember the index and the number of lines of all blocks
+    const size_t blocks = m_blocks.size();
+    m_blockLines.resize(blocks);
+    for (size_t index = 0; index < blocks; ++index) {
+        m_blocks[index]->setIndex(index);
+        m_blockLines[index] = m_blocks[index]->lines();
+    }
 
-        // calculate next start line
-        newStartLine += block->lines();
+    // build the tree in linear time: each node passes its sum on to its parent
+    m_blockLinesTree = m_blockLines;
+    for (size_t index = 1; index <= blocks; ++index) {
+        const size_t parent = index + (index & (~index + 1));
+        if (parent <= blocks) {
+            m_blockLinesTree[parent - 1] += m_blockLinesTree[index - 1];
+        }
     }
+
+    // all blocks compute their start line again
+    ++m_startLinesRevision;
 }
 
 void TextBuffer::balanceBlock(int index)
@@ -485,14 +723,20 @@ void TextBuffer::balanceBlock(int index)
     TextBlock *blockToBalance = m_blocks.at(index);
 
     // first case, too big one, split it
+    // after insertLines() it might be much too big, split off blocks from the end until it fits
+    // for the normal case of one wrapped line this halves the block
     if (blockToBalance->lines() >= 2 * m_blockSize) {
-        // half the block
-        int halfSize = blockToBalance->lines() / 2;
+        // create new blocks behind current one, already set right start line
+        std::vector<TextBlock *> newBlocks;
+        while (blockToBalance->lines() >= 2 * m_blockSize) {
+            TextBlock *newBlock = blockToBalance->splitBlock(blockToBalance->lines() - m_blockSize);
+            Q_ASSERT(newBlock);
+            newBlocks.push_back(newBlock);
+        }
 
-        // create and insert new block behind current one, already set right start line
-        TextBlock *newBlock = blockToBalance->splitBlock(halfSize);
-        Q_ASSERT(newBlock);
-        m_blocks.insert(m_blocks.begin() + index + 1, newBlock);
+        // insert them at once, the last split off one is the first in line
+        m_blocks.insert(m_blocks.begin() + index + 1, newBlocks.rbegin(), newBlocks.rend());
+        fixBlockIndices();
 
         // split is done
         return;
@@ -520,6 +764,89 @@ void TextBuffer::balanceBlock(int index)
     // delete old block
     delete blockToBalance;
     m_blocks.erase(m_blocks.begin() + index);
+    fixBlockIndices();
+}
+
+void TextBuffer::setSearchIndexEnabled(bool enabled)
+{
+    if (enabled == m_searchIndexEnabled) {
+        return;
+    }
+
+    m_searchIndexEnabled = enabled;
+    if (!enabled) {
+        for (TextBlock *block : m_blocks) {
+            block->dropSearchIndex();
+        }
+    }
+}
+
+bool TextBuffer::buildSearchIndex(int maxBlocks)
+{
+    if (!m_searchIndexEnabled) {
+        return false;
+    }
+
+    // go on where the last call stopped, blocks in front of it only lack a filter after edits
+    const int blocks = static_cast<int>(m_blocks.size());
+    for (int i = 0; i < blocks && maxBlocks > 0 && !searchIndexComplete(); ++i) {
+        m_searchIndexNextBlock = (m_searchIndexNextBlock + (i > 0 ? 1 : 0)) % blocks;
+        TextBlock *block = m_blocks.at(m_searchIndexNextBlock);
+        if (!block->hasSearchIndex()) {
+            block->buildSearchIndex();
+            --maxBlocks;
+        }
+    }
+
+    checkSearchIndexMemory();
+    return m_searchIndexEnabled && !searchIndexComplete();
+}
+
+void TextBuffer::checkSearchIndexMemory()
+{
+    if (!m_searchIndexEnabled || m_searchIndexMemoryLimit <= 0 || m_searchIndexMemory <= m_searchIndexMemoryLimit) {
+        return;
+    }
+
+    qCWarning(LOG_KTE) << "search index needs more than" << m_searchIndexMemoryLimit << "bytes, dropped it, indexed" << m_searchIndexBlocks << "of"
+                       << m_blocks.size() << "blocks with" << m_searchIndexMemory << "bytes";
+    setSearchIndexEnabled(false);
+}
+
+int TextBuffer::searchIndexNextLine(int line, const std::vector<quint32> &trigrams, bool backwards) const
+{
+    if (!m_searchIndexEnabled || trigrams.empty() || line < 0 || line >= m_lines) {
+        return line;
+    }
+
+    // the first block that might contain the text, the line itself if it is in that block
+    const int blocks = static_cast<int>(m_blocks.size());
+    for (int blockIndex = blockForLine(line); blockIndex >= 0 && blockIndex < blocks; blockIndex += backwards ? -1 : 1) {
+        const TextBlock *block = m_blocks.at(blockIndex);
+        if (block->searchIndexMayContain(trigrams)) {
+            return backwards ? qMin(line, block->startLine() + block->lines() - 1) : qMax(line, block->startLine());
+        }
+    }
+    return backwards ? -1 : m_lines;
+}
+
+std::vector<quint32> TextBuffer::searchIndexTrigrams(const QString &text)
+{
+    std::vector<quint32> trigrams;
+
+    // the filters know single UTF-16 code units only, case folding of surrogate pairs can't be looked up
+    for (const QChar c : text) {
+        if (c.isSurrogate() || c == QLatin1Char('\n')) {
+            return trigrams;
+        }
+    }
+
+    for (int i = 2; i < text.size(); ++i) {
+        trigrams.push_back(TextBlock::searchIndexHash(text[i - 2].toCaseFolded().unicode(), text[i - 1].toCaseFolded().unicode(), text[i].toCaseFolded().unicode()));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
 }
 
 void TextBuffer::debugPrint(const QString &title) const
@@ -547,7 +874,12 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     // construct the file loader for the given file, with correct prober type
     Kate::TextLoader file(filename, m_encodingProberType);
 
+    // large file mode and parallel loading split the raw data themselves, they detect the eol mode, too
+    EndOfLineMode rawDataEol = eolUnknown;
+    bool rawDataSplit = false;
+
     // triple play, maximal three loading rounds
+    // the file is read only once, the rounds only decode the in-memory data again
     // 0) use the given encoding, be done, if no encoding errors happen
     // 1) use BOM to decided if Unicode or if that fails, use encoding prober, if no encoding errors happen, be done
     // 2) use fallback encoding, be done, if no encoding errors happen
@@ -580,9 +912,49 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
             // create one dummy textline, in any case
             m_blocks.back()->appendLine(QString());
             m_lines++;
+            fixBlockIndices();
             return false;
         }
 
+        // the raw data is only read once, check the codec on it before any blocks get built
+        // the last round will take the codec in any case
+        const bool lastRound = (i == (enforceTextCodec ? 0 : 3));
+        if (!lastRound && !file.decodesWithoutErrors()) {
+            BUFFER_DEBUG << "Failed try to load file" << filename << "with codec" << (file.textCodec() ? file.textCodec()->name() : "(null)");
+            continue;
+        }
+
+        // large file mode: only index the lines, they are decoded on first access
+        // needs a codec without errors, the last round uses the one of round 0 again, that is only checked if enforced
+        if ((m_largeFileModeThreshold > 0) && file.isPlainFile() && (file.rawDataSize() >= m_largeFileModeThreshold)
+            && (!lastRound || (enforceTextCodec && file.decodesWithoutErrors()))
+            && loadLargeFile(filename,
+                             file.rawData(),
+                             file.rawDataSize(),
+                             file.textCodec(),
+                             file.byteOrderMarkLength(),
+                             tooLongLinesWrapped,
+                             longestLineLoaded,
+                             rawDataEol)) {
+            rawDataSplit = true;
+            encodingErrors = false;
+            setTextCodec(file.textCodec());
+            break;
+        }
+
+        // big files are decoded and split into lines by multiple threads
+        if ((m_parallelLoadThreshold > 0) && (file.rawDataSize() >= m_parallelLoadThreshold)
+            && loadParallel(file, encodingErrors, tooLongLinesWrapped, longestLineLoaded, rawDataEol)) {
+            rawDataSplit = true;
+            if (!encodingErrors) {
+                setTextCodec(file.textCodec());
+                break;
+            }
+
+            // only the last round gets here, codecs with errors are rejected above
+            continue;
+        }
+
         // read in all lines...
         encodingErrors = false;
         while (!file.eof()) {
@@ -606,21 +978,9 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
             // split lines, if too large
             do {
                 // calculate line length
-                int lineLength = length;
-                if ((m_lineLengthLimit > 0) && (lineLength > m_lineLengthLimit)) {
-                    // search for place to wrap
-                    int spacePosition = m_lineLengthLimit - 1;
-                    for (int testPosition = m_lineLengthLimit - 1; (testPosition >= 0) && (testPosition >= (m_lineLengthLimit - (m_lineLengthLimit / 10)));
-                         --testPosition) {
-                        // wrap place found?
-                        if (unicodeData[testPosition].isSpace() || unicodeData[testPosition].isPunct()) {
-                            spacePosition = testPosition;
-                            break;
-                        }
-                    }
-
+                const int lineLength = wrappedLineLength(unicodeData, length, m_lineLengthLimit);
+                if (lineLength < length) {
                     // wrap the line
-                    lineLength = spacePosition + 1;
                     length -= lineLength;
                     tooLongLinesWrapped = true;
                 } else {
@@ -661,8 +1021,9 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     }
 
     // remember eol mode, if any found in file
-    if (file.eol() != eolUnknown) {
-        setEndOfLineMode(file.eol());
+    const EndOfLineMode eol = rawDataSplit ? rawDataEol : file.eol();
+    if (eol != eolUnknown) {
+        setEndOfLineMode(eol);
     }
 
     // remember mime type for filter device
@@ -671,6 +1032,9 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     // assert that one line is there!
     Q_ASSERT(m_lines > 0);
 
+    // the blocks were appended without updating the block line counts, build them now
+    fixBlockIndices();
+
     // report CODEC + ERRORS
     BUFFER_DEBUG << "Loaded file " << filename << "with codec" << m_textCodec->name() << (encodingErrors ? "with" : "without") << "encoding errors";
 
@@ -687,6 +1051,433 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     return true;
 }
 
+int TextBuffer::wrappedLineLength(const QChar *unicodeData, int length, int lineLengthLimit)
+{
+    // no limit or short enough, no wrap
+    if ((lineLengthLimit <= 0) || (length <= lineLengthLimit)) {
+        return length;
+    }
+
+    // search for place to wrap
+    int spacePosition = lineLengthLimit - 1;
+    for (int testPosition = lineLengthLimit - 1; (testPosition >= 0) && (testPosition >= (lineLengthLimit - (lineLengthLimit / 10))); --testPosition) {
+        // wrap place found?
+        if (unicodeData[testPosition].isSpace() || unicodeData[testPosition].isPunct()) {
+            spacePosition = testPosition;
+            break;
+        }
+    }
+
+    return spacePosition + 1;
+}
+
+bool TextBuffer::loadLargeFile(const QString &filename,
+                               const char *data,
+                               qint64 size,
+                               QTextCodec *codec,
+                               int byteOrderMarkLength,
+                               bool &tooLongLinesWrapped,
+                               int &longestLineLoaded,
+                               EndOfLineMode &eol)
+{
+    // must start with one empty block
+    Q_ASSERT(m_blocks.size() == 1);
+    Q_ASSERT(m_lines == 0);
+
+    // only for UTF-8 and Latin-1 line breaks and line lengths can be found on the raw bytes
+    const int mib = codec->mibEnum();
+    const bool utf8 = (mib == 106);
+    if (!utf8 && mib != 4) {
+        return false;
+    }
+
+    // open the file, the blocks read their bytes on first access
+    // it is read and not memory mapped: if others truncate the file, a mapping would crash us on access
+    // the lines are indexed on the data already read, that must still match the file
+    QScopedPointer<QFile> largeFile(new QFile(filename));
+    if (!largeFile->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return false;
+    }
+    if ((size <= 0) || (largeFile->size() != size)) {
+        return false;
+    }
+
+    // remember the parameters, the blocks are decoded later with them
+    m_largeFileSize = size;
+    m_largeFileUtf8 = utf8;
+    m_largeFileLineLengthLimit = m_lineLengthLimit;
+
+    // go back to one empty block on failure, normal loading will take over
+    auto failed = [this]() {
+        for (size_t b = 1; b < m_blocks.size(); ++b) {
+            delete m_blocks.at(b);
+        }
+        m_blocks.resize(1);
+        m_blocks.back()->clearLines();
+        m_lines = 0;
+        m_largeFileSize = 0;
+        return false;
+    };
+
+    // state of the current line & block
+    const char *const end = data + size;
+    const char *lineStart = data + byteOrderMarkLength;
+    const char *blockStart = lineStart;
+    bool blockStartsAfterCarriageReturn = false;
+    int blockLines = 0;
+    bool lastWasR = false;
+    eol = eolUnknown;
+
+    // account one line, wrapped lines might need more than one line
+    auto addLine = [&](const char *lineEnd) {
+        // the UTF-16 length is at most the byte length, only count it if it matters
+        const int bytes = int(lineEnd - lineStart);
+        int lineLength = bytes;
+        if (utf8 && ((bytes > longestLineLoaded) || ((m_lineLengthLimit > 0) && (bytes > m_lineLengthLimit)))) {
+            // count UTF-16 code units, 4 byte sequences need a surrogate pair
+            lineLength = 0;
+            for (const char *it = lineStart; it != lineEnd; ++it) {
+                const uchar c = uchar(*it);
+                lineLength += ((c & 0xC0) != 0x80) + (c >= 0xF0);
+            }
+        }
+
+        if (longestLineLoaded < lineLength) {
+            longestLineLoaded = lineLength;
+        }
+
+        // too long line? decode it to compute the lines it will be wrapped into
+        if ((m_lineLengthLimit > 0) && (lineLength > m_lineLengthLimit)) {
+            const QString text = utf8 ? QString::fromUtf8(lineStart, bytes) : QString::fromLatin1(lineStart, bytes);
+            const QChar *unicodeData = text.unicode();
+            int length = text.length();
+            while (length > 0) {
+                const int wrappedLength = wrappedLineLength(unicodeData, length, m_lineLengthLimit);
+                unicodeData += wrappedLength;
+                length -= wrappedLength;
+                ++blockLines;
+            }
+            tooLongLinesWrapped = true;
+        } else {
+            ++blockLines;
+        }
+    };
+
+    // assign the byte range to the current block
+    auto finishBlock = [&](const char *blockEnd) {
+        m_blocks.back()->setLazyLines(blockStart - data, blockEnd - data, blockStartsAfterCarriageReturn, blockLines);
+        m_lines += blockLines;
+    };
+
+    // scan for line breaks like TextLoader::readLine() does, but on the raw bytes
+    const char *position = lineStart;
+    for (;;) {
+        // start a new block at the start of a line, if the current one is full, the last empty line stays in it
+        if ((position == lineStart) && (position != end) && (blockLines >= m_blockSize)) {
+            finishBlock(position);
+            m_blocks.push_back(new TextBlock(this, m_lines));
+            blockStart = position;
+            blockStartsAfterCarriageReturn = lastWasR;
+            blockLines = 0;
+        }
+
+        const char *const lineBreak = findLineBreak(position, end);
+        if (lineBreak != position) {
+            lastWasR = false;
+        }
+
+        // we decode at most a block or a line at once, it must fit into a QString
+        if ((lineBreak - blockStart) > (std::numeric_limits<int>::max() / 4)) {
+            return failed();
+        }
+
+        if (lineBreak == end) {
+            break;
+        }
+
+        const uchar c = uchar(*lineBreak);
+        if (c == '\n') {
+            if (lastWasR) {
+                lastWasR = false;
+                position = lineStart = lineBreak + 1;
+                eol = eolDos;
+                continue;
+            }
+
+            addLine(lineBreak);
+            position = lineStart = lineBreak + 1;
+
+            // only win, if not dos!
+            if (eol != eolDos) {
+                eol = eolUnix;
+            }
+        } else if (c == '\r') {
+            addLine(lineBreak);
+            position = lineStart = lineBreak + 1;
+            lastWasR = true;
+
+            // should only win of first time!
+            if (eol == eolUnknown) {
+                eol = eolMac;
+            }
+        } else if (utf8 && (end - lineBreak) > 2 && uchar(lineBreak[1]) == 0x80 && uchar(lineBreak[2]) == 0xA8) {
+            // QChar::LineSeparator
+            addLine(lineBreak);
+            position = lineStart = lineBreak + 3;
+        } else {
+            // first byte of another character
+            lastWasR = false;
+            position = lineBreak + 1;
+        }
+    }
+
+    // the last line, even if empty
+    addLine(end);
+    finishBlock(end);
+
+    // keep the file open
+    m_largeFile = largeFile.take();
+    return true;
+}
+
+void TextBuffer::splitLines(const QString &text,
+                            int lineLengthLimit,
+                            bool startsAfterCarriageReturn,
+                            bool appendLastLine,
+                            std::vector<TextLine> &lines,
+                            EndOfLineMode &eol,
+                            int &longestLine,
+                            bool &tooLongLinesWrapped)
+{
+    // append one line, split it, if too large
+    auto appendLine = [&](const QChar *unicodeData, int length) {
+        if (longestLine < length) {
+            longestLine = length;
+        }
+
+        do {
+            const int lineLength = wrappedLineLength(unicodeData, length, lineLengthLimit);
+            if (lineLength < length) {
+                tooLongLinesWrapped = true;
+            }
+            lines.push_back(TextLine::create(QString(unicodeData, lineLength)));
+            unicodeData += lineLength;
+            length -= lineLength;
+        } while (length > 0);
+    };
+
+    // split like TextLoader::readLine() does
+    const QChar *const end = text.unicode() + text.length();
+    const QChar *lineStart = text.unicode();
+    const QChar *position = lineStart;
+    bool lastWasR = startsAfterCarriageReturn;
+    while (true) {
+        const QChar *const lineBreak = findLineBreak(position, end);
+        if (lineBreak != position) {
+            lastWasR = false;
+        }
+        if (lineBreak == end) {
+            break;
+        }
+
+        if (*lineBreak == QLatin1Char('\n') && lastWasR) {
+            // \r\n, the line was already finished by the \r
+            lastWasR = false;
+            eol = eolDos;
+        } else {
+            appendLine(lineStart, lineBreak - lineStart);
+            if (*lineBreak == QLatin1Char('\n')) {
+                // only win, if not dos!
+                if (eol != eolDos) {
+                    eol = eolUnix;
+                }
+            } else if (*lineBreak == QLatin1Char('\r')) {
+                lastWasR = true;
+
+                // should only win of first time!
+                if (eol == eolUnknown) {
+                    eol = eolMac;
+                }
+            }
+        }
+
+        lineStart = position = lineBreak + 1;
+    }
+
+    // the last line of the text, even if empty
+    if (appendLastLine) {
+        appendLine(lineStart, end - lineStart);
+    }
+}
+
+bool TextBuffer::loadParallel(TextLoader &file, bool &encodingErrors, bool &tooLongLinesWrapped, int &longestLineLoaded, EndOfLineMode &eol)
+{
+    // must start with one empty block
+    Q_ASSERT(m_blocks.size() == 1);
+    Q_ASSERT(m_lines == 0);
+
+    // BOM & codec must be known
+    if (!file.prepareCodec()) {
+        return false;
+    }
+
+    // the data can only be cut at \n bytes if they can't be part of a multi byte character
+    QTextCodec *codec = file.textCodec();
+    const int mib = codec->mibEnum();
+    if (mib != 106 && mib != 4 && mib != 111) {
+        return false;
+    }
+
+    // cut the data after \n bytes into chunks, one or more per thread, no line crosses them
+    // after a \n never a \r\n starts, each chunk starts a new line
+    const char *const data = file.rawData();
+    const qint64 size = file.rawDataSize();
+    const qint64 start = file.byteOrderMarkLength();
+    const int threads = qMax(1, QThread::idealThreadCount());
+    const qint64 chunkSize = qMin(qMax((size - start) / qMax(2, threads), qint64(1)), KATE_PARALLEL_LOAD_MAX_CHUNK_SIZE);
+    std::vector<qint64> chunkStarts;
+    for (qint64 chunkStart = start; chunkStart < size;) {
+        chunkStarts.push_back(chunkStart);
+        const qint64 cut = chunkStart + chunkSize;
+        const char *lineFeed = (cut < size) ? static_cast<const char *>(memchr(data + cut - 1, '\n', size - cut + 1)) : nullptr;
+        chunkStart = lineFeed ? (lineFeed - data + 1) : size;
+    }
+    if (chunkStarts.empty()) {
+        chunkStarts.push_back(start);
+    }
+    chunkStarts.push_back(size);
+
+    // results of one chunk
+    struct Chunk {
+        std::vector<TextLine> lines;
+        EndOfLineMode eol = eolUnknown;
+        int longestLine = 0;
+        bool tooLongLinesWrapped = false;
+        bool encodingErrors = false;
+    };
+    std::vector<Chunk> chunks(chunkStarts.size() - 1);
+
+    // decode and split the chunks, each thread takes the next unhandled one
+    std::atomic<size_t> nextChunk(0);
+    const int lineLengthLimit = m_lineLengthLimit;
+    auto work = [&]() {
+        for (size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) {
+            // decode like the loader, the header is only handled at the start of the file
+            QTextCodec::ConverterState state(c == 0 ? QTextCodec::DefaultConversion : QTextCodec::IgnoreHeader);
+            const QString text = codec->toUnicode(data + chunkStarts[c], int(chunkStarts[c + 1] - chunkStarts[c]), &state);
+
+            Chunk &chunk = chunks[c];
+            chunk.encodingErrors = state.invalidChars > 0;
+            splitLines(text, lineLengthLimit, false, c + 1 == chunks.size(), chunk.lines, chunk.eol, chunk.longestLine, chunk.tooLongLinesWrapped);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < qMin(threads, int(chunks.size())); ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // stitch the lines together into blocks, in the same layout the serial load would create
+    // \r\n wins over \n, this wins over \r, see TextLoader::readLine()
+    auto eolRank = [](EndOfLineMode mode) {
+        return (mode == eolDos) ? 3 : (mode == eolUnix) ? 2 : (mode == eolMac) ? 1 : 0;
+    };
+    encodingErrors = false;
+    eol = eolUnknown;
+    for (Chunk &chunk : chunks) {
+        encodingErrors = encodingErrors || chunk.encodingErrors;
+        tooLongLinesWrapped = tooLongLinesWrapped || chunk.tooLongLinesWrapped;
+        longestLineLoaded = qMax(longestLineLoaded, chunk.longestLine);
+        if (eolRank(chunk.eol) > eolRank(eol)) {
+            eol = chunk.eol;
+        }
+
+        for (TextLine &line : chunk.lines) {
+            // ensure blocks aren't too large
+            if (m_blocks.back()->lines() >= m_blockSize) {
+                m_blocks.push_back(new TextBlock(this, m_blocks.back()->startLine() + m_blocks.back()->lines()));
+            }
+
+            m_blocks.back()->appendLine(std::move(line));
+            ++m_lines;
+        }
+        std::vector<TextLine>().swap(chunk.lines);
+    }
+
+    return true;
+}
+
+void TextBuffer::loadLazyLines(qint64 byteStart, qint64 byteEnd, bool startsAfterCarriageReturn, int lineCount, std::vector<TextLine> &lines) const
+{
+    Q_ASSERT(m_largeFile);
+    Q_ASSERT(lines.empty());
+
+    // read and decode the complete range at once
+    const QByteArray data = readFileRange(*m_largeFile, byteStart, byteEnd);
+    const QString text = m_largeFileUtf8 ? QString::fromUtf8(data) : QString::fromLatin1(data);
+
+    // the last block ends with the last line, even if empty, other blocks end after a line break
+    EndOfLineMode eol = eolUnknown;
+    int longestLine = 0;
+    bool tooLongLinesWrapped = false;
+    lines.reserve(m_blockSize);
+    splitLines(text, m_largeFileLineLengthLimit, startsAfterCarriageReturn, byteEnd == m_largeFileSize, lines, eol, longestLine, tooLongLinesWrapped);
+
+    // the file got truncated or changed by others, keep the indexed number of lines
+    // the document tells the user about the file modified on disk anyway
+    if (static_cast<int>(lines.size()) > lineCount) {
+        lines.resize(lineCount);
+    }
+    while (static_cast<int>(lines.size()) < lineCount) {
+        lines.push_back(TextLine::create(QString()));
+    }
+}
+
+void TextBuffer::lazyBlockLoaded(TextBlock *loadedBlock) const
+{
+    // still enough room for decoded blocks?
+    if (++m_lazyBlocksLoaded <= KATE_LARGE_FILE_MAX_LOADED_BLOCKS) {
+        return;
+    }
+
+    // collect the other decoded blocks, the coldest first
+    std::vector<TextBlock *> loadedBlocks;
+    for (TextBlock *block : m_blocks) {
+        if (block != loadedBlock && block->lazyLinesLoaded()) {
+            loadedBlocks.push_back(block);
+        }
+    }
+    std::sort(loadedBlocks.begin(), loadedBlocks.end(), [](const TextBlock *left, const TextBlock *right) {
+        return left->lazyLastUse() < right->lazyLastUse();
+    });
+
+    // evict the colder half, blocks with modified lines stay decoded
+    for (size_t i = 0; i < loadedBlocks.size() / 2; ++i) {
+        if (loadedBlocks[i]->evictLazyLines()) {
+            --m_lazyBlocksLoaded;
+        } else {
+            loadedBlocks[i]->detachFromFile();
+        }
+    }
+}
+
+void TextBuffer::detachFromLargeFile()
+{
+    // decode all blocks still depending on the file
+    for (TextBlock *block : qAsConst(m_blocks)) {
+        block->detachFromFile();
+    }
+
+    // close the file
+    delete m_largeFile;
+    m_largeFile = nullptr;
+    m_largeFileSize = 0;
+    Q_ASSERT(m_lazyBlocksLoaded == 0);
+}
+
 const QByteArray &TextBuffer::digest() const
 {
     return m_digest;
@@ -716,18 +1507,27 @@ bool TextBuffer::save(const QString &filename)
     // codec must be set, else below we fail!
     Q_ASSERT(m_textCodec);
 
-    SaveResult saveRes = saveBufferUnprivileged(filename);
+    // large file mode: don't overwrite the file the blocks still depend on
+    if (m_largeFile && (QFileInfo(filename).canonicalFilePath() == QFileInfo(*m_largeFile).canonicalFilePath())) {
+        detachFromLargeFile();
+    }
+
+    QByteArray digest;
+    SaveResult saveRes = saveBufferUnprivileged(filename, digest);
 
     if (saveRes == SaveResult::Failed) {
         return false;
     } else if (saveRes == SaveResult::MissingPermissions) {
         // either unit-test mode or we're missing permissions to write to the
         // file => use temporary file and try to use authhelper
-        if (!saveBufferEscalated(filename)) {
+        if (!saveBufferEscalated(filename, digest)) {
             return false;
         }
     }
 
+    // digest of the written data, if empty it must be computed from the file again
+    setDigest(digest);
+
     // remember this revision as last saved
     m_history.setLastSavedRevision();
 
@@ -739,17 +1539,79 @@ bool TextBuffer::save(const QString &filename)
     return true;
 }
 
-bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFile)
+/**
+ * Number of bytes the given text needs encoded as UTF-8.
+ * Unpaired surrogates count as the one '?' QTextCodec writes for them.
+ */
+static qint64 utf8Length(const QChar *text, int size)
+{
+    qint64 length = size;
+    for (int i = 0; i < size; ++i) {
+        const ushort c = text[i].unicode();
+        if (c < 0x80) {
+            continue;
+        }
+
+        if (c < 0x800) {
+            length += 1;
+        } else if (!QChar::isSurrogate(c)) {
+            length += 2;
+        } else if (QChar::isHighSurrogate(c) && (i + 1 < size) && QChar::isLowSurrogate(text[i + 1].unicode())) {
+            // two chars, four bytes
+            length += 2;
+            ++i;
+        }
+    }
+    return length;
+}
+
+/**
+ * Encode the given text as UTF-8, like QTextCodec does, unpaired surrogates become '?'.
+ * There must be room for 3 bytes per char.
+ * @return end of the written data
+ */
+static char *encodeUtf8(char *out, const QChar *text, int size)
 {
-    // construct stream + disable Unicode headers
-    QTextStream stream(&saveFile);
-    stream.setCodec(QTextCodec::codecForName("UTF-16"));
+    for (int i = 0; i < size; ++i) {
+        const ushort c = text[i].unicode();
+        if (c < 0x80) {
+            *out++ = char(c);
+        } else if (c < 0x800) {
+            *out++ = char(0xc0 | (c >> 6));
+            *out++ = char(0x80 | (c & 0x3f));
+        } else if (!QChar::isSurrogate(c)) {
+            *out++ = char(0xe0 | (c >> 12));
+            *out++ = char(0x80 | ((c >> 6) & 0x3f));
+            *out++ = char(0x80 | (c & 0x3f));
+        } else if (QChar::isHighSurrogate(c) && (i + 1 < size) && QChar::isLowSurrogate(text[i + 1].unicode())) {
+            const uint ucs4 = QChar::surrogateToUcs4(c, text[++i].unicode());
+            *out++ = char(0xf0 | (ucs4 >> 18));
+            *out++ = char(0x80 | ((ucs4 >> 12) & 0x3f));
+            *out++ = char(0x80 | ((ucs4 >> 6) & 0x3f));
+            *out++ = char(0x80 | (ucs4 & 0x3f));
+        } else {
+            *out++ = '?';
+        }
+    }
+    return out;
+}
 
-    // set the correct codec
-    stream.setCodec(m_textCodec);
+/**
+ * Encode the given text as Latin-1, like QTextCodec does, chars not in Latin-1 become '?'.
+ * @return end of the written data
+ */
+static char *encodeLatin1(char *out, const QChar *text, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        const ushort c = text[i].unicode();
+        *out++ = (c < 0x100) ? char(c) : '?';
+    }
+    return out;
+}
 
-    // generate byte order mark?
-    stream.setGenerateByteOrderMark(generateByteOrderMark());
+bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFile, QByteArray &digest)
+{
+    digest.clear();
 
     // our loved eol string ;)
     QString eol = QStringLiteral("\n");
@@ -759,37 +1621,128 @@ bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFil
         eol = QStringLiteral("\r");
     }
 
+    // do we need to add a trailing newline char?
+    bool trailingEol = false;
+    if (m_newLineAtEof) {
+        Q_ASSERT(m_lines > 0); // see .h file
+        const Kate::TextLine lastLine = line(m_lines - 1);
+        trailingEol = lastLine->firstChar() > -1 || lastLine->length() > 0;
+    }
+    const int eolCount = m_lines - 1 + (trailingEol ? 1 : 0);
+
+    // UTF-8 and Latin-1 are encoded by hand straight into the output buffer, the eol is pure ASCII for them.
+    // all other codecs use one encoder for the whole text, it keeps the state of stateful codecs and
+    // writes the byte order mark, if wanted
+    const int mib = m_textCodec->mibEnum();
+    const bool utf8 = (mib == 106);
+    const bool latin1 = (mib == 4);
+    QScopedPointer<QTextEncoder> encoder;
+    if (!utf8 && !latin1) {
+        encoder.reset(m_textCodec->makeEncoder(generateByteOrderMark() ? QTextCodec::DefaultConversion : QTextCodec::IgnoreHeader));
+    }
+
+    // the git compatible digest needs the size of the data up front, we can only compute it for the hand
+    // written encodings without compression, the size is then known from the text without encoding it twice
+    QScopedPointer<QCryptographicHash> hash;
+    qint64 expectedSize = -1;
+    if (!encoder && (saveFile.compressionType() == KCompressionDevice::None)) {
+        expectedSize = (utf8 && generateByteOrderMark()) ? 3 : 0;
+        expectedSize += qint64(eolCount) * eol.size();
+        for (int i = 0; i < m_lines; ++i) {
+            const TextLine textLine = line(i);
+            expectedSize += utf8 ? utf8Length(textLine->text().constData(), textLine->length()) : textLine->length();
+        }
+
+        hash.reset(new QCryptographicHash(QCryptographicHash::Sha1));
+        hash->addData(QByteArray("blob ") + QByteArray::number(expectedSize) + '\0');
+    }
+
+    // output buffer, written to the device once full
+    QByteArray buffer(KATE_SAVE_BUFFER_SIZE, Qt::Uninitialized);
+    int used = 0;
+    qint64 written = 0;
+    auto flush = [&]() {
+        if (hash) {
+            hash->addData(buffer.constData(), used);
+        }
+        const bool ok = saveFile.write(buffer.constData(), used) == used;
+        written += used;
+        used = 0;
+        return ok;
+    };
+
+    // append the given encoded data to the output buffer
+    auto append = [&](const QByteArray &data) {
+        if (used + data.size() > buffer.size()) {
+            if (!flush()) {
+                return false;
+            }
+            if (data.size() > buffer.size()) {
+                buffer.resize(data.size());
+            }
+        }
+        memcpy(buffer.data() + used, data.constData(), data.size());
+        used += data.size();
+        return true;
+    };
+
+    if (utf8 && generateByteOrderMark()) {
+        buffer[0] = char(0xef);
+        buffer[1] = char(0xbb);
+        buffer[2] = char(0xbf);
+        used = 3;
+    }
+
     // just dump the lines out ;)
+    // the encoder gets the lines in larger chunks, that saves most of the calls
+    QString pending;
+    if (encoder) {
+        pending.reserve(KATE_SAVE_BUFFER_SIZE / 4);
+    }
     for (int i = 0; i < m_lines; ++i) {
-        // dump current line
-        stream << line(i)->text();
+        const TextLine textLine = line(i);
+        const bool withEol = ((i + 1) < m_lines) || trailingEol;
 
-        // append correct end of line string
-        if ((i + 1) < m_lines) {
-            stream << eol;
+        if (encoder) {
+            pending += textLine->text();
+            if (withEol) {
+                pending += eol;
+            }
+            if (pending.size() >= KATE_SAVE_BUFFER_SIZE / 4) {
+                if (!append(encoder->fromUnicode(pending))) {
+                    return false;
+                }
+                pending.resize(0);
+            }
+            continue;
         }
 
-        // early out on stream errors
-        if (stream.status() != QTextStream::Ok) {
-            return false;
+        // make room for the longest possible encoding of the line
+        const int maxSize = (utf8 ? 3 : 1) * textLine->length() + eol.size();
+        if (used + maxSize > buffer.size()) {
+            if (!flush()) {
+                return false;
+            }
+            if (maxSize > buffer.size()) {
+                buffer.resize(maxSize);
+            }
         }
-    }
 
-    // do we need to add a trailing newline char?
-    if (m_newLineAtEof) {
-        Q_ASSERT(m_lines > 0); // see .h file
-        const Kate::TextLine lastLine = line(m_lines - 1);
-        const int firstChar = lastLine->firstChar();
-        if (firstChar > -1 || lastLine->length() > 0) {
-            stream << eol;
+        char *out = buffer.data() + used;
+        out = utf8 ? encodeUtf8(out, textLine->text().constData(), textLine->length()) : encodeLatin1(out, textLine->text().constData(), textLine->length());
+        if (withEol) {
+            for (const QChar c : qAsConst(eol)) {
+                *out++ = char(c.unicode());
+            }
         }
+        used = out - buffer.constData();
     }
 
-    // flush stream
-    stream.flush();
+    if (encoder && !pending.isEmpty() && !append(encoder->fromUnicode(pending))) {
+        return false;
+    }
 
-    // only finalize if stream status == OK
-    if (stream.status() != QTextStream::Ok) {
+    if (!flush()) {
         return false;
     }
 
@@ -802,10 +1755,18 @@ bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFil
         return false;
     }
 
+    // the digest is only valid if our size computation was right
+    if (hash) {
+        Q_ASSERT(written == expectedSize);
+        if (written == expectedSize) {
+            digest = hash->result();
+        }
+    }
+
     return true;
 }
 
-TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filename)
+TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filename, QByteArray &digest)
 {
     if (m_alwaysUseKAuthForSave) {
         // unit-testing mode, simulate we need privileges
@@ -815,6 +1776,22 @@ TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filenam
     // construct correct filter device
     // we try to use the same compression as for opening
     const KCompressionDevice::CompressionType type = KFilterDev::compressionTypeForMimeType(m_mimeTypeForFilterDev);
+
+    // write to a temporary file and rename it over the target only after everything got written
+    if (m_saveViaTemporaryFile) {
+        QSaveFile temporaryFile(filename);
+        if (temporaryFile.open(QIODevice::WriteOnly)) {
+            // the compression device doesn't close the already opened file, commit() does
+            KCompressionDevice saveFile(&temporaryFile, false, type);
+            if (!saveFile.open(QIODevice::WriteOnly) || !saveBuffer(filename, saveFile, digest) || !temporaryFile.commit()) {
+                return SaveResult::Failed;
+            }
+            return SaveResult::Success;
+        }
+
+        // no temporary file possible, e.g. for a not writable folder, try to write the file itself
+    }
+
     QScopedPointer<KCompressionDevice> saveFile(new KCompressionDevice(filename, type));
 
     if (!saveFile->open(QIODevice::WriteOnly)) {
@@ -826,14 +1803,14 @@ TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filenam
         return SaveResult::MissingPermissions;
     }
 
-    if (!saveBuffer(filename, *saveFile)) {
+    if (!saveBuffer(filename, *saveFile, digest)) {
         return SaveResult::Failed;
     }
 
     return SaveResult::Success;
 }
 
-bool TextBuffer::saveBufferEscalated(const QString &filename)
+bool TextBuffer::saveBufferEscalated(const QString &filename, QByteArray &digest)
 {
     // construct correct filter device
     // we try to use the same compression as for opening
@@ -865,7 +1842,7 @@ bool TextBuffer::saveBufferEscalated(const QString &filename)
         return false;
     }
 
-    if (!saveBuffer(filename, *saveFile)) {
+    if (!saveBuffer(filename, *saveFile, digest)) {
         return false;
     }
 
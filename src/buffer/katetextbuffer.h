@@ -10,6 +10,7 @@
 #include <QObject>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QTextCodec>
 #include <QVector>
 
@@ -26,9 +27,12 @@
 #include <KEncodingProber>
 
 class KCompressionDevice;
+class QFile;
 
 namespace Kate
 {
+class TextLoader;
+
 /**
  * Class representing a text buffer.
  * The interface is line based, internally the text will be stored in blocks of text lines.
@@ -179,6 +183,162 @@ public:
         m_lineLengthLimit = lineLengthLimit;
     }
 
+    /**
+     * Set the file size from which on load() decodes and splits the file by multiple threads.
+     * @param threshold minimal file size in bytes, 0 to disable
+     */
+    void setParallelLoadThreshold(qint64 threshold)
+    {
+        m_parallelLoadThreshold = threshold;
+    }
+
+    /**
+     * Get the file size from which on load() decodes and splits the file by multiple threads.
+     * @return minimal file size in bytes, 0 if disabled
+     */
+    qint64 parallelLoadThreshold() const
+    {
+        return m_parallelLoadThreshold;
+    }
+
+    /**
+     * Set the file size from which on load() uses the large file mode.
+     * In large file mode, plain UTF-8 or Latin-1 encoded files are kept open and the blocks only
+     * remember the byte ranges of their lines. A block is read and decoded on first access and cold, clean
+     * blocks are evicted again. A block that gets edited no longer depends on the file.
+     * If others truncate or change the file meanwhile, blocks not read yet get the changed content,
+     * padded or cut to the line count of the index.
+     * @param threshold minimal file size in bytes, 0 disables the large file mode
+     */
+    void setLargeFileModeThreshold(qint64 threshold)
+    {
+        m_largeFileModeThreshold = threshold;
+    }
+
+    /**
+     * Get the file size from which on load() uses the large file mode.
+     * @return minimal file size in bytes, 0 if disabled
+     */
+    qint64 largeFileModeThreshold() const
+    {
+        return m_largeFileModeThreshold;
+    }
+
+    /**
+     * Enable or disable the search index. With the index, each block keeps a small filter of the trigrams of its lines,
+     * searches for a literal text skip the blocks whose filter rules the text out, see searchIndexNextLine().
+     * The filters are built by buildSearchIndex(), edits keep them up to date. Disabling drops all filters.
+     * @param enabled search index enabled?
+     */
+    void setSearchIndexEnabled(bool enabled);
+
+    /**
+     * Is the search index enabled?
+     * @return search index enabled?
+     */
+    bool searchIndexEnabled() const
+    {
+        return m_searchIndexEnabled;
+    }
+
+    /**
+     * Set the memory the filters of the search index may use, once they need more, the index is dropped and disabled.
+     * @param limit maximal memory in bytes, 0 for no limit
+     */
+    void setSearchIndexMemoryLimit(qint64 limit)
+    {
+        m_searchIndexMemoryLimit = limit;
+    }
+
+    /**
+     * Get the memory the filters of the search index may use.
+     * @return maximal memory in bytes, 0 for no limit
+     */
+    qint64 searchIndexMemoryLimit() const
+    {
+        return m_searchIndexMemoryLimit;
+    }
+
+    /**
+     * Memory used by the filters of the search index.
+     * @return memory in bytes
+     */
+    qint64 searchIndexMemory() const
+    {
+        return m_searchIndexMemory;
+    }
+
+    /**
+     * Have all blocks a filter?
+     * @return search index complete?
+     */
+    bool searchIndexComplete() const
+    {
+        return m_searchIndexBlocks == static_cast<int>(m_blocks.size());
+    }
+
+    /**
+     * Build the filters of some blocks without one, if the search index is enabled.
+     * Meant to be called again and again in the background, until the index is complete.
+     * @param maxBlocks maximal number of blocks to index
+     * @return true, if there are blocks left without filter
+     */
+    bool buildSearchIndex(int maxBlocks);
+
+    /**
+     * Skip the lines that can't contain a text with the given trigrams, according to the search index.
+     * @param line line to start with
+     * @param trigrams hashes of the trigrams of the text, see searchIndexTrigrams()
+     * @param backwards skip towards the start of the buffer?
+     * @return first line at or after (backwards: at or before) the given one that might contain the text, lines() (backwards: -1) if none
+     */
+    int searchIndexNextLine(int line, const std::vector<quint32> &trigrams, bool backwards) const;
+
+    /**
+     * The trigrams of a text, as used by the search index, they are case folded.
+     * @param text literal text on one line
+     * @return hashes of the distinct trigrams, empty if the text is too short or can't be looked up in the index
+     */
+    static std::vector<quint32> searchIndexTrigrams(const QString &text);
+
+    /**
+     * Set whether save() writes to a temporary file next to the target first and renames it over the target on success.
+     * The old file content stays intact if saving fails, but the target is replaced by a new file: hard links are broken
+     * and the owner of the file might change.
+     * @param viaTemporaryFile save through a temporary file?
+     */
+    void setSaveViaTemporaryFile(bool viaTemporaryFile)
+    {
+        m_saveViaTemporaryFile = viaTemporaryFile;
+    }
+
+    /**
+     * Get whether save() writes to a temporary file next to the target first.
+     * @return save through a temporary file?
+     */
+    bool saveViaTemporaryFile() const
+    {
+        return m_saveViaTemporaryFile;
+    }
+
+    /**
+     * Was the current content loaded in large file mode and are there still blocks depending on the file?
+     * @return large file mode active?
+     */
+    bool largeFileModeActive() const
+    {
+        return m_largeFile != nullptr;
+    }
+
+    /**
+     * Large file mode: number of blocks whose lines are decoded and still backed by the file.
+     * @return decoded blocks that can be evicted
+     */
+    int lazyBlocksLoaded() const
+    {
+        return m_lazyBlocksLoaded;
+    }
+
     /**
      * Load the given file. This will first clear the buffer and then load the file.
      * Even on error during loading the buffer will still be cleared.
@@ -229,6 +389,24 @@ public:
      */
     TextLine line(int line) const;
 
+    /**
+     * Length of a line, estimated from the size in the file for lines of large files
+     * that were not decoded yet, see setLargeFileModeThreshold().
+     * @param line wanted line number
+     * @return (estimated) length of the line
+     */
+    int estimatedLineLength(int line) const;
+
+    /**
+     * Large file mode: evicted blocks lose the highlighting data of their lines, but the state at their end.
+     * Tells once, if the lines of the block of @p line must be highlighted again.
+     * @param line wanted line number
+     * @param startLine filled with the first line of the block
+     * @param endLine filled with the last line of the block
+     * @return lines to highlight again?
+     */
+    bool takeLostHighlighting(int line, int &startLine, int &endLine);
+
     /**
      * Retrieve text of complete buffer.
      * @return text for this buffer, lines separated by '\n'
@@ -338,6 +516,16 @@ public:
      */
     virtual void insertText(const KTextEditor::Cursor &position, const QString &text);
 
+    /**
+     * Insert multiple lines at given cursor position, e.g. for pasting large texts.
+     * Same result as insertText() and wrapLine() for each line, but the lines are spliced into the blocks at once,
+     * with one history entry and one linesInserted() signal.
+     * @param position position where to insert the first line
+     * @param lines lines to insert, at least two, the rest of the line at position is appended to the last one
+     * Virtual, can be overwritten.
+     */
+    virtual void insertLines(const KTextEditor::Cursor &position, const QStringList &lines);
+
     /**
      * Remove text at given range. Does nothing if range is empty, beside some consistency checks.
      * @param range range of text to remove, must be on one line only.
@@ -345,6 +533,15 @@ public:
      */
     virtual void removeText(const KTextEditor::Range &range);
 
+    /**
+     * Remove text spanning multiple lines, the inverse of insertLines().
+     * Same result as removeText() and unwrapLine() for each line, but the lines are removed from the blocks at once,
+     * with one history entry and one linesRemoved() signal.
+     * @param range range of text to remove, must span at least two lines
+     * Virtual, can be overwritten.
+     */
+    virtual void removeLines(const KTextEditor::Range &range);
+
     /**
      * TextHistory of this buffer
      * @return text history for this buffer
@@ -403,6 +600,20 @@ Q_SIGNALS:
      */
     void textInserted(const KTextEditor::Cursor &position, const QString &text);
 
+    /**
+     * Multiple lines got inserted.
+     * @param position position where the first line was inserted
+     * @param lines inserted lines
+     */
+    void linesInserted(const KTextEditor::Cursor &position, const QStringList &lines);
+
+    /**
+     * Text spanning multiple lines got removed.
+     * @param range range where the removal occurred
+     * @param lines removed text, one entry per line
+     */
+    void linesRemoved(const KTextEditor::Range &range, const QStringList &lines);
+
     /**
      * Text got removed.
      * @param range range where the removal occurred
@@ -425,11 +636,25 @@ private:
     int blockForLine(int line) const;
 
     /**
-     * Fix start lines of all blocks after the given one
+     * Fix start lines of all blocks after the given one, after the number of lines of the given block changed.
+     * Updates the tree of block line counts in O(log n), the blocks compute their start line again on demand.
      * @param startBlock index of block from which we start to fix
      */
     void fixStartLines(int startBlock);
 
+    /**
+     * Start line of the block with the given index, computed from the tree of block line counts in O(log n).
+     * @param index block index
+     * @return start line of the block
+     */
+    int blockStartLine(int index) const;
+
+    /**
+     * Update the block indices and build the tree of block line counts again.
+     * Must be called after blocks got inserted or removed.
+     */
+    void fixBlockIndices();
+
     /**
      * Balance the given block. Look if it is too small or too large.
      * @param index block to balance
@@ -455,30 +680,125 @@ private:
      */
     void notifyAboutRangeChange(KTextEditor::View *view, KTextEditor::LineRange lineRange, bool rangeWithAttribute);
 
+    /**
+     * Drop and disable the search index, if its filters use more memory than allowed.
+     */
+    void checkSearchIndexMemory();
+
     /**
      * Mark all modified lines as lines saved on disk (modified line system).
      */
     void markModifiedLinesAsSaved();
 
     /**
-     * Save the current buffer content to the given already opened device
+     * Save the current buffer content to the given already opened device.
+     * The lines are encoded block-wise into a large output buffer, UTF-8 and Latin-1 without the codec.
      *
      * @param filename path name for display/debugging purposes
      * @param saveFile open device to write the buffer to
+     * @param digest git compatible sha1 digest of the written data, computed while writing,
+     *               empty if it can't be computed up front (compression or other codecs)
      */
-    bool saveBuffer(const QString &filename, KCompressionDevice &saveFile);
+    bool saveBuffer(const QString &filename, KCompressionDevice &saveFile, QByteArray &digest);
 
     /**
      * Attempt to save the buffer content in the given filename location using
      * current privileges.
      */
-    SaveResult saveBufferUnprivileged(const QString &filename);
+    SaveResult saveBufferUnprivileged(const QString &filename, QByteArray &digest);
 
     /**
      * Attempt to save the buffer content in the given filename location using
      * escalated privileges.
      */
-    bool saveBufferEscalated(const QString &filename);
+    bool saveBufferEscalated(const QString &filename, QByteArray &digest);
+
+    /**
+     * Length of the next line to create from the given line text, if lines longer than the
+     * line length limit are wrapped on load.
+     * @param unicodeData text of the line
+     * @param length length of the line
+     * @param lineLengthLimit line length limit, 0 for no limit
+     * @return length of the next line, length if no wrap is needed
+     */
+    static int wrappedLineLength(const QChar *unicodeData, int length, int lineLengthLimit);
+
+    /**
+     * Split the given text into lines like TextLoader::readLine() does and append them.
+     * Lines longer than the line length limit are wrapped.
+     * @param text text to split
+     * @param lineLengthLimit line length limit, 0 for no limit
+     * @param startsAfterCarriageReturn does the text directly follow a \r?
+     * @param appendLastLine append the text after the last line break, too?
+     * @param lines vector to append the lines to
+     * @param eol end of line mode, updated like the loader does
+     * @param longestLine the longest line (before wrapping)
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     */
+    static void splitLines(const QString &text,
+                           int lineLengthLimit,
+                           bool startsAfterCarriageReturn,
+                           bool appendLastLine,
+                           std::vector<TextLine> &lines,
+                           EndOfLineMode &eol,
+                           int &longestLine,
+                           bool &tooLongLinesWrapped);
+
+    /**
+     * Parallel loading: decode and split the data of the opened file in chunks by multiple threads.
+     * Must be called with one empty block and no lines.
+     * @param file opened file loader, the codec is used
+     * @param encodingErrors were there encoding errors?
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     * @param longestLineLoaded the longest line in the file (before wrapping)
+     * @param eol detected end of line mode
+     * @return success, false if the codec doesn't allow to cut the data
+     */
+    bool loadParallel(TextLoader &file, bool &encodingErrors, bool &tooLongLinesWrapped, int &longestLineLoaded, EndOfLineMode &eol);
+
+    /**
+     * Large file mode: index the lines of the given file into not yet decoded blocks.
+     * The line breaks are found on the raw data already read by the loader, the file is kept open to decode the blocks.
+     * Must be called with one empty block and no lines.
+     * @param filename file to index
+     * @param data raw data of the file
+     * @param size size of the raw data, the file must still have this size
+     * @param codec codec of the file, must be UTF-8 or Latin-1
+     * @param byteOrderMarkLength number of bytes to skip at the start
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     * @param longestLineLoaded the longest line in the file (before wrapping)
+     * @param eol detected end of line mode
+     * @return success, on failure the buffer is left empty again and normal loading must be used
+     */
+    bool loadLargeFile(const QString &filename,
+                       const char *data,
+                       qint64 size,
+                       QTextCodec *codec,
+                       int byteOrderMarkLength,
+                       bool &tooLongLinesWrapped,
+                       int &longestLineLoaded,
+                       EndOfLineMode &eol);
+
+    /**
+     * Large file mode: read and decode the lines of the given byte range of the file.
+     * @param byteStart start of the byte range
+     * @param byteEnd end of the byte range
+     * @param startsAfterCarriageReturn does the range directly follow a \r?
+     * @param lineCount number of lines indexed for the range, the file might have changed meanwhile
+     * @param lines empty vector to append the lines to
+     */
+    void loadLazyLines(qint64 byteStart, qint64 byteEnd, bool startsAfterCarriageReturn, int lineCount, std::vector<TextLine> &lines) const;
+
+    /**
+     * Large file mode: a block got decoded, evict the coldest blocks if too many are decoded.
+     * @param loadedBlock block that got decoded, will not be evicted
+     */
+    void lazyBlockLoaded(TextBlock *loadedBlock) const;
+
+    /**
+     * Large file mode: decode all blocks and close the file.
+     */
+    void detachFromLargeFile();
 
 public:
     /**
@@ -530,7 +850,7 @@ public:
 public:
     /**
      * Checksum of the document on disk, set either through file loading
-     * in openFile() or in KTextEditor::DocumentPrivate::saveFile()
+     * in openFile(), by save() or in KTextEditor::DocumentPrivate::saveFile()
      * @return git compatible sha1 checksum for this document
      */
     const QByteArray &digest() const;
@@ -577,6 +897,22 @@ private:
      */
     mutable int m_lastUsedBlock;
 
+    /**
+     * Number of lines of each block, as accounted in m_blockLinesTree.
+     */
+    std::vector<int> m_blockLines;
+
+    /**
+     * Fenwick tree over m_blockLines, same indices as m_blocks.
+     * Allows to compute the start line of a block and the block of a line in O(log n).
+     */
+    std::vector<int> m_blockLinesTree;
+
+    /**
+     * Incremented on each change of the block line counts, the blocks cache their start line only for one revision.
+     */
+    quint64 m_startLinesRevision;
+
     /**
      * Revision of the buffer.
      */
@@ -664,6 +1000,64 @@ private:
      */
     bool m_alwaysUseKAuthForSave;
 
+    /**
+     * Save through a temporary file that is renamed over the target?
+     */
+    bool m_saveViaTemporaryFile;
+
+    /**
+     * Minimal file size for parallel loading, 0 to disable it
+     */
+    qint64 m_parallelLoadThreshold;
+
+    /**
+     * Minimal file size for the large file mode, 0 to disable it
+     */
+    qint64 m_largeFileModeThreshold;
+
+    /**
+     * Large file mode: the opened file, nullptr if not in large file mode
+     */
+    QFile *m_largeFile;
+
+    /**
+     * Large file mode: size of the file when it got indexed
+     */
+    qint64 m_largeFileSize;
+
+    /**
+     * Large file mode: UTF-8 or Latin-1 encoded file?
+     */
+    bool m_largeFileUtf8;
+
+    /**
+     * Large file mode: line length limit used for the index
+     */
+    int m_largeFileLineLengthLimit;
+
+    /**
+     * Large file mode: number of decoded blocks still backed by the file, they can be evicted
+     */
+    mutable int m_lazyBlocksLoaded;
+
+    /**
+     * Large file mode: usage counter to find cold blocks
+     */
+    mutable quint64 m_lazyUseCounter;
+
+    /**
+     * Search index: enabled? memory limit for the filters of the blocks and their memory and number, kept up to date by the blocks
+     */
+    bool m_searchIndexEnabled;
+    qint64 m_searchIndexMemoryLimit;
+    qint64 m_searchIndexMemory;
+    int m_searchIndexBlocks;
+
+    /**
+     * Search index: block to look for blocks without filter first
+     */
+    int m_searchIndexNextBlock;
+
     /**
      * For copying QBuffer -> QTemporaryFile while saving document in privileged mode
      */
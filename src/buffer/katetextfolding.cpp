@@ -51,6 +51,9 @@ void TextFolding::clear()
     // reset counter
     m_idCounter = -1;
 
+    // the buffer revision starts again
+    invalidateFoldedLinesIndex();
+
     // no ranges, no work
     if (m_foldingRanges.isEmpty()) {
         // assert all stuff is consistent and return!
@@ -62,6 +65,7 @@ void TextFolding::clear()
     // cleanup
     m_idToFoldingRange.clear();
     m_foldedFoldingRanges.clear();
+    invalidateFoldedLinesIndex();
     qDeleteAll(m_foldingRanges);
     m_foldingRanges.clear();
 
@@ -254,6 +258,25 @@ void TextFolding::ensureLineIsVisible(int line)
     }
 }
 
+void TextFolding::updateFoldedLinesIndex() const
+{
+    // still up to date?
+    if (m_foldedLinesRevision == m_buffer.revision()) {
+        return;
+    }
+
+    // collect the lines of all folded ranges and sum up the hidden lines in front of them
+    m_foldedLines.clear();
+    m_foldedLines.reserve(m_foldedFoldingRanges.size());
+    int hiddenLines = 0;
+    for (FoldingRange *range : m_foldedFoldingRanges) {
+        const FoldedLines lines = {range->start->line(), range->end->line(), hiddenLines};
+        m_foldedLines.push_back(lines);
+        hiddenLines = lines.hiddenLinesUntilEnd();
+    }
+    m_foldedLinesRevision = m_buffer.revision();
+}
+
 int TextFolding::visibleLines() const
 {
     // start with all lines we have
@@ -264,10 +287,9 @@ int TextFolding::visibleLines() const
         return visibleLines;
     }
 
-    // count all folded lines and subtract them from visible lines
-    for (FoldingRange *range : m_foldedFoldingRanges) {
-        visibleLines -= (range->end->line() - range->start->line());
-    }
+    // subtract all folded lines
+    updateFoldedLinesIndex();
+    visibleLines -= m_foldedLines.back().hiddenLinesUntilEnd();
 
     // be done, assert we did no trash
     Q_ASSERT(visibleLines > 0);
@@ -279,37 +301,29 @@ int TextFolding::lineToVisibleLine(int line) const
     // valid input needed!
     Q_ASSERT(line >= 0);
 
-    // start with identity
-    int visibleLine = line;
-
     // skip if nothing folded or first line
     if (m_foldedFoldingRanges.isEmpty() || (line == 0)) {
-        return visibleLine;
+        return line;
     }
 
-    // walk over all folded ranges until we reach the line
-    // keep track of seen visible lines, for the case we want to convert a hidden line!
-    int seenVisibleLines = 0;
-    int lastLine = 0;
-    for (FoldingRange *range : m_foldedFoldingRanges) {
-        // abort if we reach our line!
-        if (range->start->line() >= line) {
-            break;
-        }
-
-        // count visible lines
-        seenVisibleLines += (range->start->line() - lastLine);
-        lastLine = range->end->line();
-
-        // we might be contained in the region, then we return last visible line
-        if (line <= range->end->line()) {
-            return seenVisibleLines;
-        }
+    // search the last folded range starting before our line
+    updateFoldedLinesIndex();
+    auto it = std::lower_bound(m_foldedLines.begin(), m_foldedLines.end(), line, [](const FoldedLines &lines, int line) {
+        return lines.startLine < line;
+    });
+    if (it == m_foldedLines.begin()) {
+        return line;
+    }
+    --it;
 
-        // subtrace folded lines
-        visibleLine -= (range->end->line() - range->start->line());
+    // we might be contained in the region, then we return the visible line of its start
+    if (line <= it->endLine) {
+        return it->visibleStartLine();
     }
 
+    // else subtract all folded lines in front of us
+    const int visibleLine = line - it->hiddenLinesUntilEnd();
+
     // be done, assert we did no trash
     Q_ASSERT(visibleLine >= 0);
     return visibleLine;
@@ -320,40 +334,56 @@ int TextFolding::visibleLineToLine(int visibleLine) const
     // valid input needed!
     Q_ASSERT(visibleLine >= 0);
 
-    // start with identity
-    int line = visibleLine;
-
     // skip if nothing folded or first line
     if (m_foldedFoldingRanges.isEmpty() || (visibleLine == 0)) {
-        return line;
+        return visibleLine;
     }
 
-    // last visible line seen, as line in buffer
-    int seenVisibleLines = 0;
-    int lastLine = 0;
-    int lastLineVisibleLines = 0;
-    for (FoldingRange *range : m_foldedFoldingRanges) {
-        // else compute visible lines and move last seen
-        lastLineVisibleLines = seenVisibleLines;
-        seenVisibleLines += (range->start->line() - lastLine);
+    // search the first folded range whose start is visible at or behind our visible line,
+    // all lines hidden by the ranges in front of it are in front of our line
+    updateFoldedLinesIndex();
+    auto it = std::lower_bound(m_foldedLines.begin(), m_foldedLines.end(), visibleLine, [](const FoldedLines &lines, int visibleLine) {
+        return lines.visibleStartLine() < visibleLine;
+    });
 
-        // bail out if enough seen
-        if (seenVisibleLines >= visibleLine) {
-            break;
-        }
+    // compute line
+    const int line = (it == m_foldedLines.begin()) ? visibleLine : (visibleLine + (it - 1)->hiddenLinesUntilEnd());
+    Q_ASSERT(line >= 0);
+    return line;
+}
 
-        lastLine = range->end->line();
+QVector<int> TextFolding::visibleLinesToLines(int firstVisibleLine, int lastVisibleLine, int step) const
+{
+    // valid input needed!
+    Q_ASSERT(firstVisibleLine >= 0);
+    Q_ASSERT(step > 0);
+
+    QVector<int> lines;
+    if (lastVisibleLine < firstVisibleLine) {
+        return lines;
     }
+    lines.reserve((lastVisibleLine - firstVisibleLine) / step + 1);
 
-    // check if still no enough visible!
-    if (seenVisibleLines < visibleLine) {
-        lastLineVisibleLines = seenVisibleLines;
+    // skip if nothing folded
+    if (m_foldedFoldingRanges.isEmpty()) {
+        for (int visibleLine = firstVisibleLine; visibleLine <= lastVisibleLine; visibleLine += step) {
+            lines.append(visibleLine);
+        }
+        return lines;
     }
 
-    // compute visible line
-    line = (lastLine + (visibleLine - lastLineVisibleLines));
-    Q_ASSERT(line >= 0);
-    return line;
+    // like visibleLineToLine(), but only the first folded range is searched, the others are found walking along
+    updateFoldedLinesIndex();
+    auto it = std::lower_bound(m_foldedLines.begin(), m_foldedLines.end(), firstVisibleLine, [](const FoldedLines &lines, int visibleLine) {
+        return lines.visibleStartLine() < visibleLine;
+    });
+    for (int visibleLine = firstVisibleLine; visibleLine <= lastVisibleLine; visibleLine += step) {
+        while (it != m_foldedLines.end() && it->visibleStartLine() < visibleLine) {
+            ++it;
+        }
+        lines.append((it == m_foldedLines.begin()) ? visibleLine : (visibleLine + (it - 1)->hiddenLinesUntilEnd()));
+    }
+    return lines;
 }
 
 QVector<QPair<qint64, TextFolding::FoldingRangeFlags>> TextFolding::foldingRangesStartingOnLine(int line) const
@@ -617,6 +647,7 @@ bool TextFolding::updateFoldedRangesForNewRange(TextFolding::FoldingRange *newRa
 
     // fixup folded ranges
     m_foldedFoldingRanges = newFoldedFoldingRanges;
+    invalidateFoldedLinesIndex();
 
     // folding changed!
     Q_EMIT foldingRangesChanged();
@@ -661,6 +692,7 @@ bool TextFolding::updateFoldedRangesForRemovedRange(TextFolding::FoldingRange *o
 
     // fixup folded ranges
     m_foldedFoldingRanges = newFoldedFoldingRanges;
+    invalidateFoldedLinesIndex();
 
     // folding changed!
     Q_EMIT foldingRangesChanged();
@@ -16,6 +16,8 @@
 #include <QJsonDocument>
 #include <QObject>
 
+#include <vector>
+
 namespace Kate
 {
 class TextBuffer;
@@ -113,15 +115,15 @@ public:
 
     /**
      * Query number of visible lines.
-     * Very fast, if nothing is folded, else walks over all folded regions
-     * O(n) for n == number of folded ranges
+     * Very fast, if nothing is folded, else uses the folded lines index
+     * O(1), the index is rebuilt in O(n) for n == number of folded ranges after the folding or the buffer changed
      */
     int visibleLines() const;
 
     /**
      * Convert a text buffer line to a visible line number.
-     * Very fast, if nothing is folded, else walks over all folded regions
-     * O(n) for n == number of folded ranges
+     * Very fast, if nothing is folded, else does binary search in the folded lines index
+     * log(n) for n == number of folded ranges
      * @param line line index in the text buffer
      * @return index in visible lines
      */
@@ -129,13 +131,25 @@ public:
 
     /**
      * Convert a visible line number to a line number in the text buffer.
-     * Very fast, if nothing is folded, else walks over all folded regions
-     * O(n) for n == number of folded ranges
+     * Very fast, if nothing is folded, else does binary search in the folded lines index
+     * log(n) for n == number of folded ranges
      * @param visibleLine visible line index
      * @return index in text buffer lines
      */
     int visibleLineToLine(int visibleLine) const;
 
+    /**
+     * Convert the visible lines firstVisibleLine, firstVisibleLine + step, ... up to lastVisibleLine
+     * to line numbers in the text buffer, like visibleLineToLine() does for each of them.
+     * Does one binary search, then walks the folded lines index along
+     * O(log(n) + n + m) for n == number of folded ranges and m == number of converted lines
+     * @param firstVisibleLine first visible line index
+     * @param lastVisibleLine last visible line index
+     * @param step distance of the converted visible lines, > 0
+     * @return indices in text buffer lines
+     */
+    QVector<int> visibleLinesToLines(int firstVisibleLine, int lastVisibleLine, int step = 1) const;
+
     /**
      * Queries which folding ranges start at the given line and returns the id + flags for all
      * of them. Very fast if nothing is folded, else binary search.
@@ -338,6 +352,19 @@ private:
      */
     void foldingRangesStartingOnLine(QVector<QPair<qint64, FoldingRangeFlags>> &results, const TextFolding::FoldingRange::Vector &ranges, int line) const;
 
+    /**
+     * Rebuild the folded lines index, if the folded ranges or the buffer changed since it was built.
+     */
+    void updateFoldedLinesIndex() const;
+
+    /**
+     * Mark the folded lines index as outdated, must be called whenever m_foldedFoldingRanges changes.
+     */
+    void invalidateFoldedLinesIndex()
+    {
+        m_foldedLinesRevision = -1;
+    }
+
 private:
     /**
      * parent text buffer
@@ -360,6 +387,54 @@ private:
      */
     FoldingRange::Vector m_foldedFoldingRanges;
 
+    /**
+     * Lines of a folded range, in the folded lines index
+     */
+    struct FoldedLines {
+        /**
+         * start line, the following lines up to end line are hidden
+         */
+        int startLine;
+
+        /**
+         * end line
+         */
+        int endLine;
+
+        /**
+         * number of lines hidden by the folded ranges in front of this one, prefix sum
+         */
+        int hiddenLinesBefore;
+
+        /**
+         * visible line of the start line
+         */
+        int visibleStartLine() const
+        {
+            return startLine - hiddenLinesBefore;
+        }
+
+        /**
+         * number of lines hidden by this range and the ones in front of it
+         */
+        int hiddenLinesUntilEnd() const
+        {
+            return hiddenLinesBefore + endLine - startLine;
+        }
+    };
+
+    /**
+     * folded lines index: the lines of m_foldedFoldingRanges, in the same order
+     * the moving cursors of the ranges change with each edit, the index is rebuilt lazily
+     * once the revision of the buffer differs from the one it got built for
+     */
+    mutable std::vector<FoldedLines> m_foldedLines;
+
+    /**
+     * buffer revision the folded lines index was built for, -1 if it is outdated
+     */
+    mutable qint64 m_foldedLinesRevision = -1;
+
     /**
      * global id counter for the created ranges
      */
@@ -92,6 +92,30 @@ void TextHistory::removeText(const KTextEditor::Range &range, int oldLineLength)
     addEntry(entry);
 }
 
+void TextHistory::insertLines(const KTextEditor::Cursor &position, int newLines, int lastLineLength)
+{
+    // create and add new entry
+    Entry entry;
+    entry.type = Entry::InsertLines;
+    entry.line = position.line();
+    entry.column = position.column();
+    entry.length = newLines;
+    entry.oldLineLength = lastLineLength;
+    addEntry(entry);
+}
+
+void TextHistory::removeLines(const KTextEditor::Range &range)
+{
+    // create and add new entry
+    Entry entry;
+    entry.type = Entry::RemoveLines;
+    entry.line = range.start().line();
+    entry.column = range.start().column();
+    entry.length = range.end().line() - range.start().line();
+    entry.oldLineLength = range.end().column();
+    addEntry(entry);
+}
+
 void TextHistory::addEntry(const Entry &entry)
 {
     // history should never be empty
@@ -249,6 +273,51 @@ void TextHistory::Entry::transformCursor(int &cursorLine, int &cursorColumn, boo
 
         return;
 
+    // Insert lines
+    case InsertLines:
+        // we insert into this line, behaves like a wrap at the insert position
+        if (cursorLine == line) {
+            // skip cursors with too small column
+            if (cursorColumn <= column) {
+                if (cursorColumn < column || !moveOnInsert) {
+                    return;
+                }
+            }
+
+            // adjust column, the rest of the line is behind the last inserted line
+            cursorColumn = cursorColumn - column + oldLineLength;
+        }
+
+        // always move cursor behind the new lines
+        cursorLine += length;
+        return;
+
+    // Remove lines
+    case RemoveLines:
+        // ignore the front of the first line
+        if (cursorLine == line && cursorColumn <= column) {
+            return;
+        }
+
+        // lines behind the removed ones just move up
+        if (cursorLine > line + length) {
+            cursorLine -= length;
+            return;
+        }
+
+        // rest of the last line is appended to the first one, adjust column
+        if (cursorLine == line + length && cursorColumn > oldLineLength) {
+            cursorColumn = column + cursorColumn - oldLineLength;
+        }
+
+        // inside the removed text
+        else {
+            cursorColumn = column;
+        }
+
+        cursorLine = line;
+        return;
+
     // nothing
     default:
         return;
@@ -344,6 +413,56 @@ void TextHistory::Entry::reverseTransformCursor(int &cursorLine, int &cursorColu
         }
         return;
 
+    // Insert lines
+    case InsertLines:
+        // ignore lines before the insert and the front of the line we inserted into
+        if (cursorLine < line || (cursorLine == line && cursorColumn <= column)) {
+            return;
+        }
+
+        // lines behind the inserted ones just move up
+        if (cursorLine > line + length) {
+            cursorLine -= length;
+            return;
+        }
+
+        // rest of the old line behind the last inserted line, adjust column
+        if (cursorLine == line + length && cursorColumn > oldLineLength) {
+            cursorColumn = column + cursorColumn - oldLineLength;
+        }
+
+        // inside the inserted text
+        else {
+            cursorColumn = column;
+        }
+
+        cursorLine = line;
+        return;
+
+    // Remove lines
+    case RemoveLines:
+        // ignore lines before the removal
+        if (cursorLine < line) {
+            return;
+        }
+
+        // we remove from this line, behaves like an insert of the lines at the position
+        if (cursorLine == line) {
+            // skip cursors with too small column
+            if (cursorColumn <= column) {
+                if (cursorColumn < column || !moveOnInsert) {
+                    return;
+                }
+            }
+
+            // adjust column, the rest of the line is behind the last removed line
+            cursorColumn = cursorColumn - column + oldLineLength;
+        }
+
+        // always move cursor behind the removed lines
+        cursorLine += length;
+        return;
+
     // nothing
     default:
         return;
@@ -105,7 +105,7 @@ private:
         /**
          * Types of entries, matching editing primitives of buffer and placeholder
          */
-        enum Type { NoChange, WrapLine, UnwrapLine, InsertText, RemoveText };
+        enum Type { NoChange, WrapLine, UnwrapLine, InsertText, RemoveText, InsertLines, RemoveLines };
 
         /**
          * Default Constructor, invalidates all fields
@@ -135,12 +135,12 @@ private:
         int column = -1;
 
         /**
-         * length of change (length of insert or removed text)
+         * length of change (length of insert or removed text, number of new or removed lines for insert or remove of lines)
          */
         int length = -1;
 
         /**
-         * old line length (needed for unwrap and insert)
+         * old line length (needed for unwrap and insert), length of the last inserted or removed line for insert or remove of lines
          */
         int oldLineLength = -1;
     };
@@ -194,6 +194,22 @@ private:
      */
     void removeText(const KTextEditor::Range &range, int oldLineLength);
 
+    /**
+     * Notify about insert of multiple lines at given cursor position.
+     * Same as insert text and wrap line for each new line, but just one entry.
+     * @param position position where to insert the first line
+     * @param newLines number of new lines, at least one
+     * @param lastLineLength text length of the last inserted line, without the rest of the old line
+     */
+    void insertLines(const KTextEditor::Cursor &position, int newLines, int lastLineLength);
+
+    /**
+     * Notify about remove of text spanning multiple lines.
+     * Same as remove text and unwrap line for each removed line, but just one entry.
+     * @param range range of text to remove, must span at least two lines
+     */
+    void removeLines(const KTextEditor::Range &range);
+
     /**
      * Generic function to add a entry to the history. Is used by the above functions for the different editing primitives.
      * @param entry new entry to add
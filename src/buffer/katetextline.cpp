@@ -22,6 +22,12 @@ TextLineData::~TextLineData()
 {
 }
 
+const TextLine &emptyTextLine()
+{
+    static const TextLine emptyLine = TextLine::create();
+    return emptyLine;
+}
+
 int TextLineData::firstChar() const
 {
     return nextNonSpaceChar(0);
@@ -76,7 +76,7 @@ public:
          * @param _offset offset of the folding start
          * @param _foldingValue positive ones start foldings, negative ones end them
          */
-        Folding(int _offset, int _foldingValue)
+        explicit Folding(int _offset = 0, int _foldingValue = 0)
             : offset(_offset)
             , foldingValue(_foldingValue)
         {
@@ -396,7 +396,7 @@ public:
      * Accessor to foldings
      * @return foldings of this line
      */
-    const std::vector<Folding> &foldings() const
+    const QVector<Folding> &foldings() const
     {
         return m_foldings;
     }
@@ -408,7 +408,7 @@ public:
      */
     void addFolding(int offset, int folding)
     {
-        m_foldings.emplace_back(offset, folding);
+        m_foldings.append(Folding(offset, folding));
     }
 
     /**
@@ -457,8 +457,9 @@ private:
 
     /**
      * foldings of this line
+     * QVector, like the attributes, the empty ones share one null instance and take just a pointer
      */
-    std::vector<Folding> m_foldings;
+    QVector<Folding> m_foldings;
 
     /**
      * current highlighting state
@@ -473,9 +474,20 @@ private:
 
 /**
  * The normal world only accesses the text lines with shared pointers.
+ * Create them with TextLine::create(), this allocates the line and the reference count at once.
  */
 typedef QSharedPointer<TextLineData> TextLine;
 
+/**
+ * Shared empty text line, e.g. as next line after the last one for the highlighting.
+ * Must not be modified.
+ * @return empty text line
+ */
+KTEXTEDITOR_EXPORT const TextLine &emptyTextLine();
+
 }
 
+Q_DECLARE_TYPEINFO(Kate::TextLineData::Attribute, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Kate::TextLineData::Folding, Q_MOVABLE_TYPE);
+
 #endif
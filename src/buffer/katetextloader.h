@@ -10,11 +10,21 @@
 #include <QCryptographicHash>
 #include <QFile>
 #include <QMimeDatabase>
+#include <QScopedPointer>
 #include <QString>
+#include <QTemporaryFile>
+#include <QtAlgorithms>
 
 // on the fly compression
 #include <KFilterDev>
 
+// vectorized line break scanning
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace Kate
 {
 /**
@@ -24,6 +34,109 @@ namespace Kate
  */
 static const qint64 KATE_FILE_LOADER_BS = 256 * 1024;
 
+/**
+ * decompressed content up to 256 mb is kept in memory, larger content is spilled to a temporary file
+ */
+static const qint64 KATE_FILE_LOADER_SPILL_LIMIT = 256 * 1024 * 1024;
+
+/**
+ * Find the first line break in the given range of Unicode data.
+ * Line breaks are \n, \r and QChar::LineSeparator, like handled by TextLoader::readLine().
+ * Scans 16 (AVX2) or 8 (SSE2) characters per step, the remaining ones with a scalar loop.
+ * @param begin start of range to search in
+ * @param end end of range to search in
+ * @return pointer to first line break character, end if none found
+ */
+inline const QChar *findLineBreak(const QChar *begin, const QChar *end)
+{
+    const ushort *it = reinterpret_cast<const ushort *>(begin);
+    const ushort *const stop = reinterpret_cast<const ushort *>(end);
+
+#if defined(__AVX2__)
+    const __m256i lf = _mm256_set1_epi16(short('\n'));
+    const __m256i cr = _mm256_set1_epi16(short('\r'));
+    const __m256i ls = _mm256_set1_epi16(short(QChar::LineSeparator));
+    for (; (stop - it) >= 16; it += 16) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+        const __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(chars, lf), _mm256_cmpeq_epi16(chars, cr)), _mm256_cmpeq_epi16(chars, ls));
+        const uint mask = uint(_mm256_movemask_epi8(hits));
+        if (mask) {
+            // two mask bits per character
+            return reinterpret_cast<const QChar *>(it + qCountTrailingZeroBits(mask) / 2);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i lf = _mm_set1_epi16(short('\n'));
+    const __m128i cr = _mm_set1_epi16(short('\r'));
+    const __m128i ls = _mm_set1_epi16(short(QChar::LineSeparator));
+    for (; (stop - it) >= 8; it += 8) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(chars, lf), _mm_cmpeq_epi16(chars, cr)), _mm_cmpeq_epi16(chars, ls));
+        const uint mask = uint(_mm_movemask_epi8(hits));
+        if (mask) {
+            // two mask bits per character
+            return reinterpret_cast<const QChar *>(it + qCountTrailingZeroBits(mask) / 2);
+        }
+    }
+#endif
+
+    // scalar fallback and tail handling
+    for (; it != stop; ++it) {
+        if (*it == '\n' || *it == '\r' || *it == QChar::LineSeparator) {
+            break;
+        }
+    }
+    return reinterpret_cast<const QChar *>(it);
+}
+
+/**
+ * Find the first byte in the given range of raw UTF-8 or Latin-1 data that might start a line break.
+ * These are \n, \r and 0xE2, the first byte of an UTF-8 encoded QChar::LineSeparator,
+ * the caller must check the bytes after the latter.
+ * Scans 32 (AVX2) or 16 (SSE2) bytes per step, the remaining ones with a scalar loop.
+ * @param begin start of range to search in
+ * @param end end of range to search in
+ * @return pointer to first candidate byte, end if none found
+ */
+inline const char *findLineBreak(const char *begin, const char *end)
+{
+    const char *it = begin;
+
+#if defined(__AVX2__)
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i ls = _mm256_set1_epi8(char(0xE2));
+    for (; (end - it) >= 32; it += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+        const __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, lf), _mm256_cmpeq_epi8(bytes, cr)), _mm256_cmpeq_epi8(bytes, ls));
+        const uint mask = uint(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return it + qCountTrailingZeroBits(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i ls = _mm_set1_epi8(char(0xE2));
+    for (; (end - it) >= 16; it += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, lf), _mm_cmpeq_epi8(bytes, cr)), _mm_cmpeq_epi8(bytes, ls));
+        const uint mask = uint(_mm_movemask_epi8(hits));
+        if (mask) {
+            return it + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+
+    // scalar fallback and tail handling
+    for (; it != end; ++it) {
+        if (*it == '\n' || *it == '\r' || uchar(*it) == 0xE2) {
+            break;
+        }
+    }
+    return it;
+}
+
 /**
  * File Loader, will handle reading of files + detecting encoding
  */
@@ -43,10 +156,16 @@ public:
         , m_position(0)
         , m_lastLineStart(0)
         , m_eol(TextBuffer::eolUnknown) // no eol type detected atm
-        , m_buffer(KATE_FILE_LOADER_BS, 0)
+        , m_plainFile(filename)
+        , m_spillFile(nullptr)
+        , m_data(nullptr)
+        , m_dataSize(0)
+        , m_dataRead(false)
+        , m_readPosition(0)
         , m_digest(QCryptographicHash::Sha1)
-        , m_converterState(nullptr)
+        , m_decoder(nullptr)
         , m_bomFound(false)
+        , m_bomBytes(0)
         , m_firstRead(true)
         , m_proberType(proberType)
         , m_fileSize(0)
@@ -56,9 +175,9 @@ public:
         m_mimeType = QMimeDatabase().mimeTypeForFileNameAndData(filename, &testMime).name();
         m_fileSize = testMime.size();
 
-        // construct filter device
-        KCompressionDevice::CompressionType compressionType = KFilterDev::compressionTypeForMimeType(m_mimeType);
-        m_file = new KCompressionDevice(filename, compressionType);
+        // construct filter device, plain files are read directly
+        m_compressionType = KFilterDev::compressionTypeForMimeType(m_mimeType);
+        m_file = (m_compressionType != KCompressionDevice::None) ? new KCompressionDevice(filename, m_compressionType) : nullptr;
     }
 
     /**
@@ -67,11 +186,13 @@ public:
     ~TextLoader()
     {
         delete m_file;
-        delete m_converterState;
+        delete m_spillFile;
+        delete m_decoder;
     }
 
     /**
      * open file with given codec
+     * The raw file content is only read once, on the first call, later calls just rewind.
      * @param codec codec to use, if 0, will do some auto-detect or fallback
      * @return success
      */
@@ -84,23 +205,69 @@ public:
         m_position = 0;
         m_lastLineStart = 0;
         m_eol = TextBuffer::eolUnknown;
-        m_text.clear();
-        delete m_converterState;
-        m_converterState = new QTextCodec::ConverterState(QTextCodec::DefaultConversion);
+        m_text.resize(0);
+        m_text.reserve(2 * KATE_FILE_LOADER_BS);
+        delete m_decoder;
+        m_decoder = nullptr;
         m_bomFound = false;
+        m_bomBytes = 0;
         m_firstRead = true;
+        m_readPosition = 0;
 
-        // init the hash with the git header
-        const QString header = QStringLiteral("blob %1").arg(m_fileSize);
-        m_digest.reset();
-        m_digest.addData(header.toLatin1() + '\0');
+        // get the raw data once, this computes the digest, too
+        if (!m_dataRead) {
+            if (!readData()) {
+                return false;
+            }
+            m_dataRead = true;
+        }
 
-        // if already opened, close the file...
-        if (m_file->isOpen()) {
-            m_file->close();
+        return true;
+    }
+
+    /**
+     * Detect BOM & codec, like the first readLine() does, if not already done.
+     * @return false if no codec could be detected
+     */
+    bool prepareCodec()
+    {
+        return !m_firstRead || detectCodec(m_data, int(qMin(KATE_FILE_LOADER_BS, m_dataSize)));
+    }
+
+    /**
+     * Check if the complete file content can be decoded with the codec given to open() without encoding errors.
+     * This works on the in-memory raw data and creates no lines, use it to pick a codec before reading lines.
+     * If open() was called without codec, the codec is detected, like readLine() would do it.
+     * @return true if readLine() will report no encoding errors for this codec
+     */
+    bool decodesWithoutErrors()
+    {
+        // detect BOM & codec, no codec, no chance, encoding error
+        if (!prepareCodec()) {
+            return false;
         }
 
-        return m_file->open(QIODevice::ReadOnly);
+        // decode chunk wise, like readLine() does, but only keep the failure state
+        // a chunk that decodes to nothing is only an error if no line break follows, see readLine()
+        QScopedPointer<QTextDecoder> decoder(m_codec->makeDecoder(QTextCodec::DefaultConversion));
+        QString decoded;
+        bool emptyChunkPending = false;
+        for (qint64 position = 0; position < m_dataSize; position += KATE_FILE_LOADER_BS) {
+            const int c = int(qMin(KATE_FILE_LOADER_BS, m_dataSize - position));
+            const int bomBytes = (position == 0) ? m_bomBytes : 0;
+            decoder->toUnicode(&decoded, m_data + position + bomBytes, c - bomBytes);
+            if (decoder->hasFailure()) {
+                return false;
+            }
+
+            if (decoded.isEmpty()) {
+                emptyChunkPending = true;
+            } else if (emptyChunkPending && findLineBreak(decoded.unicode(), decoded.unicode() + decoded.length()) != decoded.unicode() + decoded.length()) {
+                emptyChunkPending = false;
+            }
+        }
+
+        return !emptyChunkPending;
     }
 
     /**
@@ -131,6 +298,42 @@ public:
         return m_bomFound;
     }
 
+    /**
+     * Length of the BOM in the raw data.
+     * @return byte order mark length in bytes, 0 if none found
+     */
+    int byteOrderMarkLength() const
+    {
+        return m_bomBytes;
+    }
+
+    /**
+     * Is the file read without any decompression?
+     * @return plain file?
+     */
+    bool isPlainFile() const
+    {
+        return !m_file;
+    }
+
+    /**
+     * Raw data, after decompression, only valid after open().
+     * @return raw data of the file
+     */
+    const char *rawData() const
+    {
+        return m_data;
+    }
+
+    /**
+     * Size of the raw data, after decompression, only valid after open().
+     * @return raw data size in bytes
+     */
+    qint64 rawDataSize() const
+    {
+        return m_dataSize;
+    }
+
     /**
      * mime type used to create filter dev
      * @return mime-type of filter device
@@ -187,99 +390,47 @@ public:
             if (m_position == m_text.length()) {
                 // try to load more text if something is around
                 if (!m_eof) {
-                    // kill the old lines...
-                    m_text.remove(0, m_lastLineStart);
+                    // kill the old lines, but only if they make up the larger part of the buffer
+                    // this way only the small unfinished tail is moved and the capacity is kept
+                    if (m_lastLineStart > 0 && m_lastLineStart >= (m_text.length() - m_lastLineStart)) {
+                        m_text.remove(0, m_lastLineStart);
+                        m_position -= m_lastLineStart;
+                        m_lastLineStart = 0;
+                    }
 
-                    // try to read new data
-                    const int c = m_file->read(m_buffer.data(), m_buffer.size());
+                    // get next chunk of the raw data
+                    const int c = int(qMin(KATE_FILE_LOADER_BS, m_dataSize - m_readPosition));
+                    const char *const data = m_data + m_readPosition;
+                    const bool firstChunk = (m_readPosition == 0);
+                    m_readPosition += c;
 
                     // if any text is there, append it....
                     if (c > 0) {
-                        // update hash sum
-                        m_digest.addData(m_buffer.data(), c);
-
                         // detect byte order marks & codec for byte order marks on first read
-                        int bomBytes = 0;
-                        if (m_firstRead) {
-                            // use first 16 bytes max to allow BOM detection of codec
-                            QByteArray bom(m_buffer.data(), qMin(16, c));
-                            QTextCodec *codecForByteOrderMark = QTextCodec::codecForUtfText(bom, nullptr);
-
-                            // if codec != null, we found a BOM!
-                            if (codecForByteOrderMark) {
-                                m_bomFound = true;
-
-                                // eat away the different boms!
-                                int mib = codecForByteOrderMark->mibEnum();
-                                if (mib == 106) { // utf8
-                                    bomBytes = 3;
-                                }
-                                if (mib == 1013 || mib == 1014 || mib == 1015) { // utf16
-                                    bomBytes = 2;
-                                }
-                                if (mib == 1017 || mib == 1018 || mib == 1019) { // utf32
-                                    bomBytes = 4;
-                                }
-                            }
-
-                            /**
-                             * if no codec given, do autodetection
-                             */
-                            if (!m_codec) {
-                                /**
-                                 * byte order said something about encoding?
-                                 */
-                                if (codecForByteOrderMark) {
-                                    m_codec = codecForByteOrderMark;
-                                } else {
-                                    /**
-                                     * no Unicode BOM found, trigger prober
-                                     */
-
-                                    /**
-                                     * first: try to get HTML header encoding
-                                     */
-                                    if (QTextCodec *codecForHtml = QTextCodec::codecForHtml(m_buffer, nullptr)) {
-                                        m_codec = codecForHtml;
-                                    }
-
-                                    /**
-                                     * else: use KEncodingProber
-                                     */
-                                    else {
-                                        KEncodingProber prober(m_proberType);
-                                        prober.feed(m_buffer.constData(), c);
-
-                                        // we found codec with some confidence?
-                                        if (prober.confidence() > 0.5) {
-                                            m_codec = QTextCodec::codecForName(prober.encoding());
-                                        }
-                                    }
-
-                                    // no codec, no chance, encoding error
-                                    if (!m_codec) {
-                                        return false;
-                                    }
-                                }
-                            }
-
-                            m_firstRead = false;
+                        // no codec, no chance, encoding error
+                        if (m_firstRead && !detectCodec(data, c)) {
+                            return false;
+                        }
+
+                        // eat away the byte order mark
+                        const int bomBytes = firstChunk ? m_bomBytes : 0;
+
+                        // codec is known now, create the stateful decoder for it
+                        if (!m_decoder) {
+                            Q_ASSERT(m_codec);
+                            m_decoder = m_codec->makeDecoder(QTextCodec::DefaultConversion);
                         }
 
                         // detect broken encoding, we did before use QTextCodec::ConvertInvalidToNull and check for 0 chars
-                        // this lead to issues with files containing 0 chars, therefore use the invalidChars field of the state
-                        Q_ASSERT(m_codec);
-                        QString unicode = m_codec->toUnicode(m_buffer.constData() + bomBytes, c - bomBytes, m_converterState);
-                        encodingError = encodingError || m_converterState->invalidChars;
-                        m_text.append(unicode);
+                        // this lead to issues with files containing 0 chars, therefore use the failure state of the decoder
+                        // decode into the reused scratch string, this avoids one allocation per read
+                        m_decoder->toUnicode(&m_decoded, data + bomBytes, c - bomBytes);
+                        encodingError = encodingError || m_decoder->hasFailure();
+                        m_text.append(m_decoded);
                     }
 
                     // is file completely read ?
-                    m_eof = (c == -1) || (c == 0);
-
-                    // recalc current pos and last pos
-                    m_position -= m_lastLineStart;
-                    m_lastLineStart = 0;
+                    m_eof = (c == 0);
                 }
 
                 // oh oh, end of file, escape !
@@ -302,7 +453,21 @@ public:
                 }
             }
 
-            QChar current_char = m_text.at(m_position);
+            // skip all characters up to the next line break in one go
+            const QChar *const begin = m_text.unicode() + m_position;
+            const QChar *const lineBreak = findLineBreak(begin, m_text.unicode() + m_text.length());
+            if (lineBreak != begin) {
+                m_lastWasEndOfLine = false;
+                m_lastWasR = false;
+                m_position += lineBreak - begin;
+
+                // no line break in the buffer, read more data
+                if (m_position == m_text.length()) {
+                    continue;
+                }
+            }
+
+            const QChar current_char = *lineBreak;
             if (current_char == lf) {
                 m_lastWasEndOfLine = true;
 
@@ -342,7 +507,8 @@ public:
                 }
 
                 return !encodingError;
-            } else if (current_char == QChar::LineSeparator) {
+            } else {
+                Q_ASSERT(current_char == QChar::LineSeparator);
                 m_lastWasEndOfLine = true;
 
                 // line data
@@ -353,9 +519,6 @@ public:
                 m_position++;
 
                 return !encodingError;
-            } else {
-                m_lastWasEndOfLine = false;
-                m_lastWasR = false;
             }
 
             m_position++;
@@ -369,6 +532,162 @@ public:
         return m_digest.result();
     }
 
+private:
+    /**
+     * Read the complete raw content of the file, exactly once.
+     * Plain files are read and compressed files are decompressed into a spill buffer,
+     * that moves to a temporary file if it grows too large.
+     * A plain file truncated meanwhile just ends early, as with compressed files.
+     * Computes the git blob digest of the content, too.
+     * @return success
+     */
+    bool readData()
+    {
+        // init the hash with the git header
+        const QString header = QStringLiteral("blob %1").arg(m_fileSize);
+        m_digest.reset();
+        m_digest.addData(header.toLatin1() + '\0');
+
+        if (!m_file) {
+            // plain file, read it into the spill buffer, without another buffer in between
+            if (!m_plainFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !spill(&m_plainFile, m_plainFile.size())) {
+                return false;
+            }
+        } else {
+            // compressed file, we need to decompress it once
+            if (!m_file->open(QIODevice::ReadOnly) || !spill(m_file)) {
+                return false;
+            }
+        }
+
+        // hash all the data in one go
+        for (qint64 position = 0; position < m_dataSize; position += KATE_FILE_LOADER_BS) {
+            m_digest.addData(m_data + position, int(qMin(KATE_FILE_LOADER_BS, m_dataSize - position)));
+        }
+
+        return true;
+    }
+
+    /**
+     * Read the given device until its end into the spill buffer.
+     * If the data exceeds KATE_FILE_LOADER_SPILL_LIMIT, it goes to a memory mapped temporary file instead.
+     * Like before, a read error ends the data, what was read until then is kept.
+     * @param device device to read from
+     * @param sizeHint expected size of the data, 0 if unknown
+     * @return success
+     */
+    bool spill(QIODevice *device, qint64 sizeHint = 0)
+    {
+        QByteArray buffer(KATE_FILE_LOADER_BS, 0);
+        m_spill.clear();
+        if (sizeHint > 0 && sizeHint <= KATE_FILE_LOADER_SPILL_LIMIT) {
+            m_spill.reserve(int(sizeHint));
+        }
+        qint64 c = 0;
+        while ((c = device->read(buffer.data(), buffer.size())) > 0) {
+            // too large for memory? move to temporary file
+            if (!m_spillFile && (m_spill.size() + c) > KATE_FILE_LOADER_SPILL_LIMIT) {
+                m_spillFile = new QTemporaryFile();
+                if (!m_spillFile->open() || m_spillFile->write(m_spill) != m_spill.size()) {
+                    return false;
+                }
+                m_spill.clear();
+            }
+
+            if (m_spillFile) {
+                if (m_spillFile->write(buffer.constData(), c) != c) {
+                    return false;
+                }
+            } else {
+                m_spill.append(buffer.constData(), int(c));
+            }
+        }
+
+        // map the temporary file, if used
+        if (m_spillFile) {
+            if (!m_spillFile->flush()) {
+                return false;
+            }
+            m_dataSize = m_spillFile->size();
+            m_data = reinterpret_cast<const char *>(m_spillFile->map(0, m_dataSize));
+            return m_data != nullptr;
+        }
+
+        m_dataSize = m_spill.size();
+        m_data = m_spill.constData();
+        return true;
+    }
+
+    /**
+     * Detect byte order mark and, if no codec was given to open(), the codec.
+     * @param data first chunk of raw data
+     * @param c size of the chunk
+     * @return false if no codec could be detected
+     */
+    bool detectCodec(const char *data, int c)
+    {
+        m_firstRead = false;
+
+        // use first 16 bytes max to allow BOM detection of codec
+        QByteArray bom(data, qMin(16, c));
+        QTextCodec *codecForByteOrderMark = QTextCodec::codecForUtfText(bom, nullptr);
+
+        // if codec != null, we found a BOM!
+        if (codecForByteOrderMark) {
+            m_bomFound = true;
+
+            // eat away the different boms!
+            int mib = codecForByteOrderMark->mibEnum();
+            if (mib == 106) { // utf8
+                m_bomBytes = 3;
+            }
+            if (mib == 1013 || mib == 1014 || mib == 1015) { // utf16
+                m_bomBytes = 2;
+            }
+            if (mib == 1017 || mib == 1018 || mib == 1019) { // utf32
+                m_bomBytes = 4;
+            }
+        }
+
+        /**
+         * if no codec given, do autodetection
+         */
+        if (!m_codec) {
+            /**
+             * byte order said something about encoding?
+             */
+            if (codecForByteOrderMark) {
+                m_codec = codecForByteOrderMark;
+            } else {
+                /**
+                 * no Unicode BOM found, trigger prober
+                 */
+
+                /**
+                 * first: try to get HTML header encoding
+                 */
+                if (QTextCodec *codecForHtml = QTextCodec::codecForHtml(QByteArray::fromRawData(data, c), nullptr)) {
+                    m_codec = codecForHtml;
+                }
+
+                /**
+                 * else: use KEncodingProber
+                 */
+                else {
+                    KEncodingProber prober(m_proberType);
+                    prober.feed(data, c);
+
+                    // we found codec with some confidence?
+                    if (prober.confidence() > 0.5) {
+                        m_codec = QTextCodec::codecForName(prober.encoding());
+                    }
+                }
+            }
+        }
+
+        return m_codec != nullptr;
+    }
+
 private:
     QTextCodec *m_codec;
     bool m_eof;
@@ -378,12 +697,21 @@ private:
     int m_lastLineStart;
     TextBuffer::EndOfLineMode m_eol;
     QString m_mimeType;
+    KCompressionDevice::CompressionType m_compressionType;
     QIODevice *m_file;
-    QByteArray m_buffer;
+    QFile m_plainFile;
+    QTemporaryFile *m_spillFile;
+    QByteArray m_spill;
+    const char *m_data;
+    qint64 m_dataSize;
+    bool m_dataRead;
+    qint64 m_readPosition;
     QCryptographicHash m_digest;
     QString m_text;
-    QTextCodec::ConverterState *m_converterState;
+    QString m_decoded;
+    QTextDecoder *m_decoder;
     bool m_bomFound;
+    int m_bomBytes;
     bool m_firstRead;
     KEncodingProber::ProberType m_proberType;
     quint64 m_fileSize;
@@ -115,7 +115,7 @@ QVector<QTextLayout::FormatRange> KateCompletionDelegate::createHighlighting(con
         len += text.length();
     }
 
-    Kate::TextLine thisLine = Kate::TextLine(new Kate::TextLineData(lineContent));
+    Kate::TextLine thisLine = Kate::TextLine::create(lineContent);
 
     // qCDebug(LOG_KTE) << "About to highlight with mode " << highlightMethod << " text [" << thisLine->string() << "]";
 
@@ -124,14 +124,14 @@ QVector<QTextLayout::FormatRange> KateCompletionDelegate::createHighlighting(con
         if (completionStart.line()) {
             previousLine = document()->kateTextLine(completionStart.line() - 1);
         } else {
-            previousLine = Kate::TextLine(new Kate::TextLineData());
+            previousLine = Kate::emptyTextLine();
         }
 
         Kate::TextLine nextLine;
         if ((completionStart.line() + 1) < document()->lines()) {
             nextLine = document()->kateTextLine(completionStart.line() + 1);
         } else {
-            nextLine = Kate::TextLine(new Kate::TextLineData());
+            nextLine = Kate::emptyTextLine();
         }
 
         bool ctxChanged = false;
@@ -151,7 +151,9 @@ KateCompletionWidget::KateCompletionWidget(KTextEditor::ViewPrivate *parent)
     connect(&view()->doc()->buffer(), &KateBuffer::lineWrapped, this, &KateCompletionWidget::wrapLine);
     connect(&view()->doc()->buffer(), &KateBuffer::lineUnwrapped, this, &KateCompletionWidget::unwrapLine);
     connect(&view()->doc()->buffer(), &KateBuffer::textInserted, this, &KateCompletionWidget::insertText);
+    connect(&view()->doc()->buffer(), &KateBuffer::linesInserted, this, &KateCompletionWidget::insertLines);
     connect(&view()->doc()->buffer(), &KateBuffer::textRemoved, this, &KateCompletionWidget::removeText);
+    connect(&view()->doc()->buffer(), &KateBuffer::linesRemoved, this, &KateCompletionWidget::removeLines);
 
     // This is a non-focus widget, it is passed keyboard input from the view
 
@@ -1370,6 +1372,15 @@ void KateCompletionWidget::wrapLine(const KTextEditor::Cursor &)
     m_automaticInvocationTimer->stop();
 }
 
+void KateCompletionWidget::insertLines(const KTextEditor::Cursor &, const QStringList &)
+{
+    m_lastInsertionByUser = !m_completionEditRunning;
+
+    // lines inserted, like wrap line, be done
+    m_automaticInvocationLine.clear();
+    m_automaticInvocationTimer->stop();
+}
+
 void KateCompletionWidget::unwrapLine(int)
 {
     m_lastInsertionByUser = !m_completionEditRunning;
@@ -1416,6 +1427,15 @@ void KateCompletionWidget::removeText(const KTextEditor::Range &)
     m_automaticInvocationTimer->stop();
 }
 
+void KateCompletionWidget::removeLines(const KTextEditor::Range &, const QStringList &)
+{
+    m_lastInsertionByUser = !m_completionEditRunning;
+
+    // lines removed, like unwrap line, be done
+    m_automaticInvocationLine.clear();
+    m_automaticInvocationTimer->stop();
+}
+
 void KateCompletionWidget::automaticInvocation()
 {
     // qCDebug(LOG_KTE)<<"m_automaticInvocationAt:"<<m_automaticInvocationAt;
@@ -172,7 +172,9 @@ private Q_SLOTS:
     void wrapLine(const KTextEditor::Cursor &position);
     void unwrapLine(int line);
     void insertText(const KTextEditor::Cursor &position, const QString &text);
+    void insertLines(const KTextEditor::Cursor &position, const QStringList &lines);
     void removeText(const KTextEditor::Range &range);
+    void removeLines(const KTextEditor::Range &range, const QStringList &lines);
 
 private:
     void updateAndShow();
@@ -19,6 +19,7 @@
 #include <KLocalizedString>
 
 #include <QDate>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QTextCodec>
@@ -30,6 +31,51 @@
  */
 static const int KATE_MAX_DYNAMIC_CONTEXTS = 512;
 
+/**
+ * Files of at least this size are loaded in large file mode, lines are decoded on demand
+ */
+static const qint64 KATE_LARGE_FILE_MODE_THRESHOLD = 128 * 1024 * 1024;
+
+/**
+ * Files of at least this size are decoded and split into lines by multiple threads
+ */
+static const qint64 KATE_PARALLEL_LOAD_THRESHOLD = 16 * 1024 * 1024;
+
+/**
+ * Lines to highlight at once for ensureHighlightedIncrementally(), farther away lines are highlighted in the background
+ */
+static const int KATE_HL_SYNC_LINES = 1024;
+
+/**
+ * Incremental highlighting: lines highlighted between checks of the time budget
+ */
+static const int KATE_HL_INCREMENTAL_LINES = 256;
+
+/**
+ * Incremental highlighting: time budget in milliseconds for one step, the event loop runs between the steps
+ */
+static const int KATE_HL_INCREMENTAL_TIME = 10;
+
+/**
+ * Lines at least this far behind the highlighted ones are highlighted speculatively by ensureHighlightedIncrementally()
+ */
+static const int KATE_HL_SPECULATIVE_DISTANCE = 8192;
+
+/**
+ * Lines highlighted speculatively before the wanted line, to let the state settle
+ */
+static const int KATE_HL_SPECULATIVE_LINES = 256;
+
+/**
+ * Lines after an edit to highlight until the state converges with the stored one, afterwards the rest is highlighted on demand
+ */
+static const int KATE_HL_CONVERGENCE_LINES = 4096;
+
+/**
+ * Search index: blocks indexed between checks of the time budget of KATE_HL_INCREMENTAL_TIME
+ */
+static const int KATE_SEARCH_INDEX_INCREMENTAL_BLOCKS = 64;
+
 /**
  * Create an empty buffer. (with one block with one empty line)
  */
@@ -42,8 +88,23 @@ KateBuffer::KateBuffer(KTextEditor::DocumentPrivate *doc)
     , m_highlight(nullptr)
     , m_tabWidth(8)
     , m_lineHighlighted(0)
+    , m_highlightTarget(-1)
+    , m_speculativeStart(-1)
+    , m_speculativeEnd(-1)
     , m_maxDynamicContexts(KATE_MAX_DYNAMIC_CONTEXTS)
 {
+    // incremental highlighting runs whenever the event loop is idle
+    m_highlightTimer.setSingleShot(true);
+    m_highlightTimer.setInterval(0);
+    connect(&m_highlightTimer, &QTimer::timeout, this, &KateBuffer::highlightIncrementally);
+
+    // the search index is built whenever the event loop is idle, too
+    m_searchIndexTimer.setSingleShot(true);
+    m_searchIndexTimer.setInterval(0);
+    connect(&m_searchIndexTimer, &QTimer::timeout, this, &KateBuffer::buildSearchIndexIncrementally);
+
+    // huge files are only indexed on load
+    setLargeFileModeThreshold(KATE_LARGE_FILE_MODE_THRESHOLD);
 }
 
 /**
@@ -77,7 +138,40 @@ void KateBuffer::editEnd()
     Q_ASSERT(editingMaximalLineChanged() != -1);
     Q_ASSERT(editingMinimalLineChanged() <= editingMaximalLineChanged());
 
+    // line numbers of the speculative highlighting are no longer right
+    m_speculativeStart = m_speculativeEnd = -1;
+
     updateHighlighting();
+
+    // new blocks need a search index
+    if (searchIndexEnabled() && !searchIndexComplete() && !m_searchIndexTimer.isActive()) {
+        m_searchIndexTimer.start();
+    }
+}
+
+void KateBuffer::updateSearchIndex()
+{
+    setSearchIndexMemoryLimit(qint64(m_doc->config()->searchIndexMemoryLimit()) * 1024 * 1024);
+    setSearchIndexEnabled(m_doc->config()->searchIndex());
+    if (searchIndexEnabled() && !searchIndexComplete() && !m_searchIndexTimer.isActive()) {
+        m_searchIndexTimer.start();
+    }
+}
+
+void KateBuffer::buildSearchIndexIncrementally()
+{
+    // index chunks of blocks until the time budget is used up
+    QElapsedTimer timer;
+    timer.start();
+    bool incomplete = false;
+    do {
+        incomplete = buildSearchIndex(KATE_SEARCH_INDEX_INCREMENTAL_BLOCKS);
+    } while (incomplete && timer.elapsed() < KATE_HL_INCREMENTAL_TIME);
+
+    // more to do?
+    if (incomplete) {
+        m_searchIndexTimer.start();
+    }
 }
 
 void KateBuffer::updateHighlighting()
@@ -118,6 +212,9 @@ void KateBuffer::clear()
 
     // back to line 0 with hl
     m_lineHighlighted = 0;
+    m_highlightTarget = -1;
+    m_highlightTimer.stop();
+    m_speculativeStart = m_speculativeEnd = -1;
 }
 
 bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
@@ -136,6 +233,9 @@ bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
     // line length limit
     setLineLengthLimit(m_doc->lineLengthLimit());
 
+    // big files are loaded by multiple threads
+    setParallelLoadThreshold(KATE_PARALLEL_LOAD_THRESHOLD);
+
     // then, try to load the file
     m_brokenEncoding = false;
     m_tooLongLinesWrapped = false;
@@ -183,6 +283,9 @@ bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
         m_doc->config()->setBom(true);
     }
 
+    // index the loaded text in the background
+    updateSearchIndex();
+
     // okay, loading did work
     return true;
 }
@@ -248,6 +351,7 @@ void KateBuffer::ensureHighlighted(int line, int lookAhead)
 
     // already hl up-to-date for this line?
     if (line < m_lineHighlighted) {
+        highlightLostLines(line);
         return;
     }
 
@@ -258,6 +362,120 @@ void KateBuffer::ensureHighlighted(int line, int lookAhead)
     doHighlight(m_lineHighlighted, end, false);
 }
 
+bool KateBuffer::ensureHighlightedIncrementally(int line, int lookAhead)
+{
+    // valid line at all?
+    if (line < 0 || line >= lines()) {
+        return false;
+    }
+
+    // already hl up-to-date for this line?
+    if (line < m_lineHighlighted) {
+        highlightLostLines(line);
+        return true;
+    }
+
+    // near enough, do it at once
+    if (line - m_lineHighlighted < KATE_HL_SYNC_LINES) {
+        ensureHighlighted(line, lookAhead);
+        return true;
+    }
+
+    // too far away, highlight in the background up to the farthest wanted line
+    const int end = qMin(line + lookAhead, lines() - 1);
+    m_highlightTarget = qMax(m_highlightTarget, end);
+    if (!m_highlightTimer.isActive()) {
+        m_highlightTimer.start();
+    }
+
+    // very far away, don't wait for the background highlighting, guess
+    if (line - m_lineHighlighted >= KATE_HL_SPECULATIVE_DISTANCE) {
+        if (line < m_speculativeStart || line > m_speculativeEnd) {
+            doSpeculativeHighlight(qMax(m_lineHighlighted, line - KATE_HL_SPECULATIVE_LINES), end);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void KateBuffer::doSpeculativeHighlight(int from, int to)
+{
+    // no hl around, no stuff to do
+    if (!m_highlight || m_highlight->noHighlighting()) {
+        return;
+    }
+
+    // the line before still has the state of some older highlighting or the default state, this is our checkpoint
+    Kate::TextLine prevLine = (from >= 1) ? plainLine(from - 1) : Kate::TextLine();
+    Kate::TextLine textLine = plainLine(from);
+    for (int line = from; line <= to; ++line) {
+        const Kate::TextLine nextLine = ((line + 1) < lines()) ? plainLine(line + 1) : Kate::emptyTextLine();
+
+        bool ctxChanged = false;
+        m_highlight->doHighlight(prevLine.data(), textLine.data(), nextLine.data(), ctxChanged, tabWidth());
+
+        prevLine = textLine;
+        textLine = nextLine;
+    }
+
+    // remember the range, we don't want to do it again for each line
+    m_speculativeStart = from;
+    m_speculativeEnd = to;
+}
+
+void KateBuffer::highlightLostLines(int line)
+{
+    // only highlighted lines can lose their highlighting
+    int from = 0;
+    int to = 0;
+    if (!m_highlight || m_highlight->noHighlighting() || line < 0 || line >= m_lineHighlighted || !takeLostHighlighting(line, from, to)) {
+        return;
+    }
+
+    // the state at the end of each evicted block was kept, the block in front provides the start state
+    to = qMin(to, m_lineHighlighted - 1);
+    Kate::TextLine prevLine = (from >= 1) ? plainLine(from - 1) : Kate::TextLine();
+    Kate::TextLine textLine = plainLine(from);
+    for (int current = from; current <= to; ++current) {
+        const Kate::TextLine nextLine = ((current + 1) < lines()) ? plainLine(current + 1) : Kate::emptyTextLine();
+
+        bool ctxChanged = false;
+        m_highlight->doHighlight(prevLine.data(), textLine.data(), nextLine.data(), ctxChanged, tabWidth());
+
+        prevLine = textLine;
+        textLine = nextLine;
+    }
+}
+
+void KateBuffer::highlightIncrementally()
+{
+    // edits might have removed lines or highlighted them already, edits before m_lineHighlighted restart from there
+    m_highlightTarget = qMin(m_highlightTarget, lines() - 1);
+    if (!m_highlight || m_highlight->noHighlighting() || m_highlightTarget < m_lineHighlighted) {
+        m_highlightTarget = -1;
+        return;
+    }
+
+    // highlight chunks until the time budget is used up
+    const int startLine = m_lineHighlighted;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        doHighlight(m_lineHighlighted, qMin(m_lineHighlighted + KATE_HL_INCREMENTAL_LINES - 1, m_highlightTarget), false);
+    } while (m_lineHighlighted <= m_highlightTarget && timer.elapsed() < KATE_HL_INCREMENTAL_TIME);
+
+    // views must render the lines highlighted now, only the ones showing some of them need a repaint
+    m_doc->repaintLines({startLine, m_lineHighlighted - 1});
+
+    // more to do?
+    if (m_lineHighlighted <= m_highlightTarget) {
+        m_highlightTimer.start();
+    } else {
+        m_highlightTarget = -1;
+    }
+}
+
 void KateBuffer::wrapLine(const KTextEditor::Cursor &position)
 {
     // call original
@@ -268,6 +486,28 @@ void KateBuffer::wrapLine(const KTextEditor::Cursor &position)
     }
 }
 
+void KateBuffer::insertLines(const KTextEditor::Cursor &position, const QStringList &lines)
+{
+    // call original
+    Kate::TextBuffer::insertLines(position, lines);
+
+    if (m_lineHighlighted > position.line() + 1) {
+        m_lineHighlighted += lines.size() - 1;
+    }
+}
+
+void KateBuffer::removeLines(const KTextEditor::Range &range)
+{
+    // call original
+    Kate::TextBuffer::removeLines(range);
+
+    if (m_lineHighlighted > range.end().line()) {
+        m_lineHighlighted -= range.end().line() - range.start().line();
+    } else if (m_lineHighlighted > range.start().line() + 1) {
+        m_lineHighlighted = range.start().line() + 1;
+    }
+}
+
 void KateBuffer::unwrapLine(int line)
 {
     // reimplemented, so first call original
@@ -321,6 +561,7 @@ void KateBuffer::setHighlight(int hlMode)
 void KateBuffer::invalidateHighlighting()
 {
     m_lineHighlighted = 0;
+    m_speculativeStart = m_speculativeEnd = -1;
 }
 
 void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
@@ -338,6 +579,8 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
 #endif
 
     // if possible get previous line, otherwise create 0 line.
+    // its state must be there, even if its block got evicted
+    highlightLostLines(startLine - 1);
     Kate::TextLine prevLine = (startLine >= 1) ? plainLine(startLine - 1) : Kate::TextLine();
 
     // here we are atm, start at start line in the block
@@ -347,14 +590,19 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
     bool ctxChanged = false;
     Kate::TextLine textLine = plainLine(current_line);
     Kate::TextLine nextLine;
+
+    // the end of line state stored for each already highlighted line serves as checkpoint:
+    // after the given range continue while the new state differs from it, once equal the following lines are still valid
+    const int convergenceEnd = qMin(qMin(m_lineHighlighted, lines()), endLine + 1 + KATE_HL_CONVERGENCE_LINES);
+
     // loop over the lines of the block, from startline to endline or end of block
     // if stillcontinue forces us to do so
-    for (; current_line < qMin(endLine + 1, lines()); ++current_line) {
+    for (; (current_line < qMin(endLine + 1, lines())) || (ctxChanged && current_line < convergenceEnd); ++current_line) {
         // get next line, if any
         if ((current_line + 1) < lines()) {
             nextLine = plainLine(current_line + 1);
         } else {
-            nextLine = Kate::TextLine(new Kate::TextLineData());
+            nextLine = Kate::emptyTextLine();
         }
 
         ctxChanged = false;
@@ -491,7 +739,7 @@ KTextEditor::Range KateBuffer::computeFoldingRangeForStartLine(int startLine)
 
         // walk over all attributes of the line and compute the matchings
         const auto &startLineAttributes = startTextLine->foldings();
-        for (size_t i = 0; i < startLineAttributes.size(); ++i) {
+        for (int i = 0; i < startLineAttributes.size(); ++i) {
             // folding close?
             if (startLineAttributes[i].foldingValue < 0) {
                 // search for this type, try to decrement counter, perhaps erase element!
@@ -542,7 +790,7 @@ KTextEditor::Range KateBuffer::computeFoldingRangeForStartLine(int startLine)
 
         // search for matching end marker
         const auto &lineAttributes = textLine->foldings();
-        for (size_t i = 0; i < lineAttributes.size(); ++i) {
+        for (int i = 0; i < lineAttributes.size(); ++i) {
             // matching folding close?
             if (lineAttributes[i].foldingValue == -openedRegionType) {
                 --countOfOpenRegions;
@@ -13,6 +13,7 @@
 #include <ktexteditor_export.h>
 
 #include <QObject>
+#include <QTimer>
 
 class KateLineInfo;
 namespace KTextEditor
@@ -97,6 +98,11 @@ public:
         return editingChangedNumberOfLines() != 0;
     }
 
+    /**
+     * Enable or disable the search index as configured for the document, an incomplete index is built in the background.
+     */
+    void updateSearchIndex();
+
 public:
     /**
      * Clear the buffer.
@@ -173,6 +179,19 @@ public:
      */
     void ensureHighlighted(int line, int lookAhead = 64);
 
+    /**
+     * Update highlighting of given line @p line, if needed, without blocking for long.
+     * Like @ref ensureHighlighted, if @p line is near enough to the already highlighted lines.
+     * Otherwise the lines up to line + lookAhead are highlighted incrementally in the background,
+     * tagLines() is emitted for the lines that got highlighted meanwhile.
+     * Lines very far away are highlighted speculatively at once, starting with the state that is still stored
+     * for the lines before them, the background highlighting corrects them later.
+     * Use this for rendering, not yet highlighted lines can be shown without attributes.
+     * @param lookAhead also highlight these following lines
+     * @return is @p line highlighted now, at least speculatively?
+     */
+    bool ensureHighlightedIncrementally(int line, int lookAhead = 64);
+
     /**
      * Return the total number of lines in the buffer.
      */
@@ -193,6 +212,19 @@ public:
      */
     void wrapLine(const KTextEditor::Cursor &position) override;
 
+    /**
+     * Insert multiple lines at given cursor position.
+     * @param position position where to insert the first line
+     * @param lines lines to insert
+     */
+    void insertLines(const KTextEditor::Cursor &position, const QStringList &lines) override;
+
+    /**
+     * Remove text spanning multiple lines.
+     * @param range range of text to remove
+     */
+    void removeLines(const KTextEditor::Range &range) override;
+
 public:
     inline int tabWidth() const
     {
@@ -239,6 +271,35 @@ private:
      */
     void doHighlight(int from, int to, bool invalidate);
 
+    /**
+     * Highlight the given lines without touching m_lineHighlighted.
+     * Starts with the state stored for the line before @p from, the result is corrected once
+     * the normal highlighting arrives at these lines.
+     * @param from first line in range
+     * @param to last line in range
+     */
+    void doSpeculativeHighlight(int from, int to);
+
+    /**
+     * Large file mode: highlight the already highlighted lines of the block of @p line again,
+     * if they lost their highlighting by eviction.
+     * @param line line to check
+     */
+    void highlightLostLines(int line);
+
+private Q_SLOTS:
+    /**
+     * Highlight the next lines up to m_highlightTarget, as long as the time budget allows.
+     * Restarts itself until the target is reached.
+     */
+    void highlightIncrementally();
+
+    /**
+     * Index the blocks without search index, as long as the time budget allows.
+     * Restarts itself until the index is complete.
+     */
+    void buildSearchIndexIncrementally();
+
 Q_SIGNALS:
     /**
      * Emitted when the highlighting of a certain range has
@@ -281,6 +342,27 @@ private:
      */
     int m_lineHighlighted;
 
+    /**
+     * last line to highlight incrementally, -1 if none
+     */
+    int m_highlightTarget;
+
+    /**
+     * timer for the incremental highlighting
+     */
+    QTimer m_highlightTimer;
+
+    /**
+     * timer for building the search index in the background
+     */
+    QTimer m_searchIndexTimer;
+
+    /**
+     * lines highlighted speculatively by the last doSpeculativeHighlight(), -1 if none
+     */
+    int m_speculativeStart;
+    int m_speculativeEnd;
+
     /**
      * number of dynamic contexts causing a full invalidation
      */
@@ -26,6 +26,7 @@
 #include "katepartdebug.h"
 #include "kateplaintextsearch.h"
 #include "kateregexpsearch.h"
+#include "katesearchjob.h"
 #include "katerenderer.h"
 #include "katescriptmanager.h"
 #include "kateswapfile.h"
@@ -90,6 +91,12 @@
     qCDebug(LOG_KTE)
 #endif
 
+/**
+ * Inserts of at least this many lines are done with one editInsertMultiLineText() call,
+ * instead of editInsertText() and editWrapLine() for each line.
+ */
+static const int KATE_MULTI_LINE_INSERT_THRESHOLD = 64;
+
 template<class C, class E> static int indexOf(const std::initializer_list<C> &list, const E &entry)
 {
     auto it = std::find(list.begin(), list.end(), entry);
@@ -739,6 +746,13 @@ bool KTextEditor::DocumentPrivate::insertText(const KTextEditor::Cursor &positio
         }
     }
 
+    // many lines: splice them into the buffer at once
+    if (!block && text.count(QLatin1Char('\n')) + 1 >= KATE_MULTI_LINE_INSERT_THRESHOLD) {
+        editInsertMultiLineText(currentLine, insertColumn, text.split(QLatin1Char('\n')));
+        editEnd();
+        return true;
+    }
+
     // compute expanded column for block mode
     int positionColumnExpanded = insertColumn;
     const int tabWidth = config()->tabWidth();
@@ -889,6 +903,23 @@ bool KTextEditor::DocumentPrivate::insertLines(int line, const QStringList &text
         return false;
     }
 
+    // many lines: insert them at once behind the end of the previous line, like editInsertLine() does for each line,
+    // that way the given line with its mark, cursors and modification flags just moves down
+    if (text.size() >= KATE_MULTI_LINE_INSERT_THRESHOLD) {
+        editStart();
+        int previousLine = line - 1;
+        QStringList lines = QStringList(QString()) << text;
+        if (line == 0) {
+            // no line in front of the first one, insert the first line on its own
+            editInsertLine(0, text.first());
+            previousLine = 0;
+            lines.removeAt(1);
+        }
+        const bool success = editInsertMultiLineText(previousLine, lineLength(previousLine), lines, true);
+        editEnd();
+        return success;
+    }
+
     bool success = true;
     for (const QString &string : text) {
         success &= editInsertLine(line++, string);
@@ -1317,6 +1348,214 @@ bool KTextEditor::DocumentPrivate::editInsertText(int line, int col, const QStri
     return true;
 }
 
+bool KTextEditor::DocumentPrivate::editInsertMultiLineText(int line, int col, const QStringList &lines, bool wholeLines)
+{
+    // verbose debug
+    EDIT_DEBUG << "editInsertMultiLineText" << line << col << lines.size();
+
+    if (line < 0 || col < 0) {
+        return false;
+    }
+
+    if (!isReadWrite()) {
+        return false;
+    }
+
+    Kate::TextLine l = kateTextLine(line);
+
+    if (!l) {
+        return false;
+    }
+
+    // nothing to wrap, just insert the text
+    if (lines.size() < 2) {
+        return editInsertText(line, col, lines.value(0));
+    }
+
+    editStart();
+
+    QStringList lines2 = lines;
+    int col2 = col;
+    if (col2 > l->length()) {
+        lines2.first().prepend(QString(col2 - l->length(), QLatin1Char(' ')));
+        col2 = l->length();
+    }
+
+    m_undoManager->slotMultiLineTextInserted(line, col2, lines2);
+
+    // remember last change cursor
+    m_editLastChangeStartCursor = KTextEditor::Cursor(line, col2);
+
+    // insert all lines into the buffer at once
+    m_buffer->insertLines(m_editLastChangeStartCursor, lines2);
+
+    // move the marks behind the first wrap, like editWrapLine() or editInsertLine() would do for each line
+    const int newLines = lines2.size() - 1;
+    const int firstWrapColumn = col2 + lines2.first().size();
+    QList<KTextEditor::Mark *> list;
+    for (QHash<int, KTextEditor::Mark *>::const_iterator i = m_marks.constBegin(); i != m_marks.constEnd(); ++i) {
+        if (i.value()->line >= line) {
+            if ((firstWrapColumn == 0 && !wholeLines) || (i.value()->line > line)) {
+                list.append(i.value());
+            }
+        }
+    }
+
+    for (int i = 0; i < list.size(); ++i) {
+        m_marks.take(list.at(i)->line);
+    }
+
+    for (int i = 0; i < list.size(); ++i) {
+        list.at(i)->line += newLines;
+        m_marks.insert(list.at(i)->line, list.at(i));
+    }
+
+    if (!list.isEmpty()) {
+        Q_EMIT marksChanged(this);
+    }
+
+    Q_EMIT textInserted(this, KTextEditor::Range(line, col2, line + newLines, lines2.back().size()));
+
+    editEnd();
+
+    return true;
+}
+
+bool KTextEditor::DocumentPrivate::editRemoveMultiLineText(const KTextEditor::Range &range)
+{
+    // verbose debug
+    EDIT_DEBUG << "editRemoveMultiLineText" << range;
+
+    const int line = range.start().line();
+    const int lastLine = range.end().line();
+    if (line < 0 || lastLine > this->lastLine() || range.start().column() < 0 || range.end().column() < 0) {
+        return false;
+    }
+
+    if (!isReadWrite()) {
+        return false;
+    }
+
+    // nothing to unwrap, just remove the text
+    if (lastLine == line) {
+        return editRemoveText(line, range.start().column(), range.end().column() - range.start().column());
+    }
+
+    if (range.start().column() > lineLength(line) || range.end().column() > lineLength(lastLine)) {
+        return false;
+    }
+
+    // the removal is not recorded, see above
+    Q_ASSERT(!m_undoManager->isActive());
+
+    editStart();
+
+    // remove all lines from the buffer at once
+    const QString oldText = text(range);
+    m_buffer->removeLines(range);
+
+    // handle the marks like editRemoveLines() and editUnWrapLine() would do for each line:
+    // marks of the removed lines are deleted, the one of the last line is joined with the one of the first line
+    const int removedLines = lastLine - line;
+    QList<KTextEditor::Mark *> list;
+    QList<KTextEditor::Mark *> removedMarks;
+    for (QHash<int, KTextEditor::Mark *>::const_iterator i = m_marks.constBegin(); i != m_marks.constEnd(); ++i) {
+        if (i.value()->line >= lastLine) {
+            list.append(i.value());
+        } else if (i.value()->line > line) {
+            removedMarks.append(i.value());
+        }
+    }
+
+    for (KTextEditor::Mark *mark : qAsConst(removedMarks)) {
+        delete m_marks.take(mark->line);
+    }
+
+    for (int i = 0; i < list.size(); ++i) {
+        m_marks.take(list.at(i)->line);
+    }
+
+    for (int i = 0; i < list.size(); ++i) {
+        if (list.at(i)->line == lastLine) {
+            if (KTextEditor::Mark *mark = m_marks.take(line)) {
+                list.at(i)->type |= mark->type;
+                delete mark;
+            }
+        }
+        list.at(i)->line -= removedLines;
+        m_marks.insert(list.at(i)->line, list.at(i));
+    }
+
+    if (!list.isEmpty() || !removedMarks.isEmpty()) {
+        Q_EMIT marksChanged(this);
+    }
+
+    // remember last change cursor
+    m_editLastChangeStartCursor = range.start();
+
+    Q_EMIT textRemoved(this, range, oldText);
+
+    editEnd();
+
+    return true;
+}
+
+bool KTextEditor::DocumentPrivate::editReplaceText(int line, int col, int len, const QString &s)
+{
+    // verbose debug
+    EDIT_DEBUG << "editReplaceText" << line << col << len << s;
+
+    if (line < 0 || col < 0 || len < 0) {
+        return false;
+    }
+
+    if (!isReadWrite()) {
+        return false;
+    }
+
+    Kate::TextLine l = kateTextLine(line);
+
+    if (!l) {
+        return false;
+    }
+
+    // wrong column
+    if (col > l->text().size()) {
+        return false;
+    }
+
+    // don't try to replace what's not there
+    len = qMin(len, l->text().size() - col);
+
+    // nothing to do, do nothing!
+    if (len == 0 && s.isEmpty()) {
+        return true;
+    }
+
+    editStart();
+
+    QString oldText = l->string().mid(col, len);
+
+    m_undoManager->slotTextReplaced(line, col, oldText, s);
+
+    // remember last change cursor
+    m_editLastChangeStartCursor = KTextEditor::Cursor(line, col);
+
+    // replace the text in the line
+    if (len > 0) {
+        m_buffer->removeText(KTextEditor::Range(m_editLastChangeStartCursor, KTextEditor::Cursor(line, col + len)));
+        Q_EMIT textRemoved(this, KTextEditor::Range(line, col, line, col + len), oldText);
+    }
+    if (!s.isEmpty()) {
+        m_buffer->insertText(m_editLastChangeStartCursor, s);
+        Q_EMIT textInserted(this, KTextEditor::Range(line, col, line, col + s.length()));
+    }
+
+    editEnd();
+
+    return true;
+}
+
 bool KTextEditor::DocumentPrivate::editRemoveText(int line, int col, int len)
 {
     // verbose debug
@@ -1747,8 +1986,10 @@ KTextEditor::DocumentPrivate::searchText(const KTextEditor::Range &range, const
         if (caseSensitivity == Qt::CaseInsensitive) {
             patternOptions |= QRegularExpression::CaseInsensitiveOption;
         }
-        KateRegExpSearch searcher(this);
-        return searcher.search(pattern, range, backwards, patternOptions);
+        if (!m_regExpSearch) {
+            m_regExpSearch.reset(new KateRegExpSearch(this));
+        }
+        return m_regExpSearch->search(pattern, range, backwards, patternOptions);
     }
 
     if (escapeSequences) {
@@ -1769,6 +2010,12 @@ KTextEditor::DocumentPrivate::searchText(const KTextEditor::Range &range, const
     result.append(match);
     return result;
 }
+
+KateSearchJob *
+KTextEditor::DocumentPrivate::searchTextAsync(const KTextEditor::Range &range, const QString &pattern, const KTextEditor::SearchOptions options, int maxMatches)
+{
+    return new KateSearchJob(this, range, pattern, options, maxMatches);
+}
 // END
 
 QWidget *KTextEditor::DocumentPrivate::dialogParent()
@@ -2538,8 +2785,10 @@ bool KTextEditor::DocumentPrivate::saveFile()
         return false;
     }
 
-    // update the checksum
-    createDigest();
+    // update the checksum, the buffer computed it while writing if possible, no need to read the file again
+    if (m_buffer->digest().isEmpty() || !url().isLocalFile()) {
+        createDigest();
+    }
 
     // add m_file again to dirwatch
     activateDirWatch();
@@ -3339,7 +3588,7 @@ void KTextEditor::DocumentPrivate::backspace(KTextEditor::ViewPrivate *view, con
                     beginCursor.setColumn(col - 2);
                 }
             } else {
-                beginCursor.setColumn(view->textLayout(c)->previousCursorPosition(c.column()));
+                beginCursor.setColumn(view->previousCursorPosition(c));
             }
             removeText(KTextEditor::Range(beginCursor, endCursor));
             // in most cases cursor is moved by removeText, but we should do it manually
@@ -3387,7 +3636,7 @@ void KTextEditor::DocumentPrivate::del(KTextEditor::ViewPrivate *view, const KTe
     }
 
     if (c.column() < (int)m_buffer->plainLine(c.line())->length()) {
-        KTextEditor::Cursor endCursor(c.line(), view->textLayout(c)->nextCursorPosition(c.column()));
+        KTextEditor::Cursor endCursor(c.line(), view->nextCursorPosition(c));
         removeText(KTextEditor::Range(c, endCursor));
     } else if (c.line() < lastLine()) {
         removeText(KTextEditor::Range(c.line(), c.column(), c.line() + 1, 0));
@@ -4115,6 +4364,15 @@ void KTextEditor::DocumentPrivate::repaintViews(bool paintOnlyDirty)
     }
 }
 
+void KTextEditor::DocumentPrivate::repaintLines(KTextEditor::LineRange lineRange)
+{
+    for (auto view : qAsConst(m_views)) {
+        if (view->tagLines(lineRange, true)) {
+            view->repaintText(true);
+        }
+    }
+}
+
 /*
    Bracket matching uses the following algorithm:
    If in overwrite mode, match the bracket currently underneath the cursor.
@@ -4563,6 +4821,9 @@ void KTextEditor::DocumentPrivate::updateConfig()
     // set tab width there, too
     m_buffer->setTabWidth(config()->tabWidth());
 
+    // search index on or off
+    m_buffer->updateSearchIndex();
+
     // update all views, does tagAll and updateView...
     for (auto view : qAsConst(m_views)) {
         view->updateDocumentConfig();
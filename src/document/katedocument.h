@@ -14,6 +14,8 @@
 #include <QStack>
 #include <QTimer>
 
+#include <memory>
+
 #include <KJob>
 
 #include <ktexteditor/annotationinterface.h>
@@ -56,6 +58,8 @@ class KateDocumentConfig;
 class KateHighlighting;
 class KateUndoManager;
 class KateOnTheFlyChecker;
+class KateRegExpSearch;
+class KateSearchJob;
 class KateDocumentTest;
 
 class KateAutoIndent;
@@ -260,6 +264,18 @@ public:
      */
     bool editInsertText(int line, int col, const QString &s);
 
+    /**
+     * Add multiple lines of text in the given line/column, in one go.
+     * Same result as editInsertText() and editWrapLine() for each line, but with just one buffer change and undo item.
+     * @param line line number
+     * @param col column
+     * @param lines lines to be inserted, the rest of the line is appended to the last one
+     * @param wholeLines the lines are inserted as whole lines behind \p line, like editInsertLine() does:
+     *        the mark of \p line stays even if the first wrap is at column 0
+     * @return true on success
+     */
+    bool editInsertMultiLineText(int line, int col, const QStringList &lines, bool wholeLines = false);
+
     /**
      * Remove a string in the given line/column
      * @param line line number
@@ -269,6 +285,26 @@ public:
      */
     bool editRemoveText(int line, int col, int len);
 
+    /**
+     * Remove text spanning multiple lines, in one go, to undo editInsertMultiLineText().
+     * Same result as editRemoveText() and editUnWrapLine() for each line, but with just one buffer change.
+     * The removal is not recorded for undo, only call this while the undo manager replays its history.
+     * @param range range of text to remove, must span at least two lines
+     * @return true on success
+     */
+    bool editRemoveMultiLineText(const KTextEditor::Range &range);
+
+    /**
+     * Replace a string in the given line/column by another one, in one go.
+     * Same result as editRemoveText() and editInsertText(), but with just one undo item.
+     * @param line line number
+     * @param col column
+     * @param len length of text to be replaced
+     * @param s string to be inserted instead, must not contain new lines
+     * @return true on success
+     */
+    bool editReplaceText(int line, int col, int len, const QString &s);
+
     /**
      * Mark @p line as @p autowrapped. This is necessary if static word warp is
      * enabled, because we have to know whether to insert a new line or add the
@@ -409,6 +445,25 @@ Q_SIGNALS:
 public:
     QVector<KTextEditor::Range> searchText(const KTextEditor::Range &range, const QString &pattern, const KTextEditor::SearchOptions options) const;
 
+    /**
+     * Search like searchText(), but in another thread, on snapshots of the lines of \p range taken as the search proceeds.
+     * The job reports its progress and can be canceled. Its matches are ranges at the revision the search started at,
+     * KateSearchJob::transformedRanges() transforms them to the revision the document has once the search is done.
+     *
+     * \param range range to search in
+     * \param pattern text or regular expression to search for
+     * \param options search options, like for searchText()
+     * \param maxMatches stop after this number of matches, -1 for no limit
+     * \return the running search, owned by the caller, deleting it cancels the search
+     */
+    KateSearchJob *searchTextAsync(const KTextEditor::Range &range, const QString &pattern, const KTextEditor::SearchOptions options, int maxMatches = 1);
+
+private:
+    /**
+     * regular expression search of searchText(), it keeps the compiled pattern of the last search
+     */
+    mutable std::unique_ptr<KateRegExpSearch> m_regExpSearch;
+
 private:
     /**
      * Return a widget suitable to be used as a dialog parent.
@@ -811,6 +866,9 @@ public:
     // Repaint all of all of the views
     void repaintViews(bool paintOnlyDirty = true);
 
+    // Tag the lines in all views, repaint only the views that show some of them
+    void repaintLines(KTextEditor::LineRange lineRange);
+
     KateHighlighting *highlight() const;
 
 public Q_SLOTS:
@@ -1095,6 +1153,11 @@ public:
         return *m_buffer;
     }
 
+    const KateBuffer &buffer() const
+    {
+        return *m_buffer;
+    }
+
     /**
      * set indentation mode by user
      * this will remember that a user did set it and will avoid reset on save
@@ -8,11 +8,13 @@
 #include "katelayoutcache.h"
 
 #include <QtAlgorithms>
+#include <QtMath>
 
 #include "katebuffer.h"
 #include "katedocument.h"
 #include "katepartdebug.h"
 #include "katerenderer.h"
+#include "katetextfolding.h"
 #include "kateview.h"
 
 namespace
@@ -87,6 +89,19 @@ void KateLineLayoutMap::relayoutLines(int startRealLine, int endRealLine)
     }
 }
 
+bool KateLineLayoutMap::setVisibleX(int x, int width)
+{
+    bool relayout = false;
+    for (LineLayoutPair &pair : m_lineLayouts) {
+        pair.second->setVisibleX(x, width);
+        if (pair.second->isValid() && !pair.second->windowIncludesVisibleX()) {
+            pair.second->setLayoutDirty();
+            relayout = true;
+        }
+    }
+    return relayout;
+}
+
 void KateLineLayoutMap::slotEditDone(int fromLine, int toLine, int shiftAmount)
 {
     LineLayoutMap::iterator start = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(fromLine, KateLineLayoutPtr()), lessThan);
@@ -119,6 +134,260 @@ KateLineLayoutPtr &KateLineLayoutMap::operator[](int i)
 }
 // END KateLineLayoutMap
 
+// BEGIN KateViewLineIndex
+namespace
+{
+void fenwickAdd(std::vector<int> &tree, int index, int delta)
+{
+    const int size = tree.size();
+    for (int i = index + 1; i < size; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+int fenwickSum(const std::vector<int> &tree, int count)
+{
+    int sum = 0;
+    for (int i = count; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ * The most elements in front whose values sum up to at most \p value, \p value gets the remainder.
+ */
+int fenwickFind(const std::vector<int> &tree, int &value)
+{
+    const int count = static_cast<int>(tree.size()) - 1;
+    int step = 1;
+    while (step * 2 <= count) {
+        step *= 2;
+    }
+
+    int index = 0;
+    for (; step > 0; step /= 2) {
+        if (index + step <= count && tree[index + step] <= value) {
+            index += step;
+            value -= tree[index];
+        }
+    }
+    return index;
+}
+}
+
+void KateViewLineIndex::clear()
+{
+    m_chunks.clear();
+    m_lineTree.clear();
+    m_viewLineTree.clear();
+    m_lines = 0;
+    m_valid = false;
+}
+
+int KateViewLineIndex::chunkForLine(int &line) const
+{
+    int chunk = fenwickFind(m_lineTree, line);
+
+    // behind the last line: the end of the last chunk
+    if (chunk >= static_cast<int>(m_chunks.size())) {
+        chunk = m_chunks.size() - 1;
+        line = m_chunks[chunk].lines.size();
+    }
+    return chunk;
+}
+
+void KateViewLineIndex::rebuildChunks()
+{
+    std::vector<Chunk> chunks;
+    for (Chunk &chunk : m_chunks) {
+        const int size = chunk.lines.size();
+        if (size <= 2 * ChunkSize) {
+            if (size > 0) {
+                chunks.push_back(std::move(chunk));
+            }
+            continue;
+        }
+
+        for (int start = 0; start < size; start += ChunkSize) {
+            Chunk part;
+            part.lines.assign(chunk.lines.begin() + start, chunk.lines.begin() + qMin(size, start + ChunkSize));
+            for (const ViewLines &viewLines : part.lines) {
+                part.viewLines += viewLines.visible ? viewLines.count : 0;
+            }
+            chunks.push_back(std::move(part));
+        }
+    }
+    m_chunks = std::move(chunks);
+
+    // linear construction: each node adds its sum to its parent
+    const int count = m_chunks.size();
+    m_lineTree.assign(count + 1, 0);
+    m_viewLineTree.assign(count + 1, 0);
+    for (int i = 1; i <= count; ++i) {
+        m_lineTree[i] += m_chunks[i - 1].lines.size();
+        m_viewLineTree[i] += m_chunks[i - 1].viewLines;
+        const int parent = i + (i & -i);
+        if (parent <= count) {
+            m_lineTree[parent] += m_lineTree[i];
+            m_viewLineTree[parent] += m_viewLineTree[i];
+        }
+    }
+}
+
+void KateViewLineIndex::insertLines(int line, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    // first lines: one empty chunk to insert into
+    if (m_chunks.empty()) {
+        m_chunks.emplace_back();
+        m_lineTree.assign(2, 0);
+        m_viewLineTree.assign(2, 0);
+    }
+
+    const int chunkIndex = chunkForLine(line);
+    Chunk &chunk = m_chunks[chunkIndex];
+    chunk.lines.insert(chunk.lines.begin() + line, count, ViewLines{1, true});
+    chunk.viewLines += count;
+    m_lines += count;
+
+    if (static_cast<int>(chunk.lines.size()) > 2 * ChunkSize) {
+        rebuildChunks();
+    } else {
+        fenwickAdd(m_lineTree, chunkIndex, count);
+        fenwickAdd(m_viewLineTree, chunkIndex, count);
+    }
+}
+
+void KateViewLineIndex::removeLines(int line, int count)
+{
+    bool emptyChunks = false;
+    while (count > 0) {
+        int start = line;
+        const int chunkIndex = chunkForLine(start);
+        Chunk &chunk = m_chunks[chunkIndex];
+        const int removed = qMin(count, static_cast<int>(chunk.lines.size()) - start);
+
+        int viewLines = 0;
+        for (int i = start; i < start + removed; ++i) {
+            viewLines += chunk.lines[i].visible ? chunk.lines[i].count : 0;
+        }
+        chunk.lines.erase(chunk.lines.begin() + start, chunk.lines.begin() + start + removed);
+        chunk.viewLines -= viewLines;
+        fenwickAdd(m_lineTree, chunkIndex, -removed);
+        fenwickAdd(m_viewLineTree, chunkIndex, -viewLines);
+        emptyChunks = emptyChunks || chunk.lines.empty();
+        m_lines -= removed;
+        count -= removed;
+    }
+
+    if (emptyChunks) {
+        rebuildChunks();
+    }
+}
+
+int KateViewLineIndex::viewLineCount(int line) const
+{
+    const int chunk = chunkForLine(line);
+    return m_chunks[chunk].lines[line].count;
+}
+
+void KateViewLineIndex::setViewLineCount(int line, int count, bool visible)
+{
+    const int chunkIndex = chunkForLine(line);
+    ViewLines &viewLines = m_chunks[chunkIndex].lines[line];
+
+    // hidden lines have no view lines in the tree
+    const int delta = (visible ? count : 0) - (viewLines.visible ? viewLines.count : 0);
+    viewLines.count = count;
+    viewLines.visible = visible;
+    if (delta != 0) {
+        m_chunks[chunkIndex].viewLines += delta;
+        fenwickAdd(m_viewLineTree, chunkIndex, delta);
+    }
+}
+
+void KateViewLineIndex::rebuild(const QVector<int> &visibleLines)
+{
+    for (Chunk &chunk : m_chunks) {
+        for (ViewLines &viewLines : chunk.lines) {
+            viewLines.visible = false;
+        }
+    }
+
+    // the visible lines are sorted, walk the chunks along
+    int chunkIndex = 0;
+    int chunkStart = 0;
+    for (const int line : visibleLines) {
+        if (line >= m_lines) {
+            break;
+        }
+        while (line >= chunkStart + static_cast<int>(m_chunks[chunkIndex].lines.size())) {
+            chunkStart += m_chunks[chunkIndex].lines.size();
+            ++chunkIndex;
+        }
+        m_chunks[chunkIndex].lines[line - chunkStart].visible = true;
+    }
+
+    for (Chunk &chunk : m_chunks) {
+        chunk.viewLines = 0;
+        for (const ViewLines &viewLines : chunk.lines) {
+            chunk.viewLines += viewLines.visible ? viewLines.count : 0;
+        }
+    }
+    rebuildChunks();
+    m_valid = true;
+}
+
+int KateViewLineIndex::viewLines() const
+{
+    return fenwickSum(m_viewLineTree, m_chunks.size());
+}
+
+int KateViewLineIndex::viewLinesBefore(int line) const
+{
+    Q_ASSERT(m_valid);
+    if (m_lines == 0) {
+        return 0;
+    }
+
+    const int chunkIndex = chunkForLine(line);
+    int viewLines = fenwickSum(m_viewLineTree, chunkIndex);
+    const Chunk &chunk = m_chunks[chunkIndex];
+    for (int i = 0; i < line; ++i) {
+        viewLines += chunk.lines[i].visible ? chunk.lines[i].count : 0;
+    }
+    return viewLines;
+}
+
+int KateViewLineIndex::lineAt(int viewLine) const
+{
+    Q_ASSERT(m_valid);
+
+    // find the chunk, then the line in it
+    const int chunkIndex = fenwickFind(m_viewLineTree, viewLine);
+    if (chunkIndex >= static_cast<int>(m_chunks.size())) {
+        return m_lines;
+    }
+
+    const Chunk &chunk = m_chunks[chunkIndex];
+    const int chunkStart = fenwickSum(m_lineTree, chunkIndex);
+    for (int i = 0; i < static_cast<int>(chunk.lines.size()); ++i) {
+        if (!chunk.lines[i].visible) {
+            continue;
+        }
+        if (viewLine < chunk.lines[i].count) {
+            return chunkStart + i;
+        }
+        viewLine -= chunk.lines[i].count;
+    }
+    return m_lines;
+}
+// END KateViewLineIndex
+
 KateLayoutCache::KateLayoutCache(KateRenderer *renderer, QObject *parent)
     : QObject(parent)
     , m_renderer(renderer)
@@ -133,7 +402,12 @@ KateLayoutCache::KateLayoutCache(KateRenderer *renderer, QObject *parent)
     connect(&m_renderer->doc()->buffer(), &KateBuffer::lineWrapped, this, &KateLayoutCache::wrapLine);
     connect(&m_renderer->doc()->buffer(), &KateBuffer::lineUnwrapped, this, &KateLayoutCache::unwrapLine);
     connect(&m_renderer->doc()->buffer(), &KateBuffer::textInserted, this, &KateLayoutCache::insertText);
+    connect(&m_renderer->doc()->buffer(), &KateBuffer::linesInserted, this, &KateLayoutCache::insertLines);
     connect(&m_renderer->doc()->buffer(), &KateBuffer::textRemoved, this, &KateLayoutCache::removeText);
+    connect(&m_renderer->doc()->buffer(), &KateBuffer::linesRemoved, this, &KateLayoutCache::removeLines);
+
+    // the view line index counts no view lines for hidden lines
+    connect(&m_renderer->folding(), &Kate::TextFolding::foldingRangesChanged, this, &KateLayoutCache::foldingChanged);
 }
 
 void KateLayoutCache::updateViewCache(const KTextEditor::Cursor &startPos, int newViewLineCount, int viewLinesScrolled)
@@ -282,11 +556,13 @@ KateLineLayoutPtr KateLayoutCache::line(int realLine, int virtualLine)
             l->setUsePlainTextLine(acceptDirtyLayouts());
             l->textLine(!acceptDirtyLayouts());
             m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
+            updateViewLineCount(l);
         } else if (l->isLayoutDirty() && !acceptDirtyLayouts()) {
             // reset textline
             l->setUsePlainTextLine(false);
             l->textLine(true);
             m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
+            updateViewLineCount(l);
         }
 
         Q_ASSERT(l->isValid() && (!l->isLayoutDirty() || acceptDirtyLayouts()));
@@ -300,6 +576,7 @@ KateLineLayoutPtr KateLayoutCache::line(int realLine, int virtualLine)
 
     KateLineLayoutPtr l(new KateLineLayout(*m_renderer));
     l->setLine(realLine, virtualLine);
+    l->setVisibleX(m_startX, m_viewWidth);
 
     // Mark it dirty, because it may not have the syntax highlighting applied
     // mark this here, to allow layoutLine to use plainLines...
@@ -309,6 +586,7 @@ KateLineLayoutPtr KateLayoutCache::line(int realLine, int virtualLine)
 
     m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
     Q_ASSERT(l->isValid());
+    updateViewLineCount(l);
 
     if (acceptDirtyLayouts()) {
         l->setLayoutDirty(true);
@@ -470,6 +748,98 @@ int KateLayoutCache::viewLineCount(int realLine)
     return lastViewLine(realLine) + 1;
 }
 
+int KateLayoutCache::documentViewLines()
+{
+    updateViewLineIndex();
+    return m_viewLineIndex.viewLines();
+}
+
+int KateLayoutCache::documentViewLine(const KTextEditor::Cursor &virtualCursor)
+{
+    updateViewLineIndex();
+
+    KTextEditor::Cursor realCursor = virtualCursor;
+    realCursor.setLine(m_renderer->folding().visibleLineToLine(virtualCursor.line()));
+    if (realCursor.line() >= m_viewLineIndex.lines()) {
+        return m_viewLineIndex.viewLines();
+    }
+
+    // this lays out the line if needed, it is counted exactly then
+    const int lineViewLine = viewLine(realCursor);
+    return m_viewLineIndex.viewLinesBefore(realCursor.line()) + lineViewLine;
+}
+
+KTextEditor::Cursor KateLayoutCache::documentViewLineStart(int viewLine)
+{
+    updateViewLineIndex();
+    if (m_viewLineIndex.lines() == 0) {
+        return KTextEditor::Cursor(0, 0);
+    }
+
+    // behind the end: the last view line of the last visible line
+    int realLine = m_viewLineIndex.lineAt(qMax(0, viewLine));
+    int lineViewLine = INT_MAX;
+    if (realLine >= m_viewLineIndex.lines()) {
+        realLine = m_renderer->folding().visibleLineToLine(m_renderer->folding().visibleLines() - 1);
+    } else {
+        lineViewLine = viewLine - m_viewLineIndex.viewLinesBefore(realLine);
+    }
+
+    // the view line count of the line may be an estimate, the layout tells
+    KateLineLayoutPtr l = line(realLine);
+    if (!l) {
+        return KTextEditor::Cursor(0, 0);
+    }
+    const KateTextLayout t = l->viewLine(qMin(qMax(0, lineViewLine), l->viewLineCount() - 1));
+    return KTextEditor::Cursor(m_renderer->folding().lineToVisibleLine(realLine), t.startCol());
+}
+
+void KateLayoutCache::updateViewLineIndex()
+{
+    // new or outdated index: estimate all lines
+    const int lines = m_renderer->doc()->lines();
+    if (m_viewLineIndex.lines() != lines) {
+        m_viewLineIndex.clear();
+        m_viewLineIndex.insertLines(0, lines);
+        estimateViewLineCounts(0, lines - 1);
+    }
+
+    if (!m_viewLineIndex.isValid()) {
+        const Kate::TextFolding &folding = m_renderer->folding();
+        m_viewLineIndex.rebuild(folding.visibleLinesToLines(0, folding.visibleLines() - 1));
+    }
+}
+
+void KateLayoutCache::estimateViewLineCounts(int startRealLine, int endRealLine)
+{
+    // only maintained once built
+    if (m_viewLineIndex.lines() == 0) {
+        return;
+    }
+
+    // estimate from the length, without decoding lines of large files that were never accessed
+    const KateBuffer &buffer = m_renderer->doc()->buffer();
+    const qreal charWidth = m_renderer->currentFontMetrics().averageCharWidth();
+    const bool valid = m_viewLineIndex.isValid();
+    for (int line = startRealLine; line <= endRealLine; ++line) {
+        int count = 1;
+        if (m_viewWidth > 0) {
+            count = qMax(1, qCeil(buffer.estimatedLineLength(line) * charWidth / m_viewWidth));
+        }
+        m_viewLineIndex.setViewLineCount(line, count, valid && m_renderer->folding().isLineVisible(line));
+    }
+}
+
+void KateLayoutCache::updateViewLineCount(const KateLineLayoutPtr &lineLayout)
+{
+    const int line = lineLayout->line();
+    if (!wrap() || line >= m_viewLineIndex.lines() || m_viewLineIndex.viewLineCount(line) == lineLayout->viewLineCount()) {
+        return;
+    }
+
+    m_viewLineIndex.setViewLineCount(line, lineLayout->viewLineCount(), m_viewLineIndex.isValid() && m_renderer->folding().isLineVisible(line));
+}
+
 void KateLayoutCache::viewCacheDebugOutput() const
 {
     qCDebug(LOG_KTE) << "Printing values for " << m_textLayouts.count() << " lines:";
@@ -485,27 +855,72 @@ void KateLayoutCache::viewCacheDebugOutput() const
 void KateLayoutCache::wrapLine(const KTextEditor::Cursor &position)
 {
     m_lineLayouts.slotEditDone(position.line(), position.line() + 1, 1);
+
+    if (m_viewLineIndex.lines() > 0) {
+        m_viewLineIndex.insertLines(position.line() + 1, 1);
+        estimateViewLineCounts(position.line(), position.line() + 1);
+    }
 }
 
 void KateLayoutCache::unwrapLine(int line)
 {
     m_lineLayouts.slotEditDone(line - 1, line, -1);
+
+    if (m_viewLineIndex.lines() > 0) {
+        m_viewLineIndex.removeLines(line, 1);
+        estimateViewLineCounts(line - 1, line - 1);
+    }
 }
 
 void KateLayoutCache::insertText(const KTextEditor::Cursor &position, const QString &)
 {
     m_lineLayouts.slotEditDone(position.line(), position.line(), 0);
+    if (m_lineLayouts.contains(position.line())) {
+        m_lineLayouts[position.line()]->invalidateChunkWidths(position.column());
+    }
+    estimateViewLineCounts(position.line(), position.line());
+}
+
+void KateLayoutCache::insertLines(const KTextEditor::Cursor &position, const QStringList &lines)
+{
+    m_lineLayouts.slotEditDone(position.line(), position.line() + 1, lines.size() - 1);
+
+    if (m_viewLineIndex.lines() > 0) {
+        m_viewLineIndex.insertLines(position.line() + 1, lines.size() - 1);
+        estimateViewLineCounts(position.line(), position.line() + lines.size() - 1);
+    }
 }
 
 void KateLayoutCache::removeText(const KTextEditor::Range &range)
 {
     m_lineLayouts.slotEditDone(range.start().line(), range.start().line(), 0);
+    if (m_lineLayouts.contains(range.start().line())) {
+        m_lineLayouts[range.start().line()]->invalidateChunkWidths(range.start().column());
+    }
+    estimateViewLineCounts(range.start().line(), range.start().line());
+}
+
+void KateLayoutCache::removeLines(const KTextEditor::Range &range, const QStringList &)
+{
+    const int removedLines = range.end().line() - range.start().line();
+    m_lineLayouts.slotEditDone(range.start().line(), range.end().line(), -removedLines);
+
+    if (m_viewLineIndex.lines() > 0) {
+        m_viewLineIndex.removeLines(range.start().line() + 1, removedLines);
+        estimateViewLineCounts(range.start().line(), range.start().line());
+    }
+}
+
+void KateLayoutCache::foldingChanged()
+{
+    m_viewLineIndex.invalidate();
 }
 
 void KateLayoutCache::clear()
 {
     m_textLayouts.clear();
     m_lineLayouts.clear();
+    m_viewLineIndex.clear();
     m_startPos = KTextEditor::Cursor(-1, -1);
 }
 
@@ -517,6 +932,7 @@ void KateLayoutCache::setViewWidth(int width)
 
     m_lineLayouts.clear();
     m_startPos = KTextEditor::Cursor(-1, -1);
+    m_viewLineIndex.clear();
 
     // Only get rid of layouts that we have to
     if (wider) {
@@ -526,6 +942,17 @@ void KateLayoutCache::setViewWidth(int width)
     }
 }
 
+int KateLayoutCache::startX() const
+{
+    return m_startX;
+}
+
+bool KateLayoutCache::setStartX(int x)
+{
+    m_startX = x;
+    return m_lineLayouts.setVisibleX(m_startX, m_viewWidth);
+}
+
 bool KateLayoutCache::wrap() const
 {
     return m_wrap;
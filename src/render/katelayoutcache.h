@@ -14,6 +14,8 @@
 
 #include "katetextlayout.h"
 
+#include <vector>
+
 class KateRenderer;
 
 class KateLineLayoutMap
@@ -33,6 +35,12 @@ public:
 
     inline void relayoutLines(int startRealLine, int endRealLine);
 
+    /**
+     * Set the visible range of all layouts, the windowed layouts whose window doesn't span it are marked dirty.
+     * \return \e true if any layout needs to be laid out again
+     */
+    inline bool setVisibleX(int x, int width);
+
     inline void slotEditDone(int fromLine, int toLine, int shiftAmount);
 
     KateLineLayoutPtr &operator[](int i);
@@ -44,6 +52,115 @@ private:
     LineLayoutMap m_lineLayouts;
 };
 
+/**
+ * The number of view lines of each real line with dynamic word wrap, to find the document view line
+ * a line starts at and the line at a document view line in O(log n).
+ *
+ * The lines are kept in chunks of about ChunkSize lines, two Fenwick trees over the chunks sum up
+ * their lines and the view lines of their visible lines. Lines hidden by folding count with no view lines.
+ * Inserting, removing and changing lines costs O(ChunkSize + log n), only splitting or dropping
+ * a chunk rebuilds the trees in O(n / ChunkSize). A folding change needs a rebuild() in O(n).
+ */
+class KateViewLineIndex
+{
+public:
+    void clear();
+
+    /**
+     * number of real lines in the index
+     */
+    int lines() const
+    {
+        return m_lines;
+    }
+
+    /**
+     * Insert \p count visible lines with one view line each in front of \p line.
+     */
+    void insertLines(int line, int count);
+    void removeLines(int line, int count);
+
+    int viewLineCount(int line) const;
+
+    /**
+     * Set the view line count of \p line, \p visible tells if the line is hidden by folding.
+     */
+    void setViewLineCount(int line, int count, bool visible);
+
+    /**
+     * Are the lines hidden by folding up to date? Else rebuild() must be called before any query.
+     */
+    bool isValid() const
+    {
+        return m_valid;
+    }
+
+    void invalidate()
+    {
+        m_valid = false;
+    }
+
+    /**
+     * Update which lines are hidden by folding, all lines but \p visibleLines are hidden.
+     */
+    void rebuild(const QVector<int> &visibleLines);
+
+    /**
+     * number of view lines of all visible lines
+     */
+    int viewLines() const;
+
+    /**
+     * number of view lines of the visible lines in front of \p line
+     */
+    int viewLinesBefore(int line) const;
+
+    /**
+     * The visible line that contains the document view line \p viewLine,
+     * lines() if \p viewLine is behind the last view line.
+     */
+    int lineAt(int viewLine) const;
+
+private:
+    /**
+     * The chunk that contains \p line, \p line is made relative to the chunk start.
+     */
+    int chunkForLine(int &line) const;
+
+    /**
+     * Split too large chunks, drop empty ones and rebuild both trees.
+     */
+    void rebuildChunks();
+
+private:
+    enum { ChunkSize = 256 };
+
+    struct ViewLines {
+        int count;
+        bool visible;
+    };
+
+    struct Chunk {
+        std::vector<ViewLines> lines;
+
+        /**
+         * view lines of the visible lines of this chunk
+         */
+        int viewLines = 0;
+    };
+
+    std::vector<Chunk> m_chunks;
+
+    /**
+     * 1-based Fenwick trees of the lines and of the view lines of the chunks
+     */
+    std::vector<int> m_lineTree;
+    std::vector<int> m_viewLineTree;
+
+    int m_lines = 0;
+    bool m_valid = false;
+};
+
 /**
  * This class handles Kate's caching of layouting information (in KateLineLayout
  * and KateTextLayout).  This information is used primarily by both the view and
@@ -71,6 +188,13 @@ public:
     int viewWidth() const;
     void setViewWidth(int width);
 
+    /**
+     * The x of the left side of the view, the windowed layouts of very long lines are placed around it.
+     * \return \e true if layouts in the view cache became dirty, the view cache must be updated then
+     */
+    int startX() const;
+    bool setStartX(int x);
+
     bool wrap() const;
     void setWrap(bool wrap);
 
@@ -126,11 +250,49 @@ public:
     void viewCacheDebugOutput() const;
     // END
 
+    // BEGIN view lines of the whole document, with dynamic word wrap
+    // the view lines of lines never laid out are estimated from their length, laying them out refines them
+    /**
+     * Number of view lines of all visible lines of the document.
+     */
+    int documentViewLines();
+
+    /**
+     * The view line of the document \p virtualCursor is on, 0 for the first view line of the document.
+     */
+    int documentViewLine(const KTextEditor::Cursor &virtualCursor);
+
+    /**
+     * The virtual cursor at the start of the view line \p viewLine of the document.
+     */
+    KTextEditor::Cursor documentViewLineStart(int viewLine);
+    // END
+
 private Q_SLOTS:
     void wrapLine(const KTextEditor::Cursor &position);
     void unwrapLine(int line);
     void insertText(const KTextEditor::Cursor &position, const QString &text);
+    void insertLines(const KTextEditor::Cursor &position, const QStringList &lines);
     void removeText(const KTextEditor::Range &range);
+    void removeLines(const KTextEditor::Range &range, const QStringList &lines);
+    void foldingChanged();
+
+private:
+    /**
+     * Make the view line index match the document and the folding.
+     */
+    void updateViewLineIndex();
+
+    /**
+     * Put the view line counts of the lines \p startRealLine to \p endRealLine into the index,
+     * estimated from their length and the average character width.
+     */
+    void estimateViewLineCounts(int startRealLine, int endRealLine);
+
+    /**
+     * Put the view line count of the laid out \p lineLayout into the index.
+     */
+    void updateViewLineCount(const KateLineLayoutPtr &lineLayout);
 
 private:
     KateRenderer *m_renderer;
@@ -148,8 +310,14 @@ private:
     mutable QVector<KateTextLayout> m_textLayouts;
 
     int m_viewWidth;
+    int m_startX = 0;
     bool m_wrap;
     bool m_acceptDirtyLayouts;
+
+    /**
+     * view lines of all lines, built once needed with dynamic word wrap
+     */
+    KateViewLineIndex m_viewLineIndex;
 };
 
 #endif
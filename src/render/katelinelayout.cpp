@@ -13,6 +13,7 @@
 
 #include "katepartdebug.h"
 
+#include "katebuffer.h"
 #include "katedocument.h"
 #include "katerenderer.h"
 
@@ -42,6 +43,10 @@ void KateLineLayout::clear()
     // not touching dirty
     delete m_layout;
     m_layout = nullptr;
+    m_windowStart = 0;
+    m_windowEnd = -1;
+    m_windowX = 0;
+    m_chunkWidths.clear();
     // not touching layout dirty
 }
 
@@ -53,7 +58,11 @@ bool KateLineLayout::includesCursor(const KTextEditor::Cursor &realCursor) const
 const Kate::TextLine &KateLineLayout::textLine(bool reloadForce) const
 {
     if (reloadForce || !m_textLine) {
-        m_textLine = usePlainTextLine() ? m_renderer.doc()->plainKateTextLine(line()) : m_renderer.doc()->kateTextLine(line());
+        // don't block on lines far behind the highlighted ones, they are shown without highlighting until the buffer got there
+        if (!usePlainTextLine()) {
+            m_renderer.doc()->buffer().ensureHighlightedIncrementally(line());
+        }
+        m_textLine = m_renderer.doc()->plainKateTextLine(line());
     }
 
     Q_ASSERT(m_textLine);
@@ -125,6 +134,11 @@ void KateLineLayout::setLayout(QTextLayout *layout)
     }
 
     m_layoutDirty = !m_layout;
+    if (!m_layout) {
+        m_windowStart = 0;
+        m_windowEnd = -1;
+        m_windowX = 0;
+    }
     m_dirtyList.clear();
     if (m_layout)
         for (int i = 0; i < qMax(1, m_layout->lineCount()); ++i) {
@@ -177,6 +191,10 @@ KateTextLayout KateLineLayout::viewLine(int viewLine) const
 
 int KateLineLayout::width() const
 {
+    if (isWindowed()) {
+        return (int)windowedCursorToX(length());
+    }
+
     int width = 0;
 
     for (int i = 0; i < m_layout->lineCount(); ++i) {
@@ -244,3 +262,193 @@ bool KateLineLayout::isRightToLeft() const
 
     return m_layout->textOption().textDirection() == Qt::RightToLeft;
 }
+
+bool KateLineLayout::isWindowed() const
+{
+    return m_layout && m_windowEnd >= 0;
+}
+
+int KateLineLayout::windowStart() const
+{
+    return isWindowed() ? m_windowStart : 0;
+}
+
+int KateLineLayout::windowEnd() const
+{
+    return isWindowed() ? m_windowEnd : length();
+}
+
+qreal KateLineLayout::windowX() const
+{
+    return isWindowed() ? m_windowX : 0;
+}
+
+void KateLineLayout::setWindow(int start, int end, qreal x)
+{
+    m_windowStart = (end < 0) ? 0 : start;
+    m_windowEnd = end;
+    m_windowX = (end < 0) ? 0 : x;
+    if (!isWindowed()) {
+        return;
+    }
+
+    // measure the whole chunks inside the window, the x of the columns outside of it is estimated from them
+    const QTextLine line = m_layout->lineAt(0);
+    for (int chunk = (start + WindowChunkLength - 1) / WindowChunkLength; (chunk + 1) * WindowChunkLength <= end; ++chunk) {
+        if ((int)m_chunkWidths.size() <= chunk) {
+            m_chunkWidths.resize(chunk + 1, -1);
+        }
+        m_chunkWidths[chunk] = line.cursorToX((chunk + 1) * WindowChunkLength - start) - line.cursorToX(chunk * WindowChunkLength - start);
+    }
+}
+
+int KateLineLayout::visibleX() const
+{
+    return m_visibleX;
+}
+
+int KateLineLayout::visibleWidth() const
+{
+    return m_visibleWidth;
+}
+
+void KateLineLayout::setVisibleX(int x, int width)
+{
+    m_visibleX = x;
+    m_visibleWidth = width;
+}
+
+bool KateLineLayout::windowIncludesVisibleX() const
+{
+    if (!isWindowed()) {
+        return true;
+    }
+
+    const QTextLine line = m_layout->lineAt(0);
+    return (m_windowStart == 0 || m_windowX + line.cursorToX(0) <= m_visibleX)
+        && (m_windowEnd >= length() || m_windowX + line.cursorToX(m_windowEnd - m_windowStart) >= m_visibleX + m_visibleWidth);
+}
+
+qreal KateLineLayout::windowedCursorToX(int column) const
+{
+    if (!isWindowed()) {
+        return estimatedX(column);
+    }
+
+    // outside of the window, the estimated distance to the window is added to its x, the x stays monotonic that way
+    const QTextLine line = m_layout->lineAt(0);
+    if (column < m_windowStart) {
+        return m_windowX + line.cursorToX(0) - (estimatedX(m_windowStart) - estimatedX(column));
+    }
+    if (column > m_windowEnd) {
+        return m_windowX + line.cursorToX(m_windowEnd - m_windowStart) + (estimatedX(column) - estimatedX(m_windowEnd));
+    }
+    return m_windowX + line.cursorToX(column - m_windowStart);
+}
+
+int KateLineLayout::windowedXToCursor(qreal x) const
+{
+    if (!isWindowed()) {
+        return estimatedColumn(x);
+    }
+
+    const QTextLine line = m_layout->lineAt(0);
+    const qreal startX = m_windowX + line.cursorToX(0);
+    const qreal endX = m_windowX + line.cursorToX(m_windowEnd - m_windowStart);
+    if (x < startX) {
+        return qMin(m_windowStart, estimatedColumn(estimatedX(m_windowStart) - (startX - x)));
+    }
+    if (x > endX) {
+        return qMax(m_windowEnd, estimatedColumn(estimatedX(m_windowEnd) + (x - endX)));
+    }
+    return m_windowStart + line.xToCursor(x - m_windowX);
+}
+
+void KateLineLayout::invalidateChunkWidths(int column)
+{
+    const int chunk = qMax(0, column) / WindowChunkLength;
+    if ((int)m_chunkWidths.size() > chunk) {
+        m_chunkWidths.resize(chunk);
+    }
+}
+
+qreal KateLineLayout::chunkWidth(int chunk, qreal charWidth) const
+{
+    return (chunk < (int)m_chunkWidths.size() && m_chunkWidths[chunk] >= 0) ? m_chunkWidths[chunk] : WindowChunkLength * charWidth;
+}
+
+qreal KateLineLayout::averageCharWidth() const
+{
+    qreal width = 0;
+    int chunks = 0;
+    for (const qreal measuredWidth : m_chunkWidths) {
+        if (measuredWidth >= 0) {
+            width += measuredWidth;
+            ++chunks;
+        }
+    }
+
+    // without measured chunks, monospace text is assumed
+    return (chunks > 0 && width > 0) ? width / (chunks * WindowChunkLength) : m_renderer.spaceWidth();
+}
+
+qreal KateLineLayout::estimatedX(int column) const
+{
+    const qreal charWidth = averageCharWidth();
+    const int chunk = qMax(0, column) / WindowChunkLength;
+    qreal x = 0;
+    for (int i = 0; i < chunk; ++i) {
+        x += chunkWidth(i, charWidth);
+    }
+    return x + (column - chunk * WindowChunkLength) * chunkWidth(chunk, charWidth) / WindowChunkLength;
+}
+
+int KateLineLayout::estimatedColumn(qreal x) const
+{
+    const qreal charWidth = averageCharWidth();
+    const int lineLength = length();
+    qreal chunkX = 0;
+    for (int chunk = 0; chunk * WindowChunkLength < lineLength; ++chunk) {
+        const qreal width = chunkWidth(chunk, charWidth);
+        if (x < chunkX + width) {
+            const int column = chunk * WindowChunkLength + qRound((x - chunkX) * WindowChunkLength / width);
+            return qBound(0, column, lineLength);
+        }
+        chunkX += width;
+    }
+    return lineLength;
+}
+
+int KateLineLayout::nextCursorPosition(int column) const
+{
+    if (!isWindowed()) {
+        return m_layout->nextCursorPosition(column);
+    }
+    if (column >= m_windowStart && column < m_windowEnd) {
+        return m_windowStart + m_layout->nextCursorPosition(column - m_windowStart);
+    }
+
+    // outside of the window, at least surrogate pairs are kept together
+    const QString &text = textLine()->string();
+    if (column + 1 < text.size() && text.at(column).isHighSurrogate() && text.at(column + 1).isLowSurrogate()) {
+        return column + 2;
+    }
+    return qMin(column + 1, text.size());
+}
+
+int KateLineLayout::previousCursorPosition(int column) const
+{
+    if (!isWindowed()) {
+        return m_layout->previousCursorPosition(column);
+    }
+    if (column > m_windowStart && column <= m_windowEnd) {
+        return m_windowStart + m_layout->previousCursorPosition(column - m_windowStart);
+    }
+
+    // outside of the window, at least surrogate pairs are kept together
+    const QString &text = textLine()->string();
+    if (column >= 2 && column <= text.size() && text.at(column - 1).isLowSurrogate() && text.at(column - 2).isHighSurrogate()) {
+        return column - 2;
+    }
+    return qMax(column - 1, 0);
+}
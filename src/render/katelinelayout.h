@@ -15,6 +15,8 @@
 
 #include <ktexteditor/cursor.h>
 
+#include <vector>
+
 class QTextLayout;
 namespace KTextEditor
 {
@@ -26,6 +28,18 @@ class KateRenderer;
 class KateLineLayout : public QSharedData
 {
 public:
+    /**
+     * Lines with at least this number of characters are laid out in a window around
+     * their visible part only if they are not wrapped, see isWindowed().
+     */
+    static const int WindowedLayoutLength = 16384;
+
+    /**
+     * The window of a windowed layout spans whole chunks of this number of columns,
+     * the widths of the chunks are kept once they were laid out.
+     */
+    static const int WindowChunkLength = 1024;
+
     explicit KateLineLayout(KateRenderer &renderer);
     ~KateLineLayout();
 
@@ -90,6 +104,79 @@ public:
     bool usePlainTextLine() const;
     void setUsePlainTextLine(bool plain = true);
 
+    // BEGIN windowed layout of very long lines
+    // The layout of a windowed line contains only the columns windowStart() to windowEnd(),
+    // laid out at x 0 and shown at windowX(), their estimated x. The x of the other columns
+    // is estimated from the widths of the chunks laid out so far, or from the space width.
+    bool isWindowed() const;
+    /**
+     * First column of the text of the layout, 0 if the layout isn't windowed.
+     */
+    int windowStart() const;
+    /**
+     * Column after the text of the layout, length() if the layout isn't windowed.
+     */
+    int windowEnd() const;
+    /**
+     * X the layout is shown at, 0 if the layout isn't windowed.
+     * Add it to the positions of the layout, like when drawing it.
+     */
+    qreal windowX() const;
+    /**
+     * Set the columns the layout contains, \p end < 0 if it contains the whole line, and the x it is shown at.
+     * The widths of the chunks inside the window are measured, so call this once laid out.
+     */
+    void setWindow(int start, int end, qreal x);
+
+    /**
+     * Horizontal range of the line that is shown, in pixels, the window is placed around it.
+     */
+    int visibleX() const;
+    int visibleWidth() const;
+    void setVisibleX(int x, int width);
+    /**
+     * Does the window span the visible range? Always \e true for layouts that aren't windowed.
+     */
+    bool windowIncludesVisibleX() const;
+
+    /**
+     * X of \p column in a windowed layout, inside the window it is the one of the layout.
+     * Without window, it is estimated from the chunk widths.
+     */
+    qreal windowedCursorToX(int column) const;
+    /**
+     * Column at \p x in a windowed layout, inside the window it is the one of the layout.
+     * Without window, it is estimated from the chunk widths.
+     */
+    int windowedXToCursor(qreal x) const;
+
+    /**
+     * The chunk widths of the columns from \p column on are no longer valid, e.g. after text was inserted there.
+     */
+    void invalidateChunkWidths(int column);
+    // END
+
+    /**
+     * Cursor positions after and before \p column, like QTextLayout::nextCursorPosition(), also outside of the window.
+     */
+    int nextCursorPosition(int column) const;
+    int previousCursorPosition(int column) const;
+
+private:
+    /**
+     * Width of \p chunk, measured or estimated with \p charWidth.
+     */
+    qreal chunkWidth(int chunk, qreal charWidth) const;
+    /**
+     * Average width of the characters of the measured chunks, the space width without any.
+     */
+    qreal averageCharWidth() const;
+    /**
+     * X of \p column and column at \p x estimated from the chunk widths, not using the layout.
+     */
+    qreal estimatedX(int column) const;
+    int estimatedColumn(qreal x) const;
+
 private:
     // Disable copy
     KateLineLayout(const KateLineLayout &copy);
@@ -105,6 +192,18 @@ private:
 
     bool m_layoutDirty;
     bool m_usePlainTextLine;
+
+    // window of a windowed layout, m_windowEnd < 0 if the layout contains the whole line
+    int m_windowStart = 0;
+    int m_windowEnd = -1;
+    qreal m_windowX = 0;
+    int m_visibleX = 0;
+    int m_visibleWidth = 0;
+
+    /**
+     * widths of the chunks measured so far, negative for the ones never laid out
+     */
+    std::vector<qreal> m_chunkWidths;
 };
 
 typedef QExplicitlySharedDataPointer<KateLineLayout> KateLineLayoutPtr;
@@ -35,6 +35,24 @@ static const QChar tabChar(QLatin1Char('\t'));
 static const QChar spaceChar(QLatin1Char(' '));
 static const QChar nbSpaceChar(0xa0); // non-breaking space
 
+/**
+ * Move the format ranges of a line to the window of a windowed layout, the ones outside of it are dropped.
+ */
+static void moveFormatsToWindow(QVector<QTextLayout::FormatRange> &formats, int windowStart, int windowEnd)
+{
+    QVector<QTextLayout::FormatRange> windowFormats;
+    for (QTextLayout::FormatRange &format : formats) {
+        const int start = qMax(format.start, windowStart);
+        const int end = qMin(format.start + format.length, windowEnd);
+        if (start < end) {
+            format.start = start - windowStart;
+            format.length = end - start;
+            windowFormats.append(format);
+        }
+    }
+    formats = windowFormats;
+}
+
 KateRenderer::KateRenderer(KTextEditor::DocumentPrivate *doc, Kate::TextFolding &folding, KTextEditor::ViewPrivate *view)
     : m_doc(doc)
     , m_folding(folding)
@@ -595,10 +613,13 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
             // Draw the text :)
             if (drawSelection) {
                 additionalFormats = decorationsForLine(range->textLine(), range->line(), true);
-                range->layout()->draw(&paint, QPoint(-xStart, 0), additionalFormats);
+                if (range->isWindowed()) {
+                    moveFormatsToWindow(additionalFormats, range->windowStart(), range->windowEnd());
+                }
+                range->layout()->draw(&paint, QPointF(range->windowX() - xStart, 0), additionalFormats);
 
             } else {
-                range->layout()->draw(&paint, QPoint(-xStart, 0));
+                range->layout()->draw(&paint, QPointF(range->windowX() - xStart, 0));
             }
         }
 
@@ -618,10 +639,10 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
             // draw an open box to mark non-breaking spaces
             const QString &text = range->textLine()->string();
             int y = lineHeight() * i + fm.ascent() - fm.strikeOutPos();
-            int nbSpaceIndex = text.indexOf(nbSpaceChar, line.lineLayout().xToCursor(xStart));
+            int nbSpaceIndex = text.indexOf(nbSpaceChar, line.xToCursor(xStart));
 
             while (nbSpaceIndex != -1 && nbSpaceIndex < line.endCol()) {
-                int x = line.lineLayout().cursorToX(nbSpaceIndex);
+                int x = line.cursorToX(nbSpaceIndex);
                 if (x > xEnd) {
                     break;
                 }
@@ -631,9 +652,9 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
 
             // draw tab stop indicators
             if (showTabs()) {
-                int tabIndex = text.indexOf(tabChar, line.lineLayout().xToCursor(xStart));
+                int tabIndex = text.indexOf(tabChar, line.xToCursor(xStart));
                 while (tabIndex != -1 && tabIndex < line.endCol()) {
-                    int x = line.lineLayout().cursorToX(tabIndex);
+                    int x = line.cursorToX(tabIndex);
                     if (x > xEnd) {
                         break;
                     }
@@ -644,11 +665,12 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
 
             // draw trailing spaces
             if (showSpaces() != KateDocumentConfig::None) {
-                int spaceIndex = line.endCol() - 1;
+                // the spaces outside of the window of a windowed layout aren't visible
+                int spaceIndex = qMin(line.endCol(), range->windowEnd()) - 1;
                 const int trailingPos = showSpaces() == KateDocumentConfig::All ? 0 : qMax(range->textLine()->lastChar(), 0);
 
                 if (spaceIndex >= trailingPos) {
-                    for (; spaceIndex >= line.startCol(); --spaceIndex) {
+                    for (; spaceIndex >= qMax(line.startCol(), range->windowStart()); --spaceIndex) {
                         if (!text.at(spaceIndex).isSpace()) {
                             if (showSpaces() == KateDocumentConfig::Trailing)
                                 break;
@@ -658,9 +680,9 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
 
                         if (text.at(spaceIndex) != QLatin1Char('\t') || !showTabs()) {
                             if (range->layout()->textOption().alignment() == Qt::AlignRight) { // Draw on left for RTL lines
-                                paintSpace(paint, line.lineLayout().cursorToX(spaceIndex) - xStart - spaceWidth() / 2.0, y);
+                                paintSpace(paint, line.cursorToX(spaceIndex) - xStart - spaceWidth() / 2.0, y);
                             } else {
-                                paintSpace(paint, line.lineLayout().cursorToX(spaceIndex) - xStart + spaceWidth() / 2.0, y);
+                                paintSpace(paint, line.cursorToX(spaceIndex) - xStart + spaceWidth() / 2.0, y);
                             }
                         }
                     }
@@ -672,12 +694,12 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
 
                 static const QRegularExpression nonPrintableSpacesRegExp(
                     QStringLiteral("[\\x{2000}-\\x{200F}\\x{2028}-\\x{202F}\\x{205F}-\\x{2064}\\x{206A}-\\x{206F}]"));
-                QRegularExpressionMatchIterator i = nonPrintableSpacesRegExp.globalMatch(text, line.lineLayout().xToCursor(xStart));
+                QRegularExpressionMatchIterator i = nonPrintableSpacesRegExp.globalMatch(text, line.xToCursor(xStart));
 
                 while (i.hasNext()) {
                     const int charIndex = i.next().capturedStart();
 
-                    const int x = line.lineLayout().cursorToX(charIndex);
+                    const int x = line.cursorToX(charIndex);
                     if (x > xEnd) {
                         break;
                     }
@@ -703,7 +725,7 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
         if (drawCaret() && cursor && range->includesCursor(*cursor)) {
             int caretWidth, lineWidth = 2;
             QColor color;
-            QTextLine line = range->layout()->lineForTextPosition(qMin(cursor->column(), range->length()));
+            const KateTextLayout line = range->viewLine(range->viewLineForColumn(qMin(cursor->column(), range->length())));
 
             // Determine the caret's style
             caretStyles style = caretStyle();
@@ -728,8 +750,9 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
             } else {
                 // search for the FormatRange that includes the cursor
                 const auto formatRanges = range->layout()->formats();
+                const int column = cursor->column() - range->windowStart();
                 for (const QTextLayout::FormatRange &r : formatRanges) {
-                    if ((r.start <= cursor->column()) && ((r.start + r.length) > cursor->column())) {
+                    if ((r.start <= column) && ((r.start + r.length) > column)) {
                         // check for Qt::NoBrush, as the returned color is black() and no invalid QColor
                         QBrush foregroundBrush = r.format.foreground();
                         if (foregroundBrush != Qt::NoBrush) {
@@ -763,7 +786,10 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
             }
 
             if (cursor->column() <= range->length()) {
-                range->layout()->drawCursor(&paint, QPoint(-xStart, 0), cursor->column(), caretWidth);
+                // outside of the window of a windowed layout the caret isn't visible
+                if (cursor->column() >= range->windowStart() && cursor->column() <= range->windowEnd()) {
+                    range->layout()->drawCursor(&paint, QPointF(range->windowX() - xStart, 0), cursor->column() - range->windowStart(), caretWidth);
+                }
             } else {
                 // Off the end of the line... must be block mode. Draw the caret ourselves.
                 const KateTextLayout &lastLine = range->viewLine(range->viewLineCount() - 1);
@@ -796,7 +822,7 @@ void KateRenderer::paintTextLine(QPainter &paint, KateLineLayoutPtr range, int x
 
             // Determine the position where to paint the note.
             // We start by getting the x coordinate of cursor placed to the column.
-            qreal x = range->viewLine(viewLine).lineLayout().cursorToX(column) - xStart;
+            qreal x = range->viewLine(viewLine).cursorToX(column) - xStart;
             int textLength = range->length();
             if (column == 0 || column < textLength) {
                 // If the note is inside text or at the beginning, then there is a hole in the text where the
@@ -928,11 +954,42 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
     Kate::TextLine textLine = lineLayout->textLine();
     Q_ASSERT(textLine);
 
+    // Shaping very long lines as a whole is too slow, if they are not wrapped only a window
+    // of whole chunks around their visible part is laid out. Right-to-left lines and lines
+    // with inline notes are always laid out as a whole.
+    const QString &text = textLine->string();
+    const bool rightToLeft = isLineRightToLeft(lineLayout);
+    const bool windowed = (maxwidth == -1) && (text.size() >= KateLineLayout::WindowedLayoutLength) && !rightToLeft
+        && (isPrinterFriendly() || m_view->inlineNotes(lineLayout->line()).isEmpty());
+    int windowStart = 0;
+    int windowEnd = -1;
+    qreal windowX = 0;
+    if (windowed) {
+        // the columns keep the x they had in the previous window, if any
+        const int startColumn = lineLayout->windowedXToCursor(lineLayout->visibleX());
+        const int endColumn = lineLayout->windowedXToCursor(lineLayout->visibleX() + lineLayout->visibleWidth());
+        windowStart = qMax(0, (startColumn / KateLineLayout::WindowChunkLength - 1) * KateLineLayout::WindowChunkLength);
+        windowEnd = qMin(text.size(), (endColumn / KateLineLayout::WindowChunkLength + 2) * KateLineLayout::WindowChunkLength);
+        windowStart = qMin(windowStart, windowEnd);
+
+        // don't split surrogate pairs
+        if (windowStart > 0 && windowStart < text.size() && text.at(windowStart).isLowSurrogate()) {
+            --windowStart;
+        }
+        if (windowEnd < text.size() && text.at(windowEnd).isLowSurrogate()) {
+            ++windowEnd;
+        }
+
+        // the layout itself starts at x 0, QTextLine positions can't take x that large
+        windowX = lineLayout->windowedCursorToX(windowStart);
+    }
+
     QTextLayout *l = lineLayout->layout();
+    const QString layoutText = windowed ? text.mid(windowStart, windowEnd - windowStart) : text;
     if (!l) {
-        l = new QTextLayout(textLine->string(), m_font);
+        l = new QTextLayout(layoutText, m_font);
     } else {
-        l->setText(textLine->string());
+        l->setText(layoutText);
         l->setFont(m_font);
     }
 
@@ -957,7 +1014,7 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
     // Qt's text renderer ("scribe") version 4.2 assumes a "higher-level protocol"
     // (such as KatePart) will specify the paragraph level, so it does not apply P2 & P3
     // by itself. If this ever change in Qt, the next code block could be removed.
-    if (isLineRightToLeft(lineLayout)) {
+    if (rightToLeft) {
         opt.setAlignment(Qt::AlignRight);
         opt.setTextDirection(Qt::RightToLeft);
     } else {
@@ -969,6 +1026,9 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
 
     // Syntax highlighting, inbuilt and arbitrary
     QVector<QTextLayout::FormatRange> decorations = decorationsForLine(textLine, lineLayout->line());
+    if (windowed) {
+        moveFormatsToWindow(decorations, windowStart, windowEnd);
+    }
 
     int firstLineOffset = 0;
 
@@ -1045,6 +1105,7 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
     l->endLayout();
 
     lineLayout->setLayout(l);
+    lineLayout->setWindow(windowStart, windowEnd, windowX);
 }
 
 // 1) QString::isRightToLeft() sux
@@ -1101,7 +1162,7 @@ int KateRenderer::cursorToX(const KateTextLayout &range, const KTextEditor::Curs
 
     int x;
     if (range.lineLayout().width() > 0) {
-        x = (int)range.lineLayout().cursorToX(pos.column());
+        x = (int)range.cursorToX(pos.column());
     } else {
         x = 0;
     }
@@ -1117,7 +1178,7 @@ int KateRenderer::cursorToX(const KateTextLayout &range, const KTextEditor::Curs
 KTextEditor::Cursor KateRenderer::xToCursor(const KateTextLayout &range, int x, bool returnPastLine) const
 {
     Q_ASSERT(range.isValid());
-    KTextEditor::Cursor ret(range.line(), range.lineLayout().xToCursor(x));
+    KTextEditor::Cursor ret(range.line(), range.xToCursor(x));
 
     // TODO wrong for RTL lines?
     if (returnPastLine && range.endCol(true) == -1 && x > range.width() + range.xOffset()) {
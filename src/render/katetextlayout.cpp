@@ -144,7 +144,7 @@ int KateTextLayout::endCol(bool indicateEOL) const
             return -1;
         }
 
-    return startCol() + m_textLayout.textLength();
+    return startCol() + length();
 }
 
 KTextEditor::Cursor KateTextLayout::end(bool indicateEOL) const
@@ -158,6 +158,10 @@ int KateTextLayout::length() const
         return 0;
     }
 
+    if (m_lineLayout->isWindowed()) {
+        return m_lineLayout->length();
+    }
+
     return m_textLayout.textLength();
 }
 
@@ -200,7 +204,7 @@ int KateTextLayout::endX() const
         return 0;
     }
 
-    return startX() + (int)m_textLayout.naturalTextWidth();
+    return startX() + width();
 }
 
 int KateTextLayout::width() const
@@ -209,9 +213,31 @@ int KateTextLayout::width() const
         return 0;
     }
 
+    if (m_lineLayout->isWindowed()) {
+        return m_lineLayout->width();
+    }
+
     return (int)m_textLayout.naturalTextWidth();
 }
 
+qreal KateTextLayout::cursorToX(int column) const
+{
+    if (isValid() && m_lineLayout->isWindowed()) {
+        return m_lineLayout->windowedCursorToX(column);
+    }
+
+    return m_textLayout.cursorToX(column);
+}
+
+int KateTextLayout::xToCursor(qreal x) const
+{
+    if (isValid() && m_lineLayout->isWindowed()) {
+        return m_lineLayout->windowedXToCursor(x);
+    }
+
+    return m_textLayout.xToCursor(x);
+}
+
 KateTextLayout KateTextLayout::invalid()
 {
     return KateTextLayout();
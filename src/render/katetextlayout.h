@@ -67,6 +67,13 @@ public:
     int endX() const;
     int width() const;
 
+    /**
+     * X of \p column and column at \p x, like the ones of lineLayout(),
+     * but in windowed layouts also for the columns outside of the window.
+     */
+    qreal cursorToX(int column) const;
+    int xToCursor(qreal x) const;
+
     int xOffset() const;
 
     bool isRightToLeft() const;
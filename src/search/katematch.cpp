@@ -8,8 +8,11 @@
 #include "katematch.h"
 
 #include "katedocument.h"
+#include "kateplaintextsearch.h"
 #include "kateregexpsearch.h"
 
+#include <vector>
+
 KateMatch::KateMatch(KTextEditor::DocumentPrivate *document, KTextEditor::SearchOptions options)
     : m_document(document)
     , m_options(options)
@@ -17,8 +20,23 @@ KateMatch::KateMatch(KTextEditor::DocumentPrivate *document, KTextEditor::Search
     m_resultRanges.append(KTextEditor::Range::invalid());
 }
 
+KateMatch::~KateMatch() = default;
+
 KTextEditor::Range KateMatch::searchText(const KTextEditor::Range &range, const QString &pattern)
 {
+    if (m_options.testFlag(KTextEditor::Regex)) {
+        // the pattern is only compiled again if it changed
+        if (!m_regExpSearch) {
+            m_regExpSearch.reset(new KateRegExpSearch(m_document));
+        }
+        QRegularExpression::PatternOptions patternOptions;
+        if (m_options.testFlag(KTextEditor::CaseInsensitive)) {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+        m_resultRanges = m_regExpSearch->search(pattern, range, m_options.testFlag(KTextEditor::Backwards), patternOptions);
+        return m_resultRanges[0];
+    }
+
     m_resultRanges = m_document->searchText(range, pattern, m_options);
 
     return m_resultRanges[0];
@@ -45,6 +63,133 @@ KTextEditor::Range KateMatch::replace(const QString &replacement, bool blockMode
     return m_afterReplaceRange->toRange();
 }
 
+bool KateMatch::replaceAll(const KTextEditor::Range &range,
+                           const QString &pattern,
+                           const QString &replacement,
+                           int replacementCounter,
+                           QVector<KTextEditor::Range> &replacedRanges,
+                           bool onlyOnePerLine)
+{
+    replacedRanges.clear();
+
+    // the plain text modes find the same matches as searchText(), with the word boundaries of the highlighting
+    const bool regexMode = m_options.testFlag(KTextEditor::Regex);
+    const bool escapeSequences = m_options.testFlag(KTextEditor::EscapeSequences);
+    std::unique_ptr<KateRegExpSearch> regExpSearch;
+    std::unique_ptr<KateRegExpSearch::MatchIterator> regExpMatches;
+    std::unique_ptr<KatePlainTextSearch> plainTextSearch;
+    QString needle;
+    if (regexMode) {
+        QRegularExpression::PatternOptions patternOptions;
+        if (m_options.testFlag(KTextEditor::CaseInsensitive)) {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+        regExpSearch.reset(new KateRegExpSearch(m_document, pattern, patternOptions));
+        if (!regExpSearch->isValid() || regExpSearch->isMultiLine()) {
+            return false;
+        }
+        regExpMatches.reset(new KateRegExpSearch::MatchIterator(regExpSearch->matches(range)));
+    } else {
+        needle = escapeSequences ? KateRegExpSearch::escapePlaintext(pattern) : pattern;
+        if (needle.isEmpty() || needle.contains(QLatin1Char('\n'))) {
+            return false;
+        }
+        plainTextSearch.reset(new KatePlainTextSearch(m_document,
+                                                      m_options.testFlag(KTextEditor::CaseInsensitive) ? Qt::CaseInsensitive : Qt::CaseSensitive,
+                                                      m_options.testFlag(KTextEditor::WholeWords)));
+    }
+
+    // next match, the plain text search goes on where the last match ended
+    KTextEditor::Cursor plainTextStart = range.start();
+    const auto nextMatch = [&]() -> QVector<KTextEditor::Range> {
+        if (regExpMatches) {
+            return regExpMatches->next();
+        }
+        if (plainTextStart >= range.end()) {
+            return {};
+        }
+        const KTextEditor::Range match = plainTextSearch->search(needle, KTextEditor::Range(plainTextStart, range.end()));
+        if (!match.isValid()) {
+            return {};
+        }
+        plainTextStart = match.end();
+        return {match};
+    };
+
+    // same placeholder handling as replace()
+    const bool usePlaceholders = (regexMode || escapeSequences) && replacement.contains(QLatin1Char('\\'));
+
+    // the new text of each changed line, from the start of its first match to the end of its last match
+    struct LineChange {
+        int line;
+        int startColumn;
+        int endColumn;
+        QString text;
+    };
+    std::vector<LineChange> changes;
+
+    // build all replacements before anything is changed, the captures are taken from the line texts
+    const KTextEditor::Cursor documentEnd = m_document->documentEnd();
+    QString lineText;
+    for (QVector<KTextEditor::Range> match = nextMatch(); !match.isEmpty(); match = nextMatch()) {
+        const KTextEditor::Range matchRange = match.at(0);
+        const int line = matchRange.start().line();
+        const bool sameLine = !changes.empty() && changes.back().line == line;
+        if (sameLine && onlyOnePerLine) {
+            continue;
+        }
+
+        if (!sameLine) {
+            lineText = m_document->line(line);
+            changes.push_back({line, matchRange.start().column(), matchRange.start().column(), QString()});
+        }
+
+        QString finalReplacement = replacement;
+        if (usePlaceholders) {
+            QStringList capturedTexts;
+            capturedTexts.reserve(match.size());
+            for (const KTextEditor::Range &captureRange : qAsConst(match)) {
+                capturedTexts << (captureRange.isValid() ? lineText.mid(captureRange.start().column(), captureRange.columnWidth()) : QString());
+            }
+            finalReplacement = KateRegExpSearch::buildReplacement(replacement, capturedTexts, replacementCounter);
+        }
+        ++replacementCounter;
+
+        if (finalReplacement.contains(QLatin1Char('\n'))) {
+            replacedRanges.clear();
+            return false;
+        }
+
+        // keep the text between the matches, the replacement ranges are positions in the changed line
+        LineChange &change = changes.back();
+        change.text += lineText.midRef(change.endColumn, matchRange.start().column() - change.endColumn);
+        const int replacementStart = change.startColumn + change.text.size();
+        change.text += finalReplacement;
+        change.endColumn = matchRange.end().column();
+        replacedRanges.append(KTextEditor::Range(line, replacementStart, line, replacementStart + finalReplacement.size()));
+
+        // like the search after a single replacement, the search ends once it goes on at the end of the document,
+        // e.g. an empty match there isn't replaced after a match right before it
+        KTextEditor::Cursor next(line, matchRange.end().column() + (matchRange.isEmpty() ? 1 : 0));
+        if (onlyOnePerLine || next.column() > lineText.size()) {
+            next = KTextEditor::Cursor(line + 1, 0);
+        }
+        if (next >= documentEnd) {
+            break;
+        }
+        plainTextStart = next;
+    }
+
+    // one change per line
+    m_document->editStart();
+    for (const LineChange &change : changes) {
+        m_document->editReplaceText(change.line, change.startColumn, change.endColumn - change.startColumn, change.text);
+    }
+    m_document->editEnd();
+
+    return true;
+}
+
 KTextEditor::Range KateMatch::range() const
 {
     if (!m_resultRanges.isEmpty()) {
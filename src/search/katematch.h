@@ -13,6 +13,8 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/movingrange.h>
 
+class KateRegExpSearch;
+
 namespace KTextEditor
 {
 class DocumentPrivate;
@@ -22,8 +24,29 @@ class KateMatch
 {
 public:
     KateMatch(KTextEditor::DocumentPrivate *document, KTextEditor::SearchOptions options);
+    ~KateMatch();
     KTextEditor::Range searchText(const KTextEditor::Range &range, const QString &pattern);
     KTextEditor::Range replace(const QString &replacement, bool blockMode, int replacementCounter = 1);
+
+    /**
+     * Replace all matches of @p pattern in @p range in one go.
+     * The replacements of all matches are built first, then each changed line gets rewritten once,
+     * with one undo item, see KTextEditor::DocumentPrivate::editReplaceText().
+     * This works only if neither the matches nor the replacements span multiple lines.
+     * @param range range to replace the matches in
+     * @param pattern pattern to search for
+     * @param replacement replacement, references and escape sequences are resolved in regex and escape sequences mode
+     * @param replacementCounter value of the replacement counter for the first replacement, it is incremented for each one
+     * @param replacedRanges is set to the ranges of the replacements, in document order
+     * @param onlyOnePerLine replace only the first match of each line
+     * @return false if the matches can't be replaced in one go, then nothing is changed
+     */
+    bool replaceAll(const KTextEditor::Range &range,
+                    const QString &pattern,
+                    const QString &replacement,
+                    int replacementCounter,
+                    QVector<KTextEditor::Range> &replacedRanges,
+                    bool onlyOnePerLine = false);
     bool isValid() const;
     bool isEmpty() const;
     KTextEditor::Range range() const;
@@ -39,6 +62,11 @@ private:
     const KTextEditor::SearchOptions m_options;
     QVector<KTextEditor::Range> m_resultRanges;
 
+    /**
+     * prepared search in regex mode, kept to not compile the pattern for each search again
+     */
+    std::unique_ptr<KateRegExpSearch> m_regExpSearch;
+
     /**
      * moving range to track replace changes
      * kept for later reuse
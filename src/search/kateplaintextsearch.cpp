@@ -8,21 +8,256 @@
 // BEGIN includes
 #include "kateplaintextsearch.h"
 
-#include "kateregexpsearch.h"
-
 #include <ktexteditor/document.h>
 
+#include "katebuffer.h"
+#include "katedocument.h"
+#include "katehighlight.h"
 #include "katepartdebug.h"
 
-#include <QRegularExpression>
+#include <QThread>
+#include <QtAlgorithms>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// vectorized candidate scanning
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 // END  includes
 
+/**
+ * lines searched at once by a thread of searchAllParallel()
+ */
+static const int KATE_PLAINTEXT_PARALLEL_CHUNK_LINES = 4096;
+
+namespace
+{
+/**
+ * Literal search kernel: finds the needle in the text of a line, case sensitive or not, optionally as whole word.
+ * Candidate positions are found by comparing the first and the last character of the needle
+ * with the text, 8 positions per step with SSE2, only they are compared as a whole.
+ */
+class LiteralMatcher
+{
+public:
+    LiteralMatcher(const QString &needle, Qt::CaseSensitivity caseSensitivity, bool wholeWords, const KateHighlighting *highlight)
+        : m_caseSensitivity(caseSensitivity)
+        , m_wholeWords(wholeWords)
+        , m_highlight(highlight)
+        , m_size(needle.size())
+    {
+        // compared case folded, like QString::indexOf() does, surrogate pairs are folded by Qt only
+        if (m_caseSensitivity == Qt::CaseInsensitive) {
+            m_foldedNeedle.reserve(m_size);
+            for (const QChar c : needle) {
+                m_foldedNeedle.append(c.toCaseFolded());
+                m_qtCompare = m_qtCompare || c.isSurrogate();
+            }
+        }
+        m_needle = needle;
+
+        if (m_size > 0) {
+            m_startInWord = isInWord(needle.at(0));
+            m_endInWord = isInWord(needle.at(m_size - 1));
+            m_filter = filterVariants(needle.at(0), m_first) && filterVariants(needle.at(m_size - 1), m_last);
+        }
+    }
+
+    /**
+     * Is the needle at the given position, bounded like a word if wanted?
+     */
+    bool matchesAt(const QString &text, int position) const
+    {
+        if (m_qtCompare) {
+            if (QStringRef(&text, position, m_size).compare(m_needle, m_caseSensitivity) != 0) {
+                return false;
+            }
+        } else if (m_caseSensitivity == Qt::CaseSensitive) {
+            if (memcmp(text.unicode() + position, m_needle.unicode(), m_size * sizeof(QChar)) != 0) {
+                return false;
+            }
+        } else {
+            const QChar *hay = text.unicode() + position;
+            const QChar *needle = m_foldedNeedle.unicode();
+            for (int i = 0; i < m_size; ++i) {
+                if (hay[i] != needle[i] && hay[i].toCaseFolded() != needle[i]) {
+                    return false;
+                }
+            }
+        }
+
+        return !m_wholeWords || (isWordStart(text, position) && isWordEnd(text, position + m_size));
+    }
+
+    /**
+     * Is there no word character in front of the given position, if the needle starts with one?
+     */
+    bool isWordStart(const QString &text, int position) const
+    {
+        return !m_startInWord || position == 0 || !isInWord(text.at(position - 1));
+    }
+
+    /**
+     * Is there no word character at the given position, if the needle ends with one?
+     */
+    bool isWordEnd(const QString &text, int position) const
+    {
+        return !m_endInWord || position >= text.size() || !isInWord(text.at(position));
+    }
+
+    /**
+     * First match in the text that starts at or after from and ends at or before to, -1 if none.
+     */
+    int indexIn(const QString &text, int from, int to) const
+    {
+        const int last = qMin(to, text.size()) - m_size;
+        int i = qMax(from, 0);
+        if (m_size == 0 || i > last) {
+            return -1;
+        }
+
+#if defined(__SSE2__)
+        if (m_filter) {
+            const ushort *hay = reinterpret_cast<const ushort *>(text.unicode());
+            for (; last - i >= 7; i += 8) {
+                uint mask = candidates(hay + i);
+                while (mask) {
+                    // two mask bits per character
+                    const int candidate = i + qCountTrailingZeroBits(mask) / 2;
+                    if (matchesAt(text, candidate)) {
+                        return candidate;
+                    }
+                    mask &= ~(3U << ((candidate - i) * 2));
+                }
+            }
+        }
+#endif
+
+        // scalar fallback and tail handling
+        for (; i <= last; ++i) {
+            if (matchesAt(text, i)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Last match in the text that starts at or after from and ends at or before to, -1 if none.
+     */
+    int lastIndexIn(const QString &text, int from, int to) const
+    {
+        const int first = qMax(from, 0);
+        int i = qMin(to, text.size()) - m_size;
+        if (m_size == 0 || i < first) {
+            return -1;
+        }
+
+#if defined(__SSE2__)
+        if (m_filter) {
+            const ushort *hay = reinterpret_cast<const ushort *>(text.unicode());
+            for (; i - first >= 7; i -= 8) {
+                uint mask = candidates(hay + i - 7);
+                while (mask) {
+                    // two mask bits per character, the highest one is the last candidate
+                    const int candidate = i - 7 + (31 - qCountLeadingZeroBits(mask)) / 2;
+                    if (matchesAt(text, candidate)) {
+                        return candidate;
+                    }
+                    mask &= ~(3U << ((candidate - i + 7) * 2));
+                }
+            }
+        }
+#endif
+
+        // scalar fallback and tail handling
+        for (; i >= first; --i) {
+            if (matchesAt(text, i)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+private:
+    bool isInWord(QChar c) const
+    {
+        // the rules of the highlighting, like for word selection, without document the ones of \w
+        return m_highlight ? m_highlight->isInWord(c) : (c.isLetterOrNumber() || c.isMark() || c == QLatin1Char('_'));
+    }
+
+    /**
+     * The characters a text character must be to match the given needle character, if they can be listed.
+     * Case insensitive, that's only the case for ASCII characters no other character folds to.
+     */
+    bool filterVariants(QChar c, ushort *variants) const
+    {
+        if (m_qtCompare || (m_caseSensitivity == Qt::CaseInsensitive && c.unicode() >= 128)) {
+            return false;
+        }
+
+        if (m_caseSensitivity == Qt::CaseSensitive) {
+            variants[0] = variants[1] = c.unicode();
+            return true;
+        }
+
+        // Kelvin sign, long s and dotted capital I fold to these
+        const QChar folded = c.toCaseFolded();
+        if (folded == QLatin1Char('k') || folded == QLatin1Char('s') || folded == QLatin1Char('i')) {
+            return false;
+        }
+        variants[0] = c.toLower().unicode();
+        variants[1] = c.toUpper().unicode();
+        return true;
+    }
+
+#if defined(__SSE2__)
+    /**
+     * Mask of the candidate positions among the 8 starting at the given text, two bits per position.
+     */
+    uint candidates(const ushort *hay) const
+    {
+        const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay));
+        const __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + m_size - 1));
+        const __m128i firstHits = _mm_or_si128(_mm_cmpeq_epi16(starts, _mm_set1_epi16(short(m_first[0]))), _mm_cmpeq_epi16(starts, _mm_set1_epi16(short(m_first[1]))));
+        const __m128i lastHits = _mm_or_si128(_mm_cmpeq_epi16(ends, _mm_set1_epi16(short(m_last[0]))), _mm_cmpeq_epi16(ends, _mm_set1_epi16(short(m_last[1]))));
+        return uint(_mm_movemask_epi8(_mm_and_si128(firstHits, lastHits)));
+    }
+#endif
+
+private:
+    const Qt::CaseSensitivity m_caseSensitivity;
+    const bool m_wholeWords;
+    const KateHighlighting *const m_highlight;
+    const int m_size;
+    QString m_needle;
+    QString m_foldedNeedle;
+    bool m_qtCompare = false;
+    bool m_startInWord = false;
+    bool m_endInWord = false;
+    bool m_filter = false;
+    ushort m_first[2] = {0, 0};
+    ushort m_last[2] = {0, 0};
+};
+}
+
 // BEGIN d'tor, c'tor
 //
 // KateSearch Constructor
 //
 KatePlainTextSearch::KatePlainTextSearch(const KTextEditor::Document *document, Qt::CaseSensitivity caseSensitivity, bool wholeWords)
-    : m_document(document)
+    : m_text(document)
+    , m_caseSensitivity(caseSensitivity)
+    , m_wholeWords(wholeWords)
+{
+}
+
+KatePlainTextSearch::KatePlainTextSearch(const KateSearchText &text, Qt::CaseSensitivity caseSensitivity, bool wholeWords)
+    : m_text(text)
     , m_caseSensitivity(caseSensitivity)
     , m_wholeWords(wholeWords)
 {
@@ -38,17 +273,6 @@ KatePlainTextSearch::~KatePlainTextSearch()
 
 KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextEditor::Range &inputRange, bool backwards)
 {
-    // abuse regex for whole word plaintext search
-    if (m_wholeWords) {
-        // escape dot and friends
-        const QString workPattern = QStringLiteral("\\b%1\\b").arg(QRegularExpression::escape(text));
-
-        QRegularExpression::PatternOptions options;
-        options |= m_caseSensitivity == Qt::CaseInsensitive ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption;
-
-        return KateRegExpSearch(m_document).search(workPattern, inputRange, backwards, options).at(0);
-    }
-
     if (text.isEmpty() || !inputRange.isValid() || (inputRange.start() == inputRange.end())) {
         return KTextEditor::Range::invalid();
     }
@@ -56,6 +280,15 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextE
     // split multi-line needle into single lines
     const auto needleLines = text.splitRef(QLatin1Char('\n'));
 
+    // with a search index, the lines of blocks that can't contain the (first line of the) needle are skipped
+    const auto doc = qobject_cast<const KTextEditor::DocumentPrivate *>(m_text.document());
+    const KateBuffer *buffer = (doc && doc->buffer().searchIndexEnabled()) ? &doc->buffer() : nullptr;
+    const std::vector<quint32> trigrams = buffer ? Kate::TextBuffer::searchIndexTrigrams(needleLines[0].toString()) : std::vector<quint32>();
+
+    // word boundaries follow the rules of the highlighting
+    const KateHighlighting *highlight = (m_wholeWords && doc) ? doc->highlight() : nullptr;
+    const LiteralMatcher matcher(text, m_caseSensitivity, m_wholeWords, highlight);
+
     if (needleLines.count() > 1) {
         // multi-line plaintext search (both forwards or backwards)
         const int forMin = inputRange.start().line(); // first line in range
@@ -64,12 +297,19 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextE
         const int forInc = backwards ? -1 : +1;
 
         for (int j = forInit; (forMin <= j) && (j <= forMax); j += forInc) {
+            if (!trigrams.empty()) {
+                j = buffer->searchIndexNextLine(j, trigrams, backwards);
+                if ((j < forMin) || (forMax < j)) {
+                    break;
+                }
+            }
+
             // try to match all lines
-            const int startCol = m_document->lineLength(j) - needleLines[0].length();
+            const int startCol = m_text.lineLength(j) - needleLines[0].length();
             for (int k = 0; k < needleLines.count(); k++) {
                 // which lines to compare
                 const QStringRef &needleLine = needleLines[k];
-                const QString &hayLine = m_document->line(j + k);
+                const QString &hayLine = m_text.line(j + k);
 
                 // position specific comparison (first, middle, last)
                 if (k == 0) {
@@ -80,7 +320,7 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextE
 
                     // NOTE: QString("")::endsWith("") is false in Qt, therefore we need the additional checks.
                     const bool endsWith = hayLine.endsWith(needleLine, m_caseSensitivity) || (hayLine.isEmpty() && needleLine.isEmpty());
-                    if (!endsWith) {
+                    if (!endsWith || (m_wholeWords && !matcher.isWordStart(hayLine, startCol))) {
                         break;
                     }
                 } else if (k == needleLines.count() - 1) {
@@ -89,7 +329,7 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextE
 
                     // NOTE: QString("")::startsWith("") is false in Qt, therefore we need the additional checks.
                     const bool startsWith = hayLine.startsWith(needleLine, m_caseSensitivity) || (hayLine.isEmpty() && needleLine.isEmpty());
-                    if (startsWith && needleLine.length() <= maxRight) {
+                    if (startsWith && needleLine.length() <= maxRight && (!m_wholeWords || matcher.isWordEnd(hayLine, needleLine.length()))) {
                         return KTextEditor::Range(j, startCol, j + k, needleLine.length());
                     }
                 } else {
@@ -112,22 +352,117 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, const KTextE
         const int forInc = backwards ? -1 : +1;
 
         for (int line = backwards ? endLine : startLine; (startLine <= line) && (line <= endLine); line += forInc) {
-            if ((line < 0) || (m_document->lines() <= line)) {
-                qCWarning(LOG_KTE) << "line " << line << " is not within interval [0.." << m_document->lines() << ") ... returning invalid range";
+            if (!trigrams.empty() && (line >= 0) && (line < m_text.lines())) {
+                line = buffer->searchIndexNextLine(line, trigrams, backwards);
+                if ((line < startLine) || (endLine < line)) {
+                    break;
+                }
+            }
+
+            if ((line < 0) || (m_text.lines() <= line)) {
+                qCWarning(LOG_KTE) << "line " << line << " is not within interval [0.." << m_text.lines() << ") ... returning invalid range";
                 return KTextEditor::Range::invalid();
             }
 
-            const QString textLine = m_document->line(line);
+            const QString textLine = m_text.line(line);
 
             const int offset = (line == startLine) ? startCol : 0;
             const int line_end = (line == endLine) ? endCol : textLine.length();
-            const int foundAt =
-                backwards ? textLine.lastIndexOf(text, line_end - text.length(), m_caseSensitivity) : textLine.indexOf(text, offset, m_caseSensitivity);
+            const int foundAt = backwards ? matcher.lastIndexIn(textLine, offset, line_end) : matcher.indexIn(textLine, offset, line_end);
 
-            if ((offset <= foundAt) && (foundAt + text.length() <= line_end)) {
+            if (foundAt >= 0) {
                 return KTextEditor::Range(line, foundAt, line, foundAt + text.length());
             }
         }
     }
     return KTextEditor::Range::invalid();
 }
+
+QVector<KTextEditor::Range> KatePlainTextSearch::searchAllParallel(const QString &text, const KTextEditor::Range &inputRange, int &matchCount, int maxMatches)
+{
+    // nothing to do, same checks as for the other searches
+    matchCount = 0;
+    if (text.isEmpty() || !inputRange.isValid() || inputRange.isEmpty() || inputRange.start().line() < 0 || inputRange.end().line() >= m_text.lines()) {
+        return QVector<KTextEditor::Range>();
+    }
+
+    // a multi-line match depends on the lines around it, they can't be searched independently
+    if (text.contains(QLatin1Char('\n'))) {
+        QVector<KTextEditor::Range> result;
+        KTextEditor::Range range = inputRange;
+        for (KTextEditor::Range match = search(text, range); match.isValid(); match = search(text, range)) {
+            ++matchCount;
+            if (result.size() != maxMatches) {
+                result.append(match);
+            }
+            range.setStart(match.end());
+        }
+        return result;
+    }
+
+    // the matcher is shared by the threads, it is not changed once constructed
+    // it already asked the highlighting about the needle, that loaded its word delimiters
+    const auto doc = qobject_cast<const KTextEditor::DocumentPrivate *>(m_text.document());
+    const KateHighlighting *highlight = (m_wholeWords && doc) ? doc->highlight() : nullptr;
+    const LiteralMatcher matcher(text, m_caseSensitivity, m_wholeWords, highlight);
+
+    // snapshot of the texts, they are implicitly shared, the threads never access the document
+    const int firstLine = inputRange.start().line();
+    const int lastLine = inputRange.end().line();
+    QVector<QString> texts;
+    texts.reserve(lastLine - firstLine + 1);
+    for (int line = firstLine; line <= lastLine; ++line) {
+        texts.append(m_text.line(line));
+    }
+
+    // results of one chunk of lines, a chunk needs no more ranges than the whole search
+    struct Chunk {
+        QVector<KTextEditor::Range> ranges;
+        int count = 0;
+    };
+    std::vector<Chunk> chunks((texts.size() + KATE_PLAINTEXT_PARALLEL_CHUNK_LINES - 1) / KATE_PLAINTEXT_PARALLEL_CHUNK_LINES);
+
+    // search the chunks, each thread takes the next unhandled one
+    std::atomic<size_t> nextChunk(0);
+    auto work = [&]() {
+        for (size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) {
+            Chunk &chunk = chunks[c];
+            const int chunkEnd = qMin(int(c + 1) * KATE_PLAINTEXT_PARALLEL_CHUNK_LINES, texts.size());
+            for (int i = int(c) * KATE_PLAINTEXT_PARALLEL_CHUNK_LINES; i < chunkEnd; ++i) {
+                const int line = firstLine + i;
+                const QString &hayLine = texts.at(i);
+                const int startColumn = (line == firstLine) ? inputRange.start().column() : 0;
+                const int endColumn = (line == lastLine) ? inputRange.end().column() : hayLine.length();
+                for (int column = matcher.indexIn(hayLine, startColumn, endColumn); column >= 0;
+                     column = matcher.indexIn(hayLine, column + text.length(), endColumn)) {
+                    ++chunk.count;
+                    if (chunk.ranges.size() != maxMatches) {
+                        chunk.ranges.append(KTextEditor::Range(line, column, line, column + text.length()));
+                    }
+                }
+            }
+        }
+    };
+    const int threads = qMax(1, QThread::idealThreadCount());
+    std::vector<std::thread> workers;
+    for (int t = 1; t < qMin(threads, int(chunks.size())); ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // the chunks are in document order, their matches too
+    QVector<KTextEditor::Range> result;
+    for (const Chunk &chunk : chunks) {
+        matchCount += chunk.count;
+        for (const KTextEditor::Range &range : chunk.ranges) {
+            if (result.size() == maxMatches) {
+                break;
+            }
+            result.append(range);
+        }
+    }
+    return result;
+}
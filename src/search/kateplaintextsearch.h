@@ -14,10 +14,7 @@
 
 #include <ktexteditor_export.h>
 
-namespace KTextEditor
-{
-class Document;
-}
+#include "katesearchtext.h"
 
 /**
  * Object to help to search for plain text.
@@ -28,6 +25,12 @@ class KTEXTEDITOR_EXPORT KatePlainTextSearch
 {
 public:
     explicit KatePlainTextSearch(const KTextEditor::Document *document, Qt::CaseSensitivity caseSensitivity, bool wholeWords);
+
+    /**
+     * Search in the given lines, e.g. a snapshot of a document.
+     * Without document, whole words are bounded like \\b of regular expressions.
+     */
+    KatePlainTextSearch(const KateSearchText &text, Qt::CaseSensitivity caseSensitivity, bool wholeWords);
     ~KatePlainTextSearch();
 
 public:
@@ -45,8 +48,21 @@ public:
      */
     KTextEditor::Range search(const QString &text, const KTextEditor::Range &inputRange, bool backwards = false);
 
+    /**
+     * Search for all matches of \p text inside the range \p inputRange, forwards, the lines are searched on several threads.
+     * The texts of the lines are taken in the calling thread, the document isn't touched by the other threads.
+     * Only single-line texts are searched in parallel, multi-line texts are searched match by match.
+     *
+     * \param text text to search for
+     * \param inputRange Range to search in
+     * \param matchCount is set to the number of all matches in the range
+     * \param maxMatches only the ranges of this number of matches are returned, the others are just counted, -1 for no limit
+     * \return ranges of the matches, in document order
+     */
+    QVector<KTextEditor::Range> searchAllParallel(const QString &text, const KTextEditor::Range &inputRange, int &matchCount, int maxMatches = -1);
+
 private:
-    const KTextEditor::Document *m_document;
+    const KateSearchText m_text;
     Qt::CaseSensitivity m_caseSensitivity;
     bool m_wholeWords;
 };
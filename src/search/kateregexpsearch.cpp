@@ -9,6 +9,16 @@
 #include "kateregexpsearch.h"
 
 #include <ktexteditor/document.h>
+
+#include "katebuffer.h"
+#include "katedocument.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 // END  includes
 
 // Turn debug messages on/off here
@@ -142,338 +152,640 @@ KateRegExpSearch::ReplacementStream &KateRegExpSearch::ReplacementStream::operat
     return *this;
 }
 
-// BEGIN d'tor, c'tor
-//
-// KateSearch Constructor
-//
-KateRegExpSearch::KateRegExpSearch(const KTextEditor::Document *document)
-    : m_document(document)
-{
-}
+/**
+ * multi-line search: number of lines the searched text window spans at first, it grows only if a match might continue after it
+ */
+static const int KATE_REGEXP_WINDOW_LINES = 32;
 
-//
-// KateSearch Destructor
-//
-KateRegExpSearch::~KateRegExpSearch()
+/**
+ * parallel search: number of lines one thread searches at once
+ */
+static const int KATE_REGEXP_PARALLEL_CHUNK_LINES = 4096;
+
+/**
+ * backward search: number of characters at the end of a line searched first, the chunks double towards its start
+ */
+static const int KATE_REGEXP_BACKWARD_CHUNK_CHARS = 256;
+
+namespace
 {
-}
+// helper for the multi-line search: the lines of a part of the searched range, joined by '\n'
+class LineWindow
+{
+public:
+    explicit LineWindow(const KateSearchText &lines)
+        : m_lines(lines)
+    {
+    }
 
-// helper structs for captures re-construction
-struct TwoViewCursor {
-    int index;
-    int line;
-    int col;
-};
+    void fill(int firstLine, int lastLine)
+    {
+        m_firstLine = firstLine;
+        m_text.clear();
+        m_lineStarts.clear();
+        for (int line = firstLine; line <= lastLine; ++line) {
+            // no '\n' after the last line, it is not part of the text
+            if (line > firstLine) {
+                m_text.append(QLatin1Char('\n'));
+            }
+            m_lineStarts.push_back(m_text.size());
+            m_text.append(m_lines.line(line));
+        }
+    }
+
+    const QString &text() const
+    {
+        return m_text;
+    }
 
-struct IndexPair {
-    int openIndex;
-    int closeIndex;
+    int lastLine() const
+    {
+        return m_firstLine + m_lineStarts.size() - 1;
+    }
+
+    int lineStart(int line) const
+    {
+        return m_lineStarts.at(line - m_firstLine);
+    }
+
+    int offset(const KTextEditor::Cursor &cursor) const
+    {
+        const int lineEnd = (cursor.line() < lastLine()) ? lineStart(cursor.line() + 1) - 1 : m_text.size();
+        return qMin(lineStart(cursor.line()) + cursor.column(), lineEnd);
+    }
+
+    KTextEditor::Cursor cursor(int offset) const
+    {
+        // the '\n' after a line maps to the end of that line
+        const int index = std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset) - m_lineStarts.begin() - 1;
+        return KTextEditor::Cursor(m_firstLine + index, offset - m_lineStarts.at(index));
+    }
+
+private:
+    const KateSearchText &m_lines;
+    int m_firstLine = 0;
+    QString m_text;
+    QVector<int> m_lineStarts;
 };
 
-QVector<KTextEditor::Range>
-KateRegExpSearch::search(const QString &pattern, const KTextEditor::Range &inputRange, bool backwards, QRegularExpression::PatternOptions options)
+// the literal text all matches of the pattern start with, as far as it can be told without parsing the pattern
+QString literalPrefix(const QString &pattern)
 {
-    // Returned if no matches are found
-    QVector<KTextEditor::Range> noResult(1, KTextEditor::Range::invalid());
+    // alternatives might start with anything
+    for (int i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == QLatin1Char('\\')) {
+            ++i;
+        } else if (pattern[i] == QLatin1Char('|')) {
+            return QString();
+        }
+    }
 
-    // Note that some methods in vimode (e.g. Searcher::findPatternWorker) rely on the
-    // this method returning here when pattern.isEmpty()
-    // Also if repairPattern() is called on an invalid regex pattern it may cause asserts
-    // in QString (e.g. if the pattern is just '\\', pattern.size() is 1, and repaierPattern
-    // expects at least one character after a \)
-    if (pattern.isEmpty() || !QRegularExpression(pattern).isValid() || !inputRange.isValid() || inputRange.isEmpty()) {
-        return noResult;
+    // anchors at the start don't match text
+    int i = 0;
+    while (i < pattern.size()) {
+        if (pattern[i] == QLatin1Char('^')) {
+            ++i;
+        } else if (pattern.midRef(i, 2) == QLatin1String("\\b")) {
+            i += 2;
+        } else {
+            break;
+        }
     }
 
-    QRegularExpression regexp;
+    QString prefix;
+    for (; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (QStringLiteral(".[](){}*+?^$").contains(c)) {
+            // the last character is optional with these quantifiers
+            if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('{')) {
+                prefix.chop(1);
+            }
+            break;
+        }
+
+        // escaped characters stand for themselves, beside ASCII letters and digits, they are classes, references or the like
+        if (c == QLatin1Char('\\')) {
+            if (i + 1 >= pattern.size() || (pattern[i + 1].unicode() < 128 && pattern[i + 1].isLetterOrNumber())) {
+                break;
+            }
+            ++i;
+        }
+        prefix.append(pattern[i]);
+    }
+    return prefix;
+}
 
-    // detect pattern type (single- or mutli-line)
-    bool stillMultiLine;
-    const QString repairedPattern = repairPattern(pattern, stillMultiLine);
+// The match that starts last at a position in [from, to) and ends at or before limit, a match at a position is the one
+// a search from there finds. Chunks that grow towards from are searched, the first one in which matches start is
+// walked through if it is small, else split again, so the matches before it are never enumerated.
+QRegularExpressionMatch lastMatch(const QRegularExpression &regexp, const QString &text, int from, int to, int limit)
+{
+    int end = to;
+    for (int size = KATE_REGEXP_BACKWARD_CHUNK_CHARS; end > from; size *= 2) {
+        const int start = qMax(from, end - size);
+        QRegularExpressionMatch match = regexp.match(text, start);
+        if (match.hasMatch() && match.capturedStart() < end) {
+            QRegularExpressionMatch last;
+            if (end - start <= KATE_REGEXP_BACKWARD_CHUNK_CHARS) {
+                for (; match.hasMatch() && match.capturedStart() < end; match = regexp.match(text, match.capturedStart() + 1)) {
+                    if (match.capturedEnd() <= limit) {
+                        last = match;
+                    }
+                }
+            } else {
+                last = lastMatch(regexp, text, match.capturedStart(), end, limit);
+            }
 
-    // Enable multiline mode, so that the ^ and $ metacharacters in the pattern
-    // are allowed to match, respectively, immediately after and immediately
-    // before any newline in the subject string, as well as at the very beginning
-    // and at the very end of the subject string (see QRegularExpression docs).
-    //
-    // Whole lines are passed to QRegularExpression, so that e.g. if the inputRange
-    // ends in the middle of a line, then a '$' won't match at that position. And
-    // matches that are out of the inputRange are rejected.
-    if (stillMultiLine) {
-        options |= QRegularExpression::MultilineOption;
+            if (last.hasMatch()) {
+                return last;
+            }
+        }
+        end = start;
     }
+    return QRegularExpressionMatch();
+}
+}
 
-    regexp.setPattern(repairedPattern);
-    regexp.setPatternOptions(options);
-    if (!regexp.isValid()) {
-        return noResult;
+class KateRegExpSearch::MatchIterator::Private
+{
+public:
+    Private(const KateSearchText &document, const QRegularExpression &regexp, bool multiLine, const KTextEditor::Range &range, bool backwards)
+        : document(document)
+        , regexp(regexp)
+        , multiLine(multiLine)
+        , range(range)
+        , backwards(backwards)
+        , position(range.start())
+        , window(this->document)
+        , line(range.end().line())
+    {
+        // nothing to do...
+        done = !range.isValid() || range.isEmpty() || range.start().line() < 0 || range.end().line() >= document.lines();
     }
 
-    const int rangeStartLine = inputRange.start().line();
-    const int rangeStartCol = inputRange.start().column();
+    QVector<KTextEditor::Range> nextMultiLine();
+    QVector<KTextEditor::Range> nextSingleLine();
+    QVector<KTextEditor::Range> nextBackwards();
 
-    const int rangeEndLine = inputRange.end().line();
-    const int rangeEndCol = inputRange.end().column();
+    const KateSearchText document;
+    const QRegularExpression regexp;
+    const bool multiLine;
+    const KTextEditor::Range range;
+    const bool backwards;
+    bool done = false;
 
-    if (stillMultiLine) {
-        const int rangeLineCount = rangeEndLine - rangeStartLine + 1;
-        FAST_DEBUG("regular expression search (lines " << rangeStartLine << ".." << rangeEndLine << ")");
+    // forwards: position to search from
+    KTextEditor::Cursor position;
 
-        const int docLineCount = m_document->lines();
-        // nothing to do...
-        if (rangeStartLine >= docLineCount) {
-            return noResult;
+    // forwards, multi-line: window of lines around the position
+    LineWindow window;
+    int windowLines = KATE_REGEXP_WINDOW_LINES;
+    bool fill = true;
+
+    // forwards, single-line: text of the line of the position
+    QString text;
+    int textLine = -1;
+
+    // backwards: next line to search, single-line: the next match starts before and ends at or before column, -1 for no limit in the line
+    int line;
+    int column = -1;
+
+    // backwards, multi-line: the matches found, but not yet returned, the last one comes next
+    QVector<QVector<KTextEditor::Range>> pending;
+
+    // single-line: buffer with search index and the trigrams of the literal prefix of the pattern, to skip lines
+    const Kate::TextBuffer *buffer = nullptr;
+    std::vector<quint32> trigrams;
+};
+
+QVector<KTextEditor::Range> KateRegExpSearch::MatchIterator::Private::nextMultiLine()
+{
+    // The range is searched in a window of whole lines that slides forward, it only grows
+    // if PCRE reports a partial match at its end, so a match never has to be searched in
+    // the rest of the document.
+    const int rangeStartLine = range.start().line();
+    const int rangeEndLine = range.end().line();
+
+    while (!done) {
+        if (fill) {
+            // one line before the position is kept as context for lookbehinds
+            window.fill(qMax(rangeStartLine, position.line() - 1), qMin(rangeEndLine, position.line() + windowLines - 1));
+            fill = false;
         }
 
-        QVector<int> lineLens(rangeLineCount);
-        int maxMatchOffset = 0;
+        // Whole lines are passed to QRegularExpression, so that e.g. if the inputRange
+        // ends in the middle of a line, then a '$' won't match at that position. And
+        // matches that are out of the inputRange are rejected.
+        // Before the end of the range, partial matches tell that the lines after the window are needed.
+        const bool atRangeEnd = window.lastLine() == rangeEndLine;
+        const QRegularExpressionMatch match =
+            regexp.match(window.text(), window.offset(position), atRangeEnd ? QRegularExpression::NormalMatch : QRegularExpression::PartialPreferFirstMatch);
+
+        // the match might continue after the window or depends on what follows, take more lines
+        if (!atRangeEnd && (match.hasPartialMatch() || (match.hasMatch() && match.capturedEnd() >= window.lineStart(window.lastLine())))) {
+            FAST_DEBUG("partial match, window grows to" << windowLines * 2 << "lines");
+            windowLines *= 2;
+            fill = true;
+            continue;
+        }
 
-        // all lines in the input range
-        QString wholeRange;
-        for (int i = 0; i < rangeLineCount; ++i) {
-            const int docLineIndex = rangeStartLine + i;
-            if (docLineIndex < 0 || docLineCount <= docLineIndex) { // invalid index
-                return noResult;
+        if (!match.hasMatch()) {
+            if (atRangeEnd) {
+                break;
             }
 
-            const QString textLine = m_document->line(docLineIndex);
-            lineLens[i] = textLine.length();
-            wholeRange.append(textLine);
-
-            // This check is needed as some parts in vimode rely on this behaviour.
-            // We add an '\n' as a delimiter between lines in the range; but never after the
-            // last line as that would add an '\n' that isn't there in the original text,
-            // and can skew search results or hit an assert when accessing lineLens later
-            // in the code.
-            if (i != (rangeLineCount - 1)) {
-                wholeRange.append(QLatin1Char('\n'));
-            }
+            // no match starts before the last line of the window, slide the window forward
+            position = qMax(position, KTextEditor::Cursor(window.lastLine(), 0));
+            windowLines = KATE_REGEXP_WINDOW_LINES;
+            fill = true;
+            continue;
+        }
 
-            // lineLens.at(i) + 1, because '\n' was added
-            maxMatchOffset += (i == rangeEndLine) ? rangeEndCol : lineLens.at(i) + 1;
+        if (window.cursor(match.capturedEnd()) > range.end()) {
+            FAST_DEBUG("match ends after the range");
+            break;
+        }
 
-            FAST_DEBUG("  line" << i << "has length" << lineLens.at(i));
+        // an invalid index indicates an empty capture group
+        QVector<KTextEditor::Range> result(regexp.captureCount() + 1);
+        for (int c = 0; c < result.size(); ++c) {
+            const int openIndex = match.capturedStart(c);
+            result[c] = (openIndex == -1) ? KTextEditor::Range::invalid() : KTextEditor::Range(window.cursor(openIndex), window.cursor(match.capturedEnd(c)));
         }
 
-        FAST_DEBUG("Max. match offset" << maxMatchOffset);
+        // continue after the match, an empty match must advance
+        int next = match.capturedEnd();
+        if (match.capturedLength() == 0) {
+            done = next >= window.text().size();
+            ++next;
+        }
+        if (!done) {
+            position = window.cursor(next);
+        }
+        return result;
+    }
 
-        QRegularExpressionMatch match;
-        bool found = false;
-        QRegularExpressionMatchIterator iter = regexp.globalMatch(wholeRange, rangeStartCol);
+    done = true;
+    return QVector<KTextEditor::Range>();
+}
 
-        if (backwards) {
-            while (iter.hasNext()) {
-                QRegularExpressionMatch curMatch = iter.next();
-                if (curMatch.capturedEnd() <= maxMatchOffset) {
-                    match.swap(curMatch);
-                    found = true;
+QVector<KTextEditor::Range> KateRegExpSearch::MatchIterator::Private::nextSingleLine()
+{
+    while (!done && position.line() <= range.end().line()) {
+        if (textLine != position.line()) {
+            // the lines of blocks without the literal prefix can't match
+            if (buffer) {
+                const int candidateLine = buffer->searchIndexNextLine(position.line(), trigrams, false);
+                if (candidateLine != position.line()) {
+                    position = KTextEditor::Cursor(candidateLine, 0);
+                    continue;
                 }
             }
-        } else { /* forwards */
-            QRegularExpressionMatch curMatch;
-            if (iter.hasNext()) {
-                curMatch = iter.next();
-            }
-            if (curMatch.capturedEnd() <= maxMatchOffset) {
-                match.swap(curMatch);
-                found = true;
-            }
+
+            textLine = position.line();
+            text = document.line(textLine);
         }
 
-        if (!found) {
-            // no match
-            FAST_DEBUG("not found");
-            return noResult;
+        const int endLineMaxOffset = (textLine == range.end().line()) ? range.end().column() : text.length();
+        const QRegularExpressionMatch match = (position.column() <= text.length()) ? regexp.match(text, position.column()) : QRegularExpressionMatch();
+        if (!match.hasMatch() || match.capturedEnd() > endLineMaxOffset) {
+            FAST_DEBUG("searchText | line " << textLine << ": no");
+            position = KTextEditor::Cursor(textLine + 1, 0);
+            continue;
         }
 
-        // Capture groups: save opening and closing indices and build a map,
-        // the correct values will be written into it later
-        QMap<int, TwoViewCursor *> indicesToCursors;
-        const int numCaptures = regexp.captureCount();
-        QVector<IndexPair> indexPairs(numCaptures + 1);
-        for (int c = 0; c <= numCaptures; ++c) {
+        // an invalid index indicates an empty capture group
+        QVector<KTextEditor::Range> result(regexp.captureCount() + 1);
+        for (int c = 0; c < result.size(); ++c) {
             const int openIndex = match.capturedStart(c);
-            IndexPair &pair = indexPairs[c];
-            if (openIndex == -1) {
-                // An invalid index indicates an empty capture group
-                pair.openIndex = -1;
-                pair.closeIndex = -1;
-                FAST_DEBUG("capture []");
-            } else {
-                const int closeIndex = match.capturedEnd(c);
-                pair.openIndex = openIndex;
-                pair.closeIndex = closeIndex;
-                FAST_DEBUG("capture [" << pair.openIndex << ".." << pair.closeIndex << "]");
-
-                // each key no more than once
-                if (!indicesToCursors.contains(openIndex)) {
-                    TwoViewCursor *twoViewCursor = new TwoViewCursor;
-                    twoViewCursor->index = openIndex;
-                    indicesToCursors.insert(openIndex, twoViewCursor);
-                    FAST_DEBUG("  capture group start index added: " << openIndex);
-                }
-                if (!indicesToCursors.contains(closeIndex)) {
-                    TwoViewCursor *twoViewCursor = new TwoViewCursor;
-                    twoViewCursor->index = closeIndex;
-                    indicesToCursors.insert(closeIndex, twoViewCursor);
-                    FAST_DEBUG("  capture group end index added: " << closeIndex);
-                }
-            }
+            result[c] = (openIndex == -1) ? KTextEditor::Range::invalid() : KTextEditor::Range(textLine, openIndex, textLine, match.capturedEnd(c));
         }
 
-        // find out where they belong
-        int curRelLine = 0;
-        int curRelCol = 0;
-        int curRelIndex = 0;
-
-        for (TwoViewCursor *twoViewCursor : qAsConst(indicesToCursors)) {
-            // forward to index, save line/col
-            const int index = twoViewCursor->index;
-            FAST_DEBUG("resolving position" << index);
-
-            while (curRelIndex <= index) {
-                FAST_DEBUG("walk pos (" << curRelLine << "," << curRelCol << ") = " << curRelIndex << "relative, steps more to go" << index - curRelIndex);
-
-                const int curRelLineLen = lineLens.at(curRelLine);
-                const int curLineRemainder = curRelLineLen - curRelCol;
-                const int lineFeedIndex = curRelIndex + curLineRemainder;
-                if (index <= lineFeedIndex) {
-                    if (index == lineFeedIndex) {
-                        // on this line _at_ line feed
-                        FAST_DEBUG("  on line feed");
-                        const int absLine = curRelLine + rangeStartLine;
-                        twoViewCursor->line = absLine;
-                        twoViewCursor->col = curRelLineLen;
-
-                        // advance to next line
-                        const int advance = (index - curRelIndex) + 1;
-                        ++curRelLine;
-                        curRelCol = 0;
-                        curRelIndex += advance;
-                    } else { // index < lineFeedIndex
-                        // on this line _before_ line feed
-                        FAST_DEBUG("  before line feed");
-                        const int diff = (index - curRelIndex);
-                        const int absLine = curRelLine + rangeStartLine;
-                        const int absCol = curRelCol + diff;
-                        twoViewCursor->line = absLine;
-                        twoViewCursor->col = absCol;
-
-                        // advance on same line
-                        const int advance = diff + 1;
-                        curRelCol += advance;
-                        curRelIndex += advance;
-                    }
-                    FAST_DEBUG("position(" << twoViewCursor->line << "," << twoViewCursor->col << ")");
-                } else { // if (index > lineFeedIndex)
-                    // not on this line
-                    // advance to next line
-                    FAST_DEBUG("  not on this line");
-                    ++curRelLine;
-                    curRelCol = 0;
-                    const int advance = curLineRemainder + 1;
-                    curRelIndex += advance;
-                }
+        // continue after the match, an empty match must advance, after the end of the line the search goes on in the next one
+        position = KTextEditor::Cursor(textLine, match.capturedEnd() + ((match.capturedLength() == 0) ? 1 : 0));
+        return result;
+    }
+
+    done = true;
+    return QVector<KTextEditor::Range>();
+}
+
+QVector<KTextEditor::Range> KateRegExpSearch::MatchIterator::Private::nextBackwards()
+{
+    if (multiLine) {
+        // a multi-line match depends on the text before it, collect the matches of the range in one forward pass
+        if (!done) {
+            Private forwards(document, regexp, true, range, false);
+            for (QVector<KTextEditor::Range> match = forwards.nextMultiLine(); !match.isEmpty(); match = forwards.nextMultiLine()) {
+                pending.append(match);
             }
+            done = true;
+        }
+        return pending.isEmpty() ? QVector<KTextEditor::Range>() : pending.takeLast();
+    }
+
+    while (!done) {
+        if (line < range.start().line()) {
+            done = true;
+            break;
         }
 
-        // build result array
-        QVector<KTextEditor::Range> result(numCaptures + 1, KTextEditor::Range::invalid());
-        for (int y = 0; y <= numCaptures; y++) {
-            IndexPair &pair = indexPairs[y];
-            if (!(pair.openIndex == -1 || pair.closeIndex == -1)) {
-                const TwoViewCursor *const openCursors = indicesToCursors.value(pair.openIndex);
-                const TwoViewCursor *const closeCursors = indicesToCursors.value(pair.closeIndex);
-                const int startLine = openCursors->line;
-                const int startCol = openCursors->col;
-                const int endLine = closeCursors->line;
-                const int endCol = closeCursors->col;
-                FAST_DEBUG("range " << y << ": (" << startLine << ", " << startCol << ")..(" << endLine << ", " << endCol << ")");
-                result[y] = KTextEditor::Range(startLine, startCol, endLine, endCol);
+        // the lines of blocks without the literal prefix can't match
+        if (buffer && column < 0) {
+            const int candidateLine = buffer->searchIndexNextLine(line, trigrams, true);
+            if (candidateLine != line) {
+                line = candidateLine;
+                continue;
             }
         }
 
-        // free structs allocated for indicesToCursors
-        qDeleteAll(indicesToCursors);
+        // the match starting last, the ones that end after the range or the last returned match are rejected
+        const QString lineText = document.line(line);
+        const int offset = (line == range.start().line()) ? range.start().column() : 0;
+        int endLineMaxOffset = (line == range.end().line()) ? qMin(range.end().column(), lineText.length()) : lineText.length();
+        int startLineMaxOffset = endLineMaxOffset;
+        if (column >= 0) {
+            endLineMaxOffset = qMin(endLineMaxOffset, column);
+            startLineMaxOffset = column - 1;
+        }
 
+        const QRegularExpressionMatch match =
+            (offset <= startLineMaxOffset) ? lastMatch(regexp, lineText, offset, startLineMaxOffset + 1, endLineMaxOffset) : QRegularExpressionMatch();
+        if (!match.hasMatch()) {
+            FAST_DEBUG("searchText | line " << line << ": no");
+            --line;
+            column = -1;
+            continue;
+        }
+
+        // an invalid index indicates an empty capture group
+        QVector<KTextEditor::Range> result(regexp.captureCount() + 1);
+        for (int c = 0; c < result.size(); ++c) {
+            const int openIndex = match.capturedStart(c);
+            result[c] = (openIndex == -1) ? KTextEditor::Range::invalid() : KTextEditor::Range(line, openIndex, line, match.capturedEnd(c));
+        }
+
+        // the next match is before this one
+        column = match.capturedStart();
         return result;
-    } else {
-        // single-line regex search (forwards and backwards)
-        const int rangeStartCol = inputRange.start().column();
-        const uint rangeEndCol = inputRange.end().column();
+    }
 
-        const int rangeStartLine = inputRange.start().line();
-        const int rangeEndLine = inputRange.end().line();
+    return QVector<KTextEditor::Range>();
+}
 
-        const int forInit = backwards ? rangeEndLine : rangeStartLine;
+KateRegExpSearch::MatchIterator::MatchIterator(Private *d)
+    : d(d)
+{
+}
 
-        const int forInc = backwards ? -1 : +1;
+KateRegExpSearch::MatchIterator::MatchIterator(MatchIterator &&other) = default;
 
-        FAST_DEBUG("single line " << (backwards ? rangeEndLine : rangeStartLine) << ".." << (backwards ? rangeStartLine : rangeEndLine));
+KateRegExpSearch::MatchIterator::~MatchIterator() = default;
 
-        for (int j = forInit; (rangeStartLine <= j) && (j <= rangeEndLine); j += forInc) {
-            if (j < 0 || m_document->lines() <= j) {
-                FAST_DEBUG("searchText | line " << j << ": no");
-                return noResult;
-            }
+QVector<KTextEditor::Range> KateRegExpSearch::MatchIterator::next()
+{
+    if (d->backwards) {
+        return d->nextBackwards();
+    }
+    return d->multiLine ? d->nextMultiLine() : d->nextSingleLine();
+}
 
-            const QString textLine = m_document->line(j);
+// BEGIN d'tor, c'tor
+//
+// KateSearch Constructor
+//
+KateRegExpSearch::KateRegExpSearch(const KTextEditor::Document *document)
+    : m_text(document)
+{
+}
 
-            const int offset = (j == rangeStartLine) ? rangeStartCol : 0;
-            const int endLineMaxOffset = (j == rangeEndLine) ? rangeEndCol : textLine.length();
+KateRegExpSearch::KateRegExpSearch(const KTextEditor::Document *document, const QString &pattern, QRegularExpression::PatternOptions options)
+    : m_text(document)
+{
+    prepare(pattern, options);
+}
 
-            bool found = false;
+KateRegExpSearch::KateRegExpSearch(const KateSearchText &text, const QString &pattern, QRegularExpression::PatternOptions options)
+    : m_text(text)
+{
+    prepare(pattern, options);
+}
 
-            QRegularExpressionMatch match;
+//
+// KateSearch Destructor
+//
+KateRegExpSearch::~KateRegExpSearch()
+{
+}
+// END
 
-            if (backwards) {
-                QRegularExpressionMatchIterator iter = regexp.globalMatch(textLine, offset);
-                while (iter.hasNext()) {
-                    QRegularExpressionMatch curMatch = iter.next();
-                    if (curMatch.capturedEnd() <= endLineMaxOffset) {
-                        match.swap(curMatch);
-                        found = true;
-                    }
-                }
-            } else {
-                match = regexp.match(textLine, offset);
-                if (match.hasMatch() && match.capturedEnd() <= endLineMaxOffset) {
-                    found = true;
-                }
-            }
+void KateRegExpSearch::prepare(const QString &pattern, QRegularExpression::PatternOptions options)
+{
+    // still the compiled pattern of the last search?
+    if (m_prepared && pattern == m_pattern && options == m_options) {
+        return;
+    }
 
-            if (found) {
-                FAST_DEBUG("line " << j << ": yes");
+    m_prepared = true;
+    m_pattern = pattern;
+    m_options = options;
+    m_regexp = QRegularExpression();
+    m_multiLine = false;
+    m_searchIndexTrigrams.clear();
 
-                // build result array
-                const int numCaptures = regexp.captureCount();
-                QVector<KTextEditor::Range> result(numCaptures + 1);
-                result[0] = KTextEditor::Range(j, match.capturedStart(), j, match.capturedEnd());
+    // Note that some methods in vimode (e.g. Searcher::findPatternWorker) rely on the
+    // this method returning here when pattern.isEmpty()
+    // Also if repairPattern() is called on an invalid regex pattern it may cause asserts
+    // in QString (e.g. if the pattern is just '\\', pattern.size() is 1, and repaierPattern
+    // expects at least one character after a \)
+    if (pattern.isEmpty() || !QRegularExpression(pattern).isValid()) {
+        return;
+    }
 
-                FAST_DEBUG("result range " << 0 << ": (" << j << ", " << match.capturedStart << ")..(" << j << ", " << match.capturedEnd() << ")");
+    // detect pattern type (single- or mutli-line)
+    const QString repairedPattern = repairPattern(pattern, m_multiLine);
 
-                for (int y = 1; y <= numCaptures; ++y) {
-                    const int openIndex = match.capturedStart(y);
+    // Enable multiline mode, so that the ^ and $ metacharacters in the pattern
+    // are allowed to match, respectively, immediately after and immediately
+    // before any newline in the subject string, as well as at the very beginning
+    // and at the very end of the subject string (see QRegularExpression docs).
+    if (m_multiLine) {
+        options |= QRegularExpression::MultilineOption;
+    }
 
-                    if (openIndex == -1) {
-                        result[y] = KTextEditor::Range::invalid();
+    // compile and JIT the pattern now, once for all searches with it
+    QRegularExpression regexp(repairedPattern, options);
+    if (regexp.isValid()) {
+        regexp.optimize();
+        m_regexp = regexp;
+        m_searchIndexTrigrams = Kate::TextBuffer::searchIndexTrigrams(literalPrefix(pattern));
+    }
+}
 
-                        FAST_DEBUG("capture []");
-                    } else {
-                        const int closeIndex = match.capturedEnd(y);
+bool KateRegExpSearch::isValid() const
+{
+    return m_prepared && !m_regexp.pattern().isEmpty();
+}
+
+KateRegExpSearch::MatchIterator KateRegExpSearch::matches(const KTextEditor::Range &inputRange, bool backwards) const
+{
+    MatchIterator iterator(new MatchIterator::Private(m_text, m_regexp, m_multiLine, inputRange, backwards));
+    if (!isValid()) {
+        iterator.d->done = true;
+    }
+
+    // single-line matches contain the literal prefix of the pattern on their line, the search index knows where it can't be
+    if (!m_multiLine && !m_searchIndexTrigrams.empty()) {
+        const auto doc = qobject_cast<const KTextEditor::DocumentPrivate *>(m_text.document());
+        if (doc && doc->buffer().searchIndexEnabled()) {
+            iterator.d->buffer = &doc->buffer();
+            iterator.d->trigrams = m_searchIndexTrigrams;
+        }
+    }
+    return iterator;
+}
+
+QVector<KTextEditor::Range> KateRegExpSearch::search(const KTextEditor::Range &inputRange, bool backwards) const
+{
+    // Returned if no matches are found
+    QVector<KTextEditor::Range> noResult(1, KTextEditor::Range::invalid());
+
+    // backwards, a multi-line search is a forward pass, only the last match is kept
+    if (backwards && m_multiLine) {
+        MatchIterator iterator = matches(inputRange);
+        QVector<KTextEditor::Range> result = noResult;
+        for (QVector<KTextEditor::Range> match = iterator.next(); !match.isEmpty(); match = iterator.next()) {
+            result = match;
+        }
+        return result;
+    }
 
-                        FAST_DEBUG("result range " << y << ": (" << j << ", " << openIndex << ")..(" << j << ", " << closeIndex << ")");
+    const QVector<KTextEditor::Range> result = matches(inputRange, backwards).next();
+    return result.isEmpty() ? noResult : result;
+}
 
-                        result[y] = KTextEditor::Range(j, openIndex, j, closeIndex);
+QVector<KTextEditor::Range> KateRegExpSearch::searchAll(const KTextEditor::Range &inputRange, int maxMatches) const
+{
+    QVector<KTextEditor::Range> result;
+    MatchIterator iterator = matches(inputRange);
+    while (result.size() != maxMatches) {
+        const QVector<KTextEditor::Range> match = iterator.next();
+        if (match.isEmpty()) {
+            break;
+        }
+        result.append(match.at(0));
+    }
+    return result;
+}
+
+bool KateRegExpSearch::isMultiLine() const
+{
+    return m_multiLine;
+}
+
+QVector<KTextEditor::Range> KateRegExpSearch::searchAllParallel(const KTextEditor::Range &inputRange, int &matchCount, int maxMatches) const
+{
+    // a multi-line match depends on the lines around it, they can't be searched independently
+    if (m_multiLine) {
+        QVector<KTextEditor::Range> result = searchAll(inputRange);
+        matchCount = result.size();
+        if (maxMatches >= 0 && result.size() > maxMatches) {
+            result.resize(maxMatches);
+        }
+        return result;
+    }
+
+    // nothing to do, same checks as for the other searches
+    matchCount = 0;
+    if (!isValid() || !inputRange.isValid() || inputRange.isEmpty() || inputRange.start().line() < 0 || inputRange.end().line() >= m_text.lines()) {
+        return QVector<KTextEditor::Range>();
+    }
+
+    // snapshot of the texts, they are implicitly shared, the threads never access the document
+    const int firstLine = inputRange.start().line();
+    const int lastLine = inputRange.end().line();
+    QVector<QString> texts;
+    texts.reserve(lastLine - firstLine + 1);
+    for (int line = firstLine; line <= lastLine; ++line) {
+        texts.append(m_text.line(line));
+    }
+
+    // results of one chunk of lines, a chunk needs no more ranges than the whole search
+    struct Chunk {
+        QVector<KTextEditor::Range> ranges;
+        int count = 0;
+    };
+    std::vector<Chunk> chunks((texts.size() + KATE_REGEXP_PARALLEL_CHUNK_LINES - 1) / KATE_REGEXP_PARALLEL_CHUNK_LINES);
+
+    // search the chunks, each thread takes the next unhandled one
+    // every thread uses an own compiled pattern, QRegularExpression is only reentrant
+    std::atomic<size_t> nextChunk(0);
+    auto work = [&]() {
+        QRegularExpression regexp(m_regexp.pattern(), m_regexp.patternOptions());
+        regexp.optimize();
+
+        for (size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) {
+            Chunk &chunk = chunks[c];
+            const int chunkEnd = qMin(int(c + 1) * KATE_REGEXP_PARALLEL_CHUNK_LINES, texts.size());
+            for (int i = int(c) * KATE_REGEXP_PARALLEL_CHUNK_LINES; i < chunkEnd; ++i) {
+                // like the single-line search of the match iterator, matches that end after the range are rejected
+                const int line = firstLine + i;
+                const QString &text = texts.at(i);
+                const int endLineMaxOffset = (line == lastLine) ? inputRange.end().column() : text.length();
+                int column = (line == firstLine) ? inputRange.start().column() : 0;
+                while (column <= text.length()) {
+                    const QRegularExpressionMatch match = regexp.match(text, column);
+                    if (!match.hasMatch() || match.capturedEnd() > endLineMaxOffset) {
+                        break;
+                    }
+
+                    ++chunk.count;
+                    if (chunk.ranges.size() != maxMatches) {
+                        chunk.ranges.append(KTextEditor::Range(line, match.capturedStart(), line, match.capturedEnd()));
                     }
+
+                    // continue after the match, an empty match must advance
+                    column = match.capturedEnd() + ((match.capturedLength() == 0) ? 1 : 0);
                 }
-                return result;
-            } else {
-                FAST_DEBUG("searchText | line " << j << ": no");
             }
         }
+    };
+    const int threads = qMax(1, QThread::idealThreadCount());
+    std::vector<std::thread> workers;
+    for (int t = 1; t < qMin(threads, int(chunks.size())); ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
     }
-    return noResult;
+
+    // the chunks are in document order, their matches too
+    QVector<KTextEditor::Range> result;
+    for (const Chunk &chunk : chunks) {
+        matchCount += chunk.count;
+        for (const KTextEditor::Range &range : chunk.ranges) {
+            if (result.size() == maxMatches) {
+                break;
+            }
+            result.append(range);
+        }
+    }
+    return result;
+}
+
+QVector<KTextEditor::Range>
+KateRegExpSearch::search(const QString &pattern, const KTextEditor::Range &inputRange, bool backwards, QRegularExpression::PatternOptions options)
+{
+    prepare(pattern, options);
+    return search(inputRange, backwards);
+}
+
+QVector<KTextEditor::Range>
+KateRegExpSearch::searchAll(const QString &pattern, const KTextEditor::Range &inputRange, QRegularExpression::PatternOptions options, int maxMatches)
+{
+    prepare(pattern, options);
+    return searchAll(inputRange, maxMatches);
 }
 
 /*static*/ QString KateRegExpSearch::escapePlaintext(const QString &text)
@@ -15,10 +15,10 @@
 
 #include <ktexteditor_export.h>
 
-namespace KTextEditor
-{
-class Document;
-}
+#include "katesearchtext.h"
+
+#include <memory>
+#include <vector>
 
 /**
  * Object to help to search for regexp.
@@ -29,8 +29,119 @@ class KTEXTEDITOR_EXPORT KateRegExpSearch
 {
 public:
     explicit KateRegExpSearch(const KTextEditor::Document *document);
+
+    /**
+     * Prepared search: the regular expression \p pattern is compiled once, for all searches
+     * without pattern argument, see search(const KTextEditor::Range &, bool) and matches().
+     *
+     * \param document document to search in
+     * \param pattern regular expression to search for
+     * \param options QRegularExpression pattern options
+     */
+    KateRegExpSearch(const KTextEditor::Document *document,
+                     const QString &pattern,
+                     QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption);
+
+    /**
+     * Prepared search in the given lines, e.g. a snapshot of a document.
+     *
+     * \param text lines to search in
+     * \param pattern regular expression to search for
+     * \param options QRegularExpression pattern options
+     */
+    KateRegExpSearch(const KateSearchText &text, const QString &pattern, QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption);
+
     ~KateRegExpSearch();
 
+    /**
+     * Iterator over the matches of a prepared search in a range, see matches().
+     * The iterator is invalid once the document changes.
+     */
+    class KTEXTEDITOR_EXPORT MatchIterator
+    {
+    public:
+        MatchIterator(MatchIterator &&other);
+        ~MatchIterator();
+
+        /**
+         * Next match, forwards in document order, backwards in reverse document order.
+         * After an empty match the forward search goes on one character later.
+         * Backwards, the next match of a single-line pattern is the one that starts last
+         * before the previous match and ends at or before its start.
+         *
+         * \return Vector of ranges, one for each capture group, like search().
+         *         Empty if there are no more matches.
+         */
+        QVector<KTextEditor::Range> next();
+
+    private:
+        friend class KateRegExpSearch;
+        class Private;
+        explicit MatchIterator(Private *d);
+        std::unique_ptr<Private> d;
+    };
+
+    //
+    // prepared search
+    //
+public:
+    /**
+     * Is the prepared pattern valid?
+     * \return \e true if there is a non-empty, valid prepared pattern
+     */
+    bool isValid() const;
+
+    /**
+     * Search for the prepared pattern inside the range \p inputRange,
+     * like search(const QString &, const KTextEditor::Range &, bool, QRegularExpression::PatternOptions).
+     *
+     * \param inputRange Range to search in
+     * \param backwards if \e true, the search will be backwards
+     * \return Vector of ranges, one for each capture group, see search()
+     */
+    QVector<KTextEditor::Range> search(const KTextEditor::Range &inputRange, bool backwards = false) const;
+
+    /**
+     * Search for all matches of the prepared pattern inside the range \p inputRange in one forward pass.
+     * Multi-line patterns are matched in a window of lines that slides over the range,
+     * the range is never joined as a whole.
+     * After an empty match the search goes on one character later.
+     *
+     * \param inputRange Range to search in
+     * \param maxMatches stop after this number of matches, -1 for no limit
+     * \return ranges of the whole matches, in document order
+     */
+    QVector<KTextEditor::Range> searchAll(const KTextEditor::Range &inputRange, int maxMatches = -1) const;
+
+    /**
+     * Can a match of the prepared pattern span multiple lines?
+     * \return \e true for multi-line patterns, their matches depend on the lines around them
+     */
+    bool isMultiLine() const;
+
+    /**
+     * Search for all matches of the prepared pattern inside the range \p inputRange, like searchAll(),
+     * but the lines are searched on several threads.
+     * The texts of the lines are taken in the calling thread, the document isn't touched by the other threads.
+     * Only single-line patterns are searched in parallel, the lines are independent for them,
+     * multi-line patterns are searched in one pass like searchAll().
+     *
+     * \param inputRange Range to search in
+     * \param matchCount is set to the number of all matches in the range
+     * \param maxMatches only the ranges of this number of matches are returned, the others are just counted, -1 for no limit
+     * \return ranges of the whole matches, in document order
+     */
+    QVector<KTextEditor::Range> searchAllParallel(const KTextEditor::Range &inputRange, int &matchCount, int maxMatches = -1) const;
+
+    /**
+     * Iterate over the matches of the prepared pattern inside the range \p inputRange.
+     *
+     * \param inputRange Range to search in
+     * \param backwards if \e true, the matches come in reverse document order
+     * \return iterator over the matches
+     */
+    MatchIterator matches(const KTextEditor::Range &inputRange, bool backwards = false) const;
+
     //
     // KTextEditor::SearchInterface stuff
     //
@@ -51,12 +162,29 @@ public:
      *         zero) spans the whole match. If no matches are found, the vector will
      *         contain one element, an invalid range (see Range::isValid()).
      * \see KTextEditor::Range, QRegularExpression
+     *
+     * The compiled pattern is kept, searching for the same pattern again doesn't compile it again.
      */
     QVector<KTextEditor::Range> search(const QString &pattern,
                                        const KTextEditor::Range &inputRange,
                                        bool backwards = false,
                                        QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption);
 
+    /**
+     * Search for all matches of the regular expression \p pattern inside the range
+     * \p inputRange in one forward pass, see searchAll(const KTextEditor::Range &, int).
+     *
+     * \param pattern text to search for
+     * \param inputRange Range to search in
+     * \param options QRegularExpression pattern options
+     * \param maxMatches stop after this number of matches, -1 for no limit
+     * \return ranges of the whole matches, in document order
+     */
+    QVector<KTextEditor::Range> searchAll(const QString &pattern,
+                                          const KTextEditor::Range &inputRange,
+                                          QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption,
+                                          int maxMatches = -1);
+
     /**
      * Returns a modified version of text where escape sequences are resolved, e.g. "\\n" to "\n".
      *
@@ -106,8 +234,33 @@ private:
      */
     QString repairPattern(const QString &pattern, bool &stillMultiLine);
 
+    /**
+     * Prepares the search for the \p pattern: it is compiled with repairPattern() applied,
+     * unless it is the prepared pattern already.
+     *
+     * \param pattern the regular expression search pattern
+     * \param options QRegularExpression pattern options
+     */
+    void prepare(const QString &pattern, QRegularExpression::PatternOptions options);
+
 private:
-    const KTextEditor::Document *const m_document;
+    const KateSearchText m_text;
+
+    /**
+     * prepared pattern with its options, the compiled regular expression
+     * has an empty pattern if the pattern is empty or invalid
+     */
+    bool m_prepared = false;
+    QString m_pattern;
+    QRegularExpression::PatternOptions m_options;
+    QRegularExpression m_regexp;
+    bool m_multiLine = false;
+
+    /**
+     * trigrams of the literal text all matches of the prepared pattern start with, to skip lines with the search index
+     */
+    std::vector<quint32> m_searchIndexTrigrams;
+
     class ReplacementStream;
 };
 
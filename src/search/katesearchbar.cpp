@@ -13,7 +13,10 @@
 #include "katedocument.h"
 #include "kateglobal.h"
 #include "katematch.h"
+#include "kateplaintextsearch.h"
+#include "kateregexpsearch.h"
 #include "katerenderer.h"
+#include "katesearchjob.h"
 #include "kateundomanager.h"
 #include "kateview.h"
 
@@ -36,6 +39,7 @@
 #include <QRegularExpression>
 #include <QShortcut>
 #include <QStringListModel>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #include <vector>
@@ -136,6 +140,7 @@ KateSearchBar::KateSearchBar(bool initAsPower, KTextEditor::ViewPrivate *view, K
     , m_incUi(nullptr)
     , m_incInitCursor(view->cursorPosition())
     , m_powerUi(nullptr)
+    , m_highlightAllTimer(new QTimer(this))
     , highlightMatchAttribute(new Attribute())
     , highlightReplacementAttribute(new Attribute())
     , m_incHighlightAll(false)
@@ -150,6 +155,20 @@ KateSearchBar::KateSearchBar(bool initAsPower, KTextEditor::ViewPrivate *view, K
     connect(view, &KTextEditor::View::selectionChanged, this, &KateSearchBar::updateSelectionOnly);
     connect(this, &KateSearchBar::findOrReplaceAllFinished, this, &KateSearchBar::endFindOrReplaceAll);
 
+    // highlight all follows the visible lines: at once if they leave the highlighted lines, a bit later after edits
+    m_highlightAllTimer->setSingleShot(true);
+    connect(m_highlightAllTimer, &QTimer::timeout, this, &KateSearchBar::updateHighlightAll);
+    connect(view, &KTextEditor::ViewPrivate::displayRangeChanged, this, [this]() {
+        if (m_highlightAllRange && !m_highlightAllLines.contains(m_view->visibleRange().toLineRange())) {
+            updateHighlightAll();
+        }
+    });
+    connect(view->doc(), &KTextEditor::Document::textChanged, this, [this]() {
+        if (m_highlightAllRange) {
+            m_highlightAllTimer->start(100);
+        }
+    });
+
     // init match attribute
     Attribute::Ptr mouseInAttribute(new Attribute());
     mouseInAttribute->setFontBold(true);
@@ -200,6 +219,7 @@ KateSearchBar::~KateSearchBar()
         endFindOrReplaceAll();
     }
 
+    m_incSearchJob.reset();
     clearHighlights();
     delete m_layout;
     delete m_widget;
@@ -216,6 +236,7 @@ void KateSearchBar::closed()
         viewBar()->removeBarWidget(this);
     }
 
+    m_incSearchJob.reset();
     clearHighlights();
     m_replacement.clear();
 }
@@ -330,6 +351,63 @@ void KateSearchBar::highlightReplacement(const Range &range)
     m_hlRanges.append(highlight);
 }
 
+void KateSearchBar::updateHighlightAll()
+{
+    if (!m_highlightAllRange) {
+        return;
+    }
+
+    qDeleteAll(m_hlRanges);
+    m_hlRanges.clear();
+
+    // the visible lines and as many before and after them, some lines at least for views that are not shown yet
+    const Range visibleRange = m_view->visibleRange();
+    const int margin = qMax(visibleRange.numberOfLines() + 1, 100);
+    m_highlightAllLines = LineRange(qMax(0, visibleRange.start().line() - margin), qMin(m_view->doc()->lines() - 1, visibleRange.end().line() + margin));
+
+    const Range inputRange = m_highlightAllRange->toRange();
+    const Range linesRange(m_highlightAllLines.start(), 0, m_highlightAllLines.end(), m_view->doc()->lineLength(m_highlightAllLines.end()));
+    const Range searchRange = inputRange.intersect(linesRange);
+    if (!searchRange.isValid()) {
+        return;
+    }
+
+    // reuse match object to avoid massive moving range creation
+    KateMatch match(m_view->doc(), m_highlightAllOptions);
+
+    // same steps as findOrReplaceAll(), with a block selection each line is searched on its own
+    auto highlightAll = [this, &match](Range workingRange) {
+        while (workingRange.isValid()) {
+            match.searchText(workingRange, m_highlightAllPattern);
+            if (!match.isValid()) {
+                break;
+            }
+            highlightMatch(match.range());
+
+            // Continue after match
+            if (match.range().end() >= workingRange.end()) {
+                break;
+            }
+            KTextEditor::DocumentCursor workingStart(m_view->doc(), match.range().end());
+            if (match.isEmpty()) {
+                workingStart.move(1);
+            }
+            if (workingStart.atEndOfDocument()) {
+                break;
+            }
+            workingRange.setStart(workingStart.toCursor());
+        }
+    };
+
+    if (m_highlightAllBlock) {
+        for (int line = searchRange.start().line(); line <= searchRange.end().line(); ++line) {
+            highlightAll(m_view->doc()->rangeOnLine(inputRange, line));
+        }
+    } else {
+        highlightAll(searchRange);
+    }
+}
+
 void KateSearchBar::indicateMatch(MatchResult matchResult)
 {
     QLineEdit *const lineEdit = isPower() ? m_powerUi->pattern->lineEdit() : m_incUi->pattern->lineEdit();
@@ -412,6 +490,14 @@ void KateSearchBar::onIncPatternChanged(const QString &pattern)
     m_incUi->next->setDisabled(pattern.isEmpty());
     m_incUi->prev->setDisabled(pattern.isEmpty());
 
+    // a search still running for the pattern before is of no use anymore
+    m_incSearchJob.reset();
+
+    if (!pattern.isEmpty() && m_view->doc()->lines() >= KateSearchJob::IncrementalSearchLines) {
+        startIncrementalSearch(pattern, false);
+        return;
+    }
+
     KateMatch match(m_view->doc(), searchOptions());
 
     if (!pattern.isEmpty()) {
@@ -428,9 +514,46 @@ void KateSearchBar::onIncPatternChanged(const QString &pattern)
         match.searchText(inputRange, pattern);
     }
 
+    indicateIncrementalMatch(pattern, match.isValid() ? match.range() : Range::invalid(), wrap);
+}
+
+void KateSearchBar::startIncrementalSearch(const QString &pattern, bool wrap)
+{
+    const Range inputRange = wrap ? m_view->document()->documentRange() : Range(m_incInitCursor, m_view->document()->documentEnd());
+    m_incSearchJob.reset(m_view->doc()->searchTextAsync(inputRange, pattern, searchOptions()));
+
+    indicateMatch(MatchNeutral);
+    connect(m_incSearchJob.get(), &KateSearchJob::progress, this, [this](int searchedLines, int lines) {
+        m_incUi->status->setText(i18n("Searching... %1%", lines > 0 ? 100LL * searchedLines / lines : 100));
+    });
+    connect(m_incSearchJob.get(), &KateSearchJob::finished, this, [this, pattern, wrap]() {
+        // the job may not be deleted while it emits finished
+        KateSearchJob *job = m_incSearchJob.release();
+        job->deleteLater();
+
+        // canceled as the document got changed, cleared or reloaded
+        if (job->isCanceled()) {
+            indicateMatch(MatchNothing);
+            return;
+        }
+
+        // the matches are at the revision the search started at, the document may have changed since
+        const QVector<Range> matches = job->transformedRanges();
+        if (matches.isEmpty() && !wrap) {
+            // Find, second try
+            startIncrementalSearch(pattern, true);
+            return;
+        }
+
+        indicateIncrementalMatch(pattern, matches.isEmpty() ? Range::invalid() : matches.first(), wrap);
+    });
+}
+
+void KateSearchBar::indicateIncrementalMatch(const QString &pattern, const KTextEditor::Range &match, bool wrap)
+{
     const MatchResult matchResult = match.isValid() ? (wrap ? MatchWrappedForward : MatchFound) : pattern.isEmpty() ? MatchNothing : MatchMismatch;
 
-    const Range selectionRange = pattern.isEmpty() ? Range(m_incInitCursor, m_incInitCursor) : match.isValid() ? match.range() : Range::invalid();
+    const Range selectionRange = pattern.isEmpty() ? Range(m_incInitCursor, m_incInitCursor) : match;
 
     // don't update m_incInitCursor when we move the cursor
     disconnect(m_view, &KTextEditor::View::cursorPositionChanged, this, &KateSearchBar::updateIncInitCursor);
@@ -763,6 +886,7 @@ void KateSearchBar::beginFindOrReplaceAll(Range inputRange, const QString &repla
     m_workingRange = m_view->doc()->newMovingRange(m_inputRange);
     m_replacement = replacement;
     m_replaceMode = replaceMode;
+    m_bulkReplace = replaceMode;
     m_matchCounter = 0;
     m_cancelFindOrReplace = false; // Ensure we have a GO!
 
@@ -773,13 +897,35 @@ void KateSearchBar::findOrReplaceAll()
 {
     const SearchOptions enabledOptions = searchOptions(SearchForward);
 
-    // we highlight all ranges of a replace, up to some hard limit
+    // we highlight all ranges of a replace and mark the lines of all matches, up to some hard limit
     // e.g. if you replace 100000 things, rendering will break down otherwise ;=)
+    // the matches of a find all are highlighted around the visible lines only, see updateHighlightAll()
     const int maxHighlightings = 65536;
 
     // reuse match object to avoid massive moving range creation
     KateMatch match(m_view->doc(), enabledOptions);
 
+    // regex find all: the matches are collected in one forward pass over the range, up to some limit per pass,
+    // instead of one search per match
+    const bool regExpFindAll = !m_replaceMode && enabledOptions.testFlag(KTextEditor::Regex);
+    const int maxMatchesPerPass = 4096;
+    // for single-line patterns the lines are independent, they are searched in batches on all cores
+    const int linesPerParallelPass = 262144;
+    // replace all: the matches of a batch of lines are replaced at once, if they and their replacements don't span lines
+    const int linesPerBulkReplacePass = 65536;
+    QRegularExpression::PatternOptions patternOptions;
+    if (enabledOptions.testFlag(KTextEditor::CaseInsensitive)) {
+        patternOptions |= QRegularExpression::CaseInsensitiveOption;
+    }
+    const KateRegExpSearch regExpSearch(m_view->doc(), regExpFindAll ? searchPattern() : QString(), patternOptions);
+
+    // plain text find all: single-line texts are searched in batches on all cores, too, with the matcher of the plain text search
+    const QString plainText = enabledOptions.testFlag(KTextEditor::EscapeSequences) ? KateRegExpSearch::escapePlaintext(searchPattern()) : searchPattern();
+    const bool plainTextFindAll = !m_replaceMode && !enabledOptions.testFlag(KTextEditor::Regex) && !plainText.contains(QLatin1Char('\n'));
+    KatePlainTextSearch plainTextSearch(m_view->doc(),
+                                        enabledOptions.testFlag(KTextEditor::CaseInsensitive) ? Qt::CaseInsensitive : Qt::CaseSensitive,
+                                        enabledOptions.testFlag(KTextEditor::WholeWords));
+
     bool block = m_view->selection() && m_view->blockSelection();
 
     int line = m_inputRange.start().line();
@@ -795,6 +941,115 @@ void KateSearchBar::findOrReplaceAll()
         }
 
         do {
+            if (m_bulkReplace && !block) {
+                const Range workingRange = m_workingRange->toRange();
+                const int passEndLine = qMin(workingRange.end().line(), workingRange.start().line() + linesPerBulkReplacePass - 1);
+                const bool lastPass = passEndLine == workingRange.end().line();
+                const Range passRange(workingRange.start(), lastPass ? workingRange.end() : Cursor(passEndLine, m_view->doc()->lineLength(passEndLine)));
+
+                KTextEditor::DocumentPrivate *const doc = m_view->doc();
+                const bool firstReplacement = m_matchCounter == 0;
+                if (firstReplacement) {
+                    doc->startEditing();
+                }
+                QVector<Range> replacedRanges;
+                m_bulkReplace = match.replaceAll(passRange, searchPattern(), m_replacement, m_matchCounter + 1, replacedRanges);
+                m_matchCounter += replacedRanges.size();
+                if (firstReplacement && m_matchCounter == 0) {
+                    doc->finishEditing();
+                }
+
+                // not possible in one go, replace one match after the other
+                if (!m_bulkReplace) {
+                    continue;
+                }
+
+                // remember ranges if limit not reached
+                if (m_matchCounter < maxHighlightings) {
+                    m_highlightRanges.insert(m_highlightRanges.end(), replacedRanges.begin(), replacedRanges.end());
+                } else {
+                    m_highlightRanges.clear();
+                }
+
+                if (lastPass) {
+                    done = true;
+                    break;
+                }
+
+                // Continue in the next line
+                m_workingRange->setRange(Cursor(passEndLine + 1, 0), m_workingRange->end());
+
+                timeOut = rolex.elapsed() > 150;
+                continue;
+            }
+
+            if ((regExpFindAll && !regExpSearch.isMultiLine()) || plainTextFindAll) {
+                const Range workingRange = m_workingRange->toRange();
+                const int passEndLine = qMin(workingRange.end().line(), workingRange.start().line() + linesPerParallelPass - 1);
+                const bool lastPass = passEndLine == workingRange.end().line();
+                const Range passRange(workingRange.start(), lastPass ? workingRange.end() : Cursor(passEndLine, m_view->doc()->lineLength(passEndLine)));
+
+                // only as many ranges as are highlighted are needed, the others are just counted
+                int matchCount = 0;
+                const QVector<Range> matches = regExpFindAll ? regExpSearch.searchAllParallel(passRange, matchCount, maxHighlightings)
+                                                             : plainTextSearch.searchAllParallel(plainText, passRange, matchCount, maxHighlightings);
+                m_matchCounter += matchCount;
+
+                // remember ranges if limit not reached
+                if (m_matchCounter < maxHighlightings) {
+                    m_highlightRanges.insert(m_highlightRanges.end(), matches.begin(), matches.end());
+                } else {
+                    m_highlightRanges.clear();
+                }
+
+                if (lastPass) {
+                    done = true;
+                    break;
+                }
+
+                // Continue in the next line
+                m_workingRange->setRange(Cursor(passEndLine + 1, 0), m_workingRange->end());
+
+                timeOut = rolex.elapsed() > 150;
+                continue;
+            }
+
+            if (regExpFindAll) {
+                const QVector<Range> matches = regExpSearch.searchAll(*m_workingRange, maxMatchesPerPass);
+                for (const Range &range : matches) {
+                    ++m_matchCounter;
+
+                    // remember ranges if limit not reached
+                    if (m_matchCounter < maxHighlightings) {
+                        m_highlightRanges.push_back(range);
+                    } else {
+                        m_highlightRanges.clear();
+                    }
+                }
+
+                // all matches of the range found?
+                if (matches.size() < maxMatchesPerPass) {
+                    done = true;
+                    break;
+                }
+
+                // Continue after the last match
+                KTextEditor::DocumentCursor workingStart(m_view->doc(), matches.last().end());
+                if (matches.last().isEmpty()) {
+                    workingStart.move(1);
+                }
+                m_workingRange->setRange(workingStart.toCursor(), m_workingRange->end());
+
+                // Are we done?
+                if (!m_workingRange->toRange().isValid() || workingStart.atEndOfDocument()) {
+                    done = true;
+                    break;
+                }
+
+                timeOut = rolex.elapsed() > 150;
+                continue;
+            }
+
             match.searchText(*m_workingRange, searchPattern());
             if (!match.isValid()) {
                 done = true;
@@ -892,10 +1147,14 @@ void KateSearchBar::endFindOrReplaceAll()
         // Never merge replace actions with other replace actions/user actions
         m_view->doc()->undoManager()->undoSafePoint();
 
-    } else {
-        for (const Range &r : qAsConst(m_highlightRanges)) {
-            highlightMatch(r);
-        }
+    } else if (m_matchCounter > 0) {
+        // only the matches around the visible lines get highlighted, again after scrolling and editing
+        delete m_highlightAllRange;
+        m_highlightAllRange = m_view->doc()->newMovingRange(m_inputRange, KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight);
+        m_highlightAllBlock = m_view->selection() && m_view->blockSelection();
+        m_highlightAllPattern = searchPattern();
+        m_highlightAllOptions = searchOptions(SearchForward);
+        updateHighlightAll();
         //         indicateMatch(m_matchCounter > 0 ? MatchFound : MatchMismatch); TODO
     }
 
@@ -1316,6 +1575,7 @@ void KateSearchBar::enterPowerMode()
             backupConfig(OF_INCREMENTAL);
 
             // Kill widget
+            m_incSearchJob.reset();
             delete m_incUi;
             m_incUi = nullptr;
             m_layout->removeWidget(m_widget);
@@ -1573,6 +1833,12 @@ bool KateSearchBar::clearHighlights()
         delete m_infoMessage;
     }
 
+    // stop to highlight all matches
+    m_highlightAllTimer->stop();
+    delete m_highlightAllRange;
+    m_highlightAllRange = nullptr;
+    m_highlightAllLines = LineRange::invalid();
+
     if (m_hlRanges.isEmpty()) {
         return false;
     }
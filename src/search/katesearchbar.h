@@ -13,14 +13,19 @@
 
 #include <ktexteditor/attribute.h>
 #include <ktexteditor/document.h>
+#include <ktexteditor/linerange.h>
+
+#include <memory>
 
 namespace KTextEditor
 {
 class ViewPrivate;
 }
 class KateViewConfig;
+class KateSearchJob;
 class QVBoxLayout;
 class QComboBox;
+class QTimer;
 
 namespace Ui
 {
@@ -139,6 +144,12 @@ private Q_SLOTS:
      */
     void endFindOrReplaceAll();
 
+    /**
+     * Highlight the matches of the last find all in the visible lines and in some lines around them.
+     * The old highlights are removed, the cost doesn't depend on the number of matches in the document.
+     */
+    void updateHighlightAll();
+
 Q_SIGNALS:
     /**
      * Will emitted by @ref findOrReplaceAll() when all is done.
@@ -170,6 +181,8 @@ private:
     void highlightMatch(const KTextEditor::Range &range);
     void highlightReplacement(const KTextEditor::Range &range);
     void indicateMatch(MatchResult matchResult);
+    void startIncrementalSearch(const QString &pattern, bool wrap);
+    void indicateIncrementalMatch(const QString &pattern, const KTextEditor::Range &match, bool wrap);
     static void selectRange(KTextEditor::ViewPrivate *view, const KTextEditor::Range &range);
     void selectRange2(const KTextEditor::Range &range);
 
@@ -199,6 +212,7 @@ private:
     // Incremental search related
     Ui::IncrementalSearchBar *m_incUi;
     KTextEditor::Cursor m_incInitCursor;
+    std::unique_ptr<KateSearchJob> m_incSearchJob;
 
     // Power search related
     Ui::PowerSearchBar *m_powerUi = nullptr;
@@ -207,9 +221,19 @@ private:
     QString m_replacement;
     uint m_matchCounter = 0;
     bool m_replaceMode = false;
+    bool m_bulkReplace = false;
     bool m_cancelFindOrReplace = true;
     std::vector<KTextEditor::Range> m_highlightRanges;
 
+    // highlight all: the input range, pattern and options of the last find all
+    // and the lines around the visible ones that got searched for matches to highlight
+    KTextEditor::MovingRange *m_highlightAllRange = nullptr;
+    bool m_highlightAllBlock = false;
+    QString m_highlightAllPattern;
+    KTextEditor::SearchOptions m_highlightAllOptions;
+    KTextEditor::LineRange m_highlightAllLines = KTextEditor::LineRange::invalid();
+    QTimer *m_highlightAllTimer;
+
     // attribute to highlight matches with
     KTextEditor::Attribute::Ptr highlightMatchAttribute;
     KTextEditor::Attribute::Ptr highlightReplacementAttribute;
@@ -0,0 +1,289 @@
+/*
+    SPDX-FileCopyrightText: KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katesearchjob.h"
+
+#include "katedocument.h"
+#include "kateplaintextsearch.h"
+#include "kateregexpsearch.h"
+#include "katesearchtext.h"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <atomic>
+
+/**
+ * lines searched at once by single-line searches, the snapshots are taken one such chunk at a time,
+ * between them the search can be canceled and reports its progress
+ */
+static const int KATE_SEARCH_JOB_CHUNK_LINES = 4096;
+
+/**
+ * State of a search, shared by the job and the runner in the thread pool.
+ * The job hands the runner one chunk of lines after the other.
+ */
+class KateSearchJob::State : public std::enable_shared_from_this<KateSearchJob::State>
+{
+public:
+    State(const QString &pattern, KTextEditor::SearchOptions options, int maxMatches)
+        : pattern(pattern)
+        , options(options)
+        , maxMatches(maxMatches)
+    {
+    }
+
+    /**
+     * Search the chunk.
+     * \return \e false if the search is done, no further chunk needs to be searched
+     */
+    bool search();
+
+    /**
+     * Let the job know the chunk is searched, in the GUI thread.
+     */
+    void notify();
+
+    /**
+     * job to update, only accessed in the GUI thread
+     */
+    QPointer<KateSearchJob> job;
+
+    // what to search, not changed once the search runs
+    const QString pattern;
+    const KTextEditor::SearchOptions options;
+    const int maxMatches;
+
+    /**
+     * chunk to search and the snapshot of its lines, only set by the job while no chunk is searched
+     */
+    KateSearchText text = KateSearchText(nullptr);
+    KTextEditor::Range chunk;
+
+    std::atomic<bool> canceled{false};
+    std::atomic<bool> done{false};
+
+    /**
+     * matches, only accessed by the job while no chunk is searched
+     */
+    QVector<QVector<KTextEditor::Range>> results;
+
+private:
+    /**
+     * Add a match.
+     * \return \e true if the search shall go on
+     */
+    bool add(const QVector<KTextEditor::Range> &match)
+    {
+        results.append(match);
+        return maxMatches < 0 || results.size() < maxMatches;
+    }
+};
+
+class KateSearchJob::Runner : public QRunnable
+{
+public:
+    explicit Runner(const std::shared_ptr<State> &state)
+        : m_state(state)
+    {
+    }
+
+    void run() override
+    {
+        // nobody waits for the matches anymore if the job was deleted before the search started
+        if (!m_state->canceled && !m_state->search()) {
+            m_state->done = true;
+        }
+        m_state->notify();
+    }
+
+private:
+    const std::shared_ptr<State> m_state;
+};
+
+void KateSearchJob::State::notify()
+{
+    if (!QCoreApplication::instance()) {
+        return;
+    }
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [state = shared_from_this()]() {
+            if (state->job) {
+                state->job->update();
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+bool KateSearchJob::State::search()
+{
+    const bool backwards = options.testFlag(KTextEditor::Backwards);
+    const Qt::CaseSensitivity caseSensitivity = options.testFlag(KTextEditor::CaseInsensitive) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+
+    if (options.testFlag(KTextEditor::Regex)) {
+        QRegularExpression::PatternOptions patternOptions;
+        if (caseSensitivity == Qt::CaseInsensitive) {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+        const KateRegExpSearch searcher(text, pattern, patternOptions);
+        if (!searcher.isValid()) {
+            return false;
+        }
+
+        KateRegExpSearch::MatchIterator matches = searcher.matches(chunk, backwards);
+        for (QVector<KTextEditor::Range> match = matches.next(); !match.isEmpty(); match = matches.next()) {
+            if (!add(match) || canceled) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const QString needle = options.testFlag(KTextEditor::EscapeSequences) ? KateRegExpSearch::escapePlaintext(pattern) : pattern;
+    KatePlainTextSearch searcher(text, caseSensitivity, options.testFlag(KTextEditor::WholeWords));
+
+    KTextEditor::Range range = chunk;
+    for (;;) {
+        const KTextEditor::Range match = searcher.search(needle, range, backwards);
+        if (!match.isValid()) {
+            return true;
+        }
+        if (!add({match}) || canceled) {
+            return false;
+        }
+        if (backwards) {
+            range.setEnd(match.start());
+        } else {
+            range.setStart(match.end());
+        }
+    }
+}
+
+KateSearchJob::KateSearchJob(KTextEditor::DocumentPrivate *document,
+                             const KTextEditor::Range &range,
+                             const QString &pattern,
+                             KTextEditor::SearchOptions options,
+                             int maxMatches)
+    : m_document(document)
+    , m_revision(document->revision())
+    , m_range(range)
+    , m_lines(range.numberOfLines() + 1)
+{
+    // the matches are transformed from this revision
+    document->lockRevision(m_revision);
+    m_revisionLocked = true;
+    connect(document, &KTextEditor::DocumentPrivate::aboutToInvalidateMovingInterfaceContent, this, &KateSearchJob::releaseRevision);
+    connect(document, &KTextEditor::DocumentPrivate::aboutToDeleteMovingInterfaceContent, this, &KateSearchJob::releaseRevision);
+
+    // the matches of multi-line patterns depend on the lines around them, the range is searched as a whole
+    bool multiLine = false;
+    if (options.testFlag(KTextEditor::Regex)) {
+        const KateRegExpSearch searcher(document,
+                                        pattern,
+                                        options.testFlag(KTextEditor::CaseInsensitive) ? QRegularExpression::CaseInsensitiveOption
+                                                                                        : QRegularExpression::NoPatternOption);
+        multiLine = searcher.isValid() && searcher.isMultiLine();
+    } else {
+        const QString needle = options.testFlag(KTextEditor::EscapeSequences) ? KateRegExpSearch::escapePlaintext(pattern) : pattern;
+        multiLine = needle.contains(QLatin1Char('\n'));
+    }
+    m_chunkLines = multiLine ? m_lines : KATE_SEARCH_JOB_CHUNK_LINES;
+    m_chunks = (m_lines - 1) / m_chunkLines + 1;
+
+    m_state = std::make_shared<State>(pattern, options, maxMatches);
+    m_state->job = this;
+    searchNextChunk();
+}
+
+void KateSearchJob::searchNextChunk()
+{
+    const bool backwards = m_state->options.testFlag(KTextEditor::Backwards);
+    const int chunk = backwards ? m_chunks - 1 - m_searchedChunks : m_searchedChunks;
+    const int firstLine = m_range.start().line();
+    const int lastLine = m_range.end().line();
+    const int chunkFirstLine = firstLine + chunk * m_chunkLines;
+    const int chunkLastLine = qMin(lastLine, chunkFirstLine + m_chunkLines - 1);
+    const KTextEditor::Cursor start = (chunkFirstLine == firstLine) ? m_range.start() : KTextEditor::Cursor(chunkFirstLine, 0);
+    const KTextEditor::Cursor end = (chunkLastLine == lastLine) ? m_range.end() : KTextEditor::Cursor(chunkLastLine, m_document->lineLength(chunkLastLine));
+
+    // only the lines of the chunk are taken, the search may be done before it needs the others
+    m_state->text = KateSearchText::snapshot(m_document, chunkFirstLine, chunkLastLine);
+    m_state->chunk = KTextEditor::Range(start, end);
+    ++m_searchedChunks;
+    m_searchedLines += chunkLastLine - chunkFirstLine + 1;
+    QThreadPool::globalInstance()->start(new Runner(m_state));
+}
+
+KateSearchJob::~KateSearchJob()
+{
+    m_state->canceled = true;
+    releaseRevision();
+}
+
+bool KateSearchJob::isCanceled() const
+{
+    return m_state->canceled;
+}
+
+void KateSearchJob::cancel()
+{
+    m_state->canceled = true;
+}
+
+void KateSearchJob::releaseRevision()
+{
+    // the revisions are gone once the document is cleared or deleted, the search is of no use anymore
+    if (!m_revisionLocked) {
+        return;
+    }
+    m_revisionLocked = false;
+    m_state->canceled = true;
+    if (m_document) {
+        m_document->unlockRevision(m_revision);
+    }
+}
+
+void KateSearchJob::update()
+{
+    if (m_finished) {
+        return;
+    }
+
+    // the snapshot of the next chunk must be at the revision of the matches, else the search can't go on
+    if (!m_state->done && !m_state->canceled && m_searchedChunks < m_chunks) {
+        if (m_document && m_document->revision() == m_revision) {
+            const int searchedLines = m_searchedLines;
+            searchNextChunk();
+            Q_EMIT progress(searchedLines, m_lines);
+            return;
+        }
+        m_state->canceled = true;
+    }
+
+    // no chunk is searched anymore
+    m_finished = true;
+    m_results = std::move(m_state->results);
+    Q_EMIT progress(m_lines, m_lines);
+    Q_EMIT finished();
+}
+
+QVector<KTextEditor::Range> KateSearchJob::transformedRanges() const
+{
+    QVector<KTextEditor::Range> ranges;
+    if (!m_document || !m_revisionLocked) {
+        return ranges;
+    }
+
+    ranges.reserve(m_results.size());
+    for (const QVector<KTextEditor::Range> &match : m_results) {
+        KTextEditor::Range range = match.first();
+        m_document->transformRange(range, KTextEditor::MovingRange::DoNotExpand, KTextEditor::MovingRange::AllowEmpty, m_revision);
+        ranges.append(range);
+    }
+    return ranges;
+}
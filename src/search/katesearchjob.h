@@ -0,0 +1,152 @@
+/*
+    SPDX-FileCopyrightText: KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_SEARCHJOB_H
+#define KATE_SEARCHJOB_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include <ktexteditor/document.h>
+#include <ktexteditor/range.h>
+
+#include <ktexteditor_export.h>
+
+#include <memory>
+
+namespace KTextEditor
+{
+class DocumentPrivate;
+}
+
+/**
+ * Search running in a thread of the global thread pool, on snapshots of the searched lines of a document,
+ * see KTextEditor::DocumentPrivate::searchTextAsync().
+ *
+ * Single-line patterns are searched in chunks of lines, the snapshot of a chunk is only taken in the GUI thread
+ * once the chunks before it are searched, a search that is done early doesn't touch the lines after them.
+ * The revision the search started at stays locked as long as the job lives,
+ * the matches can be transformed to the current revision with transformedRanges().
+ * If the document is changed before all needed chunks are taken, the search is canceled.
+ * Deleting the job cancels the search.
+ */
+class KTEXTEDITOR_EXPORT KateSearchJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Documents with at least this number of lines are searched with a job by the incremental searches
+     * of the search bar and the vi mode, typing the pattern isn't blocked by searching them.
+     */
+    static const int IncrementalSearchLines = 100000;
+
+    /**
+     * Start the search, the parameters are the ones of KTextEditor::DocumentPrivate::searchTextAsync().
+     */
+    KateSearchJob(KTextEditor::DocumentPrivate *document,
+                  const KTextEditor::Range &range,
+                  const QString &pattern,
+                  KTextEditor::SearchOptions options,
+                  int maxMatches);
+    ~KateSearchJob() override;
+
+    /**
+     * Revision of the document the search started at, the ranges of results() are at this revision.
+     */
+    qint64 revision() const
+    {
+        return m_revision;
+    }
+
+    /**
+     * Number of lines of the searched range.
+     */
+    int lines() const
+    {
+        return m_lines;
+    }
+
+    /**
+     * Is the search done? The results are complete then.
+     */
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+    /**
+     * Was the search canceled before it was done? Also the case if the document was changed meanwhile.
+     */
+    bool isCanceled() const;
+
+    /**
+     * The matches, in search order, available once finished() was emitted.
+     * Each match is a vector of ranges like the ones of KTextEditor::DocumentPrivate::searchText():
+     * the first one spans the whole match, the others the capture groups of regular expressions.
+     */
+    const QVector<QVector<KTextEditor::Range>> &results() const
+    {
+        return m_results;
+    }
+
+    /**
+     * The whole matches of results(), transformed from revision() to the current revision of the document.
+     * Empty if the document was reloaded, cleared or deleted meanwhile.
+     */
+    QVector<KTextEditor::Range> transformedRanges() const;
+
+public Q_SLOTS:
+    /**
+     * Stop the search, finished() is emitted with the matches found until then.
+     */
+    void cancel();
+
+Q_SIGNALS:
+    /**
+     * Emitted from time to time while searching.
+     * \param searchedLines number of lines of the range searched so far
+     * \param lines number of lines of the range
+     */
+    void progress(int searchedLines, int lines);
+
+    /**
+     * Emitted once, when the search is done or canceled.
+     */
+    void finished();
+
+private:
+    void update();
+    void searchNextChunk();
+    void releaseRevision();
+
+private:
+    class State;
+    class Runner;
+
+    QPointer<KTextEditor::DocumentPrivate> m_document;
+    const qint64 m_revision;
+    bool m_revisionLocked = false;
+    const KTextEditor::Range m_range;
+    int m_lines = 0;
+
+    // chunks of lines the range is searched in, in search order
+    int m_chunkLines = 0;
+    int m_chunks = 0;
+    int m_searchedChunks = 0;
+    int m_searchedLines = 0;
+
+    /**
+     * shared with the search in the thread pool, that may still run when the job is deleted
+     */
+    std::shared_ptr<State> m_state;
+
+    bool m_finished = false;
+    QVector<QVector<KTextEditor::Range>> m_results;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_SEARCHTEXT_H
+#define KATE_SEARCHTEXT_H
+
+#include <QString>
+#include <QVector>
+
+#include <ktexteditor/document.h>
+
+/**
+ * The lines KatePlainTextSearch and KateRegExpSearch search in: the ones of a document, as they are
+ * when they are searched, or a snapshot of some of them.
+ * A snapshot doesn't access the document anymore once it is taken, it can be searched in another thread.
+ */
+class KateSearchText
+{
+public:
+    /**
+     * The lines of the \p document.
+     */
+    explicit KateSearchText(const KTextEditor::Document *document)
+        : m_document(document)
+    {
+    }
+
+    /**
+     * Snapshot of the lines \p firstLine to \p lastLine of the \p document, taken now.
+     * The other lines of the document are empty in the snapshot.
+     */
+    static KateSearchText snapshot(const KTextEditor::Document *document, int firstLine, int lastLine)
+    {
+        KateSearchText text(nullptr);
+        text.m_lineCount = document->lines();
+        text.m_firstLine = qMax(0, firstLine);
+        lastLine = qMin(lastLine, text.m_lineCount - 1);
+        text.m_lines.reserve(qMax(0, lastLine - text.m_firstLine + 1));
+        for (int line = text.m_firstLine; line <= lastLine; ++line) {
+            // the text is shared with the document, it is copied by the document once it is changed
+            text.m_lines.append(document->line(line));
+        }
+        return text;
+    }
+
+    /**
+     * The document whose lines are searched, nullptr for a snapshot.
+     */
+    const KTextEditor::Document *document() const
+    {
+        return m_document;
+    }
+
+    int lines() const
+    {
+        return m_document ? m_document->lines() : m_lineCount;
+    }
+
+    QString line(int line) const
+    {
+        if (m_document) {
+            return m_document->line(line);
+        }
+        const int index = line - m_firstLine;
+        return (index >= 0 && index < m_lines.size()) ? m_lines.at(index) : QString();
+    }
+
+    int lineLength(int line) const
+    {
+        if (m_document) {
+            return m_document->lineLength(line);
+        }
+        const int index = line - m_firstLine;
+        return (index >= 0 && index < m_lines.size()) ? m_lines.at(index).size() : ((line >= 0 && line < m_lineCount) ? 0 : -1);
+    }
+
+private:
+    const KTextEditor::Document *m_document;
+
+    // snapshot: lines of the document and the ones taken from it
+    int m_lineCount = 0;
+    int m_firstLine = 0;
+    QVector<QString> m_lines;
+};
+
+#endif
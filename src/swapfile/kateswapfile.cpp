@@ -36,7 +36,9 @@ const static qint8 EA_FinishEditing = 'E';
 const static qint8 EA_WrapLine = 'W';
 const static qint8 EA_UnwrapLine = 'U';
 const static qint8 EA_InsertText = 'I';
+const static qint8 EA_InsertLines = 'L';
 const static qint8 EA_RemoveText = 'R';
+const static qint8 EA_RemoveLines = 'D';
 
 namespace Kate
 {
@@ -94,7 +96,9 @@ void SwapFile::setTrackingEnabled(bool enable)
         connect(&buffer, &Kate::TextBuffer::lineWrapped, this, &Kate::SwapFile::wrapLine);
         connect(&buffer, &Kate::TextBuffer::lineUnwrapped, this, &Kate::SwapFile::unwrapLine);
         connect(&buffer, &Kate::TextBuffer::textInserted, this, &Kate::SwapFile::insertText);
+        connect(&buffer, &Kate::TextBuffer::linesInserted, this, &Kate::SwapFile::insertLines);
         connect(&buffer, &Kate::TextBuffer::textRemoved, this, &Kate::SwapFile::removeText);
+        connect(&buffer, &Kate::TextBuffer::linesRemoved, this, &Kate::SwapFile::removeLines);
     } else {
         disconnect(&buffer, &Kate::TextBuffer::editingStarted, this, &Kate::SwapFile::startEditing);
         disconnect(&buffer, &Kate::TextBuffer::editingFinished, this, &Kate::SwapFile::finishEditing);
@@ -103,7 +107,9 @@ void SwapFile::setTrackingEnabled(bool enable)
         disconnect(&buffer, &Kate::TextBuffer::lineWrapped, this, &Kate::SwapFile::wrapLine);
         disconnect(&buffer, &Kate::TextBuffer::lineUnwrapped, this, &Kate::SwapFile::unwrapLine);
         disconnect(&buffer, &Kate::TextBuffer::textInserted, this, &Kate::SwapFile::insertText);
+        disconnect(&buffer, &Kate::TextBuffer::linesInserted, this, &Kate::SwapFile::insertLines);
         disconnect(&buffer, &Kate::TextBuffer::textRemoved, this, &Kate::SwapFile::removeText);
+        disconnect(&buffer, &Kate::TextBuffer::linesRemoved, this, &Kate::SwapFile::removeLines);
     }
 }
 
@@ -350,6 +356,31 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
 
             break;
         }
+        case EA_InsertLines: {
+            if (!editRunning) {
+                brokenSwapFile = true;
+                break;
+            }
+
+            int line, column;
+            QByteArray text;
+            stream >> line >> column >> text;
+            const QStringList lines = QString::fromUtf8(text.data(), text.size()).split(QLatin1Char('\n'));
+            if (lines.size() < 2) {
+                brokenSwapFile = true;
+                break;
+            }
+            m_document->editInsertMultiLineText(line, column, lines);
+
+            // track undo/redo cursor
+            if (firstEditInGroup) {
+                firstEditInGroup = false;
+                undoCursor = KTextEditor::Cursor(line, column);
+            }
+            redoCursor = KTextEditor::Cursor(line + lines.size() - 1, lines.back().size());
+
+            break;
+        }
         case EA_RemoveText: {
             if (!editRunning) {
                 brokenSwapFile = true;
@@ -369,6 +400,29 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
 
             break;
         }
+        case EA_RemoveLines: {
+            if (!editRunning) {
+                brokenSwapFile = true;
+                break;
+            }
+
+            int line, startColumn, endLine, endColumn;
+            stream >> line >> startColumn >> endLine >> endColumn;
+            if (endLine <= line) {
+                brokenSwapFile = true;
+                break;
+            }
+            m_document->removeText(KTextEditor::Range(KTextEditor::Cursor(line, startColumn), KTextEditor::Cursor(endLine, endColumn)));
+
+            // track undo/redo cursor
+            if (firstEditInGroup) {
+                firstEditInGroup = false;
+                undoCursor = KTextEditor::Cursor(endLine, endColumn);
+            }
+            redoCursor = KTextEditor::Cursor(line, startColumn);
+
+            break;
+        }
         default: {
             qCWarning(LOG_KTE) << "Unknown type:" << type;
         }
@@ -504,6 +558,20 @@ void SwapFile::insertText(const KTextEditor::Cursor &position, const QString &te
     m_needSync = true;
 }
 
+void SwapFile::insertLines(const KTextEditor::Cursor &position, const QStringList &lines)
+{
+    // skip if not open
+    if (!m_swapfile.isOpen()) {
+        return;
+    }
+
+    // format: qint8, int, int, bytearray
+    // the lines are joined with '\n', they can't contain line breaks themselves
+    m_stream << EA_InsertLines << position.line() << position.column() << lines.join(QLatin1Char('\n')).toUtf8();
+
+    m_needSync = true;
+}
+
 void SwapFile::removeText(const KTextEditor::Range &range)
 {
     // skip if not open
@@ -518,6 +586,20 @@ void SwapFile::removeText(const KTextEditor::Range &range)
     m_needSync = true;
 }
 
+void SwapFile::removeLines(const KTextEditor::Range &range)
+{
+    // skip if not open
+    if (!m_swapfile.isOpen()) {
+        return;
+    }
+
+    // format: qint8, int, int, int, int
+    Q_ASSERT(range.start().line() < range.end().line());
+    m_stream << EA_RemoveLines << range.start().line() << range.start().column() << range.end().line() << range.end().column();
+
+    m_needSync = true;
+}
+
 bool SwapFile::shouldRecover() const
 {
     // should not recover if the file has already recovered in another view
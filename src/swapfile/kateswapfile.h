@@ -67,7 +67,9 @@ protected Q_SLOTS:
     void wrapLine(const KTextEditor::Cursor &position);
     void unwrapLine(int line);
     void insertText(const KTextEditor::Cursor &position, const QString &text);
+    void insertLines(const KTextEditor::Cursor &position, const QStringList &lines);
     void removeText(const KTextEditor::Range &range);
+    void removeLines(const KTextEditor::Range &range);
 
 public Q_SLOTS:
     void discard();
@@ -144,6 +144,32 @@ KateModifiedRemoveLine::KateModifiedRemoveLine(KTextEditor::DocumentPrivate *doc
     }
 }
 
+KateModifiedInsertMultiLineText::KateModifiedInsertMultiLineText(KTextEditor::DocumentPrivate *document, int line, int col, const QStringList &lines)
+    : KateEditInsertMultiLineTextUndo(document, line, col, lines)
+{
+    // the inserted lines get their flags on redo like on the first insert, only the first line must be restored on undo
+    Kate::TextLine tl = document->plainKateTextLine(line);
+    Q_ASSERT(tl);
+    if (tl->markedAsModified()) {
+        setFlag(UndoLine1Modified);
+    } else if (!lines.front().isEmpty() || col < tl->length() || tl->markedAsSavedOnDisk()) {
+        setFlag(UndoLine1Saved);
+    }
+}
+
+KateModifiedReplaceText::KateModifiedReplaceText(KTextEditor::DocumentPrivate *document, int line, int col, const QString &oldText, const QString &newText)
+    : KateEditReplaceTextUndo(document, line, col, oldText, newText)
+{
+    setFlag(RedoLine1Modified);
+    Kate::TextLine tl = document->plainKateTextLine(line);
+    Q_ASSERT(tl);
+    if (tl->markedAsModified()) {
+        setFlag(UndoLine1Modified);
+    } else {
+        setFlag(UndoLine1Saved);
+    }
+}
+
 void KateModifiedInsertText::undo()
 {
     KateEditInsertTextUndo::undo();
@@ -216,6 +242,30 @@ void KateModifiedRemoveLine::undo()
     tl->markAsSavedOnDisk(isFlagSet(UndoLine1Saved));
 }
 
+void KateModifiedInsertMultiLineText::undo()
+{
+    KateEditInsertMultiLineTextUndo::undo();
+
+    KTextEditor::DocumentPrivate *doc = document();
+    Kate::TextLine tl = doc->plainKateTextLine(line());
+    Q_ASSERT(tl);
+
+    tl->markAsModified(isFlagSet(UndoLine1Modified));
+    tl->markAsSavedOnDisk(isFlagSet(UndoLine1Saved));
+}
+
+void KateModifiedReplaceText::undo()
+{
+    KateEditReplaceTextUndo::undo();
+
+    KTextEditor::DocumentPrivate *doc = document();
+    Kate::TextLine tl = doc->plainKateTextLine(line());
+    Q_ASSERT(tl);
+
+    tl->markAsModified(isFlagSet(UndoLine1Modified));
+    tl->markAsSavedOnDisk(isFlagSet(UndoLine1Saved));
+}
+
 void KateModifiedRemoveText::redo()
 {
     KateEditRemoveTextUndo::redo();
@@ -240,6 +290,18 @@ void KateModifiedInsertText::redo()
     tl->markAsSavedOnDisk(isFlagSet(RedoLine1Saved));
 }
 
+void KateModifiedReplaceText::redo()
+{
+    KateEditReplaceTextUndo::redo();
+
+    KTextEditor::DocumentPrivate *doc = document();
+    Kate::TextLine tl = doc->plainKateTextLine(line());
+    Q_ASSERT(tl);
+
+    tl->markAsModified(isFlagSet(RedoLine1Modified));
+    tl->markAsSavedOnDisk(isFlagSet(RedoLine1Saved));
+}
+
 void KateModifiedUnWrapLine::redo()
 {
     KateEditUnWrapLineUndo::redo();
@@ -442,3 +504,45 @@ void KateModifiedRemoveLine::updateUndoSavedOnDiskFlag(QBitArray &lines)
         setFlag(UndoLine1Saved);
     }
 }
+
+void KateModifiedInsertMultiLineText::updateUndoSavedOnDiskFlag(QBitArray &lines)
+{
+    if (line() >= lines.size()) {
+        lines.resize(line() + 1);
+    }
+
+    if (isFlagSet(UndoLine1Modified) && !lines.testBit(line())) {
+        lines.setBit(line());
+
+        unsetFlag(UndoLine1Modified);
+        setFlag(UndoLine1Saved);
+    }
+}
+
+void KateModifiedReplaceText::updateRedoSavedOnDiskFlag(QBitArray &lines)
+{
+    if (line() >= lines.size()) {
+        lines.resize(line() + 1);
+    }
+
+    if (!lines.testBit(line())) {
+        lines.setBit(line());
+
+        unsetFlag(RedoLine1Modified);
+        setFlag(RedoLine1Saved);
+    }
+}
+
+void KateModifiedReplaceText::updateUndoSavedOnDiskFlag(QBitArray &lines)
+{
+    if (line() >= lines.size()) {
+        lines.resize(line() + 1);
+    }
+
+    if (!lines.testBit(line())) {
+        lines.setBit(line());
+
+        unsetFlag(UndoLine1Modified);
+        setFlag(UndoLine1Saved);
+    }
+}
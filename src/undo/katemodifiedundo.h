@@ -121,4 +121,36 @@ public:
     void updateUndoSavedOnDiskFlag(QBitArray &lines) override;
 };
 
+class KateModifiedInsertMultiLineText : public KateEditInsertMultiLineTextUndo
+{
+public:
+    KateModifiedInsertMultiLineText(KTextEditor::DocumentPrivate *document, int line, int col, const QStringList &lines);
+
+    /**
+     * @copydoc KateUndo::undo()
+     */
+    void undo() override;
+
+    void updateUndoSavedOnDiskFlag(QBitArray &lines) override;
+};
+
+class KateModifiedReplaceText : public KateEditReplaceTextUndo
+{
+public:
+    KateModifiedReplaceText(KTextEditor::DocumentPrivate *document, int line, int col, const QString &oldText, const QString &newText);
+
+    /**
+     * @copydoc KateUndo::undo()
+     */
+    void undo() override;
+
+    /**
+     * @copydoc KateUndo::redo()
+     */
+    void redo() override;
+
+    void updateUndoSavedOnDiskFlag(QBitArray &lines) override;
+    void updateRedoSavedOnDiskFlag(QBitArray &lines) override;
+};
+
 #endif // KATE_MODIFIED_UNDO_H
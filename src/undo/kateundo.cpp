@@ -73,6 +73,23 @@ KateEditRemoveLineUndo::KateEditRemoveLineUndo(KTextEditor::DocumentPrivate *doc
 {
 }
 
+KateEditInsertMultiLineTextUndo::KateEditInsertMultiLineTextUndo(KTextEditor::DocumentPrivate *document, int line, int col, const QStringList &lines)
+    : KateUndo(document)
+    , m_line(line)
+    , m_col(col)
+    , m_lines(lines)
+{
+}
+
+KateEditReplaceTextUndo::KateEditReplaceTextUndo(KTextEditor::DocumentPrivate *document, int line, int col, const QString &oldText, const QString &newText)
+    : KateUndo(document)
+    , m_line(line)
+    , m_col(col)
+    , m_oldText(oldText)
+    , m_newText(newText)
+{
+}
+
 bool KateUndo::isEmpty() const
 {
     return false;
@@ -169,6 +186,20 @@ void KateEditMarkLineAutoWrappedUndo::undo()
     doc->editMarkLineAutoWrapped(m_line, m_autowrapped);
 }
 
+void KateEditInsertMultiLineTextUndo::undo()
+{
+    KTextEditor::DocumentPrivate *doc = document();
+
+    doc->editRemoveMultiLineText(KTextEditor::Range(m_line, m_col, m_line + m_lines.size() - 1, m_lines.back().size()));
+}
+
+void KateEditReplaceTextUndo::undo()
+{
+    KTextEditor::DocumentPrivate *doc = document();
+
+    doc->editReplaceText(m_line, m_col, m_newText.size(), m_oldText);
+}
+
 void KateEditRemoveTextUndo::redo()
 {
     KTextEditor::DocumentPrivate *doc = document();
@@ -211,6 +242,20 @@ void KateEditInsertLineUndo::redo()
     doc->editInsertLine(m_line, m_text);
 }
 
+void KateEditInsertMultiLineTextUndo::redo()
+{
+    KTextEditor::DocumentPrivate *doc = document();
+
+    doc->editInsertMultiLineText(m_line, m_col, m_lines);
+}
+
+void KateEditReplaceTextUndo::redo()
+{
+    KTextEditor::DocumentPrivate *doc = document();
+
+    doc->editReplaceText(m_line, m_col, m_oldText.size(), m_newText);
+}
+
 void KateEditMarkLineAutoWrappedUndo::redo()
 {
     KTextEditor::DocumentPrivate *doc = document();
@@ -12,6 +12,7 @@
 #define kate_undo_h
 
 #include <QList>
+#include <QStringList>
 
 #include <QBitArray>
 #include <ktexteditor/range.h>
@@ -48,7 +49,18 @@ public:
     /**
      * Types for undo items
      */
-    enum UndoType { editInsertText, editRemoveText, editWrapLine, editUnWrapLine, editInsertLine, editRemoveLine, editMarkLineAutoWrapped, editInvalid };
+    enum UndoType {
+        editInsertText,
+        editRemoveText,
+        editWrapLine,
+        editUnWrapLine,
+        editInsertLine,
+        editRemoveLine,
+        editMarkLineAutoWrapped,
+        editInsertMultiLineText,
+        editReplaceText,
+        editInvalid
+    };
 
 public:
     /**
@@ -413,6 +425,77 @@ private:
     const QString m_text;
 };
 
+class KateEditInsertMultiLineTextUndo : public KateUndo
+{
+public:
+    explicit KateEditInsertMultiLineTextUndo(KTextEditor::DocumentPrivate *document, int line, int col, const QStringList &lines);
+
+    /**
+     * @copydoc KateUndo::undo()
+     */
+    void undo() override;
+
+    /**
+     * @copydoc KateUndo::redo()
+     */
+    void redo() override;
+
+    /**
+     * @copydoc KateUndo::type()
+     */
+    KateUndo::UndoType type() const override
+    {
+        return KateUndo::editInsertMultiLineText;
+    }
+
+protected:
+    inline int line() const
+    {
+        return m_line;
+    }
+
+private:
+    const int m_line;
+    const int m_col;
+    const QStringList m_lines;
+};
+
+class KateEditReplaceTextUndo : public KateUndo
+{
+public:
+    explicit KateEditReplaceTextUndo(KTextEditor::DocumentPrivate *document, int line, int col, const QString &oldText, const QString &newText);
+
+    /**
+     * @copydoc KateUndo::undo()
+     */
+    void undo() override;
+
+    /**
+     * @copydoc KateUndo::redo()
+     */
+    void redo() override;
+
+    /**
+     * @copydoc KateUndo::type()
+     */
+    KateUndo::UndoType type() const override
+    {
+        return KateUndo::editReplaceText;
+    }
+
+protected:
+    inline int line() const
+    {
+        return m_line;
+    }
+
+private:
+    const int m_line;
+    const int m_col;
+    const QString m_oldText;
+    const QString m_newText;
+};
+
 /**
  * Class to manage a group of undo items
  */
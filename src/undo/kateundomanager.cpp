@@ -135,6 +135,13 @@ void KateUndoManager::slotTextRemoved(int line, int col, const QString &s)
     }
 }
 
+void KateUndoManager::slotTextReplaced(int line, int col, const QString &oldText, const QString &newText)
+{
+    if (m_editCurrentUndo != nullptr) { // do we care about notifications?
+        addUndoItem(new KateModifiedReplaceText(m_document, line, col, oldText, newText));
+    }
+}
+
 void KateUndoManager::slotMarkLineAutoWrapped(int line, bool autowrapped)
 {
     if (m_editCurrentUndo != nullptr) { // do we care about notifications?
@@ -163,6 +170,13 @@ void KateUndoManager::slotLineInserted(int line, const QString &s)
     }
 }
 
+void KateUndoManager::slotMultiLineTextInserted(int line, int col, const QStringList &lines)
+{
+    if (m_editCurrentUndo != nullptr) { // do we care about notifications?
+        addUndoItem(new KateModifiedInsertMultiLineText(m_document, line, col, lines));
+    }
+}
+
 void KateUndoManager::slotLineRemoved(int line, const QString &s)
 {
     if (m_editCurrentUndo != nullptr) { // do we care about notifications?
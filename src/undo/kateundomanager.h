@@ -12,6 +12,7 @@
 #include <ktexteditor_export.h>
 
 #include <QList>
+#include <QStringList>
 
 namespace KTextEditor
 {
@@ -147,6 +148,11 @@ public Q_SLOTS:
      */
     void slotTextRemoved(int line, int col, const QString &s);
 
+    /**
+     * Notify KateUndoManager that text was replaced by other text in one line.
+     */
+    void slotTextReplaced(int line, int col, const QString &oldText, const QString &newText);
+
     /**
      * Notify KateUndoManager that a line was marked as autowrapped.
      */
@@ -167,6 +173,11 @@ public Q_SLOTS:
      */
     void slotLineInserted(int line, const QString &s);
 
+    /**
+     * Notify KateUndoManager that multiple lines of text were inserted at once.
+     */
+    void slotMultiLineTextInserted(int line, int col, const QStringList &lines);
+
     /**
      * Notify KateUndoManager that a line was removed.
      */
@@ -347,6 +347,10 @@ KateDocumentConfig::KateDocumentConfig()
     addConfigEntry(ConfigEntry(SwapFileDirectory, "Swap Directory", QString(), QString()));
     addConfigEntry(ConfigEntry(SwapFileSyncInterval, "Swap Sync Interval", QString(), 15));
     addConfigEntry(ConfigEntry(LineLengthLimit, "Line Length Limit", QString(), 10000));
+    addConfigEntry(ConfigEntry(SearchIndex, "Search Index", QString(), false));
+    addConfigEntry(ConfigEntry(SearchIndexMemoryLimit, "Search Index Memory Limit", QString(), 64, [](const QVariant &value) {
+        return value.toInt() >= 1;
+    }));
 
     // finalize the entries, e.g. hashs them
     finalizeConfigEntries();
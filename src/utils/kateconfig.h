@@ -526,7 +526,17 @@ public:
         /**
          * Line length limit
          */
-        LineLengthLimit
+        LineLengthLimit,
+
+        /**
+         * Search index
+         */
+        SearchIndex,
+
+        /**
+         * Memory limit of the search index in MiB
+         */
+        SearchIndexMemoryLimit
     };
 
 public:
@@ -896,6 +906,26 @@ public:
         setValue(LineLengthLimit, limit);
     }
 
+    bool searchIndex() const
+    {
+        return value(SearchIndex).toBool();
+    }
+
+    void setSearchIndex(bool on)
+    {
+        setValue(SearchIndex, on);
+    }
+
+    int searchIndexMemoryLimit() const
+    {
+        return value(SearchIndexMemoryLimit).toInt();
+    }
+
+    void setSearchIndexMemoryLimit(int limit)
+    {
+        setValue(SearchIndexMemoryLimit, limit);
+    }
+
 private:
     static KateDocumentConfig *s_global;
     KTextEditor::DocumentPrivate *m_doc = nullptr;
@@ -11,6 +11,7 @@
 #include "katecmd.h"
 #include "katedocument.h"
 #include "kateglobal.h"
+#include "katematch.h"
 #include "katepartdebug.h"
 #include "kateview.h"
 
@@ -180,11 +181,11 @@ KateCommands::SedReplace::InteractiveSedReplacer::InteractiveSedReplacer(KTextEd
                                                                          int endLine)
     : m_findPattern(findPattern)
     , m_replacePattern(replacePattern)
+    , m_caseSensitive(caseSensitive)
     , m_onlyOnePerLine(onlyOnePerLine)
     , m_endLine(endLine)
     , m_doc(doc)
-    , m_regExpSearch(doc)
-    , m_caseSensitive(caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive)
+    , m_regExpSearch(doc, findPattern, caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption)
     , m_numReplacementsDone(0)
     , m_numLinesTouched(0)
     , m_lastChangedLineNum(-1)
@@ -257,6 +258,31 @@ void KateCommands::SedReplace::InteractiveSedReplacer::replaceCurrentMatch()
 void KateCommands::SedReplace::InteractiveSedReplacer::replaceAllRemaining()
 {
     m_doc->editBegin();
+
+    // replace the matches of all lines in one go, if neither they nor their replacements span lines
+    const int endLine = qMin(m_endLine, m_doc->lines() - 1);
+    if (m_currentSearchPos.line() <= endLine) {
+        KTextEditor::SearchOptions options(KTextEditor::Regex);
+        if (!m_caseSensitive) {
+            options |= KTextEditor::CaseInsensitive;
+        }
+        KateMatch match(m_doc, options);
+        const KTextEditor::Range range(m_currentSearchPos, KTextEditor::Cursor(endLine, m_doc->lineLength(endLine)));
+        QVector<KTextEditor::Range> replacedRanges;
+        if (match.replaceAll(range, m_findPattern, m_replacePattern, 0, replacedRanges, m_onlyOnePerLine)) {
+            for (const KTextEditor::Range &replacedRange : qAsConst(replacedRanges)) {
+                m_numReplacementsDone++;
+                if (m_lastChangedLineNum != replacedRange.start().line()) {
+                    m_numLinesTouched++;
+                }
+                m_lastChangedLineNum = replacedRange.start().line();
+            }
+
+            // all done, no match starts after the end line
+            m_currentSearchPos = KTextEditor::Cursor(endLine + 1, 0);
+        }
+    }
+
     while (currentMatch().isValid()) {
         replaceCurrentMatch();
     }
@@ -283,11 +309,8 @@ const QVector<KTextEditor::Range> KateCommands::SedReplace::InteractiveSedReplac
         return QVector<KTextEditor::Range>();
     }
 
-    QRegularExpression::PatternOptions options;
-    if (m_caseSensitive == Qt::CaseInsensitive) {
-        options |= (QRegularExpression::CaseInsensitiveOption);
-    }
-    return m_regExpSearch.search(m_findPattern, KTextEditor::Range(m_currentSearchPos, m_doc->documentEnd()), false /* search backwards */, options);
+    // the pattern got prepared once in the constructor
+    return m_regExpSearch.search(KTextEditor::Range(m_currentSearchPos, m_doc->documentEnd()), false /* search backwards */);
 }
 
 QString KateCommands::SedReplace::InteractiveSedReplacer::replacementTextForCurrentMatch()
@@ -116,11 +116,11 @@ public:
     private:
         const QString m_findPattern;
         const QString m_replacePattern;
+        const bool m_caseSensitive;
         bool m_onlyOnePerLine;
         int m_endLine;
         KTextEditor::DocumentPrivate *m_doc;
         KateRegExpSearch m_regExpSearch;
-        Qt::CaseSensitivity m_caseSensitive;
 
         int m_numReplacementsDone;
         int m_numLinesTouched;
@@ -134,6 +134,7 @@ void KateTextPreview::paintEvent(QPaintEvent *event)
         // compute layout WITHOUT cache to not poison it + render it
         KateLineLayoutPtr lineLayout(new KateLineLayout(*renderer));
         lineLayout->setLine(realLine, -1);
+        lineLayout->setVisibleX(xStart, xEnd - xStart);
         renderer->layoutLine(lineLayout, -1 /* no wrap */, false /* no layout cache */);
         renderer->paintTextLine(paint, lineLayout, xStart, xEnd, nullptr, KateRenderer::SkipDrawFirstInvisibleLineUnderlined);
 
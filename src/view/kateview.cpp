@@ -2144,11 +2144,15 @@ bool KTextEditor::ViewPrivate::tagRange(const KTextEditor::Range &range, bool re
 
 bool KTextEditor::ViewPrivate::tagLines(KTextEditor::LineRange lineRange, bool realLines)
 {
-    return m_viewInternal->tagLines(lineRange.start(), lineRange.end(), realLines);
+    return tagLines(KTextEditor::Cursor(lineRange.start(), 0), KTextEditor::Cursor(lineRange.end(), -1), realLines);
 }
 
 bool KTextEditor::ViewPrivate::tagLines(KTextEditor::Cursor start, KTextEditor::Cursor end, bool realCursors)
 {
+    // highlighting, selection and range changes are shown by the mini map, too
+    if (realCursors) {
+        m_viewInternal->m_lineScroll->tagMiniMapLines(start.line(), end.line());
+    }
     return m_viewInternal->tagLines(start, end, realCursors);
 }
 
@@ -2765,6 +2769,20 @@ QTextLayout *KTextEditor::ViewPrivate::textLayout(const KTextEditor::Cursor &pos
     return thisLine->isValid() ? thisLine->layout() : nullptr;
 }
 
+int KTextEditor::ViewPrivate::nextCursorPosition(const KTextEditor::Cursor &pos) const
+{
+    KateLineLayoutPtr thisLine = m_viewInternal->cache()->line(pos);
+
+    return thisLine->isValid() ? thisLine->nextCursorPosition(pos.column()) : pos.column() + 1;
+}
+
+int KTextEditor::ViewPrivate::previousCursorPosition(const KTextEditor::Cursor &pos) const
+{
+    KateLineLayoutPtr thisLine = m_viewInternal->cache()->line(pos);
+
+    return thisLine->isValid() ? thisLine->previousCursorPosition(pos.column()) : qMax(0, pos.column() - 1);
+}
+
 void KTextEditor::ViewPrivate::indent()
 {
     KTextEditor::Cursor c(cursorPosition().line(), 0);
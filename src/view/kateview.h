@@ -449,6 +449,13 @@ public:
     QTextLayout *textLayout(int line) const;
     QTextLayout *textLayout(const KTextEditor::Cursor &pos) const;
 
+    /**
+     * Cursor positions after and before \p pos in its line, like QTextLayout::nextCursorPosition().
+     * Unlike the ones of textLayout(), they work for the columns of very long lines outside of their laid out window, too.
+     */
+    int nextCursorPosition(const KTextEditor::Cursor &pos) const;
+    int previousCursorPosition(const KTextEditor::Cursor &pos) const;
+
 public Q_SLOTS:
     void indent();
     void unIndent();
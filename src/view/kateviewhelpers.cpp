@@ -43,7 +43,10 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QBoxLayout>
+#include <QCoreApplication>
 #include <QCursor>
+#include <QElapsedTimer>
+#include <QImage>
 #include <QKeyEvent>
 #include <QLinearGradient>
 #include <QMenu>
@@ -52,9 +55,11 @@
 #include <QPalette>
 #include <QPen>
 #include <QRegularExpression>
+#include <QRunnable>
 #include <QStyle>
 #include <QStyleOption>
 #include <QTextCodec>
+#include <QThreadPool>
 #include <QToolButton>
 #include <QToolTip>
 #include <QVariant>
@@ -149,6 +154,16 @@ static const int s_lineWidth = 100;
 static const int s_pixelMargin = 8;
 static const int s_linePixelIncLimit = 6;
 
+/**
+ * document lines of a mini map tile, at least one pixel row
+ */
+static const int s_miniMapTileLines = 256;
+
+/**
+ * time in ms to take snapshots of mini map tiles at once, the other tiles are taken right after
+ */
+static const int s_miniMapSnapshotTime = 10;
+
 const unsigned char KateScrollBar::characterOpacity[256] = {0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, // <- 15
                                                             0,   0,   0,   0,   0,   0,   0,   0,   255, 0,   255, 0,   0,   0,   0,   0, // <- 31
                                                             0,   125, 41,  221, 138, 195, 218, 21,  142, 142, 137, 137, 97,  87,  87,  140, // <- 47
@@ -189,6 +204,31 @@ KateScrollBar::KateScrollBar(Qt::Orientation orientation, KateViewInternal *pare
     m_updateTimer.setSingleShot(true);
     QTimer::singleShot(10, this, SLOT(updatePixmap()));
 
+    m_miniMapTileTimer.setInterval(0);
+    m_miniMapTileTimer.setSingleShot(true);
+    connect(&m_miniMapTileTimer, &QTimer::timeout, this, &KateScrollBar::updateMiniMapTiles);
+
+    // edited lines and the lines after added or removed ones are drawn again in the mini map
+    const KateBuffer *buffer = &m_doc->buffer();
+    connect(buffer, &KateBuffer::lineWrapped, this, [this](const KTextEditor::Cursor &position) {
+        tagMiniMapLines(position.line(), -1);
+    });
+    connect(buffer, &KateBuffer::lineUnwrapped, this, [this](int line) {
+        tagMiniMapLines(line - 1, -1);
+    });
+    connect(buffer, &KateBuffer::linesInserted, this, [this](const KTextEditor::Cursor &position) {
+        tagMiniMapLines(position.line(), -1);
+    });
+    connect(buffer, &KateBuffer::textInserted, this, [this](const KTextEditor::Cursor &position) {
+        tagMiniMapLines(position.line(), position.line());
+    });
+    connect(buffer, &KateBuffer::textRemoved, this, [this](const KTextEditor::Range &range) {
+        tagMiniMapLines(range.start().line(), range.start().line());
+    });
+    connect(buffer, &KateBuffer::linesRemoved, this, [this](const KTextEditor::Range &range) {
+        tagMiniMapLines(range.start().line(), -1);
+    });
+
     // track mouse for text preview widget
     setMouseTracking(orientation == Qt::Vertical);
 
@@ -204,7 +244,7 @@ void KateScrollBar::showEvent(QShowEvent *event)
 
     if (m_needsUpdateOnShow) {
         m_needsUpdateOnShow = false;
-        updatePixmap();
+        updateMiniMapTiles();
     }
 }
 
@@ -215,19 +255,23 @@ KateScrollBar::~KateScrollBar()
 
 void KateScrollBar::setShowMiniMap(bool b)
 {
+    // edits, selections and highlighting tag the lines to draw again, see tagMiniMapLines()
+    const bool wasShown = m_showMiniMap;
     if (b && !m_showMiniMap) {
-        auto timerSlot = QOverload<>::of(&QTimer::start);
-        connect(m_view, &KTextEditor::ViewPrivate::selectionChanged, &m_updateTimer, timerSlot, Qt::UniqueConnection);
-        connect(m_doc, &KTextEditor::DocumentPrivate::textChanged, &m_updateTimer, timerSlot, Qt::UniqueConnection);
-        connect(m_view, &KTextEditor::ViewPrivate::delayedUpdateOfView, &m_updateTimer, timerSlot, Qt::UniqueConnection);
-        connect(&m_updateTimer, &QTimer::timeout, this, &KateScrollBar::updatePixmap, Qt::UniqueConnection);
-        connect(&(m_view->textFolding()), &Kate::TextFolding::foldingRangesChanged, &m_updateTimer, timerSlot, Qt::UniqueConnection);
+        connect(&m_updateTimer, &QTimer::timeout, this, &KateScrollBar::updateMiniMapTiles, Qt::UniqueConnection);
+        connect(&(m_view->textFolding()), &Kate::TextFolding::foldingRangesChanged, this, &KateScrollBar::queuePixmapUpdate, Qt::UniqueConnection);
     } else if (!b) {
         disconnect(&m_updateTimer);
+        disconnect(&(m_view->textFolding()), &Kate::TextFolding::foldingRangesChanged, this, &KateScrollBar::queuePixmapUpdate);
     }
 
     m_showMiniMap = b;
 
+    // nothing was tagged while hidden
+    if (b && !wasShown) {
+        queuePixmapUpdate();
+    }
+
     updateGeometry();
     update();
 }
@@ -437,7 +481,13 @@ void KateScrollBar::showTextPreview()
         }
 
         const qreal posInPercent = static_cast<double>(cursorPos.y() - grooveRect.top()) / grooveRect.height();
-        const qreal startLine = posInPercent * m_view->textFolding().visibleLines();
+        qreal startLine = posInPercent * m_view->textFolding().visibleLines();
+
+        // with dynamic word wrap the scroll bar counts view lines, preview the line of the view line under the mouse
+        if (m_viewInternal->lineScrollByViewLines()) {
+            KateLayoutCache *cache = m_viewInternal->cache();
+            startLine = cache->documentViewLineStart(static_cast<int>(posInPercent * cache->documentViewLines())).line();
+        }
 
         m_textPreview->resize(m_view->width() / 2, m_view->height() / 5);
         const int xGlobal = mapToGlobal(QPoint(0, 0)).x();
@@ -464,29 +514,90 @@ void KateScrollBar::hideTextPreview()
     delete m_textPreview;
 }
 
+/**
+ * Snapshot of the lines of a mini map tile, rendered into an image on a thread of the global thread pool.
+ * Only every line increment-th line is taken, like it is drawn, but the modification markers of all lines.
+ */
+class KateScrollBar::MiniMapTile : public QRunnable
+{
+public:
+    struct Decoration {
+        int start;
+        int length;
+        QColor color;
+    };
+
+    struct Line {
+        int line;
+        QString text;
+        QVector<Kate::TextLineData::Attribute> attributes;
+        QVector<Decoration> decorations;
+    };
+
+    struct Marker {
+        int row;
+        bool modified;
+    };
+
+    MiniMapTile(KateScrollBar *scrollBar, int tile, quint64 generation)
+        : m_scrollBar(scrollBar)
+        , m_tile(tile)
+        , m_generation(generation)
+    {
+    }
+
+    void run() override
+    {
+        const QImage image = render();
+        if (!QCoreApplication::instance()) {
+            return;
+        }
+
+        // the scroll bar is only accessed in the GUI thread
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [scrollBar = m_scrollBar, tile = m_tile, generation = m_generation, image]() {
+                if (scrollBar) {
+                    scrollBar->miniMapTileRendered(tile, generation, image);
+                }
+            },
+            Qt::QueuedConnection);
+    }
+
+    // what to render, not changed once the tile is started
+    int width = 0;
+    int rows = 0;
+    int charIncrement = 1;
+    QColor defaultTextColor;
+    QColor selectionBgColor;
+    QColor modifiedLineColor;
+    QColor savedLineColor;
+    KTextEditor::Range selection;
+    QVector<QColor> attributeColors;
+    QVector<Line> lines;
+    QVector<Marker> markers;
+
+private:
+    QImage render() const;
+    QColor charColor(const Line &line, int &attributeIndex, int x) const;
+
+    const QPointer<KateScrollBar> m_scrollBar;
+    const int m_tile;
+    const quint64 m_generation;
+};
+
 // This function is optimized for bing called in sequence.
-const QColor KateScrollBar::charColor(const QVector<Kate::TextLineData::Attribute> &attributes,
-                                      int &attributeIndex,
-                                      const QVector<QTextLayout::FormatRange> &decorations,
-                                      const QColor &defaultColor,
-                                      int x,
-                                      QChar ch)
+QColor KateScrollBar::MiniMapTile::charColor(const Line &line, int &attributeIndex, int x) const
 {
-    QColor color = defaultColor;
+    QColor color = defaultTextColor;
 
     bool styleFound = false;
 
     // Query the decorations, that is, things like search highlighting, or the
     // KDevelop DUChain highlighting, for a color to use
-    for (auto &range : decorations) {
-        if (range.start <= x && range.start + range.length > x) {
-            // If there's a different background color set (search markers, ...)
-            // use that, otherwise use the foreground color.
-            if (range.format.hasProperty(QTextFormat::BackgroundBrush)) {
-                color = range.format.background().color();
-            } else {
-                color = range.format.foreground().color();
-            }
+    for (const Decoration &decoration : line.decorations) {
+        if (decoration.start <= x && decoration.start + decoration.length > x) {
+            color = decoration.color;
             styleFound = true;
             break;
         }
@@ -495,12 +606,13 @@ const QColor KateScrollBar::charColor(const QVector<Kate::TextLineData::Attribut
     // If there's no decoration set for the current character (this will mostly be the case for
     // plain Kate), query the styles, that is, the default kate syntax highlighting.
     if (!styleFound) {
+        const QVector<Kate::TextLineData::Attribute> &attributes = line.attributes;
         // go to the block containing x
         while ((attributeIndex < attributes.size()) && ((attributes[attributeIndex].offset + attributes[attributeIndex].length) < x)) {
             ++attributeIndex;
         }
         if ((attributeIndex < attributes.size()) && (x < attributes[attributeIndex].offset + attributes[attributeIndex].length)) {
-            color = m_view->renderer()->attribute(attributes[attributeIndex].attributeValue)->foreground().color();
+            color = attributeColors.value(attributes[attributeIndex].attributeValue, defaultTextColor);
         }
     }
 
@@ -509,16 +621,162 @@ const QColor KateScrollBar::charColor(const QVector<Kate::TextLineData::Attribut
     // than an A or similar.
     // This gives the pixels created a bit of structure, which makes it look more
     // like real text.
+    const QChar ch = line.text.at(x);
     color.setAlpha((ch.unicode() < 256) ? characterOpacity[ch.unicode()] : 222);
 
     return color;
 }
 
+QImage KateScrollBar::MiniMapTile::render() const
+{
+    QImage image(width, rows, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter;
+    if (!painter.begin(&image)) {
+        return image;
+    }
+
+    // init pen once, afterwards, only change it if color changes to avoid a lot of allocation for setPen
+    painter.setPen(selectionBgColor);
+
+    int pixelY = 0;
+    int drawnLines = 0;
+
+    for (const Line &line : lines) {
+        const QString &lineText = line.text;
+        int attributeIndex = 0;
+
+        // Draw selection if it is on an empty line
+        if (selection.contains(KTextEditor::Cursor(line.line, 0)) && lineText.size() == 0) {
+            if (selectionBgColor != painter.pen().color()) {
+                painter.setPen(selectionBgColor);
+            }
+            painter.drawLine(s_pixelMargin, pixelY, s_pixelMargin + s_lineWidth - 1, pixelY);
+        }
+
+        // Iterate over the line to draw the background
+        int selStartX = -1;
+        int selEndX = -1;
+        int pixelX = s_pixelMargin; // use this to control the offset of the text from the left
+        for (int x = 0; (x < lineText.size() && x < s_lineWidth); x += charIncrement) {
+            if (pixelX >= s_lineWidth + s_pixelMargin) {
+                break;
+            }
+            // Query the selection and draw it behind the character
+            if (selection.contains(KTextEditor::Cursor(line.line, x))) {
+                if (selStartX == -1)
+                    selStartX = pixelX;
+                selEndX = pixelX;
+                if (lineText.size() - 1 == x) {
+                    selEndX = s_lineWidth + s_pixelMargin - 1;
+                }
+            }
+
+            if (lineText[x] == QLatin1Char('\t')) {
+                pixelX += qMax(4 / charIncrement, 1); // FIXME: tab width...
+            } else {
+                pixelX++;
+            }
+        }
+
+        if (selStartX != -1) {
+            if (selectionBgColor != painter.pen().color()) {
+                painter.setPen(selectionBgColor);
+            }
+            painter.drawLine(selStartX, pixelY, selEndX, pixelY);
+        }
+
+        // Iterate over all the characters in the current line
+        pixelX = s_pixelMargin;
+        for (int x = 0; (x < lineText.size() && x < s_lineWidth); x += charIncrement) {
+            if (pixelX >= s_lineWidth + s_pixelMargin) {
+                break;
+            }
+
+            // draw the pixels
+            if (lineText[x] == QLatin1Char(' ')) {
+                pixelX++;
+            } else if (lineText[x] == QLatin1Char('\t')) {
+                pixelX += qMax(4 / charIncrement, 1); // FIXME: tab width...
+            } else {
+                const QColor newPenColor(charColor(line, attributeIndex, x));
+                if (newPenColor != painter.pen().color()) {
+                    painter.setPen(newPenColor);
+                }
+
+                // Actually draw the pixel with the color queried from the renderer.
+                painter.drawPoint(pixelX, pixelY);
+
+                pixelX++;
+            }
+        }
+        drawnLines++;
+        if (((drawnLines) % charIncrement) == 0) {
+            pixelY++;
+        }
+    }
+
+    // Draw line modification marker map.
+    for (const Marker &marker : markers) {
+        painter.fillRect(2, marker.row, 3, 1, marker.modified ? modifiedLineColor : savedLineColor);
+    }
+
+    // end painting
+    painter.end();
+    return image;
+}
+
 void KateScrollBar::updatePixmap()
 {
-    // QTime time;
-    // time.start();
+    // everything may have changed, e.g. the document was reloaded
+    invalidateMiniMap();
+    updateMiniMapTiles();
+}
+
+void KateScrollBar::queuePixmapUpdate()
+{
+    invalidateMiniMap();
+    m_updateTimer.start();
+}
+
+void KateScrollBar::invalidateMiniMap()
+{
+    for (MiniMapTileState &tile : m_miniMapTiles) {
+        tile.generation = ++m_miniMapGeneration;
+        tile.dirty = true;
+    }
+}
+
+void KateScrollBar::tagMiniMapLines(int startLine, int endLine)
+{
+    if (!m_showMiniMap || m_miniMapTiles.isEmpty()) {
+        return;
+    }
 
+    const Kate::TextFolding &folding = m_view->textFolding();
+    const int lastLine = m_doc->lastLine();
+    const int lastTile = m_miniMapTiles.size() - 1;
+    startLine = qBound(0, startLine, lastLine);
+    const int firstTile = qMin(folding.lineToVisibleLine(startLine) / m_miniMapTileLines, lastTile);
+    int endTile = lastTile;
+    if (endLine >= 0) {
+        endTile = qMin(folding.lineToVisibleLine(qBound(startLine, endLine, lastLine)) / m_miniMapTileLines, lastTile);
+    }
+
+    for (int tile = firstTile; tile <= endTile; ++tile) {
+        m_miniMapTiles[tile].generation = ++m_miniMapGeneration;
+        m_miniMapTiles[tile].dirty = true;
+    }
+
+    // lines might be tagged all the time, e.g. while highlighting in the background, don't postpone the update
+    if (!m_updateTimer.isActive()) {
+        m_updateTimer.start();
+    }
+}
+
+void KateScrollBar::updateMiniMapTiles()
+{
     if (!m_showMiniMap) {
         // make sure no time is wasted if the option is disabled
         return;
@@ -559,6 +817,37 @@ void KateScrollBar::updatePixmap()
     // qCDebug(LOG_KTE) << "l" << lineIncrement << "c" << charIncrement << "d";
     // qCDebug(LOG_KTE) << "pixmap" << pixmapLineCount << pixmapLineWidth << "docLines" << m_view->textFolding().visibleLines() << "height" << m_grooveHeight;
 
+    // a tile spans whole pixel rows
+    const int rowLines = lineIncrement * charIncrement;
+    const int tileLines = qMax(1, s_miniMapTileLines / rowLines) * rowLines;
+    const int tileCount = (docLineCount + tileLines - 1) / tileLines;
+
+    // scaled differently, all tiles are outdated
+    if (tileLines != m_miniMapTileLines || lineIncrement != m_miniMapLineIncrement || charIncrement != m_miniMapCharIncrement) {
+        m_miniMapTileLines = tileLines;
+        m_miniMapLineIncrement = lineIncrement;
+        m_miniMapCharIncrement = charIncrement;
+        m_pixmap = QPixmap();
+        invalidateMiniMap();
+    }
+
+    const int oldTileCount = m_miniMapTiles.size();
+    m_miniMapTiles.resize(tileCount);
+    for (int tile = oldTileCount; tile < tileCount; ++tile) {
+        m_miniMapTiles[tile].generation = ++m_miniMapGeneration;
+    }
+
+    // the pixmap grows and shrinks with the document, the rows of the tiles rendered already are kept
+    if (m_pixmap.width() != pixmapLineWidth || m_pixmap.height() != pixmapLineCount) {
+        QPixmap pixmap(pixmapLineWidth, pixmapLineCount);
+        pixmap.fill(Qt::transparent);
+        if (!m_pixmap.isNull()) {
+            QPainter painter(&pixmap);
+            painter.drawPixmap(0, 0, m_pixmap);
+        }
+        m_pixmap = pixmap;
+    }
+
     const QColor backgroundColor = m_view->defaultStyleAttribute(KTextEditor::dsNormal)->background().color();
     const QColor defaultTextColor = m_view->defaultStyleAttribute(KTextEditor::dsNormal)->foreground().color();
     const QColor selectionBgColor = m_view->renderer()->config()->selectionColor();
@@ -568,131 +857,100 @@ void KateScrollBar::updatePixmap()
     modifiedLineColor.setHsv(modifiedLineColor.hue(), 255, 255 - backgroundColor.value() / 3);
     savedLineColor.setHsv(savedLineColor.hue(), 100, 255 - backgroundColor.value() / 3);
 
-    // increase dimensions by ratio
-    m_pixmap = QPixmap(pixmapLineWidth * m_view->devicePixelRatioF(), pixmapLineCount * m_view->devicePixelRatioF());
-    m_pixmap.fill(QColor("transparent"));
-
     // The text currently selected in the document, to be drawn later.
     const KTextEditor::Range &selection = m_view->selectionRange();
 
-    QPainter painter;
-    if (painter.begin(&m_pixmap)) {
-        // init pen once, afterwards, only change it if color changes to avoid a lot of allocation for setPen
-        painter.setPen(selectionBgColor);
-
-        // Do not force updates of the highlighting if the document is very large
-        bool simpleMode = m_doc->lines() > 7500;
-
-        int pixelY = 0;
-        int drawnLines = 0;
-
-        // Iterate over all visible lines, drawing them.
-        for (int virtualLine = 0; virtualLine < docLineCount; virtualLine += lineIncrement) {
-            int realLineNumber = m_view->textFolding().visibleLineToLine(virtualLine);
-            QString lineText = m_doc->line(realLineNumber);
+    // foreground colors of the highlighting attributes, as far as used
+    QVector<QColor> attributeColors;
 
-            if (!simpleMode) {
-                m_doc->buffer().ensureHighlighted(realLineNumber);
-            }
+    // Take snapshots of the outdated tiles for a while, the others follow right after.
+    QElapsedTimer timer;
+    timer.start();
+    for (int tile = 0; tile < tileCount; ++tile) {
+        MiniMapTileState &state = m_miniMapTiles[tile];
+        if (!state.dirty) {
+            continue;
+        }
+        if (timer.elapsed() >= s_miniMapSnapshotTime) {
+            m_miniMapTileTimer.start();
+            break;
+        }
+        state.dirty = false;
+
+        MiniMapTile *miniMapTile = new MiniMapTile(this, tile, state.generation);
+        miniMapTile->width = pixmapLineWidth;
+        miniMapTile->rows = tileLines / rowLines;
+        miniMapTile->charIncrement = charIncrement;
+        miniMapTile->defaultTextColor = defaultTextColor;
+        miniMapTile->selectionBgColor = selectionBgColor;
+        miniMapTile->modifiedLineColor = modifiedLineColor;
+        miniMapTile->savedLineColor = savedLineColor;
+        miniMapTile->selection = selection;
+
+        const int firstLine = tile * tileLines;
+        const QVector<int> realLineNumbers = m_view->textFolding().visibleLinesToLines(firstLine, qMin(firstLine + tileLines, docLineCount) - 1);
+
+        // Do not wait for the highlighting of lines far away, the tile is tagged once they are highlighted
+        m_doc->buffer().ensureHighlightedIncrementally(realLineNumbers.last());
+
+        miniMapTile->lines.reserve(realLineNumbers.size() / lineIncrement + 1);
+        for (int i = 0; i < realLineNumbers.size(); ++i) {
+            const int realLineNumber = realLineNumbers.at(i);
             const Kate::TextLine &kateline = m_doc->plainKateTextLine(realLineNumber);
 
-            const QVector<Kate::TextLineData::Attribute> &attributes = kateline->attributesList();
-            QVector<QTextLayout::FormatRange> decorations = m_view->renderer()->decorationsForLine(kateline, realLineNumber);
-            int attributeIndex = 0;
-
-            // Draw selection if it is on an empty line
-            if (selection.contains(KTextEditor::Cursor(realLineNumber, 0)) && lineText.size() == 0) {
-                if (selectionBgColor != painter.pen().color()) {
-                    painter.setPen(selectionBgColor);
-                }
-                painter.drawLine(s_pixelMargin, pixelY, s_pixelMargin + s_lineWidth - 1, pixelY);
-            }
-
-            // Iterate over the line to draw the background
-            int selStartX = -1;
-            int selEndX = -1;
-            int pixelX = s_pixelMargin; // use this to control the offset of the text from the left
-            for (int x = 0; (x < lineText.size() && x < s_lineWidth); x += charIncrement) {
-                if (pixelX >= s_lineWidth + s_pixelMargin) {
-                    break;
-                }
-                // Query the selection and draw it behind the character
-                if (selection.contains(KTextEditor::Cursor(realLineNumber, x))) {
-                    if (selStartX == -1)
-                        selStartX = pixelX;
-                    selEndX = pixelX;
-                    if (lineText.size() - 1 == x) {
-                        selEndX = s_lineWidth + s_pixelMargin - 1;
+            if (i % lineIncrement == 0) {
+                MiniMapTile::Line line;
+                line.line = realLineNumber;
+                line.text = kateline->string();
+                line.attributes = kateline->attributesList();
+                for (const Kate::TextLineData::Attribute &attribute : qAsConst(line.attributes)) {
+                    while (attributeColors.size() <= attribute.attributeValue) {
+                        attributeColors.append(m_view->renderer()->attribute(attributeColors.size())->foreground().color());
                     }
                 }
 
-                if (lineText[x] == QLatin1Char('\t')) {
-                    pixelX += qMax(4 / charIncrement, 1); // FIXME: tab width...
-                } else {
-                    pixelX++;
-                }
-            }
-
-            if (selStartX != -1) {
-                if (selectionBgColor != painter.pen().color()) {
-                    painter.setPen(selectionBgColor);
+                // If there's a different background color set (search markers, ...)
+                // use that, otherwise use the foreground color.
+                const QVector<QTextLayout::FormatRange> decorations = m_view->renderer()->decorationsForLine(kateline, realLineNumber);
+                for (const QTextLayout::FormatRange &range : decorations) {
+                    const QColor color = range.format.hasProperty(QTextFormat::BackgroundBrush) ? range.format.background().color()
+                                                                                                : range.format.foreground().color();
+                    line.decorations.append({range.start, range.length, color});
                 }
-                painter.drawLine(selStartX, pixelY, selEndX, pixelY);
+                miniMapTile->lines.append(line);
             }
 
-            // Iterate over all the characters in the current line
-            pixelX = s_pixelMargin;
-            for (int x = 0; (x < lineText.size() && x < s_lineWidth); x += charIncrement) {
-                if (pixelX >= s_lineWidth + s_pixelMargin) {
-                    break;
-                }
-
-                // draw the pixels
-                if (lineText[x] == QLatin1Char(' ')) {
-                    pixelX++;
-                } else if (lineText[x] == QLatin1Char('\t')) {
-                    pixelX += qMax(4 / charIncrement, 1); // FIXME: tab width...
+            // line modification markers, the last one of a row wins
+            if (kateline->markedAsModified() || kateline->markedAsSavedOnDisk()) {
+                const MiniMapTile::Marker marker{i / rowLines, kateline->markedAsModified()};
+                if (!miniMapTile->markers.isEmpty() && miniMapTile->markers.last().row == marker.row) {
+                    miniMapTile->markers.last() = marker;
                 } else {
-                    const QColor newPenColor(charColor(attributes, attributeIndex, decorations, defaultTextColor, x, lineText[x]));
-                    if (newPenColor != painter.pen().color()) {
-                        painter.setPen(newPenColor);
-                    }
-
-                    // Actually draw the pixel with the color queried from the renderer.
-                    painter.drawPoint(pixelX, pixelY);
-
-                    pixelX++;
-                }
-            }
-            drawnLines++;
-            if (((drawnLines) % charIncrement) == 0) {
-                pixelY++;
-            }
-        }
-        // qCDebug(LOG_KTE) << drawnLines;
-        // Draw line modification marker map.
-        // Disable this if the document is really huge,
-        // since it requires querying every line.
-        if (m_doc->lines() < 50000) {
-            for (int lineno = 0; lineno < docLineCount; lineno++) {
-                int realLineNo = m_view->textFolding().visibleLineToLine(lineno);
-                const Kate::TextLine &line = m_doc->plainKateTextLine(realLineNo);
-                const QColor &col = line->markedAsModified() ? modifiedLineColor : savedLineColor;
-                if (line->markedAsModified() || line->markedAsSavedOnDisk()) {
-                    int pos = (lineno * pixmapLineCount) / pixmapLinesUnscaled;
-                    painter.fillRect(2, pos, 3, 1, col);
+                    miniMapTile->markers.append(marker);
                 }
             }
         }
+        miniMapTile->attributeColors = attributeColors;
 
-        // end painting
-        painter.end();
+        QThreadPool::globalInstance()->start(miniMapTile);
     }
 
-    // set right ratio
-    m_pixmap.setDevicePixelRatio(m_view->devicePixelRatioF());
+    // Redraw the scrollbar widget with the resized pixmap.
+    update();
+}
+
+void KateScrollBar::miniMapTileRendered(int tile, quint64 generation, const QImage &image)
+{
+    // outdated meanwhile, it is rendered again anyway
+    if (tile >= m_miniMapTiles.size() || m_miniMapTiles.at(tile).generation != generation) {
+        return;
+    }
+
+    QPainter painter(&m_pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(0, tile * image.height(), image);
+    painter.end();
 
-    // qCDebug(LOG_KTE) << time.elapsed();
     // Redraw the scrollbar widget with the updated pixmap.
     update();
 }
@@ -976,7 +1234,10 @@ void KateScrollBar::recomputeMarksPositions()
     }
 
     // get total visible (=without folded) lines in the document
-    int visibleLines = m_view->textFolding().visibleLines() - 1;
+    // with dynamic word wrap the scroll bar counts view lines, the marks are placed like the slider
+    const bool byViewLines = m_viewInternal->lineScrollByViewLines();
+    KateLayoutCache *cache = m_viewInternal->cache();
+    int visibleLines = (byViewLines ? cache->documentViewLines() : m_view->textFolding().visibleLines()) - 1;
     if (m_view->config()->scrollPastEnd()) {
         visibleLines += m_viewInternal->linesDisplayed() - 1;
         visibleLines -= m_view->config()->autoCenterLines();
@@ -987,7 +1248,10 @@ void KateScrollBar::recomputeMarksPositions()
     const QHash<int, KTextEditor::Mark *> &marks = m_doc->marks();
     for (QHash<int, KTextEditor::Mark *>::const_iterator i = marks.constBegin(); i != marks.constEnd(); ++i) {
         KTextEditor::Mark *mark = i.value();
-        const int line = m_view->textFolding().lineToVisibleLine(mark->line);
+        int line = m_view->textFolding().lineToVisibleLine(mark->line);
+        if (byViewLines) {
+            line = cache->documentViewLine(KTextEditor::Cursor(line, 0));
+        }
         const double ratio = static_cast<double>(line) / visibleLines;
         m_lines.insert(top + (int)(h * ratio), KateRendererConfig::global()->lineMarkerColor((KTextEditor::MarkInterface::MarkTypes)mark->type));
     }
@@ -153,10 +153,16 @@ public:
         update();
     }
 
-    inline void queuePixmapUpdate()
-    {
-        m_updateTimer.start();
-    }
+    /**
+     * Render the whole mini map again, soon.
+     */
+    void queuePixmapUpdate();
+
+    /**
+     * Render the mini map tiles of the real lines \p startLine to \p endLine again, soon.
+     * \p endLine -1 tags all lines from \p startLine on.
+     */
+    void tagMiniMapLines(int startLine, int endLine);
 
 Q_SIGNALS:
     void sliderMMBMoved(int value);
@@ -180,6 +186,7 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void showTextPreview();
+    void updateMiniMapTiles();
 
 private:
     void showTextPreviewDelayed();
@@ -193,12 +200,8 @@ private:
 
     int minimapYToStdY(int y);
 
-    const QColor charColor(const QVector<Kate::TextLineData::Attribute> &attributes,
-                           int &attributeIndex,
-                           const QVector<QTextLayout::FormatRange> &decorations,
-                           const QColor &defaultColor,
-                           int x,
-                           QChar ch);
+    void invalidateMiniMap();
+    void miniMapTileRendered(int tile, quint64 generation, const QImage &image);
 
     bool m_middleMouseDown;
     bool m_leftMouseDown;
@@ -218,6 +221,24 @@ private:
     int m_miniMapWidth;
 
     QPixmap m_pixmap;
+
+    /**
+     * The mini map is rendered in tiles of some lines, on threads of the global thread pool,
+     * from snapshots of the lines. A tile is rendered again once its lines are tagged.
+     */
+    class MiniMapTile;
+    struct MiniMapTileState {
+        // changes whenever the tile gets outdated, older renderings of it are dropped
+        quint64 generation = 0;
+        bool dirty = true;
+    };
+    QVector<MiniMapTileState> m_miniMapTiles;
+    quint64 m_miniMapGeneration = 0;
+    int m_miniMapTileLines = 0;
+    int m_miniMapLineIncrement = 0;
+    int m_miniMapCharIncrement = 0;
+    QTimer m_miniMapTileTimer;
+
     int m_grooveHeight;
     QRect m_stdGroveRect;
     QRect m_mapGroveRect;
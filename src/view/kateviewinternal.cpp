@@ -181,10 +181,9 @@ KateViewInternal::KateViewInternal(KTextEditor::ViewPrivate *view)
     // Hijack the line scroller's controls, so we can scroll nicely for word-wrap
     connect(m_lineScroll, &KateScrollBar::actionTriggered, this, &KateViewInternal::scrollAction);
 
-    auto viewScrollLinesSlot = QOverload<int>::of(&KateViewInternal::scrollLines);
-    connect(m_lineScroll, &KateScrollBar::sliderMoved, this, viewScrollLinesSlot);
-    connect(m_lineScroll, &KateScrollBar::sliderMMBMoved, this, viewScrollLinesSlot);
-    connect(m_lineScroll, &KateScrollBar::valueChanged, this, viewScrollLinesSlot);
+    connect(m_lineScroll, &KateScrollBar::sliderMoved, this, &KateViewInternal::scrollToLineScrollValue);
+    connect(m_lineScroll, &KateScrollBar::sliderMMBMoved, this, &KateViewInternal::scrollToLineScrollValue);
+    connect(m_lineScroll, &KateScrollBar::valueChanged, this, &KateViewInternal::scrollToLineScrollValue);
 
     //
     // scrollbar for columns
@@ -399,6 +398,31 @@ void KateViewInternal::scrollLines(int line)
     scrollPos(newPos);
 }
 
+bool KateViewInternal::lineScrollByViewLines() const
+{
+    // the mini map draws the lines in line units
+    return view()->dynWordWrap() && !view()->config()->scrollBarMiniMap();
+}
+
+int KateViewInternal::lineScrollValue(const KTextEditor::Cursor &virtualCursor) const
+{
+    return lineScrollByViewLines() ? cache()->documentViewLine(virtualCursor) : virtualCursor.line();
+}
+
+/**
+ * Value is the line or, with dynamic word wrap, the view line of the document to scroll to.
+ */
+void KateViewInternal::scrollToLineScrollValue(int value)
+{
+    if (!lineScrollByViewLines()) {
+        scrollLines(value);
+        return;
+    }
+
+    KTextEditor::Cursor c = cache()->documentViewLineStart(value);
+    scrollPos(c);
+}
+
 // This can scroll less than one true line
 void KateViewInternal::scrollViewLines(int offset)
 {
@@ -406,7 +430,7 @@ void KateViewInternal::scrollViewLines(int offset)
     scrollPos(c);
 
     bool blocked = m_lineScroll->blockSignals(true);
-    m_lineScroll->setValue(startLine());
+    m_lineScroll->setValue(lineScrollValue(startPos()));
     m_lineScroll->blockSignals(blocked);
 }
 
@@ -574,7 +598,11 @@ void KateViewInternal::scrollColumns(int x)
     int dx = startX() - x;
     m_startX = x;
 
-    if (qAbs(dx) < width()) {
+    if (cache()->setStartX(x)) {
+        // very long lines are laid out around the visible columns only, they got new windows
+        updateView(true);
+        update();
+    } else if (qAbs(dx) < width()) {
         // scroll excluding child widgets (floating notifications)
         scroll(dx, 0, rect());
     } else {
@@ -623,12 +651,14 @@ void KateViewInternal::updateView(bool changed, int viewLinesScrolled)
 
     KTextEditor::Cursor maxStart = maxStartPos(changed);
     int maxLineScrollRange = maxStart.line();
-    if (view()->dynWordWrap() && maxStart.column() != 0) {
+    if (lineScrollByViewLines()) {
+        maxLineScrollRange = lineScrollValue(maxStart);
+    } else if (view()->dynWordWrap() && maxStart.column() != 0) {
         maxLineScrollRange++;
     }
     m_lineScroll->setRange(0, maxLineScrollRange);
 
-    m_lineScroll->setValue(startLine());
+    m_lineScroll->setValue(lineScrollValue(startPos()));
     m_lineScroll->setSingleStep(1);
     m_lineScroll->setPageStep(qMax(0, height()) / renderer()->lineHeight());
     m_lineScroll->blockSignals(blocked);
@@ -841,7 +871,7 @@ QPoint KateViewInternal::cursorToCoordinate(const KTextEditor::Cursor &cursor, b
 
     // only set x value if we have a valid layout (bug #171027)
     if (layout.isValid()) {
-        x = (int)layout.lineLayout().cursorToX(cursor.column());
+        x = (int)layout.cursorToX(cursor.column());
     }
     //  else
     //    qCDebug(LOG_KTE) << "Invalid Layout";
@@ -1061,7 +1091,7 @@ public:
                     }
 
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->nextCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->nextCursorPosition(column()));
                 }
             }
         } else {
@@ -1071,7 +1101,7 @@ public:
                 } else if (column() == 0) {
                     break;
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->previousCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->previousCursorPosition(column()));
                 }
             }
         }
@@ -1133,7 +1163,7 @@ public:
                     continue;
                 }
 
-                m_cursor.setColumn(thisLine->layout()->nextCursorPosition(column()));
+                m_cursor.setColumn(thisLine->nextCursorPosition(column()));
             }
 
         } else {
@@ -1163,7 +1193,7 @@ public:
                 if (column() > thisLine->length()) {
                     m_cursor.setColumn(column() - 1);
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->previousCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->previousCursorPosition(column()));
                 }
             }
         }
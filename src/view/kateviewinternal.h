@@ -146,7 +146,8 @@ public Q_SLOTS:
     void paintCursor();
 
 private Q_SLOTS:
-    void scrollLines(int line); // connected to the sliderMoved of the m_lineScroll
+    void scrollLines(int line);
+    void scrollToLineScrollValue(int value); // connected to the sliderMoved of the m_lineScroll
     void scrollViewLines(int offset);
     void scrollAction(int action);
     void scrollNextPage();
@@ -256,6 +257,12 @@ private:
     void scrollPos(KTextEditor::Cursor &c, bool force = false, bool calledExternally = false, bool emitSignals = true);
     void scrollLines(int lines, bool sel);
 
+    /**
+     * With dynamic word wrap the line scroll bar counts view lines, unless it shows the mini map.
+     */
+    bool lineScrollByViewLines() const;
+    int lineScrollValue(const KTextEditor::Cursor &virtualCursor) const;
+
     KTextEditor::Attribute::Ptr attributeAt(const KTextEditor::Cursor &position) const;
     int linesDisplayed() const;
 
@@ -9,6 +9,8 @@
 #include "../globalstate.h"
 #include "../history.h"
 #include "katedocument.h"
+#include "kateregexpsearch.h"
+#include "katesearchjob.h"
 #include "kateview.h"
 #include <vimode/inputmodemanager.h>
 #include <vimode/modes/modebase.h>
@@ -247,6 +249,8 @@ SearchMode::SearchMode(EmulatedCommandBar *emulatedCommandBar,
 {
 }
 
+SearchMode::~SearchMode() = default;
+
 void SearchMode::init(SearchMode::SearchDirection searchDirection)
 {
     m_searchDirection = searchDirection;
@@ -285,21 +289,99 @@ void SearchMode::editTextChanged(const QString &newText)
     m_currentSearchParams.isBackwards = searchBackwards;
     m_currentSearchParams.shouldPlaceCursorAtEndOfMatch = placeCursorAtEndOfMatch;
 
+    // a search still running for the pattern before is of no use anymore
+    m_searchJob.reset();
+
     // The "count" for the current search is not shared between Visual & Normal mode, so we need to pick
     // the right one to handle the counted search.
     int c = viInputModeManager()->getCurrentViModeHandler()->getCount();
+
+    // Large documents are searched in another thread, typing the pattern isn't blocked by it.
+    // Counted searches and multi-line patterns are searched like the search motion does.
+    KTextEditor::DocumentPrivate *doc = view()->doc();
+    if (c == 1 && doc->lines() >= KateSearchJob::IncrementalSearchLines) {
+        const KateRegExpSearch searcher(doc,
+                                        qtRegexPattern,
+                                        caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        if (searcher.isValid() && !searcher.isMultiLine()) {
+            if (searchBackwards) {
+                // the line of the cursor is searched right away, the lines before it by the job
+                const int line = m_startingCursorPos.line();
+                KateRegExpSearch::MatchIterator matches = searcher.matches(KTextEditor::Range(line, 0, line, doc->lineLength(line)), true);
+                for (QVector<KTextEditor::Range> match = matches.next(); !match.isEmpty(); match = matches.next()) {
+                    if (match.first().start() < m_startingCursorPos) {
+                        showIncrementalMatch(match.first());
+                        return;
+                    }
+                }
+            }
+            startIncrementalSearch(false);
+            return;
+        }
+    }
+
     KTextEditor::Range match = viInputModeManager()->searcher()->findPattern(m_currentSearchParams,
                                                                              m_startingCursorPos,
                                                                              c,
                                                                              false /* Don't add incremental searches to search history */);
+    showIncrementalMatch(match);
+}
+
+void SearchMode::startIncrementalSearch(bool wrap)
+{
+    KTextEditor::DocumentPrivate *doc = view()->doc();
+    KTextEditor::SearchOptions options = KTextEditor::Regex;
+    if (!m_currentSearchParams.isCaseSensitive) {
+        options |= KTextEditor::CaseInsensitive;
+    }
+    if (m_currentSearchParams.isBackwards) {
+        options |= KTextEditor::Backwards;
+    }
+
+    // the same ranges as the ones Searcher::findPatternWorker() searches
+    KTextEditor::Range range = doc->documentRange();
+    if (!wrap && !m_currentSearchParams.isBackwards) {
+        range.setStart(KTextEditor::Cursor(m_startingCursorPos.line(), m_startingCursorPos.column() + 1));
+    } else if (!wrap) {
+        const int line = m_startingCursorPos.line() - 1;
+        if (line < 0) {
+            startIncrementalSearch(true);
+            return;
+        }
+        range.setEnd(KTextEditor::Cursor(line, doc->lineLength(line)));
+    }
+
+    m_searchJob.reset(doc->searchTextAsync(range, m_currentSearchParams.pattern, options));
+    QObject::connect(m_searchJob.get(), &KateSearchJob::finished, m_searchJob.get(), [this, wrap]() {
+        // the job may not be deleted while it emits finished
+        KateSearchJob *job = m_searchJob.release();
+        job->deleteLater();
 
+        // canceled as the document got changed, cleared or reloaded
+        if (job->isCanceled()) {
+            return;
+        }
+
+        // the matches are at the revision the search started at, the document may have changed since
+        const QVector<KTextEditor::Range> matches = job->transformedRanges();
+        if (matches.isEmpty() && !wrap) {
+            // Wrap around.
+            startIncrementalSearch(true);
+            return;
+        }
+        showIncrementalMatch(matches.isEmpty() ? KTextEditor::Range::invalid() : matches.first());
+    });
+}
+
+void SearchMode::showIncrementalMatch(const KTextEditor::Range &match)
+{
     if (match.isValid()) {
         // The returned range ends one past the last character of the match, so adjust.
         KTextEditor::Cursor realMatchEnd = KTextEditor::Cursor(match.end().line(), match.end().column() - 1);
         if (realMatchEnd.column() == -1) {
             realMatchEnd = KTextEditor::Cursor(realMatchEnd.line() - 1, view()->doc()->lineLength(realMatchEnd.line() - 1));
         }
-        moveCursorTo(placeCursorAtEndOfMatch ? realMatchEnd : match.start());
+        moveCursorTo(m_currentSearchParams.shouldPlaceCursorAtEndOfMatch ? realMatchEnd : match.start());
         setBarBackground(SearchMode::MatchFound);
     } else {
         moveCursorTo(m_startingCursorPos);
@@ -315,6 +397,7 @@ void SearchMode::editTextChanged(const QString &newText)
 
 void SearchMode::deactivate(bool wasAborted)
 {
+    m_searchJob.reset();
     // "Deactivate" can be called multiple times between init()'s, so only reset the cursor once!
     if (m_startingCursorPos.isValid()) {
         if (wasAborted) {
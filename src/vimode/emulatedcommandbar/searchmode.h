@@ -17,6 +17,10 @@ class ViewPrivate;
 
 #include <KTextEditor/Cursor>
 
+#include <memory>
+
+class KateSearchJob;
+
 namespace KateVi
 {
 class EmulatedCommandBar;
@@ -33,9 +37,7 @@ public:
                InputModeManager *viInputModeManager,
                KTextEditor::ViewPrivate *view,
                QLineEdit *edit);
-    ~SearchMode() override
-    {
-    }
+    ~SearchMode() override;
     enum class SearchDirection { Forward, Backward };
     void init(SearchDirection);
     bool handleKeyPress(const QKeyEvent *keyEvent) override;
@@ -53,6 +55,9 @@ private:
     SearchDirection m_searchDirection;
     KTextEditor::Cursor m_startingCursorPos;
     KateVi::Searcher::SearchParams m_currentSearchParams;
+    std::unique_ptr<KateSearchJob> m_searchJob;
+    void startIncrementalSearch(bool wrap);
+    void showIncrementalMatch(const KTextEditor::Range &match);
     CompletionStartParams activateSearchHistoryCompletion();
     enum BarBackgroundStatus { Normal, MatchFound, NoMatchFound };
     void setBarBackground(BarBackgroundStatus status);
@@ -8,6 +8,7 @@
 #include "globalstate.h"
 #include "history.h"
 #include "katedocument.h"
+#include "kateregexpsearch.h"
 #include "kateview.h"
 #include "ktexteditor/range.h"
 #include <vimode/inputmodemanager.h>
@@ -115,32 +116,26 @@ KTextEditor::Range Searcher::findPattern(const SearchParams &searchParams, const
 KTextEditor::Range Searcher::findPatternWorker(const SearchParams &searchParams, const KTextEditor::Cursor &startFrom, int count) const
 {
     KTextEditor::Cursor searchBegin = startFrom;
-    KTextEditor::SearchOptions flags = KTextEditor::Regex;
 
-    const QString &pattern = searchParams.pattern;
-
-    if (searchParams.isBackwards) {
-        flags |= KTextEditor::Backwards;
-    }
+    // the pattern is compiled once for all searches below
+    QRegularExpression::PatternOptions options;
     if (!searchParams.isCaseSensitive) {
-        flags |= KTextEditor::CaseInsensitive;
+        options |= QRegularExpression::CaseInsensitiveOption;
     }
+    const KateRegExpSearch searcher(m_view->doc(), searchParams.pattern, options);
+    const KTextEditor::Range documentRange = m_view->doc()->documentRange();
+
     KTextEditor::Range finalMatch;
     for (int i = 0; i < count; i++) {
         if (!searchParams.isBackwards) {
             const KTextEditor::Range matchRange =
-                m_view->doc()
-                    ->searchText(KTextEditor::Range(KTextEditor::Cursor(searchBegin.line(), searchBegin.column() + 1), m_view->doc()->documentEnd()),
-                                 pattern,
-                                 flags)
-                    .first();
+                searcher.search(KTextEditor::Range(KTextEditor::Cursor(searchBegin.line(), searchBegin.column() + 1), documentRange.end())).first();
 
             if (matchRange.isValid()) {
                 finalMatch = matchRange;
             } else {
                 // Wrap around.
-                const KTextEditor::Range wrappedMatchRange =
-                    m_view->doc()->searchText(KTextEditor::Range(m_view->doc()->documentRange().start(), m_view->doc()->documentEnd()), pattern, flags).first();
+                const KTextEditor::Range wrappedMatchRange = searcher.search(documentRange).first();
                 if (wrappedMatchRange.isValid()) {
                     finalMatch = wrappedMatchRange;
                 } else {
@@ -150,51 +145,22 @@ KTextEditor::Range Searcher::findPatternWorker(const SearchParams &searchParams,
         } else {
             // Ok - this is trickier: we can't search in the range from doc start to searchBegin, because
             // the match might extend *beyond* searchBegin.
-            // We could search through the entire document and then filter out only those matches that are
-            // after searchBegin, but it's more efficient to instead search from the start of the
-            // document until the beginning of the line after searchBegin, and then filter.
-            // Unfortunately, searchText doesn't necessarily turn up all matches (just the first one, sometimes)
-            // so we must repeatedly search in such a way that the previous match isn't found, until we either
-            // find no matches at all, or the first match that is before searchBegin.
-            KTextEditor::Cursor newSearchBegin = KTextEditor::Cursor(searchBegin.line(), m_view->doc()->lineLength(searchBegin.line()));
-            KTextEditor::Range bestMatch = KTextEditor::Range::invalid();
-            while (true) {
-                QVector<KTextEditor::Range> matchesUnfiltered =
-                    m_view->doc()->searchText(KTextEditor::Range(newSearchBegin, m_view->doc()->documentRange().start()), pattern, flags);
-
-                if (matchesUnfiltered.size() == 1 && !matchesUnfiltered.first().isValid()) {
+            // Instead we go backwards over the matches from the start of the document until the end of
+            // the line of searchBegin, the first one that starts before searchBegin is the one we want.
+            const KTextEditor::Cursor lineEnd(searchBegin.line(), m_view->doc()->lineLength(searchBegin.line()));
+            KateRegExpSearch::MatchIterator matches = searcher.matches(KTextEditor::Range(documentRange.start(), lineEnd), true);
+            KTextEditor::Range matchRange = KTextEditor::Range::invalid();
+            for (QVector<KTextEditor::Range> match = matches.next(); !match.isEmpty(); match = matches.next()) {
+                if (match.first().start() < searchBegin) {
+                    matchRange = match.first();
                     break;
                 }
-
-                // After sorting, the last element in matchesUnfiltered is the last match position.
-                std::sort(matchesUnfiltered.begin(), matchesUnfiltered.end());
-
-                QVector<KTextEditor::Range> filteredMatches;
-                for (KTextEditor::Range unfilteredMatch : qAsConst(matchesUnfiltered)) {
-                    if (unfilteredMatch.start() < searchBegin) {
-                        filteredMatches.append(unfilteredMatch);
-                    }
-                }
-                if (!filteredMatches.isEmpty()) {
-                    // Want the latest matching range that is before searchBegin.
-                    bestMatch = filteredMatches.last();
-                    break;
-                }
-
-                // We found some unfiltered matches, but none were suitable. In case matchesUnfiltered wasn't
-                // all matching elements, search again, starting from before the earliest matching range.
-                if (filteredMatches.isEmpty()) {
-                    newSearchBegin = matchesUnfiltered.first().start();
-                }
             }
 
-            KTextEditor::Range matchRange = bestMatch;
-
             if (matchRange.isValid()) {
                 finalMatch = matchRange;
             } else {
-                const KTextEditor::Range wrappedMatchRange =
-                    m_view->doc()->searchText(KTextEditor::Range(m_view->doc()->documentEnd(), m_view->doc()->documentRange().start()), pattern, flags).first();
+                const KTextEditor::Range wrappedMatchRange = searcher.search(documentRange, true).first();
 
                 if (wrappedMatchRange.isValid()) {
                     finalMatch = wrappedMatchRange;